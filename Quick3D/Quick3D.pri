@@ -8,7 +8,13 @@ HEADERS += \
     Source/Mesh/*.h \
     Source/Render/*.h \
     Source/Terrain/*.h \
-    Source/Utils/*.h
+    Source/Utils/*.h \
+    Source/Zip/*.h \
+    ../COTS/unzip11/crypt.h \
+    ../COTS/unzip11/ioapi.h \
+    ../COTS/unzip11/mztools.h \
+    ../COTS/unzip11/unzip.h \
+    ../COTS/unzip11/zip.h
 
 SOURCES += \
     Source/Animation/*.cpp \
@@ -19,14 +25,18 @@ SOURCES += \
     Source/Mesh/*.cpp \
     Source/Render/*.cpp \
     Source/Terrain/*.cpp \
-    Source/Utils/*.cpp
+    Source/Utils/*.cpp \
+    Source/Zip/*.cpp \
+    ../COTS/unzip11/ioapi.c \
+    ../COTS/unzip11/mztools.c \
+    ../COTS/unzip11/unzip.c \
+    ../COTS/unzip11/zip.c
 
 RESOURCES += \
     Quick3DShaders.qrc
 
 win32 {
     HEADERS += \
-        Source/Zip/*.h \
         ../COTS/zlib/crc32.h \
         ../COTS/zlib/deflate.h \
         ../COTS/zlib/gzguts.h \
@@ -38,12 +48,7 @@ win32 {
         ../COTS/zlib/zconf.h \
         ../COTS/zlib/zlib.h \
         ../COTS/zlib/zutil.h \
-        ../COTS/unzip11/crypt.h \
-        ../COTS/unzip11/ioapi.h \
         ../COTS/unzip11/iowin32.h \
-        ../COTS/unzip11/mztools.h \
-        ../COTS/unzip11/unzip.h \
-        ../COTS/unzip11/zip.h \
         ../COTS/SFML-1.6/src/SFML/Window/GlContext.hpp \
         ../COTS/SFML-1.6/src/SFML/Window/InputImpl.hpp \
         ../COTS/SFML-1.6/src/SFML/Window/JoystickImpl.hpp \
@@ -61,7 +66,6 @@ win32 {
         ../COTS/SFML-1.6/src/SFML/System/Win32/ThreadLocalImpl.hpp
 
     SOURCES += \
-        Source/Zip/*.cpp \
         ../COTS/zlib/adler32.c \
         ../COTS/zlib/compress.c \
         ../COTS/zlib/crc32.c \
@@ -77,11 +81,7 @@ win32 {
         ../COTS/zlib/trees.c \
         ../COTS/zlib/uncompr.c \
         ../COTS/zlib/zutil.c \
-        ../COTS/unzip11/ioapi.c \
         ../COTS/unzip11/iowin32.c \
-        ../COTS/unzip11/mztools.c \
-        ../COTS/unzip11/unzip.c \
-        ../COTS/unzip11/zip.c \
         ../COTS/SFML-1.6/src/SFML/System/Clock.cpp \
         ../COTS/SFML-1.6/src/SFML/System/Err.cpp \
         ../COTS/SFML-1.6/src/SFML/System/Lock.cpp \
@@ -5,7 +5,7 @@ win32 {
     QT += core gui network opengl xml
 }
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
 
 TEMPLATE = lib
 DEFINES += QUICK3D_LIB
@@ -37,6 +37,9 @@ INCLUDEPATH += $$PWD/Source/Zip
 
 win32 {
     LIBS += -lopengl32 -luser32 -lgdi32 -lwinmm
+} else {
+    # zlib is bundled in COTS for Windows only, unzip11 uses the system one elsewhere
+    LIBS += -lz
 }
 
 # Directories
@@ -51,6 +54,12 @@ QMAKE_CXXFLAGS += -Wno-invalid-offsetof
 QMAKE_CXXFLAGS += -Wno-unused-parameter
 QMAKE_CXXFLAGS += -Wno-reorder
 
+# Vectorized kernels (CWGS84), enabled with CONFIG+=avx2
+avx2 {
+    win32-msvc*: QMAKE_CXXFLAGS += /arch:AVX2
+    else: QMAKE_CXXFLAGS += -mavx2 -mfma
+}
+
 # Target
 CONFIG(debug, debug|release) {
     TARGET = Quick3Dd
@@ -25,6 +25,8 @@ uniform mat4			u_camera_matrix;
 uniform mat4			u_shadow_projection_matrix;
 uniform mat4			u_shadow_matrix;
 uniform mat4			u_model_matrix;
+uniform int				u_instanced;
+uniform mat4			u_instance_base_matrix;
 uniform vec3			u_camera_true_position;
 uniform vec3			u_camera_position;
 uniform vec3			u_camera_direction;
@@ -109,12 +111,28 @@ varying float           v_difftex_weight_7;
 
 attribute vec3          a_position;
 attribute vec3          a_texcoord;
-attribute vec3          a_normal;
+attribute vec2          a_normal;      // Octahedral encoding
 attribute vec3          a_difftext_weight_0_1_2;
 attribute vec3          a_difftext_weight_3_4_5;
 attribute vec3          a_difftext_weight_6_7_8;
-attribute vec3          a_tangent;
+attribute vec2          a_tangent;     // Octahedral encoding
 attribute float         a_altitude;
+attribute mat4          a_instance_matrix;      // Per instance, read when u_instanced is set
+
+//-------------------------------------------------------------------------------------------------
+// Unpacks a direction stored on an unfolded octahedron
+
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 v = vec3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+
+    if (v.z < 0.0)
+    {
+        v.xy = (vec2(1.0, 1.0) - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+    }
+
+    return normalize(v);
+}
 
 //-------------------------------------------------------------------------------------------------
 
@@ -202,9 +220,17 @@ float waveHeight(vec3 input_position)
 
 void main()
 {
-    vec4 vertex_pos = u_model_matrix * vec4(a_position, 1.0);
-    vec4 normal = u_model_matrix * vec4(a_normal, 0.0);
-    vec4 tangent = u_model_matrix * vec4(a_tangent, 0.0);
+    mat4 model_matrix = u_model_matrix;
+
+    // Instances are placed relative to a common base
+    if (bool(u_instanced))
+    {
+        model_matrix = u_instance_base_matrix * a_instance_matrix * u_model_matrix;
+    }
+
+    vec4 vertex_pos = model_matrix * vec4(a_position, 1.0);
+    vec4 normal = model_matrix * vec4(decodeOctahedral(a_normal), 0.0);
+    vec4 tangent = model_matrix * vec4(decodeOctahedral(a_tangent), 0.0);
     vec3 binormal = normalize(cross(normal.xyz, tangent.xyz));
     vec4 shadow_coord = u_shadow_projection_matrix * (u_shadow_matrix * vertex_pos);
     mat4 vp = u_camera_projection_matrix * u_camera_matrix;
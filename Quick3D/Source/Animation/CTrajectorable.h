@@ -71,6 +71,9 @@ public:
     //!
     virtual bool isTrajectorable() const { return true; }
 
+    //! Vehicles only touch their own hierarchy, height fields and declared dependencies during update
+    virtual bool isUpdateThreadSafe() const Q_DECL_OVERRIDE { return true; }
+
     //-------------------------------------------------------------------------------------------------
     // Control methods
     //-------------------------------------------------------------------------------------------------
@@ -0,0 +1,208 @@
+
+// Qt
+#include <QtConcurrent>
+
+// Application
+#include "CCollisionBroadphase.h"
+
+//-------------------------------------------------------------------------------------------------
+
+using namespace Math;
+
+//-------------------------------------------------------------------------------------------------
+
+// Below this number of pairs, the narrowphase is not worth dispatching to threads
+#define PARALLEL_NARROWPHASE_PAIRS  256
+
+//-------------------------------------------------------------------------------------------------
+
+// Orders proxy indices by the start of their interval on one axis
+class CProxyStartLessThan
+{
+public:
+
+    CProxyStartLessThan(const QVector<CCollisionProxy>& vProxies, int iAxis)
+        : m_vProxies(vProxies)
+        , m_iAxis(iAxis)
+    {
+    }
+
+    bool operator()(int iFirst, int iSecond) const
+    {
+        return
+                m_vProxies[iFirst].m_vPosition[m_iAxis] - m_vProxies[iFirst].m_dRadius <
+                m_vProxies[iSecond].m_vPosition[m_iAxis] - m_vProxies[iSecond].m_dRadius;
+    }
+
+protected:
+
+    const QVector<CCollisionProxy>& m_vProxies;
+    int m_iAxis;
+};
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    \class CCollisionBroadphase
+    \brief Finds the pairs of physical components that may collide.
+    \inmodule Quick3D
+    \sa CPhysicalComponent::computeCollisions()
+
+    Each component is given once per frame as a proxy holding its geocentric position and bounding radius. \br
+    computePairs() sorts the proxies along the axis on which they spread the most and sweeps them,
+    so that only components with overlapping intervals are paired. Pairs of static components are skipped. \br
+    computeHits() then tests the bounding spheres of the pairs.
+*/
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Constructs a CCollisionBroadphase.
+*/
+CCollisionBroadphase::CCollisionBroadphase()
+{
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Destroys a CCollisionBroadphase.
+*/
+CCollisionBroadphase::~CCollisionBroadphase()
+{
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Removes all proxies and pairs. Allocated memory is kept for the next frame.
+*/
+void CCollisionBroadphase::clear()
+{
+    m_vProxies.resize(0);
+    m_vPairs.resize(0);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Adds \a tProxy to the broadphase.
+*/
+void CCollisionBroadphase::addProxy(const CCollisionProxy& tProxy)
+{
+    m_vProxies.append(tProxy);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Fills the pair list with the proxies whose intervals overlap on the axis of greatest spread. \br\br
+    A pair is made only if at least one of its proxies is moving.
+*/
+void CCollisionBroadphase::computePairs()
+{
+    m_vPairs.resize(0);
+
+    int iCount = m_vProxies.count();
+
+    if (iCount < 2)
+    {
+        return;
+    }
+
+    // Choose the axis of greatest variance
+    CVector3 vSum;
+    CVector3 vSquareSum;
+
+    foreach (const CCollisionProxy& tProxy, m_vProxies)
+    {
+        vSum += tProxy.m_vPosition;
+        vSquareSum += CVector3(
+                    tProxy.m_vPosition.X * tProxy.m_vPosition.X,
+                    tProxy.m_vPosition.Y * tProxy.m_vPosition.Y,
+                    tProxy.m_vPosition.Z * tProxy.m_vPosition.Z
+                    );
+    }
+
+    int iAxis = 0;
+    double dBestVariance = -1.0;
+
+    for (int iIndex = 0; iIndex < 3; iIndex++)
+    {
+        double dMean = vSum[iIndex] / (double) iCount;
+        double dVariance = vSquareSum[iIndex] / (double) iCount - dMean * dMean;
+
+        if (dVariance > dBestVariance)
+        {
+            dBestVariance = dVariance;
+            iAxis = iIndex;
+        }
+    }
+
+    // Sort interval starts
+    m_vSorted.resize(iCount);
+
+    for (int iIndex = 0; iIndex < iCount; iIndex++)
+    {
+        m_vSorted[iIndex] = iIndex;
+    }
+
+    qSort(m_vSorted.begin(), m_vSorted.end(), CProxyStartLessThan(m_vProxies, iAxis));
+
+    // Sweep, keeping the proxies whose interval is still open
+    QVector<int> vActive;
+
+    foreach (int iCurrent, m_vSorted)
+    {
+        const CCollisionProxy& tCurrent = m_vProxies[iCurrent];
+        double dStart = tCurrent.m_vPosition[iAxis] - tCurrent.m_dRadius;
+
+        for (int iActive = vActive.count() - 1; iActive >= 0; iActive--)
+        {
+            const CCollisionProxy& tOther = m_vProxies[vActive[iActive]];
+
+            if (tOther.m_vPosition[iAxis] + tOther.m_dRadius < dStart)
+            {
+                vActive[iActive] = vActive.last();
+                vActive.removeLast();
+            }
+            else if (tCurrent.m_bMoving || tOther.m_bMoving)
+            {
+                m_vPairs.append(CCollisionPair(qMin(iCurrent, vActive[iActive]), qMax(iCurrent, vActive[iActive])));
+            }
+        }
+
+        vActive.append(iCurrent);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Sets the hit flag of each pair whose bounding spheres intersect. \br\br
+    Pairs are tested on the global thread pool when there are enough of them.
+*/
+void CCollisionBroadphase::computeHits()
+{
+    const QVector<CCollisionProxy>& vProxies = m_vProxies;
+
+    auto testPair = [&vProxies](CCollisionPair& tPair)
+    {
+        const CCollisionProxy& tFirst = vProxies[tPair.m_iFirst];
+        const CCollisionProxy& tSecond = vProxies[tPair.m_iSecond];
+
+        tPair.m_bHit = (tFirst.m_vPosition - tSecond.m_vPosition).magnitude() < tFirst.m_dRadius + tSecond.m_dRadius;
+    };
+
+    if (m_vPairs.count() >= PARALLEL_NARROWPHASE_PAIRS)
+    {
+        QtConcurrent::blockingMap(m_vPairs, testPair);
+    }
+    else
+    {
+        for (int iIndex = 0; iIndex < m_vPairs.count(); iIndex++)
+        {
+            testPair(m_vPairs[iIndex]);
+        }
+    }
+}
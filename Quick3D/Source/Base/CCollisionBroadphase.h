@@ -0,0 +1,127 @@
+
+#pragma once
+
+// Qt
+#include <QVector>
+
+// Application
+#include "quick3d_global.h"
+#include "CQ3DConstants.h"
+#include "CVector3.h"
+
+//-------------------------------------------------------------------------------------------------
+// Forward declarations
+
+class CPhysicalComponent;
+
+//-------------------------------------------------------------------------------------------------
+
+//! A collision candidate, as seen by the broadphase
+class QUICK3D_EXPORT CCollisionProxy
+{
+public:
+
+    //! Default constructor
+    CCollisionProxy()
+        : m_pComponent(nullptr)
+        , m_dRadius(0.0)
+        , m_bMoving(false)
+    {
+    }
+
+    //! Constructor with parameters
+    CCollisionProxy(CPhysicalComponent* pComponent, Math::CVector3 vPosition, double dRadius, bool bMoving)
+        : m_pComponent(pComponent)
+        , m_vPosition(vPosition)
+        , m_dRadius(dRadius)
+        , m_bMoving(bMoving)
+    {
+    }
+
+    CPhysicalComponent*     m_pComponent;
+    Math::CVector3          m_vPosition;        // Geocentric position, computed once per frame
+    double                  m_dRadius;          // Bounding sphere radius
+    bool                    m_bMoving;          // Has a non null velocity
+};
+
+//-------------------------------------------------------------------------------------------------
+
+//! A pair of proxies whose bounding spheres may intersect
+class QUICK3D_EXPORT CCollisionPair
+{
+public:
+
+    //! Default constructor
+    CCollisionPair()
+        : m_iFirst(0)
+        , m_iSecond(0)
+        , m_bHit(false)
+    {
+    }
+
+    //! Constructor with parameters
+    CCollisionPair(int iFirst, int iSecond)
+        : m_iFirst(iFirst)
+        , m_iSecond(iSecond)
+        , m_bHit(false)
+    {
+    }
+
+    int     m_iFirst;       // Index of the first proxy
+    int     m_iSecond;      // Index of the second proxy
+    bool    m_bHit;         // Set by the narrowphase
+};
+
+//-------------------------------------------------------------------------------------------------
+
+//! Sweep and prune broadphase over the geocentric positions of collidable components
+class QUICK3D_EXPORT CCollisionBroadphase
+{
+public:
+
+    //-------------------------------------------------------------------------------------------------
+    // Constructors and destructor
+    //-------------------------------------------------------------------------------------------------
+
+    //!
+    CCollisionBroadphase();
+
+    //!
+    virtual ~CCollisionBroadphase();
+
+    //-------------------------------------------------------------------------------------------------
+    // Getters
+    //-------------------------------------------------------------------------------------------------
+
+    //! Returns the proxies
+    const QVector<CCollisionProxy>& proxies() const { return m_vProxies; }
+
+    //! Returns the candidate pairs found by computePairs()
+    QVector<CCollisionPair>& pairs() { return m_vPairs; }
+
+    //-------------------------------------------------------------------------------------------------
+    // Control methods
+    //-------------------------------------------------------------------------------------------------
+
+    //! Removes all proxies and pairs
+    void clear();
+
+    //! Adds a proxy
+    void addProxy(const CCollisionProxy& tProxy);
+
+    //! Finds the pairs whose bounding intervals overlap on the axis of greatest spread, at least one proxy moving
+    void computePairs();
+
+    //! Tests the bounding spheres of all pairs, in parallel when there are many
+    void computeHits();
+
+    //-------------------------------------------------------------------------------------------------
+    // Properties
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    QVector<CCollisionProxy>    m_vProxies;
+    QVector<CCollisionPair>     m_vPairs;
+    QVector<int>                m_vSorted;      // Proxy indices sorted by interval start
+};
@@ -41,7 +41,11 @@ IMPLEMENT_MEMORY_MONITORED(CComponent, "CComponent")
 //-------------------------------------------------------------------------------------------------
 // Properties statiques
 
-int CComponent::m_iNumComponents = 0;
+QAtomicInt CComponent::m_iNumComponents(0);
+
+QAtomicInt CComponent::m_iUpdateDependencyRevision(0);
+
+QMutex CComponent::m_mComponentCounterMutex;
 
 QMap<QString, int> CComponent::m_mComponentCounter;
 
@@ -81,6 +85,12 @@ CComponent::CComponent(C3DScene* pScene)
     , m_bRaytracable(true)
     , m_bInheritTransform(true)
     , m_bSelected(false)
+    , m_uiTransformVersion(0)
+    , m_uiParentTransformVersion(0)
+    , m_bInterpolated(false)
+    , m_bTransformDirty(true)
+    , m_bTransformRoot(true)
+    , m_bRigidTransform(true)
     , m_dStatus(1.0)
 {
     Q_UNUSED(pScene);
@@ -89,7 +99,7 @@ CComponent::CComponent(C3DScene* pScene)
     LOG_METHOD_DEBUG(QString::number(qulonglong(this), 16));
 #endif
 
-    m_iNumComponents++;
+    m_iNumComponents.ref();
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -103,7 +113,7 @@ CComponent::~CComponent()
     LOG_METHOD_DEBUG(QString::number(qulonglong(this), 16));
 #endif
 
-    m_iNumComponents--;
+    m_iNumComponents.deref();
 
     foreach (QSP<CComponent> pChild, m_vChildren)
     {
@@ -198,6 +208,7 @@ void CComponent::setParent(QSP<CComponent> pParent)
     // Assignation du nom de parent et du parent
     m_sParentName = pParent->m_sName;
     m_pParent = pParent;
+    m_bTransformDirty = true;
 
     if (m_bInheritTransform && m_pParent)
     {
@@ -221,6 +232,22 @@ void CComponent::solveLinks(C3DScene* pScene)
 
 //-------------------------------------------------------------------------------------------------
 
+/*!
+    Declares that this component reads or writes \a pComponent during update(). \br\br
+    C3DScene::stepScene() updates root objects concurrently, except those linked by such dependencies,
+    which are updated by the same task in scene order. Links solved by CComponentReference are declared automatically.
+*/
+void CComponent::addUpdateDependency(QSP<CComponent> pComponent)
+{
+    if (pComponent != nullptr && pComponent.data() != this && m_vUpdateDependencies.contains(pComponent) == false)
+    {
+        m_vUpdateDependencies.append(pComponent);
+        m_iUpdateDependencyRevision.ref();
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
 /*!
     Clears the links in this component and its children. \br\br
     \a pScene is the scene containing this component.
@@ -232,9 +259,16 @@ void CComponent::clearLinks(C3DScene* pScene)
         pChild->clearLinks(pScene);
     }
 
+    if (m_vUpdateDependencies.count() > 0)
+    {
+        m_vUpdateDependencies.clear();
+        m_iUpdateDependencyRevision.ref();
+    }
+
     m_vChildren.clear();
     m_sParentName.clear();
     m_pParent.reset();
+    m_bTransformDirty = true;
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -384,6 +418,8 @@ void CComponent::setGeoloc(CGeoloc gGeoloc)
     {
         m_vECEFRotation = m_vRotation;
     }
+
+    m_bTransformDirty = true;
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -411,6 +447,8 @@ void CComponent::setPosition(CVector3 vPosition)
     {
         m_vECEFRotation = m_vRotation;
     }
+
+    m_bTransformDirty = true;
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -438,6 +476,8 @@ void CComponent::setRotation(CVector3 vRotation)
     {
         m_vECEFRotation = m_vRotation;
     }
+
+    m_bTransformDirty = true;
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -458,6 +498,7 @@ void CComponent::setScale(CVector3 vScale)
 void CComponent::setAnimPosition(CVector3 vPosition)
 {
     m_vAnimPosition = vPosition;
+    m_bTransformDirty = true;
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -483,6 +524,8 @@ void CComponent::setAnimRotation(CVector3 vRotation)
     if (m_vAnimRotation.X > m_vRotationMaximum.X) m_vAnimRotation.X = m_vRotationMaximum.X;
     if (m_vAnimRotation.Y > m_vRotationMaximum.Y) m_vAnimRotation.Y = m_vRotationMaximum.Y;
     if (m_vAnimRotation.Z > m_vRotationMaximum.Z) m_vAnimRotation.Z = m_vRotationMaximum.Z;
+
+    m_bTransformDirty = true;
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -500,6 +543,7 @@ void CComponent::setAnimScale(CVector3 vScale)
 /*!
     Sets the world transform of this component to \a value. \br\br
     This should not be called directly as it is computed from position, rotation and scale properties.
+    The next computeWorldTransform() rebuilds it from these properties.
 */
 void CComponent::setWorldTransform(const Math::CMatrix4& value)
 {
@@ -507,6 +551,11 @@ void CComponent::setWorldTransform(const Math::CMatrix4& value)
 
     m_mWorldTransform = value;
     m_mWorldTransformInverse = m_mWorldTransform.inverse();
+
+    // The matrix may hold a scale, children use the general inverse until it is rebuilt
+    m_bRigidTransform = false;
+    m_bTransformDirty = true;
+    m_uiTransformVersion++;
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -517,6 +566,7 @@ void CComponent::setWorldTransform(const Math::CMatrix4& value)
 void CComponent::setInheritTransform(bool bValue)
 {
     m_bInheritTransform = bValue;
+    m_bTransformDirty = true;
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -576,6 +626,9 @@ CComponent& CComponent::operator = (const CComponent& target)
     m_mWorldTransformInverse    = target.m_mWorldTransformInverse;
     m_bVisible                  = target.m_bVisible;
     m_bInheritTransform         = target.m_bInheritTransform;
+    m_bRigidTransform           = target.m_bRigidTransform;
+    m_bTransformDirty           = true;
+    m_uiTransformVersion++;
 
     return *this;
 }
@@ -979,55 +1032,127 @@ void CComponent::loadTransform()
         m_vECEFRotation = m_vRotation;
     }
 
+    m_bTransformDirty = true;
+
     computeWorldTransform();
 }
 
 //-------------------------------------------------------------------------------------------------
 
 /*!
-    Computes the world transform matrix of the component, taking into account parent transform.
+    Computes the world transform matrix of the component, taking into account parent transform. \br\br
+    Nothing is done unless position, rotation, parenting or the parent's world transform changed since the last call,
+    so static components cost a few comparisons per step.
+    The inverse is obtained by transposition, since the transform is made of rotations and translations only.
 */
 void CComponent::computeWorldTransform()
 {
-    CMatrix4 mRotation;
-    CMatrix4 mAnimRotation;
-    CMatrix4 mPosition;
-    CMatrix4 mAnimPosition;
+    bool bRoot = isRootObject();
+    bool bInheritParent = (m_pParent && m_bInheritTransform);
 
-    // Create the original rotation matrix
-    mRotation = CMatrix4::makeRotation(m_vECEFRotation);
+    if (
+            m_bTransformDirty == false &&
+            m_bTransformRoot == bRoot &&
+            (bInheritParent == false || m_pParent->m_uiTransformVersion == m_uiParentTransformVersion)
+            )
+    {
+        return;
+    }
 
-    // Create the animated rotation matrix
-    mAnimRotation = CMatrix4::makeRotation(m_vAnimRotation);
+    // Animated rotation, then original rotation
+    CMatrix4 mLocal = CMatrix4::makeRotation(m_vAnimRotation) * CMatrix4::makeRotation(m_vECEFRotation);
 
-    // Create the original position matrix
-    mPosition = CMatrix4::makeTranslation(m_vPosition);
+    // Animated position, then original position, then geocentric position if the object is placed on earth
+    CVector3 vTranslation = m_vAnimPosition + m_vPosition;
+
+    if (bRoot || m_bInheritTransform == false)
+    {
+        vTranslation = vTranslation + m_gGeoloc.toVector3();
+    }
+
+    mLocal.Data[3][0] = vTranslation.X;
+    mLocal.Data[3][1] = vTranslation.Y;
+    mLocal.Data[3][2] = vTranslation.Z;
+
+    if (bInheritParent)
+    {
+        m_mWorldTransform = mLocal * m_pParent->m_mWorldTransform;
+        m_uiParentTransformVersion = m_pParent->m_uiTransformVersion;
+        m_bRigidTransform = m_pParent->m_bRigidTransform;
+    }
+    else
+    {
+        m_mWorldTransform = mLocal;
+        m_bRigidTransform = true;
+    }
 
-    // Create the animated position matrix
-    mAnimPosition = CMatrix4::makeTranslation(m_vAnimPosition);
+    // Compute the inverse of the transfom matrix
+    m_mWorldTransformInverse = m_bRigidTransform ? m_mWorldTransform.inverseRigid() : m_mWorldTransform.inverse();
 
-    // Apply the transform matrices to m_mWorldTransform
-    m_mWorldTransform.makeIdentity();
+    m_bTransformDirty = false;
+    m_bTransformRoot = bRoot;
+    m_uiTransformVersion++;
+}
 
-    m_mWorldTransform = m_mWorldTransform * mAnimRotation;
-    m_mWorldTransform = m_mWorldTransform * mRotation;
-    m_mWorldTransform = m_mWorldTransform * mAnimPosition;
-    m_mWorldTransform = m_mWorldTransform * mPosition;
+//-------------------------------------------------------------------------------------------------
 
-    if (isRootObject() || m_bInheritTransform == false)
+/*!
+    Keeps the world transform as the previous one, for this component and its children. \br\br
+    Called by the scene at the start of each simulation step.
+*/
+void CComponent::savePreviousWorldTransform()
+{
+    m_mPreviousWorldTransform = m_mWorldTransform;
+
+    foreach (QSP<CComponent> pChild, m_vChildren)
+    {
+        pChild->savePreviousWorldTransform();
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Replaces the world transform of this component and its children by the one at \a dFactor
+    between the previous and the current transforms, so that rendering between two simulation steps is smooth. \br\br
+    restoreWorldTransform() must be called before the next simulation step.
+*/
+void CComponent::interpolateWorldTransform(double dFactor)
+{
+    // Components that were never stepped have no previous transform
+    if (m_bInterpolated == false && m_mPreviousWorldTransform.isIdentity() == false && dFactor < 1.0)
     {
-        CVector3 vPosition = m_gGeoloc.toVector3();
-        mAnimPosition = CMatrix4::makeTranslation(vPosition);
-        m_mWorldTransform = m_mWorldTransform * mAnimPosition;
+        m_mSimulatedWorldTransform = m_mWorldTransform;
+        m_mSimulatedWorldTransformInverse = m_mWorldTransformInverse;
+        m_mWorldTransform = CMatrix4::interpolate(m_mPreviousWorldTransform, m_mSimulatedWorldTransform, dFactor);
+        m_mWorldTransformInverse = m_mWorldTransform.inverse();
+        m_bInterpolated = true;
     }
 
-    if (m_pParent && m_bInheritTransform)
+    foreach (QSP<CComponent> pChild, m_vChildren)
     {
-        m_mWorldTransform = m_mWorldTransform * m_pParent->m_mWorldTransform;
+        pChild->interpolateWorldTransform(dFactor);
     }
+}
 
-    // Compute the inverse of the transfom matrix
-    m_mWorldTransformInverse = m_mWorldTransform.inverse();
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Puts back the world transform of this component and its children, replaced by interpolateWorldTransform().
+*/
+void CComponent::restoreWorldTransform()
+{
+    if (m_bInterpolated)
+    {
+        m_mWorldTransform = m_mSimulatedWorldTransform;
+        m_mWorldTransformInverse = m_mSimulatedWorldTransformInverse;
+        m_bInterpolated = false;
+    }
+
+    foreach (QSP<CComponent> pChild, m_vChildren)
+    {
+        pChild->restoreWorldTransform();
+    }
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -1132,6 +1257,9 @@ void CComponent::lookAt(CComponent* pTarget)
 void CComponent::copyTransform(const CComponent* pTarget)
 {
     m_mWorldTransform = pTarget->m_mWorldTransform;
+    m_bRigidTransform = pTarget->m_bRigidTransform;
+    m_bTransformDirty = true;
+    m_uiTransformVersion++;
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -1167,6 +1295,8 @@ void CComponent::dump(QTextStream& stream, int iIdent)
 
 void CComponent::incComponentCounter(QString sClassName)
 {
+    QMutexLocker locker(&m_mComponentCounterMutex);
+
     if (m_mComponentCounter.contains(sClassName) == false)
     {
         m_mComponentCounter[sClassName] = 0;
@@ -1179,6 +1309,8 @@ void CComponent::incComponentCounter(QString sClassName)
 
 void CComponent::decComponentCounter(QString sClassName)
 {
+    QMutexLocker locker(&m_mComponentCounterMutex);
+
     if (m_mComponentCounter.contains(sClassName) == false)
     {
         m_mComponentCounter[sClassName] = 0;
@@ -1186,3 +1318,12 @@ void CComponent::decComponentCounter(QString sClassName)
 
     m_mComponentCounter[sClassName]--;
 }
+
+//-------------------------------------------------------------------------------------------------
+
+QMap<QString, int> CComponent::componentCounter()
+{
+    QMutexLocker locker(&m_mComponentCounterMutex);
+
+    return m_mComponentCounter;
+}
@@ -4,6 +4,8 @@
 // Qt
 #include <QString>
 #include <QVector>
+#include <QAtomicInt>
+#include <QMutex>
 #include <QGraphicsScene>
 #include <QPainter>
 #include <QImage>
@@ -201,6 +203,14 @@ public:
     //! Est-ce que l'objet peut avoir une trajectoire?
     virtual bool isTrajectorable() const { return false; }
 
+    //! Returns true if this root object may be updated concurrently with other root objects
+    //! Such an update runs in a pool thread while the scene's simulation lock is held by the stepping thread,
+    //! so it must not call scene methods that take that lock, like addComponent() or deleteComponentsByTag()
+    virtual bool isUpdateThreadSafe() const { return false; }
+
+    //! Returns the components this object reads or writes during its update
+    const QVector<QSP<CComponent> >& updateDependencies() const { return m_vUpdateDependencies; }
+
     //! Returns this object's parent
     virtual QSP<CComponent> parentComponent() const { return m_pParent; }
 
@@ -265,7 +275,10 @@ public:
     static void decComponentCounter(QString sClassName);
 
     //! Returns the number of instances of this class
-    static int getNumComponents() { return m_iNumComponents; }
+    static int getNumComponents() { return m_iNumComponents.load(); }
+
+    //! Returns a number that changes each time an update dependency is added or cleared
+    static int updateDependencyRevision() { return m_iUpdateDependencyRevision.load(); }
 
     //-------------------------------------------------------------------------------------------------
     // Operators
@@ -287,6 +300,10 @@ public:
     //! Deletes this object's links
     virtual void clearLinks(C3DScene* pScene) Q_DECL_OVERRIDE;
 
+    //! Declares that this object reads or writes pComponent during its update
+    //! Their root objects are then never updated concurrently
+    void addUpdateDependency(QSP<CComponent> pComponent);
+
     //! Looks for a component in the parent/child tree of this object
     virtual QSP<CComponent> findComponent(QString sName, QSP<CComponent> pCaller = QSP<CComponent>(nullptr));
 
@@ -311,7 +328,7 @@ public:
     //! Calls the update method for child components
     virtual void postUpdate(double dDeltaTime);
 
-    //!
+    //! Draws in pTexture->image() from a pool thread, reporting the modified areas with CTexture::invalidate()
     virtual void updateTexture(CTexture* pTexture, double dDeltaTime);
 
     //! Returns the local bounding box
@@ -332,9 +349,21 @@ public:
     //! Transforms all vertices of this component (does something if component is a mesh)
     void transformVertices(const Math::CMatrix4& matrix);
 
-    //! Compute the world transform matrix
+    //! Compute the world transform matrix, if the local transform or the parent's world transform changed
     void computeWorldTransform();
 
+    //! Makes the next computeWorldTransform() rebuild the world transform
+    void invalidateWorldTransform() { m_bTransformDirty = true; }
+
+    //! Keeps the world transform as the previous one, for this component and its children
+    void savePreviousWorldTransform();
+
+    //! Replaces the world transform by its interpolation from the previous one, for this component and its children
+    void interpolateWorldTransform(double dFactor);
+
+    //! Puts back the world transform replaced by interpolateWorldTransform()
+    void restoreWorldTransform();
+
     //! Saves the world transform matrix
     void saveTransform();
 
@@ -360,7 +389,8 @@ public:
     // Static methods
     //-------------------------------------------------------------------------------------------------
 
-    static QMap<QString, int> componentCounter() { return m_mComponentCounter; }
+    //! Returns the number of instances of each counted class
+    static QMap<QString, int> componentCounter();
 
     //-------------------------------------------------------------------------------------------------
     // Properties
@@ -386,7 +416,11 @@ protected:
     CController*                m_pController;
     Math::CMatrix4              m_mWorldTransform;              // World transform of the object
     Math::CMatrix4              m_mWorldTransformInverse;       // World inverse transform of the object
-    Math::CMatrix4              m_mPreviousWorldTransform;
+    Math::CMatrix4              m_mPreviousWorldTransform;      // World transform at the start of the last simulation step
+    Math::CMatrix4              m_mSimulatedWorldTransform;     // World transform of the last simulation step, while an interpolated one is rendered
+    Math::CMatrix4              m_mSimulatedWorldTransformInverse;
+    quint32                     m_uiTransformVersion;           // Incremented each time m_mWorldTransform is rebuilt or set
+    quint32                     m_uiParentTransformVersion;     // Parent's m_uiTransformVersion when m_mWorldTransform was built
     QVector<CHeightField*>      m_pFields;                      // The height fields of the object
     bool                        m_bVisible;                     // Is the object visible?
     bool                        m_bCastShadows;                 // Does the object cast shadows?
@@ -394,6 +428,10 @@ protected:
     bool                        m_bRaytracable;                 // Should the object be considered in ray-tracing methods?
     bool                        m_bInheritTransform;            // Should the object inherit its parent's transform?
     bool                        m_bSelected;                    // Is the object selected?
+    bool                        m_bInterpolated;                // Does m_mWorldTransform hold an interpolated transform?
+    bool                        m_bTransformDirty;              // Have position, rotation or parenting changed since m_mWorldTransform was built?
+    bool                        m_bTransformRoot;               // Was the object a root object when m_mWorldTransform was built?
+    bool                        m_bRigidTransform;              // Is m_mWorldTransform made of rotations and translations only?
 
     double                      m_dStatus;                      // Status of the object (0.0 = Out of service, 1.0 = Functional)
 
@@ -408,7 +446,10 @@ protected:
 
     QSP<CComponent>             m_pParent;                      // Object's parent
     QVector<QSP<CComponent> >   m_vChildren;                    // Object's children
+    QVector<QSP<CComponent> >   m_vUpdateDependencies;          // Components read or written during update, see addUpdateDependency()
 
-    static int                  m_iNumComponents;
+    static QAtomicInt           m_iNumComponents;
+    static QAtomicInt           m_iUpdateDependencyRevision;
+    static QMutex               m_mComponentCounterMutex;       // Components are created and destroyed by several threads
     static QMap<QString, int>   m_mComponentCounter;
 };
@@ -78,6 +78,13 @@ public:
             if (pFound != nullptr)
             {
                 m_pComponent = pFound;
+
+                // Components of other root objects must not be updated concurrently with the caller
+                if (pCaller != nullptr && pFound->root() != pCaller->root())
+                {
+                    pCaller->addUpdateDependency(pFound);
+                }
+
                 break;
             }
         }
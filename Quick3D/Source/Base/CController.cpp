@@ -141,6 +141,11 @@ void CController::setPositionTarget(QSP<CComponent> pComponent)
 
     m_rPositionTarget.setComponent(pComponent);
 
+    if (pComponent)
+    {
+        addUpdateDependency(pComponent);
+    }
+
     if (m_rPositionTarget.component()->isTrajectorable())
     {
         QSP<CTrajectorable> pTraj = QSP_CAST(CTrajectorable, m_rPositionTarget.component());
@@ -157,6 +162,11 @@ void CController::setPositionTarget(QSP<CComponent> pComponent)
 void CController::setRotationTarget(QSP<CComponent> pComponent)
 {
     m_rRotationTarget.setComponent(pComponent);
+
+    if (pComponent)
+    {
+        addUpdateDependency(pComponent);
+    }
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -1,4 +1,7 @@
 
+// Qt
+#include <QElapsedTimer>
+
 // Application
 #include "Angles.h"
 #include "CAxis.h"
@@ -529,18 +532,6 @@ void CPhysicalComponent::update(double dDeltaTimeS)
 
 //-------------------------------------------------------------------------------------------------
 
-/*!
-    Does post update work on the component using \a dDeltaTimeS, which is the elapsed seconds since the last frame.
-*/
-void CPhysicalComponent::postUpdate(double dDeltaTimeS)
-{
-    CComponent::postUpdate(dDeltaTimeS);
-
-    setPreviousWorldTransform(worldTransform());
-}
-
-//-------------------------------------------------------------------------------------------------
-
 QVector<CContactPoint> CPhysicalComponent::contactPoints()
 {
     QVector<CContactPoint> points;
@@ -557,10 +548,19 @@ QVector<CContactPoint> CPhysicalComponent::contactPoints()
 //-------------------------------------------------------------------------------------------------
 
 /*!
-    Computes collisions for the components in \a vComponents using \a dDeltaTimeS, which is the elapsed seconds since the last frame.
+    Computes collisions for the components in \a vComponents using \a dDeltaTimeS, which is the elapsed seconds since the last frame. \br\br
+    Candidate pairs are found by \a tBroadphase on geocentric positions computed once per component. \br
+    Pair counts and timing are written to \a pStatistics if not null.
 */
-void CPhysicalComponent::computeCollisions(QVector<QSP<CComponent> >& vComponents, double dDeltaTimeS)
+void CPhysicalComponent::computeCollisions(QVector<QSP<CComponent> >& vComponents, double dDeltaTimeS, CCollisionBroadphase& tBroadphase, C3DSceneStatistics* pStatistics)
 {
+    Q_UNUSED(dDeltaTimeS);
+
+    QElapsedTimer tTimer;
+    tTimer.start();
+
+    tBroadphase.clear();
+
     foreach (QSP<CComponent> pComponent, vComponents)
     {
         QSP<CPhysicalComponent> pPhysical = QSP_CAST(CPhysicalComponent, pComponent);
@@ -570,57 +570,71 @@ void CPhysicalComponent::computeCollisions(QVector<QSP<CComponent> >& vComponent
         {
             if (pPhysical->isRootObject() && pPhysical->collisionsActive() == true)
             {
-                // Compute collisions only if object has non null speed
-                if (pPhysical->velocity_ms().magnitude() > 0.0)
-                {
-                    computeCollisionsForComponent(pPhysical, vComponents, dDeltaTimeS);
-                }
+                tBroadphase.addProxy(CCollisionProxy(
+                                         pPhysical.data(),
+                                         pPhysical->geoloc().toVector3(),
+                                         pPhysical->worldBounds().radius(),
+                                         pPhysical->velocity_ms().magnitude() > 0.0
+                                         ));
             }
         }
     }
-}
 
-//-------------------------------------------------------------------------------------------------
+    tBroadphase.computePairs();
+    tBroadphase.computeHits();
 
-/*!
-    Computes collisions for \a pComponent using \a dDeltaTimeS, which is the elapsed seconds since the last frame. \br\br
-    \a vOtherComponents is the list of components which it can interact with.
-*/
-void CPhysicalComponent::computeCollisionsForComponent(QSP<CPhysicalComponent> pPhysical, QVector<QSP<CComponent> >& vOtherComponents, double dDeltaTimeS)
-{
-    // Iterate through each other components
-    foreach (QSP<CComponent> pOtherComponent, vOtherComponents)
-    {
-        QSP<CPhysicalComponent> pOtherPhysical = QSP_CAST(CPhysicalComponent, pOtherComponent);
+    // Forces are applied here, in one thread, as both components of a pair are modified
+    int iNumCollisions = 0;
 
-        if (pOtherPhysical != nullptr)
+    foreach (const CCollisionPair& tPair, tBroadphase.pairs())
+    {
+        if (tPair.m_bHit)
         {
-            if (pPhysical != pOtherPhysical && pOtherPhysical->isRootObject() && pOtherPhysical->collisionsActive() == true)
+            const CCollisionProxy& tFirst = tBroadphase.proxies()[tPair.m_iFirst];
+            const CCollisionProxy& tSecond = tBroadphase.proxies()[tPair.m_iSecond];
+
+            // Only moving components push the other one
+            if (tFirst.m_bMoving)
             {
-                // Terrains are for now processed in update()
-                if (pOtherPhysical->getClassName() != ClassName_CWorldTerrain)
-                {
-                    // Compute distance to other object
-                    CVector3 vPosition = pPhysical->geoloc().toVector3(pOtherPhysical->geoloc());
-                    double dRadiusSum = pPhysical->worldBounds().radius() + pOtherPhysical->worldBounds().radius();
+                computeCollisionResponse(tFirst.m_pComponent, tSecond.m_pComponent);
+            }
 
-                    // Do the spheres intersect?
-                    if (vPosition.magnitude() < dRadiusSum)
-                    {
-                        // If yes, make objects bounce
-
-                        double dForce = pPhysical->m_vVelocity_ms.magnitude() * pPhysical->totalMass_kg() * 4.0;
-                        CVector3 vForceDirection = vPosition.normalized() * 0.5 * dForce;
-                        double dTotalMass = pPhysical->totalMass_kg() + pOtherPhysical->totalMass_kg();
-                        double dForceThisComponent = 1.0 - (pPhysical->totalMass_kg() / dTotalMass);
-                        double dForceOtherComponent = 1.0 - (pOtherPhysical->totalMass_kg() / dTotalMass);
-                        pPhysical->addForce_kg(vForceDirection * dForceThisComponent);
-                        pOtherPhysical->addForce_kg(vForceDirection * dForceOtherComponent * -1.0);
-                    }
-                }
+            if (tSecond.m_bMoving)
+            {
+                computeCollisionResponse(tSecond.m_pComponent, tFirst.m_pComponent);
             }
+
+            iNumCollisions++;
         }
     }
+
+    if (pStatistics != nullptr)
+    {
+        pStatistics->m_iNumCollisionProxies = tBroadphase.proxies().count();
+        pStatistics->m_iNumCollisionPairs = tBroadphase.pairs().count();
+        pStatistics->m_iNumCollisions = iNumCollisions;
+        pStatistics->m_iCollisionTimeUS = tTimer.nsecsElapsed() / 1000;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Makes \a pPhysical, which is moving and touches \a pOtherPhysical, bounce off it. \br\br
+    Both components receive a force, shared according to their masses.
+*/
+void CPhysicalComponent::computeCollisionResponse(CPhysicalComponent* pPhysical, CPhysicalComponent* pOtherPhysical)
+{
+    // Position of this object relative to the other one
+    CVector3 vPosition = pPhysical->geoloc().toVector3(pOtherPhysical->geoloc());
+
+    double dForce = pPhysical->m_vVelocity_ms.magnitude() * pPhysical->totalMass_kg() * 4.0;
+    CVector3 vForceDirection = vPosition.normalized() * 0.5 * dForce;
+    double dTotalMass = pPhysical->totalMass_kg() + pOtherPhysical->totalMass_kg();
+    double dForceThisComponent = 1.0 - (pPhysical->totalMass_kg() / dTotalMass);
+    double dForceOtherComponent = 1.0 - (pOtherPhysical->totalMass_kg() / dTotalMass);
+    pPhysical->addForce_kg(vForceDirection * dForceThisComponent);
+    pOtherPhysical->addForce_kg(vForceDirection * dForceOtherComponent * -1.0);
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -6,6 +6,8 @@
 // Application
 #include "CQ3DConstants.h"
 #include "CComponent.h"
+#include "CCollisionBroadphase.h"
+#include "C3DSceneStatistics.h"
 
 //-------------------------------------------------------------------------------------------------
 // Forward declarations
@@ -170,9 +172,6 @@ public:
     //! Updates this object using the elapsed time since last update
     virtual void update(double dDeltaTime) Q_DECL_OVERRIDE;
 
-    //! Calls the update method for child components
-    virtual void postUpdate(double dDeltaTimeS) Q_DECL_OVERRIDE;
-
     //! Returns a list of contact points for this component
     virtual QVector<CContactPoint> contactPoints();
 
@@ -207,11 +206,11 @@ public:
     // Static methods
     //-------------------------------------------------------------------------------------------------
 
-    //!
-    static void computeCollisions(QVector<QSP<CComponent> >& vComponents, double dDeltaTimeS);
+    //! Computes the collisions between root components, candidate pairs being found by tBroadphase
+    static void computeCollisions(QVector<QSP<CComponent> >& vComponents, double dDeltaTimeS, CCollisionBroadphase& tBroadphase, C3DSceneStatistics* pStatistics = nullptr);
 
-    //!
-    static void computeCollisionsForComponent(QSP<CPhysicalComponent> pPhysical, QVector<QSP<CComponent> >& vOtherComponents, double dDeltaTimeS);
+    //! Applies the bounce forces of a moving component on another one it touches
+    static void computeCollisionResponse(CPhysicalComponent* pPhysical, CPhysicalComponent* pOtherPhysical);
 
     //-------------------------------------------------------------------------------------------------
     // Properties
@@ -141,6 +141,7 @@
 #define ParamName_Building                  "Building"
 #define ParamName_Buildings                 "Buildings"
 #define ParamName_Bush                      "Bush"
+#define ParamName_CacheMB                   "CacheMB"
 #define ParamName_CenterOfMass              "CenterOfMass"
 #define ParamName_Camera1                   "Camera1"
 #define ParamName_Camera2                   "Camera2"
@@ -1,5 +1,8 @@
 
-// Fondations
+// Qt
+#include <QThread>
+
+// qt-plus
 #include "CLogger.h"
 
 // Application
@@ -9,6 +12,7 @@
 
 CWorker::CWorker()
     : m_bStopRequested(false)
+    , m_iWorkPriority(0)
     , m_bStarted(false)
     , m_bFinished(false)
 {
@@ -22,36 +26,76 @@ CWorker::~CWorker()
 
 //-------------------------------------------------------------------------------------------------
 
+bool CWorker::isStarted()
+{
+    QMutexLocker locker(&m_mStateMutex);
+
+    return m_bStarted;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+bool CWorker::isFinished()
+{
+    QMutexLocker locker(&m_mStateMutex);
+
+    return m_bFinished;
+}
+
+//-------------------------------------------------------------------------------------------------
+
 void CWorker::work()
 {
 }
 
 //-------------------------------------------------------------------------------------------------
 
-void CWorker::abort()
+void CWorker::cancel()
 {
     m_bStopRequested = true;
-    wait();
+
+    {
+        QMutexLocker locker(&m_mStateMutex);
+
+        while (m_bStarted && m_bFinished == false)
+        {
+            m_cFinished.wait(&m_mStateMutex);
+        }
+    }
+
     m_bStopRequested = false;
 }
 
 //-------------------------------------------------------------------------------------------------
 
-void CWorker::doSleep(int ms)
+void CWorker::markStarted()
 {
+    QMutexLocker locker(&m_mStateMutex);
+
+    m_bStarted = true;
 }
 
 //-------------------------------------------------------------------------------------------------
 
-void CWorker::run()
+void CWorker::execute()
 {
     LOG_METHOD_DEBUG(QString("START : Thread ID = %1").arg((qlonglong) QThread::currentThreadId()));
 
-    m_bStarted = true;
+    if (m_bStopRequested == false)
+    {
+        work();
+    }
 
-    work();
+    LOG_METHOD_DEBUG(QString("FINISHED : Thread ID = %1").arg((qlonglong) QThread::currentThreadId()));
 
-    m_bFinished = true;
+    // Emitted before the finished state is published, so that cancel() callers
+    // may safely delete this object as soon as they are released
+    emit workFinished();
 
-    LOG_METHOD_DEBUG(QString("FINISHED : Thread ID = %1").arg((qlonglong) QThread::currentThreadId()));
+    {
+        QMutexLocker locker(&m_mStateMutex);
+
+        m_bFinished = true;
+        m_cFinished.wakeAll();
+    }
 }
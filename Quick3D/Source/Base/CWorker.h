@@ -2,17 +2,23 @@
 #pragma once
 
 // Qt
-#include <QThread>
+#include <QObject>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
 
 // Application
 #include "quick3d_global.h"
 
 //-------------------------------------------------------------------------------------------------
 
-class QUICK3D_EXPORT CWorker : public QThread
+//! A unit of work executed by the CWorkerManager thread pool
+class QUICK3D_EXPORT CWorker : public QObject
 {
     Q_OBJECT
 
+    friend class CWorkerManager;
+
 public:
 
     //-------------------------------------------------------------------------------------------------
@@ -29,41 +35,55 @@ public:
     // Setters
     //-------------------------------------------------------------------------------------------------
 
+    //! Sets the scheduling priority, higher values run first
+    void setWorkPriority(int iValue) { m_iWorkPriority.store(iValue); }
+
     //-------------------------------------------------------------------------------------------------
     // Getters
     //-------------------------------------------------------------------------------------------------
 
-    //! Retourne vrai si le travail a commenc
-    bool isStarted() { return m_bStarted; }
+    //! Returns the scheduling priority
+    int workPriority() const { return m_iWorkPriority.load(); }
 
-    //! Retourne vrai si le travail est termin
-    bool isFinished() { return m_bFinished; }
+    //! Returns true if the work has started
+    bool isStarted();
 
-    //-------------------------------------------------------------------------------------------------
-    // Inherited methods
-    //-------------------------------------------------------------------------------------------------
+    //! Returns true if the work is finished
+    bool isFinished();
+
+    //! Returns true if a cancellation has been requested
+    bool isCancelRequested() const { return m_bStopRequested; }
 
     //-------------------------------------------------------------------------------------------------
     // Control methods
     //-------------------------------------------------------------------------------------------------
 
-    //! Mthode de travail
+    //! Work method, executed by a thread of the pool
     virtual void work();
 
-    //! Annule le travail de l'objet
-    void abort();
+    //! Cancels the work of this object and waits for it to stop if it is running
+    void cancel();
 
-    //! Excute un sleep
-    void doSleep(int ms);
+    //-------------------------------------------------------------------------------------------------
+    // Signals
+    //-------------------------------------------------------------------------------------------------
+
+signals:
+
+    //! Emitted from the pool thread when work() has returned
+    void workFinished();
 
     //-------------------------------------------------------------------------------------------------
-    // Inherited methods protges
+    // Protected methods
     //-------------------------------------------------------------------------------------------------
 
 protected:
 
-    //! Implmentation de la mthode run() de QThread
-    virtual void run();
+    //! Flags this worker as taken by a pool thread
+    void markStarted();
+
+    //! Called by the pool thread that runs this worker
+    void execute();
 
     //-------------------------------------------------------------------------------------------------
     // Properties
@@ -71,10 +91,13 @@ protected:
 
 protected:
 
-    bool        m_bStopRequested;   // Indique si l'arrt du travail est demand
+    volatile bool   m_bStopRequested;   // Is a cancellation requested?
 
 private:
 
-    bool        m_bStarted;         // Indique si le travail a commenc
-    bool        m_bFinished;        // Indique si le travail est termin
+    QMutex          m_mStateMutex;      // Protects the started / finished states
+    QWaitCondition  m_cFinished;        // Signaled when the work is finished
+    QAtomicInt      m_iWorkPriority;    // Scheduling priority
+    bool            m_bStarted;         // Has the work started?
+    bool            m_bFinished;        // Is the work finished?
 };
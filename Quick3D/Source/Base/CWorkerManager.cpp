@@ -10,51 +10,225 @@
 
 //-------------------------------------------------------------------------------------------------
 
-#define MAX_WORKERS_RUNNING 3
+// Keep one core for the rendering thread
+#define RESERVED_CORES  1
+
+// Number of workers at the front of a queue whose priority is read again when taking one
+#define PRIORITY_WINDOW 8
+
+//-------------------------------------------------------------------------------------------------
+
+CWorkerThread::CWorkerThread(CWorkerManager* pManager, int iIndex)
+    : m_pManager(pManager)
+    , m_iIndex(iIndex)
+{
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CWorkerThread::enqueue(CWorker* pWorker)
+{
+    QMutexLocker locker(&m_mQueueMutex);
+
+    int iPriority = pWorker->workPriority();
+    int iLow = 0;
+    int iHigh = m_lQueue.count();
+
+    // Binary search of the insertion point, equal priorities keep their queueing order
+    while (iLow < iHigh)
+    {
+        int iMiddle = (iLow + iHigh) / 2;
+
+        if (m_lQueue[iMiddle]->workPriority() >= iPriority)
+        {
+            iLow = iMiddle + 1;
+        }
+        else
+        {
+            iHigh = iMiddle;
+        }
+    }
+
+    m_lQueue.insert(iLow, pWorker);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+CWorker* CWorkerThread::takeBest()
+{
+    QMutexLocker locker(&m_mQueueMutex);
+
+    if (m_lQueue.isEmpty())
+    {
+        return nullptr;
+    }
+
+    // The queue is ordered by the priorities workers had when queued
+    // Priorities may change while workers wait, so the best one is picked among the first few only
+    int iWindow = qMin(m_lQueue.count(), PRIORITY_WINDOW);
+    int iBestIndex = 0;
+    int iBestPriority = m_lQueue[0]->workPriority();
+
+    for (int iIndex = 1; iIndex < iWindow; iIndex++)
+    {
+        int iPriority = m_lQueue[iIndex]->workPriority();
+
+        if (iPriority > iBestPriority)
+        {
+            iBestIndex = iIndex;
+            iBestPriority = iPriority;
+        }
+    }
+
+    CWorker* pWorker = m_lQueue.takeAt(iBestIndex);
+
+    // Flagged while still holding the queue lock, so removeWorker() never misses a worker in transit
+    pWorker->markStarted();
+
+    return pWorker;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CWorkerThread::run()
+{
+    LOG_METHOD_DEBUG(QString("START : Pool thread %1").arg(m_iIndex));
+
+    while (true)
+    {
+        CWorker* pWorker = m_pManager->takeWorker(m_iIndex);
+
+        if (pWorker != nullptr)
+        {
+            pWorker->execute();
+        }
+        else
+        {
+            {
+                QMutexLocker locker(&m_pManager->m_mIdleMutex);
+
+                if (m_pManager->m_bStopRequested)
+                {
+                    break;
+                }
+            }
+
+            m_pManager->waitForWork();
+        }
+    }
+
+    LOG_METHOD_DEBUG(QString("FINISHED : Pool thread %1").arg(m_iIndex));
+}
 
 //-------------------------------------------------------------------------------------------------
 
 CWorkerManager::CWorkerManager()
-    : m_mMutex(QMutex::Recursive)
+    : m_iPending(0)
+    , m_iNextThread(0)
     , m_bStopRequested(false)
 {
-    start();
+    int iThreadCount = qMax(1, QThread::idealThreadCount() - RESERVED_CORES);
+
+    LOG_METHOD_DEBUG(QString("Starting %1 pool threads").arg(iThreadCount));
+
+    for (int iIndex = 0; iIndex < iThreadCount; iIndex++)
+    {
+        m_vThreads.append(new CWorkerThread(this, iIndex));
+    }
+
+    foreach (CWorkerThread* pThread, m_vThreads)
+    {
+        pThread->start(QThread::HighPriority);
+    }
 }
 
 //-------------------------------------------------------------------------------------------------
 
 CWorkerManager::~CWorkerManager()
 {
-    QMutexLocker locker(&m_mMutex);
+    // Drop queued workers
+    foreach (CWorkerThread* pThread, m_vThreads)
+    {
+        QMutexLocker locker(&pThread->m_mQueueMutex);
+
+        pThread->m_lQueue.clear();
+    }
+
+    // Release idle threads and wait for running workers to return
+    {
+        QMutexLocker locker(&m_mIdleMutex);
+
+        m_iPending = 0;
+        m_bStopRequested = true;
+        m_cWorkAvailable.wakeAll();
+    }
+
+    foreach (CWorkerThread* pThread, m_vThreads)
+    {
+        pThread->wait();
+        delete pThread;
+    }
+
+    m_vThreads.clear();
+}
 
-    m_bStopRequested = true;
-    wait();
+//-------------------------------------------------------------------------------------------------
 
-    foreach (CWorker* pWorker, m_vWorkers)
+bool CWorkerManager::containsWorker(CWorker* pWorker)
+{
+    foreach (CWorkerThread* pThread, m_vThreads)
     {
-        if (pWorker->isStarted())
+        QMutexLocker locker(&pThread->m_mQueueMutex);
+
+        if (pThread->m_lQueue.contains(pWorker))
         {
-            pWorker->abort();
+            return true;
         }
     }
+
+    return pWorker->isStarted() && pWorker->isFinished() == false;
 }
 
 //-------------------------------------------------------------------------------------------------
 
-bool CWorkerManager::containsWorker(CWorker* pWorker)
+int CWorkerManager::pendingCount()
 {
-    return m_vWorkers.contains(pWorker);
+    QMutexLocker locker(&m_mIdleMutex);
+
+    return m_iPending;
 }
 
 //-------------------------------------------------------------------------------------------------
 
 void CWorkerManager::addWorker(CWorker* pWorker)
 {
-    QMutexLocker locker(&m_mMutex);
+    // Several threads may queue the same worker at once, from pool threads for instance
+    QMutexLocker addLocker(&m_mAddMutex);
 
-    if (m_vWorkers.contains(pWorker) == false)
+    // A worker runs only once
+    if (pWorker->isStarted() || containsWorker(pWorker))
     {
-        m_vWorkers.append(pWorker);
+        return;
+    }
+
+    // Workers queued from a pool thread stay on that thread, others are spread round robin
+    CWorkerThread* pTarget = qobject_cast<CWorkerThread*>(QThread::currentThread());
+
+    if (pTarget == nullptr || m_vThreads.contains(pTarget) == false)
+    {
+        QMutexLocker locker(&m_mIdleMutex);
+
+        pTarget = m_vThreads[m_iNextThread % m_vThreads.count()];
+        m_iNextThread = (m_iNextThread + 1) % m_vThreads.count();
+    }
+
+    pTarget->enqueue(pWorker);
+
+    {
+        QMutexLocker locker(&m_mIdleMutex);
+
+        m_iPending++;
+        m_cWorkAvailable.wakeOne();
     }
 }
 
@@ -62,53 +236,56 @@ void CWorkerManager::addWorker(CWorker* pWorker)
 
 void CWorkerManager::removeWorker(CWorker* pWorker)
 {
-    QMutexLocker locker(&m_mMutex);
-
-    for (int iIndex = 0; iIndex < m_vWorkers.count(); iIndex++)
+    foreach (CWorkerThread* pThread, m_vThreads)
     {
-        if (m_vWorkers[iIndex] == pWorker)
+        QMutexLocker locker(&pThread->m_mQueueMutex);
+
+        int iIndex = pThread->m_lQueue.indexOf(pWorker);
+
+        if (iIndex != -1)
         {
-            if (pWorker->isStarted() == true && pWorker->isFinished() == false)
-            {
-                pWorker->abort();
-            }
+            pThread->m_lQueue.removeAt(iIndex);
+
+            QMutexLocker idleLocker(&m_mIdleMutex);
+            m_iPending--;
 
-            m_vWorkers.remove(iIndex);
             return;
         }
     }
+
+    // Not queued : either never added, finished, or running
+    pWorker->cancel();
 }
 
 //-------------------------------------------------------------------------------------------------
 
-void CWorkerManager::run()
+CWorker* CWorkerManager::takeWorker(int iIndex)
 {
-    while (m_bStopRequested == false)
+    CWorker* pWorker = m_vThreads[iIndex]->takeBest();
+
+    // Own queue is empty, steal from the others
+    for (int iOffset = 1; pWorker == nullptr && iOffset < m_vThreads.count(); iOffset++)
     {
-        {
-            QMutexLocker locker(&m_mMutex);
+        pWorker = m_vThreads[(iIndex + iOffset) % m_vThreads.count()]->takeBest();
+    }
 
-            for (int iIndex = 0; iIndex < MAX_WORKERS_RUNNING; iIndex++)
-            {
-                if (m_vWorkers.count() > iIndex)
-                {
-                    if (m_vWorkers[iIndex]->isStarted() == false)
-                    {
-                        m_vWorkers[iIndex]->start();
-                        m_vWorkers[iIndex]->setPriority(QThread::HighPriority);
-                    }
-                    else
-                    {
-                        if (m_vWorkers[iIndex]->isFinished())
-                        {
-                            m_vWorkers.remove(iIndex);
-                            iIndex--;
-                        }
-                    }
-                }
-            }
-        }
+    if (pWorker != nullptr)
+    {
+        QMutexLocker locker(&m_mIdleMutex);
+        m_iPending--;
+    }
 
-        msleep(50);
+    return pWorker;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CWorkerManager::waitForWork()
+{
+    QMutexLocker locker(&m_mIdleMutex);
+
+    if (m_iPending <= 0 && m_bStopRequested == false)
+    {
+        m_cWorkAvailable.wait(&m_mIdleMutex);
     }
 }
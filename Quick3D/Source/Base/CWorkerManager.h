@@ -4,6 +4,9 @@
 // Qt
 #include <QThread>
 #include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <QList>
 
 // qt-plus
 #include "CSingleton.h"
@@ -13,12 +16,50 @@
 #include "CWorker.h"
 
 //-------------------------------------------------------------------------------------------------
+// Forward declarations
 
-class QUICK3D_EXPORT CWorkerManager : public QThread, public CSingleton<CWorkerManager>
+class CWorkerManager;
+
+//-------------------------------------------------------------------------------------------------
+
+//! A thread of the CWorkerManager pool, owning a queue of pending workers
+class QUICK3D_EXPORT CWorkerThread : public QThread
+{
+    Q_OBJECT
+
+    friend class CWorkerManager;
+
+public:
+
+    //!
+    CWorkerThread(CWorkerManager* pManager, int iIndex);
+
+    //!
+    virtual void run() Q_DECL_OVERRIDE;
+
+protected:
+
+    //! Queues a worker behind the workers of higher or equal priority
+    void enqueue(CWorker* pWorker);
+
+    //! Removes and returns the best worker at the front of the queue, or nullptr if the queue is empty
+    CWorker* takeBest();
+
+    CWorkerManager*     m_pManager;
+    int                 m_iIndex;
+    QMutex              m_mQueueMutex;      // Protects m_lQueue, also used by stealing threads
+    QList<CWorker*>     m_lQueue;           // Pending workers of this thread, highest priority first when queued
+};
+
+//-------------------------------------------------------------------------------------------------
+
+//! A fixed size thread pool with per-thread queues, priorities and work stealing
+class QUICK3D_EXPORT CWorkerManager : public QObject, public CSingleton<CWorkerManager>
 {
     Q_OBJECT
 
     friend class CSingleton<CWorkerManager>;
+    friend class CWorkerThread;
 
 public:
 
@@ -26,17 +67,23 @@ public:
     // Getters
     //-------------------------------------------------------------------------------------------------
 
-    //! Retire un travailleur du pool
+    //! Returns true if the worker is queued or running
     bool containsWorker(CWorker* pWorker);
 
+    //! Returns the number of threads in the pool
+    int threadCount() const { return m_vThreads.count(); }
+
+    //! Returns the number of queued workers
+    int pendingCount();
+
     //-------------------------------------------------------------------------------------------------
     // Control methods
     //-------------------------------------------------------------------------------------------------
 
-    //! Ajoute un travailleur au pool
+    //! Queues a worker, it will run once
     void addWorker(CWorker* pWorker);
 
-    //! Retire un travailleur du pool
+    //! Removes a worker from the pool, cancelling it if it is running
     void removeWorker(CWorker* pWorker);
 
     //-------------------------------------------------------------------------------------------------
@@ -45,14 +92,23 @@ public:
 
 protected:
 
-    //! Conctructeur par dfaut
+    //! Default constructor
     CWorkerManager();
 
     //! Destructor
     virtual ~CWorkerManager();
 
-    //! Implmentation de la mthode run() de QThread
-    virtual void run();
+    //-------------------------------------------------------------------------------------------------
+    // Protected methods
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    //! Returns the next worker for the thread at iIndex, stealing from other threads if needed
+    CWorker* takeWorker(int iIndex);
+
+    //! Blocks the calling pool thread until work is available or the pool is stopping
+    void waitForWork();
 
     //-------------------------------------------------------------------------------------------------
     // Properties
@@ -60,7 +116,11 @@ protected:
 
 protected:
 
-    QMutex              m_mMutex;			// Mutex de protection des accs concurrents
-    QVector<CWorker*>   m_vWorkers;			// Pool de travailleurs
-    bool                m_bStopRequested;	// Indique si un arrt du travail est demand
+    QVector<CWorkerThread*> m_vThreads;         // The pool
+    QMutex                  m_mAddMutex;        // Makes the check and queueing of addWorker() atomic
+    QMutex                  m_mIdleMutex;       // Protects m_iPending and m_bStopRequested
+    QWaitCondition          m_cWorkAvailable;   // Signaled when a worker is queued
+    int                     m_iPending;         // Number of queued workers, all threads
+    int                     m_iNextThread;      // Round robin index for workers queued from outside the pool
+    bool                    m_bStopRequested;   // Is the pool stopping?
 };
@@ -120,6 +120,57 @@ public:
     //!
     void addSegments(C3DScene* pScene);
 
+    //-------------------------------------------------------------------------------------------------
+    // Static methods
+    //-------------------------------------------------------------------------------------------------
+
+    //! Returns the component-wise inverse of vDirection, a large value standing for the inverse of zero
+    static inline Math::CVector3 inverseDirection(const Math::CVector3& vDirection)
+    {
+        return Math::CVector3(
+                    vDirection.X != 0.0 ? 1.0 / vDirection.X : 1e30,
+                    vDirection.Y != 0.0 ? 1.0 / vDirection.Y : 1e30,
+                    vDirection.Z != 0.0 ? 1.0 / vDirection.Z : 1e30
+                    );
+    }
+
+    //! Computes in dEntry the smallest |t| for which vOrigin + t * direction lies in the box (vMinimum, vMaximum)
+    //! vInverse is the inverse of the direction, see inverseDirection()
+    //! Both sides of the origin are considered, like CFace::intersectTriangle() does
+    //! Returns false if the line misses the box or if dEntry would be greater than dLimit
+    static inline bool lineEntry(
+            const Math::CVector3& vOrigin, const Math::CVector3& vInverse,
+            const Math::CVector3& vMinimum, const Math::CVector3& vMaximum,
+            double dLimit, double& dEntry
+            )
+    {
+        double dNear = -1e300;
+        double dFar = 1e300;
+
+        for (int iAxis = 0; iAxis < 3; iAxis++)
+        {
+            double dT1 = (vMinimum[iAxis] - vOrigin[iAxis]) * vInverse[iAxis];
+            double dT2 = (vMaximum[iAxis] - vOrigin[iAxis]) * vInverse[iAxis];
+
+            if (dT1 > dT2)
+            {
+                double dTemp = dT1; dT1 = dT2; dT2 = dTemp;
+            }
+
+            if (dT1 > dNear) dNear = dT1;
+            if (dT2 < dFar) dFar = dT2;
+        }
+
+        if (dNear > dFar)
+        {
+            return false;
+        }
+
+        dEntry = dNear > 0.0 ? dNear : (dFar < 0.0 ? -dFar : 0.0);
+
+        return dEntry <= dLimit;
+    }
+
     //-------------------------------------------------------------------------------------------------
     // Properties
     //-------------------------------------------------------------------------------------------------
@@ -6,10 +6,10 @@
 
 // Foundations
 #include "geotrans.h"
-#include "geocent.h"
 
 // Application
 #include "CMatrix4.h"
+#include "CWGS84.h"
 #include "CGeoloc.h"
 
 //-------------------------------------------------------------------------------------------------
@@ -20,6 +20,9 @@ using namespace Math;
 
 #define EARTH_RADIUS 6378137.0
 
+// Number of geolocs converted at once by the batch methods
+#define GEOLOC_BATCH_SIZE 64
+
 //-------------------------------------------------------------------------------------------------
 
 /*!
@@ -206,6 +209,65 @@ CVector3 CGeoloc::toVector3(const CGeoloc& gReference) const
 
 //---------------------------------------------------------------------------------------------
 
+/*!
+    Fills \a pPositions with the geocentric vectors of the \a iCount geolocs in \a pGeolocs, using the WGS84 model. \br\br
+    Geolocs are converted by blocks, so that the vectorized path of CWGS84 is used when available.
+*/
+void CGeoloc::toVector3(const CGeoloc* pGeolocs, CVector3* pPositions, int iCount)
+{
+    double dLatitudes[GEOLOC_BATCH_SIZE];
+    double dLongitudes[GEOLOC_BATCH_SIZE];
+    double dAltitudes[GEOLOC_BATCH_SIZE];
+    double dX[GEOLOC_BATCH_SIZE];
+    double dY[GEOLOC_BATCH_SIZE];
+    double dZ[GEOLOC_BATCH_SIZE];
+
+    for (int iStart = 0; iStart < iCount; iStart += GEOLOC_BATCH_SIZE)
+    {
+        int iBlockSize = qMin(GEOLOC_BATCH_SIZE, iCount - iStart);
+
+        for (int iIndex = 0; iIndex < iBlockSize; iIndex++)
+        {
+            dLatitudes[iIndex] = pGeolocs[iStart + iIndex].Latitude;
+            dLongitudes[iIndex] = pGeolocs[iStart + iIndex].Longitude;
+            dAltitudes[iIndex] = pGeolocs[iStart + iIndex].Altitude;
+        }
+
+        CWGS84::geodeticToGeocentric(dLatitudes, dLongitudes, dAltitudes, dX, dY, dZ, iBlockSize);
+
+        for (int iIndex = 0; iIndex < iBlockSize; iIndex++)
+        {
+            pPositions[iStart + iIndex] = CVector3(dX[iIndex], dY[iIndex], dZ[iIndex]);
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
+/*!
+    Fills \a pPositions with the vectors of the \a iCount geolocs in \a pGeolocs, relative to \a gReference, using the WGS84 model. \br\br
+    The tangent frame of \a gReference is computed once.
+*/
+void CGeoloc::toVector3(const CGeoloc& gReference, const CGeoloc* pGeolocs, CVector3* pPositions, int iCount)
+{
+    CVector3 vReference3D = gReference.toVector3_WGS84();
+    CGeocentricFrame tFrame(vReference3D.X, vReference3D.Y, vReference3D.Z);
+
+    toVector3(pGeolocs, pPositions, iCount);
+
+    for (int iIndex = 0; iIndex < iCount; iIndex++)
+    {
+        CVector3 vPosition3D = pPositions[iIndex];
+
+        tFrame.toLocal(
+                    vPosition3D.X, vPosition3D.Y, vPosition3D.Z,
+                    pPositions[iIndex].X, pPositions[iIndex].Y, pPositions[iIndex].Z
+                    );
+    }
+}
+
+//---------------------------------------------------------------------------------------------
+
 /*!
     Returns the great circle true heading from this to geo loc to \a other.
     Does NOT use the WGS84 model.
@@ -431,24 +493,8 @@ CVector3 CGeoloc::toVector3_UTM() const
 CVector3 CGeoloc::toVector3_WGS84() const
 {
     CVector3 vPosition3D;
-    double dTemp;
-
-    //-----------------------------------------------
-    // Rcupration des coordonnes gocentriques
-
-    Convert_Geodetic_To_Geocentric(
-                Latitude * GeoTrans::fDeg2Rad,
-                Longitude * GeoTrans::fDeg2Rad,
-                Altitude,
-                &(vPosition3D.X), &(vPosition3D.Y), &(vPosition3D.Z)
-                );
-
-    dTemp = vPosition3D.Y; vPosition3D.Y = vPosition3D.Z; vPosition3D.Z = dTemp;
 
-    //-----------------------------------------------
-
-    CMatrix4 mRotationAdjustY = Math::CMatrix4::makeRotation(Math::CVector3(0.0, Math::Pi / 2.0, 0.0));
-    vPosition3D = mRotationAdjustY * vPosition3D;
+    CWGS84::geodeticToGeocentric(Latitude, Longitude, Altitude, vPosition3D.X, vPosition3D.Y, vPosition3D.Z);
 
     return vPosition3D;
 }
@@ -460,32 +506,13 @@ CVector3 CGeoloc::toVector3_WGS84() const
 */
 CGeoloc CGeoloc::fromVector3_WGS84(const CVector3& vPosition)
 {
-    CVector3 vPosition3D = vPosition;
     CGeoloc gReturnValue;
 
-    //-----------------------------------------------
-    // Adust Y angle of position
-
-    CMatrix4 mRotationAdjustY = Math::CMatrix4::makeRotation(Math::CVector3(0.0, Math::Pi / -2.0, 0.0));
-    vPosition3D = mRotationAdjustY * vPosition3D;
-
-    //-----------------------------------------------
-    // Adjust axis conventions
-
-    SWAP_DOUBLE(vPosition3D.Y, vPosition3D.Z);
-
-    //-----------------------------------------------
-
-    Convert_Geocentric_To_Geodetic(
-                vPosition3D.X, vPosition3D.Y, vPosition3D.Z,
-                &(gReturnValue.Latitude),
-                &(gReturnValue.Longitude),
-                &(gReturnValue.Altitude)
+    CWGS84::geocentricToGeodetic(
+                vPosition.X, vPosition.Y, vPosition.Z,
+                gReturnValue.Latitude, gReturnValue.Longitude, gReturnValue.Altitude
                 );
 
-    gReturnValue.Latitude = gReturnValue.Latitude * GeoTrans::fRad2Deg;
-    gReturnValue.Longitude = gReturnValue.Longitude * GeoTrans::fRad2Deg;
-
     return gReturnValue;
 }
 
@@ -496,58 +523,16 @@ CGeoloc CGeoloc::fromVector3_WGS84(const CVector3& vPosition)
 */
 CVector3 CGeoloc::toVector3_WGS84(const CGeoloc& gReference) const
 {
-    CVector3 vReference3D;
-    CVector3 vPosition3D;
-
-    //-----------------------------------------------
-    // Get geocentric coordinates of reference point and this point
+    CVector3 vReference3D = gReference.toVector3_WGS84();
+    CVector3 vPosition3D = toVector3_WGS84();
+    CVector3 vReturnValue;
 
-    Convert_Geodetic_To_Geocentric(
-                gReference.Latitude * GeoTrans::fDeg2Rad,
-                gReference.Longitude * GeoTrans::fDeg2Rad,
-                gReference.Altitude,
-                &(vReference3D.X), &(vReference3D.Y), &(vReference3D.Z)
-                );
-
-    Convert_Geodetic_To_Geocentric(
-                Latitude * GeoTrans::fDeg2Rad,
-                Longitude * GeoTrans::fDeg2Rad,
-                Altitude,
-                &(vPosition3D.X), &(vPosition3D.Y), &(vPosition3D.Z)
+    CGeocentricFrame(vReference3D.X, vReference3D.Y, vReference3D.Z).toLocal(
+                vPosition3D.X, vPosition3D.Y, vPosition3D.Z,
+                vReturnValue.X, vReturnValue.Y, vReturnValue.Z
                 );
 
-    //-----------------------------------------------
-    // Adjust axis conventions
-
-    SWAP_DOUBLE(vReference3D.Y, vReference3D.Z);
-    SWAP_DOUBLE(vPosition3D.Y, vPosition3D.Z);
-    vReference3D.Y *= -1.0; vReference3D.Z *= -1.0;
-    vPosition3D.Y *= -1.0; vPosition3D.Z *= -1.0;
-
-    //-----------------------------------------------
-
-    CMatrix4 mRotationAdjustX = Math::CMatrix4::makeRotation(Math::CVector3(Math::Pi / -2.0, 0.0, 0.0));
-    CVector3 vTemp = vReference3D;
-    double dAngleY = vTemp.eulerYAngle();
-    CMatrix4 mRotationInverseY = Math::CMatrix4::makeRotation(Math::CVector3(0, dAngleY * -1.0, 0.0));
-    vTemp = mRotationInverseY * vTemp;
-    double dAngleX = vTemp.eulerXAngle();
-    CMatrix4 mRotationInverseX = Math::CMatrix4::makeRotation(Math::CVector3(dAngleX * -1.0, 0.0, 0.0));
-
-    //-----------------------------------------------
-    // On applique les angles inverses de la rfrence  la position et  la rfrence
-
-    vReference3D = mRotationInverseY * vReference3D;
-    vReference3D = mRotationInverseX * vReference3D;
-    vReference3D = mRotationAdjustX * vReference3D;
-
-    vPosition3D = mRotationInverseY * vPosition3D;
-    vPosition3D = mRotationInverseX * vPosition3D;
-    vPosition3D = mRotationAdjustX * vPosition3D;
-
-    vPosition3D = vPosition3D - vReference3D;
-
-    return vPosition3D;
+    return vReturnValue;
 }
 
 //---------------------------------------------------------------------------------------------
@@ -557,76 +542,15 @@ CVector3 CGeoloc::toVector3_WGS84(const CGeoloc& gReference) const
 */
 CGeoloc CGeoloc::fromVector3_WGS84(const CGeoloc& gReference, const CVector3& vPosition)
 {
-    CVector3 vReference3D;
-    CVector3 vPosition3D = vPosition;
-    CGeoloc gReturnValue;
-
-    //-----------------------------------------------
-    // Get geocentric coordinates of reference point
-
-    Convert_Geodetic_To_Geocentric(
-                gReference.Latitude * GeoTrans::fDeg2Rad,
-                gReference.Longitude * GeoTrans::fDeg2Rad,
-                gReference.Altitude,
-                &(vReference3D.X), &(vReference3D.Y), &(vReference3D.Z)
-                );
-
-    //-----------------------------------------------
-    // Adjust axis conventions
-
-    SWAP_DOUBLE(vReference3D.Y, vReference3D.Z);
-    vReference3D.Y *= -1.0; vReference3D.Z *= -1.0;
-
-    //-----------------------------------------------
-
-    CMatrix4 mRotationAdjustX = Math::CMatrix4::makeRotation(Math::CVector3(Math::Pi / -2.0, 0.0, 0.0));
-    CVector3 vTemp = vReference3D;
-    double dAngleY = vTemp.eulerYAngle();
-    CMatrix4 mRotationInverseY = Math::CMatrix4::makeRotation(Math::CVector3(0, dAngleY * -1.0, 0.0));
-    vTemp = mRotationInverseY * vTemp;
-    double dAngleX = vTemp.eulerXAngle();
-    CMatrix4 mRotationInverseX = Math::CMatrix4::makeRotation(Math::CVector3(dAngleX * -1.0, 0.0, 0.0));
-
-    //-----------------------------------------------
-    // Apply inverse angles to reference point
-
-    vReference3D = mRotationInverseY * vReference3D;
-    vReference3D = mRotationInverseX * vReference3D;
-    vReference3D = mRotationAdjustX * vReference3D;
-
-    vPosition3D = vReference3D + vPosition3D;
-
-    //-----------------------------------------------
-
-    CMatrix4 mRotationAdjustInverseX = Math::CMatrix4::makeRotation(Math::CVector3(Math::Pi / 2.0, 0.0, 0.0));
-    CMatrix4 mRotationX = Math::CMatrix4::makeRotation(Math::CVector3(dAngleX * 1.0, 0.0, 0.0));
-    CMatrix4 mRotationY = Math::CMatrix4::makeRotation(Math::CVector3(0, dAngleY * 1.0, 0.0));
-
-    //-----------------------------------------------
-
-    vPosition3D = mRotationAdjustInverseX * vPosition3D;
-    vPosition3D = mRotationX * vPosition3D;
-    vPosition3D = mRotationY * vPosition3D;
-
-    //-----------------------------------------------
-    // Adjust axis conventions
-
-    SWAP_DOUBLE(vPosition3D.Y, vPosition3D.Z);
-    vPosition3D.Y *= -1.0; vPosition3D.Z *= -1.0;
-
-    //-----------------------------------------------
+    CVector3 vReference3D = gReference.toVector3_WGS84();
+    CVector3 vPosition3D;
 
-    Convert_Geocentric_To_Geodetic(
-                vPosition3D.X, vPosition3D.Y, vPosition3D.Z,
-                &(gReturnValue.Latitude),
-                &(gReturnValue.Longitude),
-                &(gReturnValue.Altitude)
+    CGeocentricFrame(vReference3D.X, vReference3D.Y, vReference3D.Z).toGeocentric(
+                vPosition.X, vPosition.Y, vPosition.Z,
+                vPosition3D.X, vPosition3D.Y, vPosition3D.Z
                 );
 
-    gReturnValue.Latitude = gReturnValue.Latitude * GeoTrans::fRad2Deg;
-    gReturnValue.Longitude = gReturnValue.Longitude * GeoTrans::fRad2Deg;
-
-    return gReturnValue;
+    return fromVector3_WGS84(vPosition3D);
 }
 
 //-------------------------------------------------------------------------------------------------
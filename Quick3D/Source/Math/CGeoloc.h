@@ -84,6 +84,12 @@ public:
     //! Transforms this geoloc to a ECEF geocentric position
     Math::CVector3 toVector3() const;
 
+    //! Transforms iCount geolocs to ECEF geocentric positions, using the WGS84 model
+    static void toVector3(const CGeoloc* pGeolocs, Math::CVector3* pPositions, int iCount);
+
+    //! Transforms iCount geolocs to vector offsets in the tangent plane of gReference, using the WGS84 model
+    static void toVector3(const CGeoloc& gReference, const CGeoloc* pGeolocs, Math::CVector3* pPositions, int iCount);
+
     //! Returns true heading in degrees of this geoloc to \a other
     double headingTo(const CGeoloc& other);
 
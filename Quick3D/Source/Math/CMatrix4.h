@@ -236,6 +236,43 @@ public:
         return Result;
     }
 
+    //! Returns a transform between m1 (dFactor = 0) and m2 (dFactor = 1)
+    //! Axes are interpolated and given their interpolated length, which suits the small rotations between two simulation steps
+    static inline CMatrix4 interpolate(const CMatrix4& m1, const CMatrix4& m2, double dFactor)
+    {
+        CMatrix4 Result;
+
+        Result.m_bIsIdentity = false;
+
+        for (int iRow = 0; iRow < 4; iRow++)
+        {
+            for (int iColumn = 0; iColumn < 4; iColumn++)
+            {
+                Result.Data[iRow][iColumn] = m1.Data[iRow][iColumn] + (m2.Data[iRow][iColumn] - m1.Data[iRow][iColumn]) * dFactor;
+            }
+        }
+
+        for (int iRow = 0; iRow < 3; iRow++)
+        {
+            CVector3 vAxis1(m1.Data[iRow][0], m1.Data[iRow][1], m1.Data[iRow][2]);
+            CVector3 vAxis2(m2.Data[iRow][0], m2.Data[iRow][1], m2.Data[iRow][2]);
+            CVector3 vAxis(Result.Data[iRow][0], Result.Data[iRow][1], Result.Data[iRow][2]);
+
+            double dLength = vAxis.magnitude();
+
+            if (dLength > 0.0)
+            {
+                double dScale = (vAxis1.magnitude() + (vAxis2.magnitude() - vAxis1.magnitude()) * dFactor) / dLength;
+
+                Result.Data[iRow][0] *= dScale;
+                Result.Data[iRow][1] *= dScale;
+                Result.Data[iRow][2] *= dScale;
+            }
+        }
+
+        return Result;
+    }
+
     //!
     static inline CMatrix4 makePerspective(double dFov, double dAspectRatio, double dNear, double dFar)
     {
@@ -332,6 +369,32 @@ public:
         return aRay;
     }
 
+    //! Returns the inverse of a matrix made of rotations and translations only
+    //! The rotation part is transposed and the translation rotated back, which is exact and cheaper than inverse()
+    inline CMatrix4 inverseRigid() const
+    {
+        CMatrix4 m;
+
+        m.m_bIsIdentity = m_bIsIdentity;
+
+        for (int iRow = 0; iRow < 3; iRow++)
+        {
+            for (int iColumn = 0; iColumn < 3; iColumn++)
+            {
+                m.Data[iRow][iColumn] = Data[iColumn][iRow];
+            }
+
+            m.Data[iRow][3] = 0.0;
+        }
+
+        m.Data[3][0] = -(Data[3][0] * Data[0][0] + Data[3][1] * Data[0][1] + Data[3][2] * Data[0][2]);
+        m.Data[3][1] = -(Data[3][0] * Data[1][0] + Data[3][1] * Data[1][1] + Data[3][2] * Data[1][2]);
+        m.Data[3][2] = -(Data[3][0] * Data[2][0] + Data[3][1] * Data[2][1] + Data[3][2] * Data[2][2]);
+        m.Data[3][3] = 1.0;
+
+        return m;
+    }
+
     inline CMatrix4 inverse()
     {
         CMatrix4 m;
@@ -0,0 +1,233 @@
+
+// MSVC does not define __FMA__, /arch:AVX2 implies it
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#define WGS84_AVX2
+#endif
+
+// Std
+#ifdef WGS84_AVX2
+#include <immintrin.h>
+#endif
+
+// Application
+#include "CWGS84.h"
+
+//-------------------------------------------------------------------------------------------------
+
+#define DEG_TO_RAD  (3.14159265358979323846 / 180.0)
+#define RAD_TO_DEG  (180.0 / 3.14159265358979323846)
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    \class CWGS84
+    \brief Closed form conversions between WGS84 geodetic coordinates and Quick3D geocentric coordinates.
+    \inmodule Quick3D
+    \sa CGeoloc, CGeocentricFrame
+
+    The geocentric axes are those of CGeoloc::toVector3(), so that the axis swap and the rotation
+    formerly applied after the GeoTrans conversion are folded in the formulas. \br
+    The batch conversion processes four positions at once when the library is built with AVX2 and FMA (CONFIG+=avx2).
+*/
+
+//-------------------------------------------------------------------------------------------------
+
+#ifdef WGS84_AVX2
+
+// Computes the sine and cosine of four angles in radians, within a few ulps for angles up to a few turns
+// Range reduction to [-Pi/4, Pi/4] uses Pi/2 in three parts, polynomials are those of the Cephes library
+static inline void sinCos4(__m256d x, __m256d& vSin, __m256d& vCos)
+{
+    const __m256d vTwoOverPi = _mm256_set1_pd(0.63661977236758134308);
+    const __m256d vPiOver2_1 = _mm256_set1_pd(1.57079632673412561417e+00);
+    const __m256d vPiOver2_2 = _mm256_set1_pd(6.07710050630396597660e-11);
+    const __m256d vPiOver2_3 = _mm256_set1_pd(2.02226624879595063154e-21);
+
+    __m256d q = _mm256_round_pd(_mm256_mul_pd(x, vTwoOverPi), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+
+    __m256d r = _mm256_fnmadd_pd(q, vPiOver2_1, x);
+    r = _mm256_fnmadd_pd(q, vPiOver2_2, r);
+    r = _mm256_fnmadd_pd(q, vPiOver2_3, r);
+
+    __m256d r2 = _mm256_mul_pd(r, r);
+
+    __m256d s = _mm256_set1_pd(1.58962301576546568060e-10);
+    s = _mm256_fmadd_pd(s, r2, _mm256_set1_pd(-2.50507477628578072866e-8));
+    s = _mm256_fmadd_pd(s, r2, _mm256_set1_pd(2.75573136213857245213e-6));
+    s = _mm256_fmadd_pd(s, r2, _mm256_set1_pd(-1.98412698295895385996e-4));
+    s = _mm256_fmadd_pd(s, r2, _mm256_set1_pd(8.33333333332211858878e-3));
+    s = _mm256_fmadd_pd(s, r2, _mm256_set1_pd(-1.66666666666666307295e-1));
+    s = _mm256_fmadd_pd(_mm256_mul_pd(r, r2), s, r);
+
+    __m256d c = _mm256_set1_pd(-1.13585365213876817300e-11);
+    c = _mm256_fmadd_pd(c, r2, _mm256_set1_pd(2.08757008419747316778e-9));
+    c = _mm256_fmadd_pd(c, r2, _mm256_set1_pd(-2.75573141792967388112e-7));
+    c = _mm256_fmadd_pd(c, r2, _mm256_set1_pd(2.48015872888517045348e-5));
+    c = _mm256_fmadd_pd(c, r2, _mm256_set1_pd(-1.38888888888730564116e-3));
+    c = _mm256_fmadd_pd(c, r2, _mm256_set1_pd(4.16666666666665929218e-2));
+    c = _mm256_fmadd_pd(_mm256_mul_pd(r2, r2), c, _mm256_fnmadd_pd(_mm256_set1_pd(0.5), r2, _mm256_set1_pd(1.0)));
+
+    // Quadrants : (sin, cos) is (s, c), (c, -s), (-s, -c), (-c, s)
+    __m256i vQuadrant = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(q));
+    __m256i vOne = _mm256_set1_epi64x(1);
+    __m256i vTwo = _mm256_set1_epi64x(2);
+
+    __m256d vSwap = _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(vQuadrant, vOne), vOne));
+    __m256d vSinSign = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_and_si256(vQuadrant, vTwo), 62));
+    __m256d vCosSign = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_and_si256(_mm256_add_epi64(vQuadrant, vOne), vTwo), 62));
+
+    vSin = _mm256_xor_pd(_mm256_blendv_pd(s, c, vSwap), vSinSign);
+    vCos = _mm256_xor_pd(_mm256_blendv_pd(c, s, vSwap), vCosSign);
+}
+
+#endif
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Converts the \a iCount geodetic positions in \a pLatitudes, \a pLongitudes (degrees) and \a pAltitudes (meters)
+    to geocentric positions in \a pX, \a pY and \a pZ.
+*/
+void CWGS84::geodeticToGeocentric(
+        const double* pLatitudes, const double* pLongitudes, const double* pAltitudes,
+        double* pX, double* pY, double* pZ,
+        int iCount
+        )
+{
+    int iIndex = 0;
+
+#ifdef WGS84_AVX2
+
+    const __m256d vDegToRad = _mm256_set1_pd(DEG_TO_RAD);
+    const __m256d vSemiMajorAxis = _mm256_set1_pd(WGS84_SEMI_MAJOR_AXIS);
+    const __m256d vEccentricitySquared = _mm256_set1_pd(WGS84_ECCENTRICITY_SQUARED);
+    const __m256d vOneMinusEccentricitySquared = _mm256_set1_pd(1.0 - WGS84_ECCENTRICITY_SQUARED);
+    const __m256d vOne = _mm256_set1_pd(1.0);
+    const __m256d vSignMask = _mm256_set1_pd(-0.0);
+
+    for (; iIndex + 4 <= iCount; iIndex += 4)
+    {
+        __m256d vSinLatitude, vCosLatitude, vSinLongitude, vCosLongitude;
+
+        sinCos4(_mm256_mul_pd(_mm256_loadu_pd(pLatitudes + iIndex), vDegToRad), vSinLatitude, vCosLatitude);
+        sinCos4(_mm256_mul_pd(_mm256_loadu_pd(pLongitudes + iIndex), vDegToRad), vSinLongitude, vCosLongitude);
+
+        __m256d vAltitude = _mm256_loadu_pd(pAltitudes + iIndex);
+
+        __m256d vN = _mm256_div_pd(
+                    vSemiMajorAxis,
+                    _mm256_sqrt_pd(_mm256_fnmadd_pd(vEccentricitySquared, _mm256_mul_pd(vSinLatitude, vSinLatitude), vOne))
+                    );
+
+        __m256d vEquatorial = _mm256_mul_pd(_mm256_add_pd(vN, vAltitude), vCosLatitude);
+
+        _mm256_storeu_pd(pX + iIndex, _mm256_mul_pd(vEquatorial, vSinLongitude));
+        _mm256_storeu_pd(pY + iIndex, _mm256_mul_pd(_mm256_fmadd_pd(vN, vOneMinusEccentricitySquared, vAltitude), vSinLatitude));
+        _mm256_storeu_pd(pZ + iIndex, _mm256_xor_pd(_mm256_mul_pd(vEquatorial, vCosLongitude), vSignMask));
+    }
+
+#endif
+
+    for (; iIndex < iCount; iIndex++)
+    {
+        geodeticToGeocentric(pLatitudes[iIndex], pLongitudes[iIndex], pAltitudes[iIndex], pX[iIndex], pY[iIndex], pZ[iIndex]);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Converts the geocentric position (\a dX, \a dY, \a dZ) to \a dLatitude, \a dLongitude (degrees) and \a dAltitude (meters). \br\br
+    Uses the closed form solution of Heikkinen, without iteration.
+*/
+void CWGS84::geocentricToGeodetic(double dX, double dY, double dZ, double& dLatitude, double& dLongitude, double& dAltitude)
+{
+    const double a = WGS84_SEMI_MAJOR_AXIS;
+    const double b = WGS84_SEMI_MINOR_AXIS;
+    const double e2 = WGS84_ECCENTRICITY_SQUARED;
+    const double ep2 = (a * a - b * b) / (b * b);
+
+    // Back to the axes used by GeoTrans
+    double x = -dZ;
+    double y = dX;
+    double z = dY;
+
+    double p2 = x * x + y * y;
+    double p = sqrt(p2);
+
+    dLongitude = atan2(y, x) * RAD_TO_DEG;
+
+    if (p < 1e-9)
+    {
+        dLatitude = z < 0.0 ? -90.0 : 90.0;
+        dAltitude = fabs(z) - b;
+        return;
+    }
+
+    double z2 = z * z;
+    double F = 54.0 * b * b * z2;
+    double G = p2 + (1.0 - e2) * z2 - e2 * (a * a - b * b);
+    double c = e2 * e2 * F * p2 / (G * G * G);
+    double s = cbrt(1.0 + c + sqrt(c * c + 2.0 * c));
+    double k = s + 1.0 + 1.0 / s;
+    double P = F / (3.0 * k * k * G * G);
+    double Q = sqrt(1.0 + 2.0 * e2 * e2 * P);
+    double r0 =
+            -(P * e2 * p) / (1.0 + Q) +
+            sqrt(0.5 * a * a * (1.0 + 1.0 / Q) - P * (1.0 - e2) * z2 / (Q * (1.0 + Q)) - 0.5 * P * p2);
+    double t = p - e2 * r0;
+    double U = sqrt(t * t + z2);
+    double V = sqrt(t * t + (1.0 - e2) * z2);
+    double z0 = b * b * z / (a * V);
+
+    dLatitude = atan2(z + ep2 * z0, p) * RAD_TO_DEG;
+    dAltitude = U * (1.0 - b * b / (a * V));
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    \class CGeocentricFrame
+    \brief The tangent frame of a reference point.
+    \inmodule Quick3D
+    \sa CGeoloc, CWGS84
+
+    The frame is the one of CGeoloc::toVector3(const CGeoloc&) : its Y axis goes along the geocentric direction of the reference,
+    which differs slightly from the ellipsoid normal. Rotations are computed once, so that transforming many positions
+    relative to the same reference costs a few multiplications each.
+*/
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Constructs the frame of the geocentric position (\a dX, \a dY, \a dZ).
+*/
+CGeocentricFrame::CGeocentricFrame(double dX, double dY, double dZ)
+    : m_dX(dX)
+    , m_dY(dY)
+    , m_dZ(dZ)
+    , m_dCosYaw(1.0)
+    , m_dSinYaw(0.0)
+    , m_dCosPitch(1.0)
+    , m_dSinPitch(0.0)
+{
+    // Reference in the axes used by GeoTrans, Y and Z negated
+    double dReferenceX = -dZ;
+    double dReferenceY = -dY;
+    double dReferenceZ = -dX;
+
+    double dHorizontal = sqrt(dReferenceX * dReferenceX + dReferenceZ * dReferenceZ);
+    double dLength = sqrt(dHorizontal * dHorizontal + dReferenceY * dReferenceY);
+
+    if (dHorizontal > 0.0)
+    {
+        m_dCosYaw = dReferenceZ / dHorizontal;
+        m_dSinYaw = dReferenceX / dHorizontal;
+    }
+
+    if (dLength > 0.0)
+    {
+        m_dCosPitch = dReferenceY / dLength;
+        m_dSinPitch = dHorizontal / dLength;
+    }
+}
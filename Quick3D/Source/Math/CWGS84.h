@@ -0,0 +1,119 @@
+
+#pragma once
+
+// Std
+#include "math.h"
+
+// Application
+#include "quick3d_global.h"
+
+//-------------------------------------------------------------------------------------------------
+
+#define WGS84_SEMI_MAJOR_AXIS       6378137.0
+#define WGS84_FLATTENING            (1.0 / 298.257223563)
+#define WGS84_SEMI_MINOR_AXIS       (WGS84_SEMI_MAJOR_AXIS * (1.0 - WGS84_FLATTENING))
+#define WGS84_ECCENTRICITY_SQUARED  (WGS84_FLATTENING * (2.0 - WGS84_FLATTENING))
+
+//-------------------------------------------------------------------------------------------------
+
+//! Closed form conversions between WGS84 geodetic coordinates and Quick3D geocentric coordinates
+//! Geocentric axes are those of CGeoloc::toVector3() : Y goes to the north pole, X to longitude 90, Z to longitude 180
+class QUICK3D_EXPORT CWGS84
+{
+public:
+
+    //-------------------------------------------------------------------------------------------------
+    // Static methods
+    //-------------------------------------------------------------------------------------------------
+
+    //! Converts a geodetic position, angles in degrees, to a geocentric position
+    static inline void geodeticToGeocentric(double dLatitude, double dLongitude, double dAltitude, double& dX, double& dY, double& dZ)
+    {
+        double dLatitudeRad = dLatitude * (3.14159265358979323846 / 180.0);
+        double dLongitudeRad = dLongitude * (3.14159265358979323846 / 180.0);
+        double dSinLatitude = sin(dLatitudeRad);
+        double dCosLatitude = cos(dLatitudeRad);
+
+        // Radius of curvature in the prime vertical
+        double dN = WGS84_SEMI_MAJOR_AXIS / sqrt(1.0 - WGS84_ECCENTRICITY_SQUARED * dSinLatitude * dSinLatitude);
+        double dEquatorial = (dN + dAltitude) * dCosLatitude;
+
+        dX = dEquatorial * sin(dLongitudeRad);
+        dY = (dN * (1.0 - WGS84_ECCENTRICITY_SQUARED) + dAltitude) * dSinLatitude;
+        dZ = -dEquatorial * cos(dLongitudeRad);
+    }
+
+    //! Converts iCount geodetic positions, angles in degrees, to geocentric positions
+    //! Uses AVX2 when the library is built with it
+    static void geodeticToGeocentric(
+            const double* pLatitudes, const double* pLongitudes, const double* pAltitudes,
+            double* pX, double* pY, double* pZ,
+            int iCount
+            );
+
+    //! Converts a geocentric position to a geodetic position, angles in degrees
+    static void geocentricToGeodetic(double dX, double dY, double dZ, double& dLatitude, double& dLongitude, double& dAltitude);
+};
+
+//-------------------------------------------------------------------------------------------------
+
+//! The tangent frame of a reference point, as used by CGeoloc::toVector3(const CGeoloc&)
+//! Y is along the geocentric direction of the reference, Z goes to the north, X to the east
+class QUICK3D_EXPORT CGeocentricFrame
+{
+public:
+
+    //-------------------------------------------------------------------------------------------------
+    // Constructors and destructor
+    //-------------------------------------------------------------------------------------------------
+
+    //! Builds the frame of the geocentric position (dX, dY, dZ)
+    CGeocentricFrame(double dX, double dY, double dZ);
+
+    //-------------------------------------------------------------------------------------------------
+    // Control methods
+    //-------------------------------------------------------------------------------------------------
+
+    //! Transforms a geocentric position to a position relative to the reference, in its tangent frame
+    inline void toLocal(double dX, double dY, double dZ, double& dLocalX, double& dLocalY, double& dLocalZ) const
+    {
+        // Offset in the axes used by GeoTrans, Y and Z negated
+        double dOffsetX = -(dZ - m_dZ);
+        double dOffsetY = -(dY - m_dY);
+        double dOffsetZ = -(dX - m_dX);
+
+        double dTempZ = m_dSinYaw * dOffsetX + m_dCosYaw * dOffsetZ;
+
+        dLocalX = m_dCosYaw * dOffsetX - m_dSinYaw * dOffsetZ;
+        dLocalY = m_dCosPitch * dOffsetY + m_dSinPitch * dTempZ;
+        dLocalZ = m_dCosPitch * dTempZ - m_dSinPitch * dOffsetY;
+    }
+
+    //! Transforms a position relative to the reference, in its tangent frame, to a geocentric position
+    inline void toGeocentric(double dLocalX, double dLocalY, double dLocalZ, double& dX, double& dY, double& dZ) const
+    {
+        double dTempY = m_dCosPitch * dLocalY - m_dSinPitch * dLocalZ;
+        double dTempZ = m_dSinPitch * dLocalY + m_dCosPitch * dLocalZ;
+
+        double dOffsetX = m_dCosYaw * dLocalX + m_dSinYaw * dTempZ;
+        double dOffsetZ = m_dCosYaw * dTempZ - m_dSinYaw * dLocalX;
+
+        dX = m_dX - dOffsetZ;
+        dY = m_dY - dTempY;
+        dZ = m_dZ - dOffsetX;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+    // Properties
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    double  m_dX;               // Geocentric position of the reference
+    double  m_dY;
+    double  m_dZ;
+    double  m_dCosYaw;          // Rotation about Y bringing the reference in the YZ plane
+    double  m_dSinYaw;
+    double  m_dCosPitch;        // Rotation about X bringing the reference on the Y axis
+    double  m_dSinPitch;
+};
@@ -206,9 +206,9 @@ protected:
         {
             if (tPartition.children().count() > 0)
             {
-                foreach (CBoundPartition<T> mtChild, tPartition.children())
+                for (int iChildIndex = 0; iChildIndex < tPartition.children().count(); iChildIndex++)
                 {
-                    Math::RayTracingResult dNewResult = intersectPartitionsInternal(pContainer, mtChild, ray);
+                    Math::RayTracingResult dNewResult = intersectPartitionsInternal(pContainer, tPartition.children()[iChildIndex], ray);
 
                     if (dNewResult.m_dDistance < dReturnResult.m_dDistance)
                     {
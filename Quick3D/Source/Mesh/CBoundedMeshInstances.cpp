@@ -1,4 +1,8 @@
 
+// Qt
+#include <QPair>
+
+// Application
 #include "C3DScene.h"
 #include "CBoundedMeshInstances.h"
 
@@ -8,6 +12,40 @@ using namespace Math;
 
 //-------------------------------------------------------------------------------------------------
 
+#define MORTON_BITS     10
+
+//-------------------------------------------------------------------------------------------------
+
+// Interleaves the 10 bits of iValue with two zero bits each
+static quint32 spreadMortonBits(quint32 iValue)
+{
+    iValue &= 0x000003FF;
+    iValue = (iValue | (iValue << 16)) & 0x030000FF;
+    iValue = (iValue | (iValue << 8)) & 0x0300F00F;
+    iValue = (iValue | (iValue << 4)) & 0x030C30C3;
+    iValue = (iValue | (iValue << 2)) & 0x09249249;
+
+    return iValue;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+// Returns the position of vPosition along a Morton curve filling bBounds
+static quint32 mortonCode(const CVector3& vPosition, const CBoundingBox& bBounds)
+{
+    CVector3 vSize = bBounds.maximum() - bBounds.minimum();
+    CVector3 vRelative = vPosition - bBounds.minimum();
+    double dScale = (double) ((1 << MORTON_BITS) - 1);
+
+    quint32 iX = (quint32) qBound(0.0, vSize.X > 0.0 ? vRelative.X / vSize.X * dScale : 0.0, dScale);
+    quint32 iY = (quint32) qBound(0.0, vSize.Y > 0.0 ? vRelative.Y / vSize.Y * dScale : 0.0, dScale);
+    quint32 iZ = (quint32) qBound(0.0, vSize.Z > 0.0 ? vRelative.Z / vSize.Z * dScale : 0.0, dScale);
+
+    return (spreadMortonBits(iX) << 2) | (spreadMortonBits(iY) << 1) | spreadMortonBits(iZ);
+}
+
+//-------------------------------------------------------------------------------------------------
+
 CBoundedMeshInstances::CBoundedMeshInstances(C3DScene* pScene)
     : CComponent(pScene)
 {
@@ -20,6 +58,15 @@ CBoundedMeshInstances::~CBoundedMeshInstances()
 {
     CComponent::decComponentCounter(ClassName_CBoundedMeshInstances);
 
+    clearInstanceGroups();
+
+    if (m_vRetiredBuffers.count() > 0)
+    {
+        m_pScene->makeCurrentRenderingContext();
+
+        deleteRetiredBuffers();
+    }
+
     foreach (CMeshInstance* pMesh, m_vMeshes)
     {
         if (pMesh != nullptr)
@@ -54,6 +101,8 @@ CBoundingBox CBoundedMeshInstances::worldBounds()
 
 void CBoundedMeshInstances::update(double dDeltaTime)
 {
+    QMutexLocker locker(&m_mMutex);
+
     foreach (CMeshInstance* pMeshInstance, m_vMeshes)
     {
         pMeshInstance->update(dDeltaTime);
@@ -67,11 +116,87 @@ void CBoundedMeshInstances::paint(CRenderContext* pContext)
     CVector3 vPosition = pContext->internalCameraMatrix() * worldBounds().center();
     double dRadius = worldBounds().radius();
 
+    QMutexLocker locker(&m_mMutex);
+
+    deleteRetiredBuffers();
+
     if (pContext->scene()->frustumCheck() == false || pContext->camera()->contains(vPosition, dRadius))
     {
-        foreach (CMeshInstance* pMeshInstance, m_vMeshes)
+        if (m_vGroups.count() > 0 && pContext->scene()->glExtension()->hasInstancing())
+        {
+            paintInstanceGroups(pContext);
+        }
+        else
+        {
+            foreach (CMeshInstance* pMeshInstance, m_vMeshes)
+            {
+                pMeshInstance->paint(pContext);
+            }
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CBoundedMeshInstances::paintInstanceGroups(CRenderContext* pContext)
+{
+    // Instance transforms are relative to the center of the bounds
+    CVector3 vBase = m_bBounds.center() - pContext->scene()->worldOrigin();
+
+    QMatrix4x4 mBase;
+    mBase.setToIdentity();
+    mBase.translate(vBase.X, vBase.Y, vBase.Z);
+
+    foreach (CMeshInstanceGroup* pGroup, m_vGroups)
+    {
+        if (pGroup->m_iBuffer == 0)
+        {
+            GL_glGenBuffers(1, &pGroup->m_iBuffer);
+            GL_glBindBuffer(GL_ARRAY_BUFFER, pGroup->m_iBuffer);
+            GL_glBufferData(GL_ARRAY_BUFFER, pGroup->m_vTransforms.count() * sizeof(GLfloat), pGroup->m_vTransforms.constData(), GL_STATIC_DRAW);
+
+            pContext->tStatistics.m_iNumStateCalls += 3;
+            pContext->tStatistics.m_iNumBytesUploaded += pGroup->m_vTransforms.count() * sizeof(GLfloat);
+        }
+
+        // Select the level of detail of each instance, consecutive instances sharing one make a range
+        QVector<QVector<CInstanceRange> > vRanges(pGroup->m_vMeshes.count());
+
+        for (int iInstance = 0; iInstance < pGroup->m_vInstances.count(); iInstance++)
+        {
+            double dDistance = (pContext->internalCameraMatrix() * pGroup->m_vCenters[iInstance]).magnitude();
+
+            for (int iLOD = 0; iLOD < pGroup->m_vMeshes.count(); iLOD++)
+            {
+                if (dDistance <= pGroup->m_vMeshes[iLOD]->geometry()->maxDistance())
+                {
+                    QVector<CInstanceRange>& vLODRanges = vRanges[iLOD];
+
+                    if (vLODRanges.count() > 0 && vLODRanges.last().iFirst + vLODRanges.last().iCount == iInstance)
+                    {
+                        vLODRanges.last().iCount++;
+                    }
+                    else
+                    {
+                        CInstanceRange tRange;
+                        tRange.iFirst = iInstance;
+                        tRange.iCount = 1;
+                        vLODRanges.append(tRange);
+                    }
+
+                    break;
+                }
+            }
+        }
+
+        for (int iLOD = 0; iLOD < pGroup->m_vMeshes.count(); iLOD++)
         {
-            pMeshInstance->paint(pContext);
+            if (vRanges[iLOD].count() > 0)
+            {
+                QSP<CMesh> pMesh = pGroup->m_vMeshes[iLOD];
+
+                pMesh->geometry()->paintInstances(pContext, pMesh.data(), mBase, pGroup->m_iBuffer, pGroup->m_vTransforms, vRanges[iLOD]);
+            }
         }
     }
 }
@@ -80,9 +205,134 @@ void CBoundedMeshInstances::paint(CRenderContext* pContext)
 
 void CBoundedMeshInstances::add(CMeshInstance* pMeshInstance)
 {
+    QMutexLocker locker(&m_mMutex);
+
     if (pMeshInstance != nullptr && m_vMeshes.contains(pMeshInstance) == false)
     {
         m_vMeshes.append(pMeshInstance);
+
+        // Groups are built again by the owner, instances are drawn one by one until then
+        clearInstanceGroups();
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CBoundedMeshInstances::buildInstances()
+{
+    // Groups are built aside, the rendering thread draws the previous ones meanwhile
+    QVector<CMeshInstanceGroup*> vGroups;
+    QVector<CMeshInstance*> vMeshes;
+
+    {
+        QMutexLocker locker(&m_mMutex);
+
+        vMeshes = m_vMeshes;
+    }
+
+    // Group the instances by meshes, each along a Morton curve
+    QVector<QVector<QPair<quint32, CMeshInstance*> > > vSortedInstances;
+
+    foreach (CMeshInstance* pMeshInstance, vMeshes)
+    {
+        if (pMeshInstance->meshes().count() == 0)
+        {
+            continue;
+        }
+
+        int iGroup = 0;
+
+        for (; iGroup < vGroups.count(); iGroup++)
+        {
+            if (vGroups[iGroup]->m_vMeshes == pMeshInstance->meshes())
+            {
+                break;
+            }
+        }
+
+        if (iGroup == vGroups.count())
+        {
+            CMeshInstanceGroup* pGroup = new CMeshInstanceGroup();
+            pGroup->m_vMeshes = pMeshInstance->meshes();
+            pGroup->m_iBuffer = 0;
+
+            vGroups.append(pGroup);
+            vSortedInstances.append(QVector<QPair<quint32, CMeshInstance*> >());
+        }
+
+        vSortedInstances[iGroup].append(QPair<quint32, CMeshInstance*>(mortonCode(pMeshInstance->worldPosition(), m_bBounds), pMeshInstance));
+    }
+
+    CVector3 vCenter = m_bBounds.center();
+
+    for (int iGroup = 0; iGroup < vGroups.count(); iGroup++)
+    {
+        CMeshInstanceGroup* pGroup = vGroups[iGroup];
+
+        qSort(vSortedInstances[iGroup]);
+
+        pGroup->m_vTransforms.reserve(vSortedInstances[iGroup].count() * 16);
+
+        for (int iIndex = 0; iIndex < vSortedInstances[iGroup].count(); iIndex++)
+        {
+            CMeshInstance* pMeshInstance = vSortedInstances[iGroup][iIndex].second;
+
+            // Same rotation order as CMeshGeometry::paint()
+            CVector3 vPosition = pMeshInstance->worldPosition() - vCenter;
+            CVector3 vRotation = pMeshInstance->worldRotation();
+
+            QMatrix4x4 mTransform;
+            mTransform.setToIdentity();
+            mTransform.translate(vPosition.X, vPosition.Y, vPosition.Z);
+            mTransform.rotate(Math::Angles::toDeg(vRotation.Y), QVector3D(0, 1, 0));
+            mTransform.rotate(Math::Angles::toDeg(vRotation.X), QVector3D(1, 0, 0));
+            mTransform.rotate(Math::Angles::toDeg(vRotation.Z), QVector3D(0, 0, 1));
+
+            const float* pData = mTransform.constData();
+
+            for (int iValue = 0; iValue < 16; iValue++)
+            {
+                pGroup->m_vTransforms.append(pData[iValue]);
+            }
+
+            pGroup->m_vInstances.append(pMeshInstance);
+            pGroup->m_vCenters.append(pMeshInstance->worldBounds().center());
+        }
+    }
+
+    QMutexLocker locker(&m_mMutex);
+
+    clearInstanceGroups();
+
+    m_vGroups = vGroups;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CBoundedMeshInstances::clearInstanceGroups()
+{
+    foreach (CMeshInstanceGroup* pGroup, m_vGroups)
+    {
+        if (pGroup->m_iBuffer != 0)
+        {
+            m_vRetiredBuffers.append(pGroup->m_iBuffer);
+        }
+
+        delete pGroup;
+    }
+
+    m_vGroups.clear();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CBoundedMeshInstances::deleteRetiredBuffers()
+{
+    if (m_vRetiredBuffers.count() > 0)
+    {
+        GL_glDeleteBuffers(m_vRetiredBuffers.count(), m_vRetiredBuffers.constData());
+
+        m_vRetiredBuffers.clear();
     }
 }
 
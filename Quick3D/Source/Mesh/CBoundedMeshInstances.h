@@ -1,6 +1,9 @@
 
 #pragma once
 
+// Qt
+#include <QMutex>
+
 // Application
 #include "quick3d_global.h"
 #include "CQ3DConstants.h"
@@ -11,6 +14,20 @@
 
 class C3DScene;
 
+//-------------------------------------------------------------------------------------------------
+
+//! Instances of a CBoundedMeshInstances sharing the same meshes, drawn with instanced calls
+class QUICK3D_EXPORT CMeshInstanceGroup
+{
+public:
+
+    QVector<QSP<CMesh> >        m_vMeshes;          // Levels of detail shared by the instances
+    QVector<CMeshInstance*>     m_vInstances;       // Sorted along a Morton curve, so that close instances make ranges
+    QVector<Math::CVector3>     m_vCenters;         // World bounds centers of the instances, for level of detail selection
+    QVector<GLfloat>            m_vTransforms;      // 16 column major floats per instance, relative to the bounds center
+    GLuint                      m_iBuffer;          // OpenGL buffer holding m_vTransforms, 0 until first paint
+};
+
 class QUICK3D_EXPORT CBoundedMeshInstances : public CComponent
 {
 public:
@@ -39,6 +56,9 @@ public:
     //!
     const QVector<CMeshInstance*>& meshes() { return m_vMeshes; }
 
+    //! Returns the instance groups, empty until buildInstances() is called
+    const QVector<CMeshInstanceGroup*>& instanceGroups() const { return m_vGroups; }
+
     //-------------------------------------------------------------------------------------------------
     // Inherited methods
     //-------------------------------------------------------------------------------------------------
@@ -68,8 +88,33 @@ public:
     //! Ajoute un mesh dans ce dlimiteur
     void add(CMeshInstance* pMeshInstance);
 
+    //! Groups the instances by meshes and computes their transforms, without OpenGL calls
+    void buildInstances();
+
+    //-------------------------------------------------------------------------------------------------
+    // Protected control methods
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    //! Deletes the instance groups, their buffers are deleted by the next paint(), m_mMutex must be locked
+    void clearInstanceGroups();
+
+    //! Deletes the buffers of the groups cleared since the last paint, in the rendering thread
+    void deleteRetiredBuffers();
+
+    //! Draws the instance groups, one call per range of instances sharing a level of detail
+    void paintInstanceGroups(CRenderContext* pContext);
+
+    //-------------------------------------------------------------------------------------------------
+    // Properties
+    //-------------------------------------------------------------------------------------------------
+
 protected:
 
-    CBoundingBox                m_bBounds;
-    QVector<CMeshInstance*>     m_vMeshes;
+    CBoundingBox                    m_bBounds;
+    QVector<CMeshInstance*>         m_vMeshes;
+    QMutex                          m_mMutex;               // Protects m_vMeshes, m_vGroups and m_vRetiredBuffers, groups are built in pool threads
+    QVector<CMeshInstanceGroup*>    m_vGroups;              // Built by buildInstances(), emptied when instances are added
+    QVector<GLuint>                 m_vRetiredBuffers;      // Buffers of cleared groups, OpenGL is only called by the rendering thread
 };
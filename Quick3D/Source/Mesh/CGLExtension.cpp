@@ -2,41 +2,83 @@
 // Application
 #include "CGLExtension.h"
 
+// Qt
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+
 #ifndef WIN32
 #include <GL/glx.h>
 #endif
 
 //-------------------------------------------------------------------------------------------------
 
-CGLExtension::CGLExtension()
+// Resolves a function of the current context, through Qt so that EGL contexts without a window system work too
+static void* getProcAddress(const char* sName)
 {
+    QOpenGLContext* pContext = QOpenGLContext::currentContext();
+
+    if (pContext != nullptr)
+    {
+        return (void*) pContext->getProcAddress(sName);
+    }
+
 #ifdef WIN32
-	glGenBuffers				= (PFNGLGENBUFFERSPROC) wglGetProcAddress("glGenBuffers");
-	glDeleteBuffers				= (PFNGLDELETEBUFFERSPROC) wglGetProcAddress("glDeleteBuffers");
-	glBindBuffer				= (PFNGLBINDBUFFERPROC) wglGetProcAddress("glBindBuffer");
-	glBufferData				= (PFNGLBUFFERDATAPROC) wglGetProcAddress("glBufferData");
-	glGetAttribLocation			= (PFNGLGETATTRIBLOCATIONPROC) wglGetProcAddress("glGetAttribLocation");
-	glEnableVertexAttribArray	= (PFNGLENABLEVERTEXATTRIBARRAYPROC) wglGetProcAddress("glEnableVertexAttribArray");
-	glDisableVertexAttribArray	= (PFNGLDISABLEVERTEXATTRIBARRAYPROC) wglGetProcAddress("glDisableVertexAttribArray");
-	glVertexAttribPointer		= (PFNGLVERTEXATTRIBPOINTERPROC) wglGetProcAddress("glVertexAttribPointer");
-	glActiveTexture				= (PFNGLACTIVETEXTUREPROC) wglGetProcAddress("glActiveTexture");
-	glGenerateMipmap			= (PFNGLGENERATEMIPMAPPROC) wglGetProcAddress("glGenerateMipmap");
+    return (void*) wglGetProcAddress(sName);
 #else
-    glGenBuffers				= (PFNGLGENBUFFERSPROC) glXGetProcAddress((const GLubyte *)("glGenBuffers"));
-    glDeleteBuffers				= (PFNGLDELETEBUFFERSPROC) glXGetProcAddress((const GLubyte *)("glDeleteBuffers"));
-    glBindBuffer				= (PFNGLBINDBUFFERPROC) glXGetProcAddress((const GLubyte *)("glBindBuffer"));
-    glBufferData				= (PFNGLBUFFERDATAPROC) glXGetProcAddress((const GLubyte *)("glBufferData"));
-    glGetAttribLocation			= (PFNGLGETATTRIBLOCATIONPROC) glXGetProcAddress((const GLubyte *)("glGetAttribLocation"));
-    glEnableVertexAttribArray	= (PFNGLENABLEVERTEXATTRIBARRAYPROC) glXGetProcAddress((const GLubyte *)("glEnableVertexAttribArray"));
-    glDisableVertexAttribArray	= (PFNGLDISABLEVERTEXATTRIBARRAYPROC) glXGetProcAddress((const GLubyte *)("glDisableVertexAttribArray"));
-    glVertexAttribPointer		= (PFNGLVERTEXATTRIBPOINTERPROC) glXGetProcAddress((const GLubyte *)("glVertexAttribPointer"));
-    glActiveTexture				= (PFNGLACTIVETEXTUREPROC) glXGetProcAddress((const GLubyte *)("glActiveTexture"));
-    glGenerateMipmap			= (PFNGLGENERATEMIPMAPPROC) glXGetProcAddress((const GLubyte *)("glGenerateMipmap"));
+    return (void*) glXGetProcAddress((const GLubyte *) sName);
 #endif
 }
 
 //-------------------------------------------------------------------------------------------------
 
+CGLExtension::CGLExtension()
+{
+    glGenBuffers                = (PFNGLGENBUFFERSPROC) getProcAddress("glGenBuffers");
+    glDeleteBuffers             = (PFNGLDELETEBUFFERSPROC) getProcAddress("glDeleteBuffers");
+    glBindBuffer                = (PFNGLBINDBUFFERPROC) getProcAddress("glBindBuffer");
+    glBufferData                = (PFNGLBUFFERDATAPROC) getProcAddress("glBufferData");
+    glBufferSubData             = (PFNGLBUFFERSUBDATAPROC) getProcAddress("glBufferSubData");
+    glMapBuffer                 = (PFNGLMAPBUFFERPROC) getProcAddress("glMapBuffer");
+    glUnmapBuffer               = (PFNGLUNMAPBUFFERPROC) getProcAddress("glUnmapBuffer");
+    glGenVertexArrays           = (PFNGLGENVERTEXARRAYSPROC) getProcAddress("glGenVertexArrays");
+    glDeleteVertexArrays        = (PFNGLDELETEVERTEXARRAYSPROC) getProcAddress("glDeleteVertexArrays");
+    glBindVertexArray           = (PFNGLBINDVERTEXARRAYPROC) getProcAddress("glBindVertexArray");
+    glGetAttribLocation         = (PFNGLGETATTRIBLOCATIONPROC) getProcAddress("glGetAttribLocation");
+    glEnableVertexAttribArray   = (PFNGLENABLEVERTEXATTRIBARRAYPROC) getProcAddress("glEnableVertexAttribArray");
+    glDisableVertexAttribArray  = (PFNGLDISABLEVERTEXATTRIBARRAYPROC) getProcAddress("glDisableVertexAttribArray");
+    glVertexAttribPointer       = (PFNGLVERTEXATTRIBPOINTERPROC) getProcAddress("glVertexAttribPointer");
+    glVertexAttribDivisor       = (PFNGLVERTEXATTRIBDIVISORPROC) getProcAddress("glVertexAttribDivisor");
+    glDrawElementsInstanced     = (PFNGLDRAWELEMENTSINSTANCEDPROC) getProcAddress("glDrawElementsInstanced");
+    glActiveTexture             = (PFNGLACTIVETEXTUREPROC) getProcAddress("glActiveTexture");
+    glGenerateMipmap            = (PFNGLGENERATEMIPMAPPROC) getProcAddress("glGenerateMipmap");
+
+    // Vertex arrays are core since OpenGL 3.0, getProcAddress() may not return nullptr for missing functions
+    m_bHasVertexArrays =
+            (QGLFormat::openGLVersionFlags() & QGLFormat::OpenGL_Version_3_0) &&
+            glGenVertexArrays != nullptr &&
+            glDeleteVertexArrays != nullptr &&
+            glBindVertexArray != nullptr;
+
+    // Attribute divisors are core since OpenGL 3.3
+    m_bHasInstancing =
+            (QGLFormat::openGLVersionFlags() & QGLFormat::OpenGL_Version_3_3) &&
+            glVertexAttribDivisor != nullptr &&
+            glDrawElementsInstanced != nullptr;
+
+    // Pixel pack buffers are core since OpenGL 2.1
+    m_bHasPixelBuffers =
+            (QGLFormat::openGLVersionFlags() & QGLFormat::OpenGL_Version_2_1) &&
+            glMapBuffer != nullptr &&
+            glUnmapBuffer != nullptr;
+
+    // Float textures and frame buffer objects are core since OpenGL 3.0
+    m_bHasFloatTargets =
+            (QGLFormat::openGLVersionFlags() & QGLFormat::OpenGL_Version_3_0) &&
+            QOpenGLFramebufferObject::hasOpenGLFramebufferObjects();
+}
+
+//-------------------------------------------------------------------------------------------------
+
 CGLExtension::~CGLExtension()
 {
 }
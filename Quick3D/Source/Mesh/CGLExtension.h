@@ -20,10 +20,18 @@
 #define GL_glDeleteBuffers              m_pScene->glExtension()->glDeleteBuffers
 #define GL_glBindBuffer                 m_pScene->glExtension()->glBindBuffer
 #define GL_glBufferData                 m_pScene->glExtension()->glBufferData
+#define GL_glBufferSubData              m_pScene->glExtension()->glBufferSubData
+#define GL_glMapBuffer                  m_pScene->glExtension()->glMapBuffer
+#define GL_glUnmapBuffer                m_pScene->glExtension()->glUnmapBuffer
+#define GL_glGenVertexArrays            m_pScene->glExtension()->glGenVertexArrays
+#define GL_glDeleteVertexArrays         m_pScene->glExtension()->glDeleteVertexArrays
+#define GL_glBindVertexArray            m_pScene->glExtension()->glBindVertexArray
 #define GL_glGetAttribLocation          m_pScene->glExtension()->glGetAttribLocation
 #define GL_glEnableVertexAttribArray    m_pScene->glExtension()->glEnableVertexAttribArray
 #define GL_glDisableVertexAttribArray   m_pScene->glExtension()->glDisableVertexAttribArray
 #define GL_glVertexAttribPointer        m_pScene->glExtension()->glVertexAttribPointer
+#define GL_glVertexAttribDivisor        m_pScene->glExtension()->glVertexAttribDivisor
+#define GL_glDrawElementsInstanced      m_pScene->glExtension()->glDrawElementsInstanced
 #define GL_glActiveTexture              m_pScene->glExtension()->glActiveTexture
 #define GL_glGenerateMipmap             m_pScene->glExtension()->glGenerateMipmap
 
@@ -39,14 +47,41 @@ public:
 	//!
 	~CGLExtension();
 
+	//! Returns true if vertex array objects can be used
+	bool hasVertexArrays() const { return m_bHasVertexArrays; }
+
+	//! Returns true if instanced drawing with per instance attributes can be used
+	bool hasInstancing() const { return m_bHasInstancing; }
+
+	//! Returns true if pixels can be read into buffer objects
+	bool hasPixelBuffers() const { return m_bHasPixelBuffers; }
+
+	//! Returns true if frame buffers can have 32 bit float color attachments
+	bool hasFloatTargets() const { return m_bHasFloatTargets; }
+
 	PFNGLGENBUFFERSPROC					glGenBuffers;
 	PFNGLDELETEBUFFERSPROC				glDeleteBuffers;
 	PFNGLBINDBUFFERPROC					glBindBuffer;
 	PFNGLBUFFERDATAPROC					glBufferData;
+	PFNGLBUFFERSUBDATAPROC				glBufferSubData;
+	PFNGLMAPBUFFERPROC					glMapBuffer;
+	PFNGLUNMAPBUFFERPROC				glUnmapBuffer;
+	PFNGLGENVERTEXARRAYSPROC			glGenVertexArrays;
+	PFNGLDELETEVERTEXARRAYSPROC			glDeleteVertexArrays;
+	PFNGLBINDVERTEXARRAYPROC			glBindVertexArray;
 	PFNGLGETATTRIBLOCATIONPROC			glGetAttribLocation;
 	PFNGLENABLEVERTEXATTRIBARRAYPROC	glEnableVertexAttribArray;
 	PFNGLDISABLEVERTEXATTRIBARRAYPROC	glDisableVertexAttribArray;
 	PFNGLVERTEXATTRIBPOINTERPROC		glVertexAttribPointer;
+	PFNGLVERTEXATTRIBDIVISORPROC		glVertexAttribDivisor;
+	PFNGLDRAWELEMENTSINSTANCEDPROC		glDrawElementsInstanced;
 	PFNGLACTIVETEXTUREPROC				glActiveTexture;
     PFNGLGENERATEMIPMAPPROC				glGenerateMipmap;
+
+protected:
+
+    bool                                m_bHasVertexArrays;
+    bool                                m_bHasInstancing;
+    bool                                m_bHasPixelBuffers;
+    bool                                m_bHasFloatTargets;
 };
@@ -1,4 +1,7 @@
 
+// Qt
+#include <QElapsedTimer>
+
 // qt-plus
 #include "CLogger.h"
 
@@ -22,11 +25,6 @@ using namespace Math;
 
 IMPLEMENT_MEMORY_MONITORED(CGLMeshData, "CGLMeshData")
 
-//-------------------------------------------------------------------------------------------------
-// Static properties
-
-GLuint CGLMeshData::m_iCurrentVBO = 0;
-
 //-------------------------------------------------------------------------------------------------
 
 /*!
@@ -39,7 +37,13 @@ CGLMeshData::CGLMeshData(C3DScene* pScene)
     , m_iNumRenderIndices(0)
     , m_vRenderPoints(nullptr)
     , m_vRenderIndices(nullptr)
+    , m_iVAO(0)
+    , m_pVertexArrayLocations(nullptr)
+    , m_iVertexBufferBytes(0)
+    , m_iIndexBufferBytes(0)
     , m_bNeedTransferBuffers(true)
+    , m_bNeedVertexArraySetup(true)
+    , m_bDynamic(false)
 {
     m_iVBO[0] = 0;
     m_iVBO[1] = 0;
@@ -56,8 +60,16 @@ CGLMeshData::CGLMeshData(C3DScene* pScene)
 */
 CGLMeshData::~CGLMeshData()
 {
+    // Vertex arrays are not shared between contexts, so ours must be current to delete them
+    m_pScene->makeCurrentRenderingContext();
+
     GL_glDeleteBuffers(2, m_iVBO);
 
+    if (m_iVAO != 0)
+    {
+        GL_glDeleteVertexArrays(1, &m_iVAO);
+    }
+
     if (m_vRenderPoints != nullptr)
     {
         delete [] m_vRenderPoints;
@@ -67,8 +79,115 @@ CGLMeshData::~CGLMeshData()
     {
         delete [] m_vRenderIndices;
     }
+}
 
-    m_pScene->makeCurrentRenderingContext();
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Packs \a vVertices in the render buffer, which is transfered to OpenGL at next paint. \br\br
+    Positions are stored as floats relative to the center of the vertices' bounds, kept in m_vRenderOrigin.
+*/
+void CGLMeshData::setRenderPoints(const QVector<CVertex>& vVertices)
+{
+    if (m_vRenderPoints != nullptr)
+    {
+        delete [] m_vRenderPoints;
+        m_vRenderPoints = nullptr;
+    }
+
+    m_iNumRenderPoints = vVertices.count();
+    m_vRenderOrigin = CVector3();
+
+    if (m_iNumRenderPoints == 0)
+    {
+        return;
+    }
+
+    CVector3 vMinimum = vVertices[0].position();
+    CVector3 vMaximum = vVertices[0].position();
+
+    for (int iVertex = 1; iVertex < vVertices.count(); iVertex++)
+    {
+        CVector3 vPosition = vVertices[iVertex].position();
+
+        vMinimum.X = qMin(vMinimum.X, vPosition.X);
+        vMinimum.Y = qMin(vMinimum.Y, vPosition.Y);
+        vMinimum.Z = qMin(vMinimum.Z, vPosition.Z);
+        vMaximum.X = qMax(vMaximum.X, vPosition.X);
+        vMaximum.Y = qMax(vMaximum.Y, vPosition.Y);
+        vMaximum.Z = qMax(vMaximum.Z, vPosition.Z);
+    }
+
+    m_vRenderOrigin = (vMinimum + vMaximum) * 0.5;
+    m_vRenderPoints = new CRenderVertex[m_iNumRenderPoints];
+
+    for (int iVertex = 0; iVertex < vVertices.count(); iVertex++)
+    {
+        m_vRenderPoints[iVertex].pack(vVertices[iVertex], m_vRenderOrigin);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Allocates \a iCount indices in the render buffer, to be filled by the caller.
+*/
+void CGLMeshData::allocateRenderIndices(GLuint iCount)
+{
+    if (m_vRenderIndices != nullptr)
+    {
+        delete [] m_vRenderIndices;
+        m_vRenderIndices = nullptr;
+    }
+
+    m_iNumRenderIndices = iCount;
+
+    if (m_iNumRenderIndices > 0)
+    {
+        m_vRenderIndices = new GLuint[m_iNumRenderIndices];
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Makes this data draw the indices of \a pIndices, which are shared with other meshes. \br\br
+    The own index buffer is released and the primitive type is taken from \a pIndices.
+    Passing \c nullptr goes back to m_vRenderIndices, which must then be allocated again.
+*/
+void CGLMeshData::setSharedIndices(QSP<CSharedIndexBuffer> pIndices)
+{
+    m_pSharedIndices = pIndices;
+
+    if (m_pSharedIndices != nullptr)
+    {
+        allocateRenderIndices(0);
+
+        m_iNumRenderIndices = m_pSharedIndices->count();
+        m_iGLType = m_pSharedIndices->glType();
+    }
+
+    // The vertex array must bind the new index buffer
+    m_bNeedVertexArraySetup = true;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Sets whether the geometry is rebuilt often, like particles or debug segments, to \a bValue. \br\br
+    Dynamic buffers are orphaned and updated with glBufferSubData(), keeping their largest size, so that updates do not wait for draws still reading them.
+*/
+void CGLMeshData::setDynamic(bool bValue)
+{
+    if (m_bDynamic != bValue)
+    {
+        m_bDynamic = bValue;
+
+        // Storage is allocated again with the new usage
+        m_iVertexBufferBytes = 0;
+        m_iIndexBufferBytes = 0;
+        m_bNeedTransferBuffers = true;
+    }
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -89,159 +208,378 @@ void CGLMeshData::paint(CRenderContext* pContext, const QMatrix4x4& mModelAbsolu
 
         pContext->tStatistics.m_iNumMeshesDrawn++;
 
-        if (m_iCurrentVBO != m_iVBO[0])
-        {
-            m_iCurrentVBO = m_iVBO[0];
-
-            pProgram->setUniformValue("u_camera_projection_matrix", pContext->cameraProjectionMatrix());
-            pProgram->setUniformValue("u_camera_matrix", pContext->cameraMatrix());
-            pProgram->setUniformValue("u_shadow_projection_matrix", pContext->shadowProjectionMatrix());
-            pProgram->setUniformValue("u_shadow_matrix", pContext->shadowMatrix());
-            pProgram->setUniformValue("u_model_matrix", mModelAbsolute);
+        CShaderLocations* pLocations = pContext->scene()->shaders()->locations(pProgram);
 
-            GL_glBindBuffer(GL_ARRAY_BUFFER, m_iVBO[0]);
-            GL_glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_iVBO[1]);
+        // Vertex positions are relative to m_vRenderOrigin
+        QMatrix4x4 mModel = mModelAbsolute;
+        mModel.translate(QVector3D(m_vRenderOrigin.X, m_vRenderOrigin.Y, m_vRenderOrigin.Z));
 
-            if (m_bNeedTransferBuffers)
-            {
-                // Transfer vertex data to VBO 0
-                GL_glBufferData(GL_ARRAY_BUFFER, m_iNumRenderPoints * sizeof(CVertex), m_vRenderPoints, GL_STATIC_DRAW);
+        // Camera matrices are set by CMaterial::activate(), the model matrix changes with every draw
+        pProgram->setUniformValue(pLocations->uniform(suModelMatrix), mModel);
+        pContext->tStatistics.m_iNumStateCalls++;
 
-                // Transfer index data to VBO 1
-                GL_glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_iNumRenderIndices * sizeof(GLuint), m_vRenderIndices, GL_STATIC_DRAW);
+        bool bUseVertexArray = bindVertexArray(pContext, pProgram, pLocations);
 
-                m_bNeedTransferBuffers = false;
-            }
+        drawElements(pContext, iGLType, 1);
 
-            // Tell OpenGL how to locate vertex position data
-            int vertexLocation = pProgram->attributeLocation("a_position");
-            pProgram->enableAttributeArray(vertexLocation);
-            GL_glVertexAttribPointer(
-                        vertexLocation, 3, GL_DOUBLE, GL_FALSE, sizeof(CVertex), (const void*) CVertex::positionOffset()
-                        );
-
-            // Tell OpenGL how to locate vertex texture coordinate data
-            int texcoordLocation = pProgram->attributeLocation("a_texcoord");
-            pProgram->enableAttributeArray(texcoordLocation);
-            GL_glVertexAttribPointer(
-                        texcoordLocation, 3, GL_DOUBLE, GL_FALSE, sizeof(CVertex), (const void*) CVertex::texCoordOffset()
-                        );
-
-            // Tell OpenGL how to locate vertex diffuse texture weight data
-            int diffTexWeight_0_1_2Location = pProgram->attributeLocation("a_difftext_weight_0_1_2");
-            pProgram->enableAttributeArray(diffTexWeight_0_1_2Location);
-            GL_glVertexAttribPointer(
-                        diffTexWeight_0_1_2Location, 3, GL_DOUBLE, GL_FALSE, sizeof(CVertex), (const void*) CVertex::diffTexWeight_0_1_2Offset()
-                        );
-
-            // Tell OpenGL how to locate vertex diffuse texture weight data
-            int diffTexWeight_3_4_5Location = pProgram->attributeLocation("a_difftext_weight_3_4_5");
-            pProgram->enableAttributeArray(diffTexWeight_3_4_5Location);
-            GL_glVertexAttribPointer(
-                        diffTexWeight_3_4_5Location, 3, GL_DOUBLE, GL_FALSE, sizeof(CVertex), (const void*) CVertex::diffTexWeight_3_4_5Offset()
-                        );
-
-            // Tell OpenGL how to locate vertex diffuse texture weight data
-            int diffTexWeight_6_7_8Location = pProgram->attributeLocation("a_difftext_weight_6_7_8");
-            pProgram->enableAttributeArray(diffTexWeight_6_7_8Location);
-            GL_glVertexAttribPointer(
-                        diffTexWeight_6_7_8Location, 3, GL_DOUBLE, GL_FALSE, sizeof(CVertex), (const void*) CVertex::diffTexWeight_6_7_8Offset()
-                        );
-
-            // Tell OpenGL how to locate vertex normal data
-            int normalLocation = pProgram->attributeLocation("a_normal");
-            pProgram->enableAttributeArray(normalLocation);
-            GL_glVertexAttribPointer(
-                        normalLocation, 3, GL_DOUBLE, GL_FALSE, sizeof(CVertex), (const void*) CVertex::normalOffset()
-                        );
-
-            // Tell OpenGL how to locate vertex tangent data
-            int tangentLocation = pProgram->attributeLocation("a_tangent");
-            pProgram->enableAttributeArray(tangentLocation);
-            GL_glVertexAttribPointer(
-                        tangentLocation, 3, GL_DOUBLE, GL_FALSE, sizeof(CVertex), (const void*) CVertex::tangentOffset()
-                        );
-
-            // Tell OpenGL how to locate altitude data
-            int altitudeLocation = pProgram->attributeLocation("a_altitude");
-            pProgram->enableAttributeArray(altitudeLocation);
-            GL_glVertexAttribPointer(
-                        altitudeLocation, 1, GL_DOUBLE, GL_FALSE, sizeof(CVertex), (const void*) CVertex::altitudeOffset()
-                        );
+        // Leave no vertex array bound, so that other buffer bindings do not change it
+        if (bUseVertexArray)
+        {
+            GL_glBindVertexArray(0);
+            pContext->tStatistics.m_iNumStateCalls++;
         }
+    }
+}
 
-        switch (iGLType)
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Renders instances of the object, each placed by a transform of \a vTransforms. \br\br
+    \a pContext is the rendering context. \br
+    \a mModelAbsolute is the model matrix applied before each instance transform, usually the scale. \br
+    \a pProgram is the shader program to use. \br
+    \a iGLType can be one of: GL_POINTS, GL_LINES, GL_TRIANGLES, GL_QUADS \br
+    \a mBase is the matrix applied after each instance transform, it places them relative to the world origin. \br
+    \a iInstanceBuffer is an OpenGL buffer holding \a vTransforms, 16 column major floats per instance. \br
+    \a vRanges are the ranges of instances to draw, one draw call each. \br\br
+    Programs without the per instance attribute, or contexts without instancing, draw one instance at a time.
+*/
+void CGLMeshData::paintInstances(
+        CRenderContext* pContext,
+        const QMatrix4x4& mModelAbsolute,
+        QGLShaderProgram* pProgram,
+        int iGLType,
+        const QMatrix4x4& mBase,
+        GLuint iInstanceBuffer,
+        const QVector<GLfloat>& vTransforms,
+        const QVector<CInstanceRange>& vRanges
+        )
+{
+    // If at least one point to render
+    if (m_iNumRenderPoints > 0 && m_iNumRenderIndices > 0 && m_iVBO[0] > 0 && m_iVBO[1] > 0)
+    {
+        m_pScene->makeCurrentRenderingContext();
+
+        CShaderLocations* pLocations = pContext->scene()->shaders()->locations(pProgram);
+        int iInstanceLocation = pLocations->attribute(saInstanceMatrix);
+
+        if (iInstanceLocation < 0 || iInstanceBuffer == 0 || m_pScene->glExtension()->hasInstancing() == false)
         {
-            case GL_POINTS:
+            for (const CInstanceRange& tRange : vRanges)
             {
-                try
-                {
-                    // Draw quads
-                    glDrawElements(GL_POINTS, m_iNumRenderIndices, GL_UNSIGNED_INT, 0);
-                }
-                catch (...)
+                for (int iInstance = tRange.iFirst; iInstance < tRange.iFirst + tRange.iCount; iInstance++)
                 {
-                    // LOG_ERROR(QString("CMesh::paint() : Exception while rendering %1").arg(m_sName));
+                    // The constructor reads rows, the transforms are stored by columns
+                    QMatrix4x4 mInstance = QMatrix4x4(vTransforms.constData() + iInstance * 16).transposed();
+
+                    paint(pContext, mBase * mInstance * mModelAbsolute, pProgram, iGLType);
                 }
+            }
 
-                pContext->tStatistics.m_iNumPolysDrawn += (m_iNumRenderIndices);
+            return;
+        }
 
-                break;
-            }
+        // Vertex positions are relative to m_vRenderOrigin
+        QMatrix4x4 mModel = mModelAbsolute;
+        mModel.translate(QVector3D(m_vRenderOrigin.X, m_vRenderOrigin.Y, m_vRenderOrigin.Z));
 
-            case GL_LINES:
-            {
-                try
-                {
-                    // Draw quads
-                    glDrawElements(GL_LINES, m_iNumRenderIndices, GL_UNSIGNED_INT, 0);
-                }
-                catch (...)
-                {
-                    // LOG_ERROR(QString("CMesh::paint() : Exception while rendering %1").arg(m_sName));
-                }
+        pProgram->setUniformValue(pLocations->uniform(suModelMatrix), mModel);
+        pProgram->setUniformValue(pLocations->uniform(suInstanceBaseMatrix), mBase);
+        pProgram->setUniformValue(pLocations->uniform(suInstanced), 1);
+        pContext->tStatistics.m_iNumStateCalls += 3;
 
-                pContext->tStatistics.m_iNumPolysDrawn += (m_iNumRenderIndices);
+        bool bUseVertexArray = bindVertexArray(pContext, pProgram, pLocations);
 
-                break;
-            }
+        // A matrix attribute uses one location per column, advanced once per instance
+        GL_glBindBuffer(GL_ARRAY_BUFFER, iInstanceBuffer);
 
-            case GL_TRIANGLES:
-            {
-                try
-                {
-                    // Draw triangles
-                    glDrawElements(GL_TRIANGLES, m_iNumRenderIndices, GL_UNSIGNED_INT, 0);
-                }
-                catch (...)
-                {
-                    // LOG_ERROR(QString("CMesh::paint() : Exception while rendering %1").arg(m_sName));
-                }
+        for (int iColumn = 0; iColumn < 4; iColumn++)
+        {
+            pProgram->enableAttributeArray(iInstanceLocation + iColumn);
+            GL_glVertexAttribDivisor(iInstanceLocation + iColumn, 1);
+        }
 
-                pContext->tStatistics.m_iNumPolysDrawn += (m_iNumRenderIndices / 3);
+        pContext->tStatistics.m_iNumStateCalls += 9;
 
-                break;
+        for (const CInstanceRange& tRange : vRanges)
+        {
+            for (int iColumn = 0; iColumn < 4; iColumn++)
+            {
+                GL_glVertexAttribPointer(
+                            iInstanceLocation + iColumn, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(GLfloat),
+                            (const void*) ((tRange.iFirst * 16 + iColumn * 4) * sizeof(GLfloat))
+                            );
             }
 
-            case GL_QUADS:
+            pContext->tStatistics.m_iNumStateCalls += 4;
+            pContext->tStatistics.m_iNumMeshesDrawn += tRange.iCount;
+
+            drawElements(pContext, iGLType, tRange.iCount);
+        }
+
+        for (int iColumn = 0; iColumn < 4; iColumn++)
+        {
+            GL_glVertexAttribDivisor(iInstanceLocation + iColumn, 0);
+            pProgram->disableAttributeArray(iInstanceLocation + iColumn);
+        }
+
+        pProgram->setUniformValue(pLocations->uniform(suInstanced), 0);
+        pContext->tStatistics.m_iNumStateCalls += 9;
+
+        // Leave no vertex array bound, so that other buffer bindings do not change it
+        if (bUseVertexArray)
+        {
+            GL_glBindVertexArray(0);
+            pContext->tStatistics.m_iNumStateCalls++;
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Makes the vertex attributes of this data current for \a pProgram, whose locations are \a pLocations. \br\br
+    Buffers are transfered if needed. With vertex arrays, the vertex array of this data is left bound and \c true is returned.
+    Without, attributes are specified again only when the buffer changes.
+*/
+bool CGLMeshData::bindVertexArray(CRenderContext* pContext, QGLShaderProgram* pProgram, CShaderLocations* pLocations)
+{
+    bool bUseVertexArray = m_pScene->glExtension()->hasVertexArrays();
+
+    if (bUseVertexArray)
+    {
+        if (m_iVAO == 0)
+        {
+            GL_glGenVertexArrays(1, &m_iVAO);
+            m_bNeedVertexArraySetup = true;
+        }
+
+        // The vertex array holds the index buffer binding and the attribute pointers
+        GL_glBindVertexArray(m_iVAO);
+        pContext->tStatistics.m_iNumStateCalls++;
+
+        if (m_bNeedTransferBuffers || m_bNeedVertexArraySetup || m_pVertexArrayLocations != pLocations)
+        {
+            bindBuffers(pContext);
+
+            if (m_bNeedTransferBuffers)
             {
-                try
-                {
-                    // Draw quads
-                    glDrawElements(GL_QUADS, m_iNumRenderIndices, GL_UNSIGNED_INT, 0);
-                }
-                catch (...)
-                {
-                    // LOG_ERROR(QString("CMesh::paint() : Exception while rendering %1").arg(m_sName));
-                }
+                transferBuffers(pContext);
+            }
 
-                pContext->tStatistics.m_iNumPolysDrawn += (m_iNumRenderIndices / 4);
+            if (m_bNeedVertexArraySetup || m_pVertexArrayLocations != pLocations)
+            {
+                setupVertexAttributes(pContext, pProgram, pLocations);
 
-                break;
+                m_pVertexArrayLocations = pLocations;
+                m_bNeedVertexArraySetup = false;
             }
+        }
+    }
+    else if (pContext->iCurrentVBO != m_iVBO[0] || m_bNeedTransferBuffers)
+    {
+        // Without vertex arrays, attributes are specified again when the buffer changes, each context tracks its own
+        pContext->iCurrentVBO = m_iVBO[0];
 
-            default:
-                break;
+        bindBuffers(pContext);
+
+        if (m_bNeedTransferBuffers)
+        {
+            transferBuffers(pContext);
         }
+
+        setupVertexAttributes(pContext, pProgram, pLocations);
+    }
+
+    return bUseVertexArray;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Draws the indices as \a iGLType primitives, \a iInstanceCount times.
+*/
+void CGLMeshData::drawElements(CRenderContext* pContext, int iGLType, GLsizei iInstanceCount)
+{
+    GLuint iIndicesPerPoly = 0;
+
+    switch (iGLType)
+    {
+        case GL_POINTS:
+        case GL_LINES:
+            iIndicesPerPoly = 1;
+            break;
+
+        case GL_TRIANGLES:
+            iIndicesPerPoly = 3;
+            break;
+
+        case GL_QUADS:
+            iIndicesPerPoly = 4;
+            break;
+
+        default:
+            return;
     }
+
+    try
+    {
+        if (iInstanceCount > 1)
+        {
+            GL_glDrawElementsInstanced(iGLType, m_iNumRenderIndices, GL_UNSIGNED_INT, 0, iInstanceCount);
+        }
+        else
+        {
+            glDrawElements(iGLType, m_iNumRenderIndices, GL_UNSIGNED_INT, 0);
+        }
+    }
+    catch (...)
+    {
+        // LOG_ERROR(QString("CMesh::paint() : Exception while rendering %1").arg(m_sName));
+    }
+
+    pContext->tStatistics.m_iNumPolysDrawn += (m_iNumRenderIndices / iIndicesPerPoly) * iInstanceCount;
+    pContext->tStatistics.m_iNumDrawCalls++;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Binds the vertex buffer and the index buffer, own or shared.
+*/
+void CGLMeshData::bindBuffers(CRenderContext* pContext)
+{
+    GL_glBindBuffer(GL_ARRAY_BUFFER, m_iVBO[0]);
+
+    if (m_pSharedIndices != nullptr)
+    {
+        m_pSharedIndices->bind(pContext);
+    }
+    else
+    {
+        GL_glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_iVBO[1]);
+    }
+
+    pContext->tStatistics.m_iNumStateCalls += 2;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Transfers the render buffers to the bound OpenGL buffers. \br\br
+    Shared indices are transfered by their owner.
+*/
+void CGLMeshData::transferBuffers(CRenderContext* pContext)
+{
+    QElapsedTimer tTimer;
+    tTimer.start();
+
+    // Transfer vertex data to VBO 0
+    transferBuffer(pContext, GL_ARRAY_BUFFER, m_iNumRenderPoints * sizeof(CRenderVertex), m_vRenderPoints, m_iVertexBufferBytes);
+
+    // Transfer index data to VBO 1
+    if (m_pSharedIndices == nullptr)
+    {
+        transferBuffer(pContext, GL_ELEMENT_ARRAY_BUFFER, m_iNumRenderIndices * sizeof(GLuint), m_vRenderIndices, m_iIndexBufferBytes);
+    }
+
+    pContext->tStatistics.m_iUploadTimeUS += tTimer.nsecsElapsed() / 1000;
+
+    m_bNeedTransferBuffers = false;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Transfers \a iBytes of \a pData to the buffer bound to \a eTarget, whose storage size is \a iStorageBytes. \br\br
+    The storage is kept when the size does not change, or when it shrinks for dynamic data, and allocated again otherwise.
+*/
+void CGLMeshData::transferBuffer(CRenderContext* pContext, GLenum eTarget, GLsizeiptr iBytes, const void* pData, GLsizeiptr& iStorageBytes)
+{
+    if (iBytes == iStorageBytes || (m_bDynamic && iBytes < iStorageBytes))
+    {
+        if (m_bDynamic)
+        {
+            // Orphan the storage, draws still reading it keep the old one
+            GL_glBufferData(eTarget, iStorageBytes, nullptr, GL_STREAM_DRAW);
+            pContext->tStatistics.m_iNumStateCalls++;
+        }
+
+        GL_glBufferSubData(eTarget, 0, iBytes, pData);
+    }
+    else
+    {
+        GL_glBufferData(eTarget, iBytes, pData, m_bDynamic ? GL_STREAM_DRAW : GL_STATIC_DRAW);
+
+        iStorageBytes = iBytes;
+    }
+
+    pContext->tStatistics.m_iNumStateCalls++;
+    pContext->tStatistics.m_iNumBytesUploaded += iBytes;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Tells OpenGL how to read the attributes of CRenderVertex in the bound vertex buffer, at the locations of \a pLocations.
+*/
+void CGLMeshData::setupVertexAttributes(CRenderContext* pContext, QGLShaderProgram* pProgram, CShaderLocations* pLocations)
+{
+    // Tell OpenGL how to locate vertex position data
+    int vertexLocation = pLocations->attribute(saPosition);
+    pProgram->enableAttributeArray(vertexLocation);
+    GL_glVertexAttribPointer(
+                vertexLocation, 3, GL_FLOAT, GL_FALSE, sizeof(CRenderVertex), (const void*) CRenderVertex::positionOffset()
+                );
+
+    // Tell OpenGL how to locate vertex texture coordinate data
+    int texcoordLocation = pLocations->attribute(saTexCoord);
+    pProgram->enableAttributeArray(texcoordLocation);
+    GL_glVertexAttribPointer(
+                texcoordLocation, 3, GL_FLOAT, GL_FALSE, sizeof(CRenderVertex), (const void*) CRenderVertex::texCoordOffset()
+                );
+
+    // Tell OpenGL how to locate vertex diffuse texture weight data
+    int diffTexWeight_0_1_2Location = pLocations->attribute(saDiffTexWeight_0_1_2);
+    pProgram->enableAttributeArray(diffTexWeight_0_1_2Location);
+    GL_glVertexAttribPointer(
+                diffTexWeight_0_1_2Location, 3, GL_HALF_FLOAT, GL_FALSE, sizeof(CRenderVertex), (const void*) CRenderVertex::diffTexWeight_0_1_2Offset()
+                );
+
+    // Tell OpenGL how to locate vertex diffuse texture weight data
+    int diffTexWeight_3_4_5Location = pLocations->attribute(saDiffTexWeight_3_4_5);
+    pProgram->enableAttributeArray(diffTexWeight_3_4_5Location);
+    GL_glVertexAttribPointer(
+                diffTexWeight_3_4_5Location, 3, GL_HALF_FLOAT, GL_FALSE, sizeof(CRenderVertex), (const void*) CRenderVertex::diffTexWeight_3_4_5Offset()
+                );
+
+    // Tell OpenGL how to locate vertex diffuse texture weight data
+    int diffTexWeight_6_7_8Location = pLocations->attribute(saDiffTexWeight_6_7_8);
+    pProgram->enableAttributeArray(diffTexWeight_6_7_8Location);
+    GL_glVertexAttribPointer(
+                diffTexWeight_6_7_8Location, 3, GL_HALF_FLOAT, GL_FALSE, sizeof(CRenderVertex), (const void*) CRenderVertex::diffTexWeight_6_7_8Offset()
+                );
+
+    // Tell OpenGL how to locate vertex normal data, octahedral encoded
+    int normalLocation = pLocations->attribute(saNormal);
+    pProgram->enableAttributeArray(normalLocation);
+    GL_glVertexAttribPointer(
+                normalLocation, 2, GL_SHORT, GL_TRUE, sizeof(CRenderVertex), (const void*) CRenderVertex::normalOffset()
+                );
+
+    // Tell OpenGL how to locate vertex tangent data, octahedral encoded
+    int tangentLocation = pLocations->attribute(saTangent);
+    pProgram->enableAttributeArray(tangentLocation);
+    GL_glVertexAttribPointer(
+                tangentLocation, 2, GL_SHORT, GL_TRUE, sizeof(CRenderVertex), (const void*) CRenderVertex::tangentOffset()
+                );
+
+    // Tell OpenGL how to locate altitude data
+    int altitudeLocation = pLocations->attribute(saAltitude);
+    pProgram->enableAttributeArray(altitudeLocation);
+    GL_glVertexAttribPointer(
+                altitudeLocation, 1, GL_FLOAT, GL_FALSE, sizeof(CRenderVertex), (const void*) CRenderVertex::altitudeOffset()
+                );
+
+    pContext->tStatistics.m_iNumStateCalls += 16;
 }
@@ -13,6 +13,8 @@
 // Application
 #include "quick3d_global.h"
 #include "CVertex.h"
+#include "CRenderVertex.h"
+#include "CSharedIndexBuffer.h"
 #include "CFace.h"
 #include "CMaterial.h"
 
@@ -20,6 +22,16 @@
 // Forward declarations
 
 class C3DScene;
+class CShaderLocations;
+
+//-------------------------------------------------------------------------------------------------
+
+//! Consecutive instances of an instance transform buffer, drawn with one call
+struct CInstanceRange
+{
+    int iFirst;
+    int iCount;
+};
 
 //-------------------------------------------------------------------------------------------------
 
@@ -43,21 +55,77 @@ public:
     // Control methods
     //-------------------------------------------------------------------------------------------------
 
+    //! Packs vVertices in m_vRenderPoints, relative to the center of their bounds
+    void setRenderPoints(const QVector<CVertex>& vVertices);
+
+    //! Allocates iCount indices in m_vRenderIndices
+    void allocateRenderIndices(GLuint iCount);
+
+    //! Draws with pIndices instead of m_vRenderIndices, nullptr to stop sharing
+    void setSharedIndices(QSP<CSharedIndexBuffer> pIndices);
+
+    //! Sets whether the geometry is rebuilt often, its buffers are then orphaned and updated in place
+    void setDynamic(bool bValue);
+
     //!
     void paint(CRenderContext* pContext, const QMatrix4x4& mModelAbsolute, QGLShaderProgram* pProgram, int iGLType);
 
+    //! Draws the ranges vRanges of the instance transforms vTransforms, uploaded in iInstanceBuffer
+    void paintInstances(
+            CRenderContext* pContext,
+            const QMatrix4x4& mModelAbsolute,
+            QGLShaderProgram* pProgram,
+            int iGLType,
+            const QMatrix4x4& mBase,
+            GLuint iInstanceBuffer,
+            const QVector<GLfloat>& vTransforms,
+            const QVector<CInstanceRange>& vRanges
+            );
+
+    //-------------------------------------------------------------------------------------------------
+    // Protected control methods
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    //! Makes the vertex attributes current, returns true if a vertex array was left bound
+    bool bindVertexArray(CRenderContext* pContext, QGLShaderProgram* pProgram, CShaderLocations* pLocations);
+
+    //! Draws the indices iInstanceCount times
+    void drawElements(CRenderContext* pContext, int iGLType, GLsizei iInstanceCount);
+
+    //! Binds the vertex and index buffers
+    void bindBuffers(CRenderContext* pContext);
+
+    //! Transfers the render buffers to OpenGL
+    void transferBuffers(CRenderContext* pContext);
+
+    //! Transfers iBytes of pData to the buffer bound to eTarget, reusing its storage when possible
+    void transferBuffer(CRenderContext* pContext, GLenum eTarget, GLsizeiptr iBytes, const void* pData, GLsizeiptr& iStorageBytes);
+
+    //! Specifies the vertex attribute pointers for the locations of a program
+    void setupVertexAttributes(CRenderContext* pContext, QGLShaderProgram* pProgram, CShaderLocations* pLocations);
+
     //-------------------------------------------------------------------------------------------------
     // Properties
     //-------------------------------------------------------------------------------------------------
 
+public:
+
     C3DScene*       m_pScene;
     GLuint          m_iNumRenderPoints;         // Number of vertices transfered to OpenGL
     GLuint          m_iNumRenderIndices;        // Number of polygon indices transfered to OpenGL
-    CVertex*        m_vRenderPoints;            // Vertices transfered to OpenGL
+    CRenderVertex*  m_vRenderPoints;            // Vertices transfered to OpenGL
+    Math::CVector3  m_vRenderOrigin;            // Origin of m_vRenderPoints positions
     GLuint*         m_vRenderIndices;           // Polygon vertex indices transfered to OpenGL
+    QSP<CSharedIndexBuffer> m_pSharedIndices;   // If not null, used instead of m_vRenderIndices
     GLuint          m_iVBO [2];                 // Data bufers allocated by OpenGL
+    GLuint          m_iVAO;                     // Vertex array holding the attribute pointers, 0 until first paint or without vertex arrays
+    CShaderLocations* m_pVertexArrayLocations;  // Locations the vertex array was set up with
+    GLsizeiptr      m_iVertexBufferBytes;       // Storage size of VBO 0
+    GLsizeiptr      m_iIndexBufferBytes;        // Storage size of VBO 1
     int             m_iGLType;
     bool            m_bNeedTransferBuffers;     // If true, it is time to give OpenGL the geometry buffers
-
-    static GLuint   m_iCurrentVBO;              // Last VBO transmitted to OpenGL
+    bool            m_bNeedVertexArraySetup;    // If true, the vertex array must be set up again
+    bool            m_bDynamic;                 // If true, buffers are orphaned and updated in place
 };
@@ -157,6 +157,8 @@ void CMaterial::clearLinks(C3DScene* pScene)
 
 void CMaterial::update(double dDeltaTime)
 {
+    QMutexLocker locker(&m_mUpdateMutex);
+
     for (int iIndex = 0; iIndex < m_vDiffuseTextures.count(); iIndex++)
     {
         m_vDiffuseTextures[iIndex]->update(dDeltaTime);
@@ -282,6 +284,9 @@ void CMaterial::disableFrameBuffer()
     {
         m_pScene->makeCurrentRenderingContext();
         m_pShadowBuffer->release();
+
+        // Binds the frame buffer the scene renders into again
+        m_pScene->bindRenderTarget();
     }
 }
 
@@ -314,51 +319,53 @@ QGLShaderProgram* CMaterial::activate(CRenderContext* pContext)
 
             pProgram->bind();
 
+            CShaderLocations* pLocations = pContext->scene()->shaders()->locations(pProgram);
+
             // IR setup
             if (pContext->bUseIR)
             {
-                pProgram->setUniformValue("u_IR_enable", (GLint) 1);
-                pProgram->setUniformValue("u_IR_factor", (GLfloat) m_dIRFactor);
+                pProgram->setUniformValue(pLocations->uniform(suIREnable), (GLint) 1);
+                pProgram->setUniformValue(pLocations->uniform(suIRFactor), (GLfloat) m_dIRFactor);
             }
             else
             {
-                pProgram->setUniformValue("u_IR_enable", (GLint) 0);
-                pProgram->setUniformValue("u_IR_factor", (GLfloat) 1.0);
+                pProgram->setUniformValue(pLocations->uniform(suIREnable), (GLint) 0);
+                pProgram->setUniformValue(pLocations->uniform(suIRFactor), (GLfloat) 1.0);
             }
 
             // Inverse polarity setup
             if (pContext->bUseInversePolarity)
             {
-                pProgram->setUniformValue("u_inverse_polarity_enable", (GLint) 1);
+                pProgram->setUniformValue(pLocations->uniform(suInversePolarityEnable), (GLint) 1);
             }
             else
             {
-                pProgram->setUniformValue("u_inverse_polarity_enable", (GLint) 0);
+                pProgram->setUniformValue(pLocations->uniform(suInversePolarityEnable), (GLint) 0);
             }
 
             // Sky setup
             if (m_bUseSky)
             {
-                pProgram->setUniformValue("u_sky_enable", (GLint) 1);
+                pProgram->setUniformValue(pLocations->uniform(suSkyEnable), (GLint) 1);
             }
             else
             {
-                pProgram->setUniformValue("u_sky_enable", (GLint) 0);
+                pProgram->setUniformValue(pLocations->uniform(suSkyEnable), (GLint) 0);
             }
 
             // Wave setup
-            pProgram->setUniformValue("u_wave_enable", (GLint) 0);
+            pProgram->setUniformValue(pLocations->uniform(suWaveEnable), (GLint) 0);
 
             // Standard setup
-            pProgram->setUniformValue("u_material_ambient", QVector4D(m_cAmbient.X, m_cAmbient.Y, m_cAmbient.Z, m_cAmbient.W));
-            pProgram->setUniformValue("u_material_diffuse", QVector4D(m_cDiffuse.X, m_cDiffuse.Y, m_cDiffuse.Z, m_cDiffuse.W));
-            pProgram->setUniformValue("u_material_specular", QVector4D(m_cSpecular.X, m_cSpecular.Y, m_cSpecular.Z, m_cSpecular.W));
-            pProgram->setUniformValue("u_material_subdermal", QVector4D(m_cSubdermal.X, m_cSubdermal.Y, m_cSubdermal.Z, m_cSubdermal.W));
-            pProgram->setUniformValue("u_material_self_illum", (GLfloat) m_dSelfIllumination);
-            pProgram->setUniformValue("u_material_shininess", (GLfloat) m_dShininess);
-            pProgram->setUniformValue("u_material_metalness", (GLfloat) m_dMetalness);
-            pProgram->setUniformValue("u_material_sss_factor", (GLfloat) m_dSSSFactor);
-            pProgram->setUniformValue("u_material_sss_radius", (GLfloat) m_dSSSRadius);
+            pProgram->setUniformValue(pLocations->uniform(suMaterialAmbient), QVector4D(m_cAmbient.X, m_cAmbient.Y, m_cAmbient.Z, m_cAmbient.W));
+            pProgram->setUniformValue(pLocations->uniform(suMaterialDiffuse), QVector4D(m_cDiffuse.X, m_cDiffuse.Y, m_cDiffuse.Z, m_cDiffuse.W));
+            pProgram->setUniformValue(pLocations->uniform(suMaterialSpecular), QVector4D(m_cSpecular.X, m_cSpecular.Y, m_cSpecular.Z, m_cSpecular.W));
+            pProgram->setUniformValue(pLocations->uniform(suMaterialSubdermal), QVector4D(m_cSubdermal.X, m_cSubdermal.Y, m_cSubdermal.Z, m_cSubdermal.W));
+            pProgram->setUniformValue(pLocations->uniform(suMaterialSelfIllum), (GLfloat) m_dSelfIllumination);
+            pProgram->setUniformValue(pLocations->uniform(suMaterialShininess), (GLfloat) m_dShininess);
+            pProgram->setUniformValue(pLocations->uniform(suMaterialMetalness), (GLfloat) m_dMetalness);
+            pProgram->setUniformValue(pLocations->uniform(suMaterialSSSFactor), (GLfloat) m_dSSSFactor);
+            pProgram->setUniformValue(pLocations->uniform(suMaterialSSSRadius), (GLfloat) m_dSSSRadius);
 
             if (m_vDiffuseTextures.count() > 0)
             {
@@ -367,29 +374,34 @@ QGLShaderProgram* CMaterial::activate(CRenderContext* pContext)
                     m_vDiffuseTextures[iIndex]->activate(iIndex);
                 }
 
-                pProgram->setUniformValue("u_texture_diffuse_enable", (GLint) 1);
+                pProgram->setUniformValue(pLocations->uniform(suTextureDiffuseEnable), (GLint) 1);
 
-                pProgram->setUniformValue("u_texture_diffuse_0", (GLint) 1);
-                pProgram->setUniformValue("u_texture_diffuse_1", (GLint) 2);
-                pProgram->setUniformValue("u_texture_diffuse_2", (GLint) 3);
-                pProgram->setUniformValue("u_texture_diffuse_3", (GLint) 4);
-                pProgram->setUniformValue("u_texture_diffuse_4", (GLint) 5);
-                pProgram->setUniformValue("u_texture_diffuse_5", (GLint) 6);
-                pProgram->setUniformValue("u_texture_diffuse_6", (GLint) 7);
-                pProgram->setUniformValue("u_texture_diffuse_7", (GLint) 8);
+                // Diffuse samplers are consecutive, unit 0 being the shadow map
+                for (int iIndex = 0; iIndex < 8; iIndex++)
+                {
+                    pProgram->setUniformValue(pLocations->uniform((EShaderUniform) (suTextureDiffuse0 + iIndex)), (GLint) (iIndex + 1));
+                }
             }
             else
             {
-                pProgram->setUniformValue("u_texture_diffuse_enable", (GLint) 0);
+                pProgram->setUniformValue(pLocations->uniform(suTextureDiffuseEnable), (GLint) 0);
             }
 
             // Bump map setup
 
-            pProgram->setUniformValue("u_texture_bump_enable", (GLint) 0);
-            pProgram->setUniformValue("u_texture_bump", (GLint) 1);
+            pProgram->setUniformValue(pLocations->uniform(suTextureBumpEnable), (GLint) 0);
+            pProgram->setUniformValue(pLocations->uniform(suTextureBump), (GLint) 1);
+
+            // Camera and environment setup, once per program and context since uniforms keep their values in the program
+            if (pLocations->beginContext(pContext->serial()))
+            {
+                pProgram->setUniformValue(pLocations->uniform(suCameraProjectionMatrix), pContext->cameraProjectionMatrix());
+                pProgram->setUniformValue(pLocations->uniform(suCameraMatrix), pContext->cameraMatrix());
+                pProgram->setUniformValue(pLocations->uniform(suShadowProjectionMatrix), pContext->shadowProjectionMatrix());
+                pProgram->setUniformValue(pLocations->uniform(suShadowMatrix), pContext->shadowMatrix());
 
-            // Environment setup
-            pContext->scene()->setupEnvironment(pContext, pProgram, m_bUseSky);
+                pContext->scene()->setupEnvironment(pContext, pProgram, m_bUseSky);
+            }
         }
     }
 
@@ -5,6 +5,7 @@
 #include <QImage>
 #include <QSharedData>
 #include <QExplicitlySharedDataPointer>
+#include <QMutex>
 #include <QtOpenGL>
 #include <QtOpenGL/QGLShaderProgram>
 #include <QGLFramebufferObject>
@@ -221,6 +222,7 @@ protected:
     bool                    m_bUseWaves;
     bool                    m_bBillBoard;
     bool                    m_bLines;
+    QMutex                  m_mUpdateMutex;         // Materials are shared by meshes updated in parallel
 
     static double           m_dTime;
 };
@@ -223,7 +223,12 @@ void CMesh::solveLinks(C3DScene* pScene)
                             }
                         }
 
-                        if (bFound) break;
+                        if (bFound)
+                        {
+                            // The updater writes the texture while this mesh is updated
+                            addUpdateDependency(pFound);
+                            break;
+                        }
                     }
                 }
 
@@ -23,6 +23,7 @@ CMeshGeometry::CMeshGeometry(C3DScene* pScene, double dMaxDistance, bool bUseSpa
     , m_bUseSpacePartitionning(bUseSpacePartitionning)
     , m_bAutomaticBounds(true)
     , m_bGeometryDirty(true)
+    , m_bDynamic(false)
 {
 }
 
@@ -80,6 +81,44 @@ void CMeshGeometry::setGLType(int iGLType)
 void CMeshGeometry::setGeometryDirty(bool bDirty)
 {
     m_bGeometryDirty = bDirty;
+
+    if (bDirty)
+    {
+        resetTriangleTree();
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Sets whether the geometry is rebuilt often, like particles or debug segments, to \a bValue. \br\br
+    The OpenGL buffers of a dynamic mesh are updated in place instead of being allocated again.
+*/
+void CMeshGeometry::setDynamic(bool bValue)
+{
+    QMutexLocker locker(&m_mMutex);
+
+    m_bDynamic = bValue;
+
+    foreach (CGLMeshData* pGLMeshData, m_vGLMeshData)
+    {
+        pGLMeshData->setDynamic(m_bDynamic);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Makes this mesh draw \a pIndices, which may be shared with other meshes, instead of its faces. \br\br
+    The caller provides the vertex normals : they are not computed from faces in this mode.
+    Passing \c nullptr draws the faces again.
+*/
+void CMeshGeometry::setSharedIndices(QSP<CSharedIndexBuffer> pIndices)
+{
+    QMutexLocker locker(&m_mMutex);
+
+    m_pSharedIndices = pIndices;
+    setGeometryDirty(true);
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -90,7 +129,7 @@ void CMeshGeometry::clear()
     m_vFaces.clear();
     m_vVertexGroups.clear();
 
-    m_bGeometryDirty = true;
+    setGeometryDirty(true);
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -136,7 +175,11 @@ void CMeshGeometry::checkAndUpdateGeometry()
     {
         QMutexLocker locker(&m_mMutex);
 
-        if (m_vVertices.count() > 0)
+        if (m_vVertices.count() > 0 && m_pSharedIndices != nullptr)
+        {
+            updateSharedGeometry();
+        }
+        else if (m_vVertices.count() > 0)
         {
             // Sort faces by material
             qSort(m_vFaces);
@@ -144,23 +187,7 @@ void CMeshGeometry::checkAndUpdateGeometry()
             // Compute normal vectors
             computeNormals();
 
-            if (m_vMaterials.count() != m_vGLMeshData.count())
-            {
-                // Destroy OpenGL geometry buffers
-                foreach (CGLMeshData* data, m_vGLMeshData)
-                {
-                    delete data;
-                }
-
-                m_vGLMeshData.clear();
-
-                for (int iMaterialIndex = 0; iMaterialIndex < m_vMaterials.count(); iMaterialIndex++)
-                {
-                    CGLMeshData* pData = new CGLMeshData(m_pScene);
-                    pData->m_iGLType = m_iGLType;
-                    m_vGLMeshData.append(pData);
-                }
-            }
+            allocateGLMeshData();
 
             // Reset the bouding box
             if (m_bAutomaticBounds)
@@ -175,20 +202,23 @@ void CMeshGeometry::checkAndUpdateGeometry()
                 // Buffers must be transmitted to OpenGL
                 pGLMeshData->m_bNeedTransferBuffers = true;
 
+                // Back to own indices if shared ones were drawn before
+                if (pGLMeshData->m_pSharedIndices != nullptr)
+                {
+                    pGLMeshData->setSharedIndices(QSP<CSharedIndexBuffer>());
+                    pGLMeshData->m_iGLType = m_iGLType;
+                }
+
                 if (m_iGLType == GL_POINTS || m_iGLType == GL_LINES)
                 {
                     if (iMaterialIndex == 0)
                     {
-                        pGLMeshData->m_iNumRenderPoints = m_vVertices.count();
-                        pGLMeshData->m_iNumRenderIndices = m_vVertices.count();
-
                         // Create OpenGL geometry buffers
-                        pGLMeshData->m_vRenderPoints = new CVertex[pGLMeshData->m_iNumRenderPoints];
-                        pGLMeshData->m_vRenderIndices = new GLuint[pGLMeshData->m_iNumRenderIndices];
+                        pGLMeshData->setRenderPoints(m_vVertices);
+                        pGLMeshData->allocateRenderIndices(m_vVertices.count());
 
                         for (int iVertexIndex = 0; iVertexIndex < m_vVertices.count(); iVertexIndex++)
                         {
-                            pGLMeshData->m_vRenderPoints[iVertexIndex] = m_vVertices[iVertexIndex];
                             pGLMeshData->m_vRenderIndices[iVertexIndex] = iVertexIndex;
 
                             // Check bounding box limits
@@ -220,18 +250,18 @@ void CMeshGeometry::checkAndUpdateGeometry()
                     if (vFaceIndices.count() > 0)
                     {
                         // Define quantities
-                        pGLMeshData->m_iNumRenderPoints = m_vVertices.count();
+                        GLuint iNumRenderIndices = 0;
 
                         if (m_iGLType == GL_QUADS)
                         {
-                            pGLMeshData->m_iNumRenderIndices = vFaceIndices.count() * 4;
+                            iNumRenderIndices = vFaceIndices.count() * 4;
                         }
                         else
                         {
-                            pGLMeshData->m_iNumRenderIndices = triangleCountForFaces(vFaceIndices) * 3;
+                            iNumRenderIndices = triangleCountForFaces(vFaceIndices) * 3;
                         }
 
-                        if (pGLMeshData->m_iNumRenderPoints > 0 && pGLMeshData->m_iNumRenderIndices > 0)
+                        if (m_vVertices.count() > 0 && iNumRenderIndices > 0)
                         {
                             /*
                             LOG_METHOD_DEBUG(QString("Allocating %1 vertices and %2 indices for %3")
@@ -242,14 +272,11 @@ void CMeshGeometry::checkAndUpdateGeometry()
                                 */
 
                             // Cration des buffers de gomtrie OpenGL
-                            pGLMeshData->m_vRenderPoints = new CVertex[pGLMeshData->m_iNumRenderPoints];
-                            pGLMeshData->m_vRenderIndices = new GLuint[pGLMeshData->m_iNumRenderIndices];
+                            pGLMeshData->setRenderPoints(m_vVertices);
+                            pGLMeshData->allocateRenderIndices(iNumRenderIndices);
 
-                            // Fill OpenGL vertex buffer
                             for (int iVertex = 0; iVertex < m_vVertices.count(); iVertex++)
                             {
-                                pGLMeshData->m_vRenderPoints[iVertex] = m_vVertices[iVertex];
-
                                 // Check bounding box limits
                                 if (m_vVertices[iVertex].position().X < m_bBounds.minimum().X) m_bBounds.minimum().X = m_vVertices[iVertex].position().X;
                                 if (m_vVertices[iVertex].position().Y < m_bBounds.minimum().Y) m_bBounds.minimum().Y = m_vVertices[iVertex].position().Y;
@@ -297,12 +324,6 @@ void CMeshGeometry::checkAndUpdateGeometry()
                     }
                 }
             }
-
-            // Spatial partitioning
-            if (m_bUseSpacePartitionning)
-            {
-                createPartitions(m_bBounds);
-            }
         }
 
         m_bGeometryDirty = false;
@@ -311,25 +332,64 @@ void CMeshGeometry::checkAndUpdateGeometry()
 
 //-------------------------------------------------------------------------------------------------
 
-void CMeshGeometry::addDataForPartition(CBoundPartition<int>& partition)
+void CMeshGeometry::allocateGLMeshData()
 {
-    // Iterate through polygons
-    for (int iFace = 0; iFace < m_vFaces.count(); iFace++)
+    if (m_vMaterials.count() != m_vGLMeshData.count())
     {
-        // Iterate through current polygon vertices
-        for (int iVertex = 0; iVertex < m_vFaces[iFace].indices().count(); iVertex++)
+        // Destroy OpenGL geometry buffers
+        foreach (CGLMeshData* data, m_vGLMeshData)
+        {
+            delete data;
+        }
+
+        m_vGLMeshData.clear();
+
+        for (int iMaterialIndex = 0; iMaterialIndex < m_vMaterials.count(); iMaterialIndex++)
         {
-            // Get current vertex position
-            CVector3 vPosition = m_vVertices[m_vFaces[iFace].indices()[iVertex]].position();
+            CGLMeshData* pData = new CGLMeshData(m_pScene);
+            pData->m_iGLType = m_iGLType;
+            pData->setDynamic(m_bDynamic);
+            m_vGLMeshData.append(pData);
+        }
+    }
+}
 
-            // Do the partition bounds contain the vertex?
-            if (partition.bounds().contains(vPosition))
-            {
-                // Yes, add the face to the partition and stop vertex iteration
-                partition.append(iFace);
-                break;
-            }
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Updates the OpenGL buffers of a mesh drawing m_pSharedIndices. \br\br
+    Faces are neither sorted nor triangulated, normals are kept as set by the caller,
+    and every material draws the shared indices. Space partitions are not built.
+*/
+void CMeshGeometry::updateSharedGeometry()
+{
+    allocateGLMeshData();
+
+    if (m_bAutomaticBounds)
+    {
+        m_bBounds.prepare();
+
+        for (int iVertex = 0; iVertex < m_vVertices.count(); iVertex++)
+        {
+            const CVector3& vPosition = m_vVertices[iVertex].position();
+
+            if (vPosition.X < m_bBounds.minimum().X) m_bBounds.minimum().X = vPosition.X;
+            if (vPosition.Y < m_bBounds.minimum().Y) m_bBounds.minimum().Y = vPosition.Y;
+            if (vPosition.Z < m_bBounds.minimum().Z) m_bBounds.minimum().Z = vPosition.Z;
+            if (vPosition.X > m_bBounds.maximum().X) m_bBounds.maximum().X = vPosition.X;
+            if (vPosition.Y > m_bBounds.maximum().Y) m_bBounds.maximum().Y = vPosition.Y;
+            if (vPosition.Z > m_bBounds.maximum().Z) m_bBounds.maximum().Z = vPosition.Z;
         }
+
+        m_bBounds.expand(CVector3(0.1, 0.1, 0.1));
+    }
+
+    foreach (CGLMeshData* pGLMeshData, m_vGLMeshData)
+    {
+        // Only vertices are transmitted, the shared indices are transmitted once by their owner
+        pGLMeshData->m_bNeedTransferBuffers = true;
+        pGLMeshData->setRenderPoints(m_vVertices);
+        pGLMeshData->setSharedIndices(m_pSharedIndices);
     }
 }
 
@@ -356,7 +416,7 @@ void CMeshGeometry::isolateVertices()
         }
     }
 
-    m_bGeometryDirty = true;
+    setGeometryDirty(true);
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -452,7 +512,7 @@ void CMeshGeometry::splitVerticesBySmoothingGroup()
         }
     }
 
-    m_bGeometryDirty = true;
+    setGeometryDirty(true);
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -477,7 +537,7 @@ void CMeshGeometry::flipNormals()
         }
     }
 
-    m_bGeometryDirty = true;
+    setGeometryDirty(true);
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -1345,7 +1405,7 @@ void CMeshGeometry::subdivideQuads(int iNumIterations)
         }
     }
 
-    m_bGeometryDirty = true;
+    setGeometryDirty(true);
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -1371,7 +1431,7 @@ void CMeshGeometry::merge(const CMeshGeometry &other)
         m_vFaces.append(CFace(this, vNewIndices));
     }
 
-    m_bGeometryDirty = true;
+    setGeometryDirty(true);
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -1383,7 +1443,7 @@ void CMeshGeometry::transformVertices(const CMatrix4& matrix)
         m_vVertices[iIndex].position() = matrix * m_vVertices[iIndex].position();
     }
 
-    m_bGeometryDirty = true;
+    setGeometryDirty(true);
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -1395,7 +1455,7 @@ void CMeshGeometry::translateUVs(CVector2 vTranslate)
         m_vVertices[iIndex].texCoord() = m_vVertices[iIndex].texCoord() + vTranslate;
     }
 
-    m_bGeometryDirty = true;
+    setGeometryDirty(true);
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -1407,7 +1467,7 @@ void CMeshGeometry::scaleUVs(CVector2 vScale)
         m_vVertices[iIndex].texCoord() = m_vVertices[iIndex].texCoord() * vScale;
     }
 
-    m_bGeometryDirty = true;
+    setGeometryDirty(true);
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -1423,7 +1483,12 @@ RayTracingResult CMeshGeometry::intersect(CComponent* pContainer, CRay3 rGlobalR
     {
         if (m_bUseSpacePartitionning)
         {
-            return intersectPartitions(pContainer, rLocalray);
+            checkTriangleTree();
+
+            RayTracingResult dNewResult = m_tTriangleTree.intersect(rLocalray);
+
+            dReturnResult.m_dDistance = dNewResult.m_dDistance;
+            dReturnResult.m_vNormal = dNewResult.m_vNormal;
         }
         else
         {
@@ -1462,41 +1527,55 @@ RayTracingResult CMeshGeometry::intersect(CComponent* pContainer, CRay3 rGlobalR
 
 //-------------------------------------------------------------------------------------------------
 
-Math::RayTracingResult CMeshGeometry::intersectPartitionData(CComponent* pContainer, const CBoundPartition<int>& partition, Math::CRay3 rLocalray)
+/*!
+    Builds the tree of the triangles of the faces, as triangulated by intersect(), unless already done
+    since the geometry was last made dirty. \br\br
+    Queries may come from several threads, the first one builds the tree.
+*/
+void CMeshGeometry::checkTriangleTree()
 {
-    RayTracingResult dReturnResult(Q3D_INFINITY, pContainer);
+    if (m_iTriangleTreeReady.loadAcquire() != 0)
+    {
+        return;
+    }
 
-    for (int iPartFaceIndex = 0; iPartFaceIndex < partition.data().count(); iPartFaceIndex++)
+    QMutexLocker locker(&m_mTriangleTreeMutex);
+
+    if (m_iTriangleTreeReady.loadAcquire() == 0)
     {
-        int iFaceIndex = partition.data()[iPartFaceIndex];
+        m_tTriangleTree.clear();
 
-        if (iFaceIndex < m_vFaces.count() && m_vFaces[iFaceIndex].indices().count() > 2)
+        for (int iFaceIndex = 0; iFaceIndex < m_vFaces.count(); iFaceIndex++)
         {
-            for (int iVertIndex = 2; iVertIndex < m_vFaces[iFaceIndex].indices().count(); iVertIndex++)
-            {
-                int i1 = m_vFaces[iFaceIndex].indices()[0];
-                int i2 = m_vFaces[iFaceIndex].indices()[iVertIndex - 1];
-                int i3 = m_vFaces[iFaceIndex].indices()[iVertIndex];
+            const QVector<int>& vIndices = m_vFaces[iFaceIndex].indices();
 
-                CVector3 v1 = m_vVertices[i1].position();
-                CVector3 v2 = m_vVertices[i2].position();
-                CVector3 v3 = m_vVertices[i3].position();
-
-                RayTracingResult dNewResult = CFace::intersectTriangle(
-                            rLocalray,
-                            v1, v2, v3
+            for (int iVertIndex = 2; iVertIndex < vIndices.count(); iVertIndex++)
+            {
+                m_tTriangleTree.addTriangle(
+                            m_vVertices[vIndices[0]].position(),
+                            m_vVertices[vIndices[iVertIndex - 1]].position(),
+                            m_vVertices[vIndices[iVertIndex]].position()
                             );
-
-                if (dNewResult.m_dDistance < dReturnResult.m_dDistance)
-                {
-                    dReturnResult.m_dDistance = dNewResult.m_dDistance;
-                    dReturnResult.m_vNormal = dNewResult.m_vNormal;
-                }
             }
         }
+
+        m_tTriangleTree.build();
+
+        m_iTriangleTreeReady.storeRelease(1);
     }
+}
 
-    return dReturnResult;
+//-------------------------------------------------------------------------------------------------
+
+void CMeshGeometry::resetTriangleTree()
+{
+    QMutexLocker locker(&m_mTriangleTreeMutex);
+
+    if (m_iTriangleTreeReady.loadAcquire() != 0)
+    {
+        m_iTriangleTreeReady.storeRelease(0);
+        m_tTriangleTree.clear();
+    }
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -1577,6 +1656,59 @@ void CMeshGeometry::paint(CRenderContext* pContext, CComponent* pContainer)
 
 //-------------------------------------------------------------------------------------------------
 
+/*!
+    Draws instances of this geometry in one call per range and material. \br\br
+    \a pContext is the rendering context. \br
+    \a pContainer gives the scale of the instances. \br
+    \a mBase places the instance transforms relative to the world origin. \br
+    \a iInstanceBuffer is the OpenGL buffer holding \a vTransforms. \br
+    \a vRanges are the ranges of instances to draw. \br\br
+    Culling is left to the caller, which knows the bounds of the instances.
+*/
+void CMeshGeometry::paintInstances(
+        CRenderContext* pContext,
+        CComponent* pContainer,
+        const QMatrix4x4& mBase,
+        GLuint iInstanceBuffer,
+        const QVector<GLfloat>& vTransforms,
+        const QVector<CInstanceRange>& vRanges
+        )
+{
+    QMutexLocker locker(&m_mMutex);
+
+    checkAndUpdateGeometry();
+
+    if (m_vGLMeshData.count() > 0 && m_vGLMeshData.count() == m_vMaterials.count())
+    {
+        QMatrix4x4 mScale;
+        mScale.setToIdentity();
+
+        if (pContainer != nullptr)
+        {
+            CVector3 WorldScale = pContainer->worldScale();
+
+            mScale.scale(WorldScale.X, WorldScale.Y, WorldScale.Z);
+        }
+
+        for (int iIndex = 0; iIndex < m_vMaterials.count(); iIndex++)
+        {
+            CGLMeshData* pData = m_vGLMeshData[iIndex];
+            CMaterial* pMaterial = m_vMaterials[iIndex].data();
+
+            // Get a program from object material
+            QGLShaderProgram* pProgram = pMaterial->activate(pContext);
+
+            // If program ok...
+            if (pProgram != nullptr)
+            {
+                pData->paintInstances(pContext, mScale, pProgram, pData->m_iGLType, mBase, iInstanceBuffer, vTransforms, vRanges);
+            }
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
 void CMeshGeometry::dump(QTextStream& stream, int iIdent)
 {
     dumpIndented(stream, iIdent, QString("[CMeshGeometry]"));
@@ -2,6 +2,7 @@
 #pragma once
 
 // Qt
+#include <QAtomicInt>
 #include <QImage>
 #include <QMutex>
 #include <QMutexLocker>
@@ -14,13 +15,13 @@
 #include "quick3d_global.h"
 #include "CQ3DConstants.h"
 #include "CBoundingBox.h"
-#include "CBoundPartition.h"
 #include "CComponent.h"
 #include "CVertex.h"
 #include "CFace.h"
 #include "CVertexGroup.h"
 #include "CMaterial.h"
 #include "CGLMeshData.h"
+#include "CTriangleBVH.h"
 
 //-------------------------------------------------------------------------------------------------
 // Forward declarations
@@ -29,7 +30,7 @@ class C3DScene;
 
 //-------------------------------------------------------------------------------------------------
 
-class QUICK3D_EXPORT CMeshGeometry : public QSharedData, public CBoundPartitioned<int>, public CDumpable
+class QUICK3D_EXPORT CMeshGeometry : public QSharedData, public CDumpable
 {
     DECLARE_MEMORY_MONITORED
 
@@ -64,6 +65,12 @@ public:
     //!
     void setGeometryDirty(bool bDirty);
 
+    //! Makes the mesh draw pIndices instead of its faces, nullptr to use faces again
+    void setSharedIndices(QSP<CSharedIndexBuffer> pIndices);
+
+    //! Sets whether the geometry is rebuilt often, like particles or debug segments
+    void setDynamic(bool bValue);
+
     //-------------------------------------------------------------------------------------------------
     // Getters
     //-------------------------------------------------------------------------------------------------
@@ -107,6 +114,12 @@ public:
     //!
     QVector<CGLMeshData*>& glMeshData() { return m_vGLMeshData; }
 
+    //! Returns true if the geometry is rebuilt often
+    bool isDynamic() const { return m_bDynamic; }
+
+    //! Returns the shared indices drawn by this mesh, if any
+    QSP<CSharedIndexBuffer> sharedIndices() const { return m_pSharedIndices; }
+
     //! Return number of triangles needed for this mesh
     int triangleCount();
 
@@ -126,9 +139,6 @@ public:
     //! Dumps contents to a stream
     virtual void dump(QTextStream& stream, int iIdent);
 
-    //!
-    virtual void addDataForPartition(CBoundPartition<int>& partition) Q_DECL_OVERRIDE;
-
     //! Ray intersection
     Math::RayTracingResult intersect(CComponent* pContainer, Math::CRay3 rGlobalRay);
 
@@ -148,6 +158,16 @@ public:
     //! Dessine l'objet
     void paint(CRenderContext* pContext, CComponent* pContainer);
 
+    //! Draws the ranges vRanges of the instance transforms vTransforms, scaled like pContainer
+    void paintInstances(
+            CRenderContext* pContext,
+            CComponent* pContainer,
+            const QMatrix4x4& mBase,
+            GLuint iInstanceBuffer,
+            const QVector<GLfloat>& vTransforms,
+            const QVector<CInstanceRange>& vRanges
+            );
+
     //! Inverse les vecteurs normaux des polygones
     void flipNormals();
 
@@ -218,8 +238,17 @@ public:
 
 protected:
 
-    //!
-    virtual Math::RayTracingResult intersectPartitionData(CComponent* pContainer, const CBoundPartition<int>& partition, Math::CRay3 rLocalray) Q_DECL_OVERRIDE;
+    //! Builds the triangle tree used by intersect() if not done yet
+    void checkTriangleTree();
+
+    //! Discards the triangle tree, it is built again on next ray query
+    void resetTriangleTree();
+
+    //! Creates one CGLMeshData per material if counts differ
+    void allocateGLMeshData();
+
+    //! Updates OpenGL buffers when drawing m_pSharedIndices
+    void updateSharedGeometry();
 
     //-------------------------------------------------------------------------------------------------
     // Properties
@@ -240,11 +269,16 @@ protected:
     QMap<QString, QString>          m_mDynTexUpdaters;          // Components that update dynamic textures
     double                          m_dMaxDistance;             // Maximum distance at which this mesh is visible
     int                             m_iGLType;
-    bool                            m_bUseSpacePartitionning;   // If true, polygons are partitioned
+    CTriangleBVH                    m_tTriangleTree;            // Triangles of the faces, built on first ray query
+    QMutex                          m_mTriangleTreeMutex;
+    QAtomicInt                      m_iTriangleTreeReady;
+    bool                            m_bUseSpacePartitionning;   // If true, ray queries use m_tTriangleTree
     bool                            m_bAutomaticBounds;
-    bool                            m_bGeometryDirty;           // If true, normals and partitions mush be computed
+    bool                            m_bGeometryDirty;           // If true, normals and render buffers must be computed
+    bool                            m_bDynamic;                 // If true, render buffers are updated in place
 
     // Shared data
 
     QVector<QSP<CMaterial> >        m_vMaterials;               // Materials of the mesh
+    QSP<CSharedIndexBuffer>         m_pSharedIndices;           // If not null, drawn instead of m_vFaces
 };
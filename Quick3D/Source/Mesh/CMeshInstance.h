@@ -42,6 +42,9 @@ public:
     // Getters
     //-------------------------------------------------------------------------------------------------
 
+    //! Returns the meshes, one per level of detail, nearest first
+    const QVector<QSP<CMesh> >& meshes() const { return m_vMeshes; }
+
     //-------------------------------------------------------------------------------------------------
     // Control methods
     //-------------------------------------------------------------------------------------------------
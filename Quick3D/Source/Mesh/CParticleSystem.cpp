@@ -11,6 +11,7 @@ using namespace Math;
 CParticleSystem::CParticleSystem(C3DScene* pScene)
     : CMesh(pScene)
 {
+    m_pGeometry->setDynamic(true);
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -0,0 +1,244 @@
+
+// Std
+#include <cmath>
+#include <cstring>
+
+// Application
+#include "CRenderVertex.h"
+
+//-------------------------------------------------------------------------------------------------
+
+using namespace Math;
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    \class CRenderVertex
+    \brief The packed vertex format transfered to OpenGL by CGLMeshData.
+    \inmodule Quick3D
+    \sa CVertex, CGLMeshData
+
+    A CRenderVertex takes 60 bytes, where a CVertex takes more than 200. \br
+    Attributes are read by the shaders as:
+    \list
+    \li a_position : 3 floats, relative to CGLMeshData::m_vRenderOrigin
+    \li a_altitude : 1 float
+    \li a_texcoord : 3 floats
+    \li a_normal, a_tangent : 2 normalized shorts, octahedral encoding
+    \li a_difftext_weight_* : 3 half floats
+    \endlist
+*/
+
+//-------------------------------------------------------------------------------------------------
+
+CRenderVertex::CRenderVertex()
+{
+    memset(this, 0, sizeof(CRenderVertex));
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Packs \a vertex in this object. The position is stored relative to \a vOrigin,
+    so that it keeps its precision as a float.
+*/
+void CRenderVertex::pack(const CVertex& vertex, const CVector3& vOrigin)
+{
+    CVector3 vPosition = vertex.position() - vOrigin;
+    CVector3 vTexCoord = vertex.texCoord();
+    CVector3 vWeight_0_1_2 = vertex.diffTexWeight_0_1_2();
+    CVector3 vWeight_3_4_5 = vertex.diffTexWeight_3_4_5();
+    CVector3 vWeight_6_7_8 = vertex.diffTexWeight_6_7_8();
+
+    m_fPosition[0] = (float) vPosition.X;
+    m_fPosition[1] = (float) vPosition.Y;
+    m_fPosition[2] = (float) vPosition.Z;
+
+    m_fAltitude = (float) vertex.altitude();
+
+    m_fTexCoord[0] = (float) vTexCoord.X;
+    m_fTexCoord[1] = (float) vTexCoord.Y;
+    m_fTexCoord[2] = (float) vTexCoord.Z;
+
+    encodeOctahedral(vertex.normal(), m_iNormal);
+    encodeOctahedral(vertex.tangent(), m_iTangent);
+
+    m_iDiffTexWeight_0_1_2[0] = floatToHalf((float) vWeight_0_1_2.X);
+    m_iDiffTexWeight_0_1_2[1] = floatToHalf((float) vWeight_0_1_2.Y);
+    m_iDiffTexWeight_0_1_2[2] = floatToHalf((float) vWeight_0_1_2.Z);
+    m_iDiffTexWeight_0_1_2[3] = 0;
+
+    m_iDiffTexWeight_3_4_5[0] = floatToHalf((float) vWeight_3_4_5.X);
+    m_iDiffTexWeight_3_4_5[1] = floatToHalf((float) vWeight_3_4_5.Y);
+    m_iDiffTexWeight_3_4_5[2] = floatToHalf((float) vWeight_3_4_5.Z);
+    m_iDiffTexWeight_3_4_5[3] = 0;
+
+    m_iDiffTexWeight_6_7_8[0] = floatToHalf((float) vWeight_6_7_8.X);
+    m_iDiffTexWeight_6_7_8[1] = floatToHalf((float) vWeight_6_7_8.Y);
+    m_iDiffTexWeight_6_7_8[2] = floatToHalf((float) vWeight_6_7_8.Z);
+    m_iDiffTexWeight_6_7_8[3] = 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Encodes \a vDirection in \a pResult, two shorts read as normalized values by OpenGL. \br\br
+    The direction is projected on an octahedron which is then unfolded on a square.
+    A null direction is encoded as +Z.
+*/
+void CRenderVertex::encodeOctahedral(const CVector3& vDirection, qint16* pResult)
+{
+    double dSum = fabs(vDirection.X) + fabs(vDirection.Y) + fabs(vDirection.Z);
+
+    if (dSum <= 0.0)
+    {
+        pResult[0] = 0;
+        pResult[1] = 0;
+        return;
+    }
+
+    double dX = vDirection.X / dSum;
+    double dY = vDirection.Y / dSum;
+
+    // Fold the lower hemisphere over the diagonals
+    if (vDirection.Z < 0.0)
+    {
+        double dFoldedX = (1.0 - fabs(dY)) * (dX >= 0.0 ? 1.0 : -1.0);
+        double dFoldedY = (1.0 - fabs(dX)) * (dY >= 0.0 ? 1.0 : -1.0);
+
+        dX = dFoldedX;
+        dY = dFoldedY;
+    }
+
+    pResult[0] = (qint16) qRound(qBound(-1.0, dX, 1.0) * 32767.0);
+    pResult[1] = (qint16) qRound(qBound(-1.0, dY, 1.0) * 32767.0);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Decodes a direction encoded by encodeOctahedral() in \a pValue. Returns a unit vector.
+*/
+CVector3 CRenderVertex::decodeOctahedral(const qint16* pValue)
+{
+    double dX = qMax((double) pValue[0] / 32767.0, -1.0);
+    double dY = qMax((double) pValue[1] / 32767.0, -1.0);
+    double dZ = 1.0 - fabs(dX) - fabs(dY);
+
+    if (dZ < 0.0)
+    {
+        double dUnfoldedX = (1.0 - fabs(dY)) * (dX >= 0.0 ? 1.0 : -1.0);
+        double dUnfoldedY = (1.0 - fabs(dX)) * (dY >= 0.0 ? 1.0 : -1.0);
+
+        dX = dUnfoldedX;
+        dY = dUnfoldedY;
+    }
+
+    return CVector3(dX, dY, dZ).normalized();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Converts \a fValue to a half float. Values too large become infinity, values too small become zero.
+*/
+quint16 CRenderVertex::floatToHalf(float fValue)
+{
+    quint32 iBits;
+    memcpy(&iBits, &fValue, sizeof(iBits));
+
+    quint16 iSign = (quint16) ((iBits >> 16) & 0x8000);
+    qint32 iExponent = (qint32) ((iBits >> 23) & 0xFF) - 127 + 15;
+    quint32 iMantissa = iBits & 0x007FFFFF;
+
+    // NaN and infinity
+    if (((iBits >> 23) & 0xFF) == 0xFF)
+    {
+        return iSign | 0x7C00 | (iMantissa != 0 ? 0x0200 : 0);
+    }
+
+    // Overflow
+    if (iExponent >= 31)
+    {
+        return iSign | 0x7C00;
+    }
+
+    // Denormals and underflow
+    if (iExponent <= 0)
+    {
+        if (iExponent < -10)
+        {
+            return iSign;
+        }
+
+        iMantissa |= 0x00800000;
+
+        int iShift = 14 - iExponent;
+        quint32 iHalfMantissa = iMantissa >> iShift;
+
+        // Round to nearest
+        if ((iMantissa >> (iShift - 1)) & 1)
+        {
+            iHalfMantissa++;
+        }
+
+        return iSign | (quint16) iHalfMantissa;
+    }
+
+    quint16 iHalf = iSign | (quint16) (iExponent << 10) | (quint16) (iMantissa >> 13);
+
+    // Round to nearest, a carry into the exponent is still correct
+    if (iMantissa & 0x00001000)
+    {
+        iHalf++;
+    }
+
+    return iHalf;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Converts the half float \a iValue to a float.
+*/
+float CRenderVertex::halfToFloat(quint16 iValue)
+{
+    quint32 iSign = (quint32) (iValue & 0x8000) << 16;
+    quint32 iExponent = (iValue >> 10) & 0x1F;
+    quint32 iMantissa = iValue & 0x03FF;
+    quint32 iBits = 0;
+
+    if (iExponent == 0)
+    {
+        if (iMantissa == 0)
+        {
+            iBits = iSign;
+        }
+        else
+        {
+            // Denormal, normalize it
+            iExponent = 127 - 15 + 1;
+
+            while ((iMantissa & 0x0400) == 0)
+            {
+                iMantissa <<= 1;
+                iExponent--;
+            }
+
+            iBits = iSign | (iExponent << 23) | ((iMantissa & 0x03FF) << 13);
+        }
+    }
+    else if (iExponent == 0x1F)
+    {
+        iBits = iSign | 0x7F800000 | (iMantissa << 13);
+    }
+    else
+    {
+        iBits = iSign | ((iExponent - 15 + 127) << 23) | (iMantissa << 13);
+    }
+
+    float fValue;
+    memcpy(&fValue, &iBits, sizeof(fValue));
+
+    return fValue;
+}
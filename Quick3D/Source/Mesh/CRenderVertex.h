@@ -0,0 +1,89 @@
+
+#pragma once
+
+// Qt
+#include <QtGlobal>
+
+// Application
+#include "quick3d_global.h"
+#include "CVector3.h"
+#include "CVertex.h"
+
+//-------------------------------------------------------------------------------------------------
+
+//! Packed vertex transfered to OpenGL, built from a CVertex
+//! Positions are floats relative to the mesh origin, normals and tangents are octahedral encoded,
+//! texture weights are half floats
+class QUICK3D_EXPORT CRenderVertex
+{
+public:
+
+    //-------------------------------------------------------------------------------------------------
+    // Constructors and destructor
+    //-------------------------------------------------------------------------------------------------
+
+    //! Default constructor
+    CRenderVertex();
+
+    //-------------------------------------------------------------------------------------------------
+    // Control methods
+    //-------------------------------------------------------------------------------------------------
+
+    //! Packs vertex, its position is stored relative to vOrigin
+    void pack(const CVertex& vertex, const Math::CVector3& vOrigin);
+
+    //-------------------------------------------------------------------------------------------------
+    // Static methods
+    //-------------------------------------------------------------------------------------------------
+
+    //! Returns the memory offset of m_fPosition
+    static unsigned int positionOffset() { return VTX_OFFSET_OF(CRenderVertex, m_fPosition); }
+
+    //! Returns the memory offset of m_fAltitude
+    static unsigned int altitudeOffset() { return VTX_OFFSET_OF(CRenderVertex, m_fAltitude); }
+
+    //! Returns the memory offset of m_fTexCoord
+    static unsigned int texCoordOffset() { return VTX_OFFSET_OF(CRenderVertex, m_fTexCoord); }
+
+    //! Returns the memory offset of m_iNormal
+    static unsigned int normalOffset() { return VTX_OFFSET_OF(CRenderVertex, m_iNormal); }
+
+    //! Returns the memory offset of m_iTangent
+    static unsigned int tangentOffset() { return VTX_OFFSET_OF(CRenderVertex, m_iTangent); }
+
+    //! Returns the memory offset of m_iDiffTexWeight_0_1_2
+    static unsigned int diffTexWeight_0_1_2Offset() { return VTX_OFFSET_OF(CRenderVertex, m_iDiffTexWeight_0_1_2); }
+
+    //! Returns the memory offset of m_iDiffTexWeight_3_4_5
+    static unsigned int diffTexWeight_3_4_5Offset() { return VTX_OFFSET_OF(CRenderVertex, m_iDiffTexWeight_3_4_5); }
+
+    //! Returns the memory offset of m_iDiffTexWeight_6_7_8
+    static unsigned int diffTexWeight_6_7_8Offset() { return VTX_OFFSET_OF(CRenderVertex, m_iDiffTexWeight_6_7_8); }
+
+    //! Encodes a direction in two normalized shorts
+    static void encodeOctahedral(const Math::CVector3& vDirection, qint16* pResult);
+
+    //! Decodes a direction encoded by encodeOctahedral()
+    static Math::CVector3 decodeOctahedral(const qint16* pValue);
+
+    //! Converts a float to a IEEE 754 half float, rounding to nearest
+    static quint16 floatToHalf(float fValue);
+
+    //! Converts a IEEE 754 half float to a float
+    static float halfToFloat(quint16 iValue);
+
+    //-------------------------------------------------------------------------------------------------
+    // Properties
+    //-------------------------------------------------------------------------------------------------
+
+public:
+
+    float       m_fPosition [3];                // Position relative to the mesh origin
+    float       m_fAltitude;                    // Altitude of the vertex
+    float       m_fTexCoord [3];                // Texture coordinates, terrain uses degrees so half floats are too coarse
+    qint16      m_iNormal [2];                  // Octahedral normal
+    qint16      m_iTangent [2];                 // Octahedral tangent
+    quint16     m_iDiffTexWeight_0_1_2 [4];     // Half float texture weights, the fourth is padding
+    quint16     m_iDiffTexWeight_3_4_5 [4];
+    quint16     m_iDiffTexWeight_6_7_8 [4];
+};
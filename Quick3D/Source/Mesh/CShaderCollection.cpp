@@ -3,18 +3,145 @@
 
 //-------------------------------------------------------------------------------------------------
 
-CShaderCollection::CShaderCollection()
+// Names in the order of EShaderUniform
+static const char* s_sUniformNames [suCount] =
 {
+    "u_camera_projection_matrix",
+    "u_camera_matrix",
+    "u_shadow_projection_matrix",
+    "u_shadow_matrix",
+    "u_resolution",
+    "u_time",
+    "u_shaderQuality",
+    "u_rendering_shadows",
+    "u_normals_only",
+    "u_depth_computing",
+    "u_camera_true_position",
+    "u_camera_position",
+    "u_camera_direction",
+    "u_camera_up",
+    "u_world_origin",
+    "u_world_up",
+    "u_camera_altitude",
+    "u_atmosphere_altitude",
+    "u_global_ambient",
+    "u_shadow_enable",
+    "u_num_lights",
+    "u_light_is_sun",
+    "u_light_position",
+    "u_light_screen_position",
+    "u_light_direction",
+    "u_light_color",
+    "u_light_distance_to_camera",
+    "u_light_distance",
+    "u_light_spot_angle",
+    "u_light_occlusion",
+    "u_fog_enable",
+    "u_fog_distance",
+    "u_fog_color",
+    "u_sun_color",
+
+    "u_IR_enable",
+    "u_IR_factor",
+    "u_inverse_polarity_enable",
+    "u_sky_enable",
+    "u_wave_enable",
+    "u_wave_amplitude",
+    "u_material_ambient",
+    "u_material_diffuse",
+    "u_material_specular",
+    "u_material_subdermal",
+    "u_material_self_illum",
+    "u_material_shininess",
+    "u_material_metalness",
+    "u_material_sss_factor",
+    "u_material_sss_radius",
+    "u_texture_diffuse_enable",
+    "u_texture_diffuse_0",
+    "u_texture_diffuse_1",
+    "u_texture_diffuse_2",
+    "u_texture_diffuse_3",
+    "u_texture_diffuse_4",
+    "u_texture_diffuse_5",
+    "u_texture_diffuse_6",
+    "u_texture_diffuse_7",
+    "u_texture_bump_enable",
+    "u_texture_bump",
+
+    "u_model_matrix",
+    "u_instanced",
+    "u_instance_base_matrix"
+};
+
+// Names in the order of EShaderAttribute
+static const char* s_sAttributeNames [saCount] =
+{
+    "a_position",
+    "a_texcoord",
+    "a_difftext_weight_0_1_2",
+    "a_difftext_weight_3_4_5",
+    "a_difftext_weight_6_7_8",
+    "a_normal",
+    "a_tangent",
+    "a_altitude",
+    "a_instance_matrix"
+};
+
+//-------------------------------------------------------------------------------------------------
+
+CShaderLocations::CShaderLocations(QGLShaderProgram* pProgram)
+    : m_iContextSerial(-1)
+{
+    for (int iIndex = 0; iIndex < suCount; iIndex++)
+    {
+        m_iUniforms[iIndex] = pProgram->uniformLocation(s_sUniformNames[iIndex]);
+    }
+
+    for (int iIndex = 0; iIndex < saCount; iIndex++)
+    {
+        m_iAttributes[iIndex] = pProgram->attributeLocation(s_sAttributeNames[iIndex]);
+    }
 }
 
 //-------------------------------------------------------------------------------------------------
 
-CShaderCollection::~CShaderCollection()
+bool CShaderLocations::beginContext(int iContextSerial)
 {
-    foreach (QGLShaderProgram* pShader, m_vShaders.values())
+    if (m_iContextSerial == iContextSerial)
     {
-        delete pShader;
+        return false;
     }
+
+    m_iContextSerial = iContextSerial;
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+const char* CShaderLocations::uniformName(EShaderUniform eUniform)
+{
+    return s_sUniformNames[eUniform];
+}
+
+//-------------------------------------------------------------------------------------------------
+
+const char* CShaderLocations::attributeName(EShaderAttribute eAttribute)
+{
+    return s_sAttributeNames[eAttribute];
+}
+
+//-------------------------------------------------------------------------------------------------
+
+CShaderCollection::CShaderCollection()
+{
+}
+
+//-------------------------------------------------------------------------------------------------
+
+CShaderCollection::~CShaderCollection()
+{
+    clear();
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -26,7 +153,13 @@ void CShaderCollection::clear()
         delete pShader;
     }
 
+    foreach (CShaderLocations* pLocations, m_vLocations.values())
+    {
+        delete pLocations;
+    }
+
     m_vShaders.clear();
+    m_vLocations.clear();
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -35,10 +168,12 @@ void CShaderCollection::addShader(QString sName, QGLShaderProgram* value)
 {
     if (m_vShaders.contains(sName))
     {
+        delete m_vLocations.take(m_vShaders[sName]);
         delete m_vShaders[sName];
     }
 
     m_vShaders[sName] = value;
+    m_vLocations[value] = new CShaderLocations(value);
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -52,3 +187,10 @@ QGLShaderProgram* CShaderCollection::getShader(QString sName)
 
     return nullptr;
 }
+
+//-------------------------------------------------------------------------------------------------
+
+CShaderLocations* CShaderCollection::locations(QGLShaderProgram* pProgram) const
+{
+    return m_vLocations.value(pProgram, nullptr);
+}
@@ -7,6 +7,7 @@
 
 // Qt
 #include <QMap>
+#include <QHash>
 #include <QtOpenGL>
 #include <QtOpenGL/QGLShaderProgram>
 
@@ -15,6 +16,131 @@
 
 //-------------------------------------------------------------------------------------------------
 
+//! Uniforms set by the engine on standard shader programs
+enum EShaderUniform
+{
+    // Per context
+    suCameraProjectionMatrix,
+    suCameraMatrix,
+    suShadowProjectionMatrix,
+    suShadowMatrix,
+    suResolution,
+    suTime,
+    suShaderQuality,
+    suRenderingShadows,
+    suNormalsOnly,
+    suDepthComputing,
+    suCameraTruePosition,
+    suCameraPosition,
+    suCameraDirection,
+    suCameraUp,
+    suWorldOrigin,
+    suWorldUp,
+    suCameraAltitude,
+    suAtmosphereAltitude,
+    suGlobalAmbient,
+    suShadowEnable,
+    suNumLights,
+    suLightIsSun,
+    suLightPosition,
+    suLightScreenPosition,
+    suLightDirection,
+    suLightColor,
+    suLightDistanceToCamera,
+    suLightDistance,
+    suLightSpotAngle,
+    suLightOcclusion,
+    suFogEnable,
+    suFogDistance,
+    suFogColor,
+    suSunColor,
+
+    // Per material
+    suIREnable,
+    suIRFactor,
+    suInversePolarityEnable,
+    suSkyEnable,
+    suWaveEnable,
+    suWaveAmplitude,
+    suMaterialAmbient,
+    suMaterialDiffuse,
+    suMaterialSpecular,
+    suMaterialSubdermal,
+    suMaterialSelfIllum,
+    suMaterialShininess,
+    suMaterialMetalness,
+    suMaterialSSSFactor,
+    suMaterialSSSRadius,
+    suTextureDiffuseEnable,
+    suTextureDiffuse0,
+    suTextureDiffuse1,
+    suTextureDiffuse2,
+    suTextureDiffuse3,
+    suTextureDiffuse4,
+    suTextureDiffuse5,
+    suTextureDiffuse6,
+    suTextureDiffuse7,
+    suTextureBumpEnable,
+    suTextureBump,
+
+    // Per mesh
+    suModelMatrix,
+    suInstanced,
+    suInstanceBaseMatrix,
+
+    suCount
+};
+
+//! Vertex attributes read by standard shader programs
+enum EShaderAttribute
+{
+    saPosition,
+    saTexCoord,
+    saDiffTexWeight_0_1_2,
+    saDiffTexWeight_3_4_5,
+    saDiffTexWeight_6_7_8,
+    saNormal,
+    saTangent,
+    saAltitude,
+    saInstanceMatrix,           // mat4, uses four consecutive locations
+
+    saCount
+};
+
+//-------------------------------------------------------------------------------------------------
+
+//! Uniform and attribute locations of a linked shader program, resolved once by name
+class QUICK3D_EXPORT CShaderLocations
+{
+public:
+
+    //! Constructor, resolves all locations of pProgram
+    CShaderLocations(QGLShaderProgram* pProgram);
+
+    //! Returns the location of eUniform, -1 if the program does not use it
+    int uniform(EShaderUniform eUniform) const { return m_iUniforms[eUniform]; }
+
+    //! Returns the location of eAttribute, -1 if the program does not use it
+    int attribute(EShaderAttribute eAttribute) const { return m_iAttributes[eAttribute]; }
+
+    //! Returns true if per context uniforms have not been set yet for the render context iContextSerial
+    bool beginContext(int iContextSerial);
+
+    //! Returns the GLSL name of eUniform
+    static const char* uniformName(EShaderUniform eUniform);
+
+    //! Returns the GLSL name of eAttribute
+    static const char* attributeName(EShaderAttribute eAttribute);
+
+protected:
+
+    int     m_iUniforms [suCount];
+    int     m_iAttributes [saCount];
+    int     m_iContextSerial;           // Render context that last received per context uniforms
+};
+
+//-------------------------------------------------------------------------------------------------
+
 class QUICK3D_EXPORT CShaderCollection
 {
 public:
@@ -28,13 +154,17 @@ public:
     //!
     void clear();
 
-    //!
+    //! Adds a linked program and resolves its locations
     void addShader(QString sName, QGLShaderProgram* value);
 
     //!
     QGLShaderProgram* getShader(QString sName);
 
+    //! Returns the locations of pProgram, nullptr if it is not in the collection
+    CShaderLocations* locations(QGLShaderProgram* pProgram) const;
+
 protected:
 
     QMap<QString, QGLShaderProgram*> m_vShaders;
+    QHash<QGLShaderProgram*, CShaderLocations*> m_vLocations;
 };
@@ -0,0 +1,80 @@
+
+// Qt
+#include <QElapsedTimer>
+#include <QMutexLocker>
+
+// Application
+#include "CSharedIndexBuffer.h"
+#include "C3DScene.h"
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    \class CSharedIndexBuffer
+    \brief An index buffer shared by meshes which have the same topology but their own vertices.
+    \inmodule Quick3D
+    \sa CGLMeshData, CMeshGeometry::setSharedIndices()
+
+    The OpenGL buffer is created and filled on first bind(), so it is transfered once
+    whatever the number of meshes using it.
+*/
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Constructs a CSharedIndexBuffer. \br\br
+    \a pScene is the scene owning the rendering context. \br
+    \a iGLType is the primitive type of the indices. \br
+    \a vIndices are the vertex indices.
+*/
+CSharedIndexBuffer::CSharedIndexBuffer(C3DScene* pScene, int iGLType, const QVector<GLuint>& vIndices)
+    : m_pScene(pScene)
+    , m_vIndices(vIndices)
+    , m_iIBO(0)
+    , m_iGLType(iGLType)
+{
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Destroys a CSharedIndexBuffer.
+*/
+CSharedIndexBuffer::~CSharedIndexBuffer()
+{
+    if (m_iIBO != 0)
+    {
+        m_pScene->makeCurrentRenderingContext();
+
+        GL_glDeleteBuffers(1, &m_iIBO);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Binds the buffer to GL_ELEMENT_ARRAY_BUFFER. \br\br
+    On first call, the buffer is created and the indices are transfered, which is accounted in the statistics of \a pContext.
+    Must be called from the rendering thread.
+*/
+void CSharedIndexBuffer::bind(CRenderContext* pContext)
+{
+    QMutexLocker locker(&m_mMutex);
+
+    if (m_iIBO == 0)
+    {
+        QElapsedTimer tTimer;
+        tTimer.start();
+
+        GL_glGenBuffers(1, &m_iIBO);
+        GL_glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_iIBO);
+        GL_glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_vIndices.count() * sizeof(GLuint), m_vIndices.constData(), GL_STATIC_DRAW);
+
+        pContext->tStatistics.m_iNumBytesUploaded += m_vIndices.count() * sizeof(GLuint);
+        pContext->tStatistics.m_iUploadTimeUS += tTimer.nsecsElapsed() / 1000;
+    }
+    else
+    {
+        GL_glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_iIBO);
+    }
+}
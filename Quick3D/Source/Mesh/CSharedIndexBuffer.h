@@ -0,0 +1,68 @@
+
+#pragma once
+
+// Qt
+#include <QMutex>
+#include <QSharedData>
+#include <QVector>
+
+// Application
+#include "quick3d_global.h"
+#include "CQ3DConstants.h"
+#include "CGLExtension.h"
+
+//-------------------------------------------------------------------------------------------------
+// Forward declarations
+
+class C3DScene;
+class CRenderContext;
+
+//-------------------------------------------------------------------------------------------------
+
+//! An OpenGL index buffer shared by several CGLMeshData with the same topology
+class QUICK3D_EXPORT CSharedIndexBuffer : public QSharedData
+{
+public:
+
+    //-------------------------------------------------------------------------------------------------
+    // Constructors and destructor
+    //-------------------------------------------------------------------------------------------------
+
+    //!
+    CSharedIndexBuffer(C3DScene* pScene, int iGLType, const QVector<GLuint>& vIndices);
+
+    //!
+    virtual ~CSharedIndexBuffer();
+
+    //-------------------------------------------------------------------------------------------------
+    // Getters
+    //-------------------------------------------------------------------------------------------------
+
+    //! Returns the primitive type of the indices (GL_TRIANGLES, GL_QUADS...)
+    int glType() const { return m_iGLType; }
+
+    //! Returns the number of indices
+    GLuint count() const { return (GLuint) m_vIndices.count(); }
+
+    //! Returns the indices
+    const QVector<GLuint>& indices() const { return m_vIndices; }
+
+    //-------------------------------------------------------------------------------------------------
+    // Control methods
+    //-------------------------------------------------------------------------------------------------
+
+    //! Binds the buffer to GL_ELEMENT_ARRAY_BUFFER, creating and filling it on first call
+    void bind(CRenderContext* pContext);
+
+    //-------------------------------------------------------------------------------------------------
+    // Properties
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    C3DScene*           m_pScene;
+    QMutex              m_mMutex;
+    QVector<GLuint>     m_vIndices;     // Indices, kept for CPU side queries
+    GLuint              m_iIBO;         // Buffer allocated by OpenGL, 0 until first bind
+    int                 m_iGLType;
+};
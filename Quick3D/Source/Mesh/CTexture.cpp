@@ -1,4 +1,10 @@
 
+// Std
+#include <string.h>
+
+// Qt
+#include <QThreadPool>
+
 // qt-plus
 #include "CLogger.h"
 
@@ -21,52 +27,108 @@ using namespace Math;
 CTextureUpdater::CTextureUpdater(CTexture* pTexture)
     : m_pTexture(pTexture)
     , m_dDeltaTime(0.0)
-    , m_bWork(false)
+    , m_iRequestTimeNS(0)
+    , m_bRequested(false)
+    , m_bRunning(false)
     , m_bStop(false)
 {
+    // The texture owns the updater, the pool must not delete it
+    setAutoDelete(false);
 }
 
 //-------------------------------------------------------------------------------------------------
 
-void CTextureUpdater::setDeltaTime(double dDeltaTime)
+CTextureUpdater::~CTextureUpdater()
 {
-    m_dDeltaTime = dDeltaTime;
+    stop();
 }
 
 //-------------------------------------------------------------------------------------------------
 
 void CTextureUpdater::stop()
 {
+    QMutexLocker locker(&m_mMutex);
+
     m_bStop = true;
-    wait();
+
+    while (m_bRunning)
+    {
+        m_cIdle.wait(&m_mMutex);
+    }
 }
 
 //-------------------------------------------------------------------------------------------------
 
-void CTextureUpdater::work()
+void CTextureUpdater::work(double dDeltaTime)
 {
-    m_bWork = true;
+    QMutexLocker locker(&m_mMutex);
+
+    if (m_bStop)
+    {
+        return;
+    }
+
+    // Requests made while a job runs are served together by its next pass
+    if (m_bRequested == false)
+    {
+        m_bRequested = true;
+        m_iRequestTimeNS = m_pTexture->m_tClock.nsecsElapsed();
+    }
+
+    m_dDeltaTime += dDeltaTime;
+
+    if (m_bRunning == false)
+    {
+        m_bRunning = true;
+
+        QThreadPool::globalInstance()->start(this);
+    }
 }
 
 //-------------------------------------------------------------------------------------------------
 
 void CTextureUpdater::run()
 {
-    while (m_bStop == false)
+    forever
     {
-        if (m_bWork)
+        double dDeltaTime = 0.0;
+        qint64 iRequestTimeNS = 0;
+
         {
-            if (m_pTexture->lock())
+            QMutexLocker locker(&m_mMutex);
+
+            if (m_bStop || m_bRequested == false)
             {
-                m_bWork = false;
-                m_pTexture->m_pUpdater->updateTexture(m_pTexture, m_dDeltaTime);
-                m_pTexture->unlock();
+                m_bRunning = false;
+                m_cIdle.wakeAll();
+                return;
             }
 
-            emit updateFinished();
+            dDeltaTime = m_dDeltaTime;
+            iRequestTimeNS = m_iRequestTimeNS;
+            m_dDeltaTime = 0.0;
+            m_bRequested = false;
         }
 
-        msleep(20);
+        if (m_pTexture->lock())
+        {
+            m_pTexture->m_pUpdater->updateTexture(m_pTexture, dDeltaTime);
+
+            if (m_pTexture->m_bReportsDirtyRects == false)
+            {
+                m_pTexture->m_vDirtyRects.clear();
+                m_pTexture->m_vDirtyRects.append(m_pTexture->m_imgTexture.rect());
+            }
+
+            if (m_pTexture->m_vDirtyRects.count() > 0 && m_pTexture->m_iDirtySinceNS < 0)
+            {
+                m_pTexture->m_iDirtySinceNS = iRequestTimeNS;
+            }
+
+            m_pTexture->unlock();
+        }
+
+        emit updateFinished();
     }
 }
 
@@ -81,33 +143,45 @@ CTexture::CTexture(C3DScene* pScene, QString sName, const QImage& imgTexture, QS
     , m_uiGLTexture(0)
     , m_bIsDynamic(bIsDynamic)
     , m_bDirty(false)
-    , m_iUpdateFPS(25)
-    , m_iUpdateCounter(0)
+    , m_uiUnpackBuffer(0)
+    , m_bReportsDirtyRects(false)
+    , m_iDirtySinceNS(-1)
+    , m_iUploadCount(0)
+    , m_iUploadedBytes(0)
+    , m_iUploadTimeNS(0)
+    , m_iLatencyNS(0)
 {
+    m_tClock.start();
+
     if (imgTexture.width() > 0 && imgTexture.height() > 0)
     {
         m_pScene->makeCurrentRenderingContext();
 
-        QImage tImage = QGLWidget::convertToGLFormat(imgTexture);
-
         GL_glActiveTexture(GL_TEXTURE1 + iIndex);
 
         glGenTextures(1, &m_uiGLTexture);
 
+        glBindTexture(GL_TEXTURE_2D, m_uiGLTexture);
+
         if (m_bIsDynamic)
         {
-            m_imgTexture = imgTexture.copy();
+            // The updater draws in the image at its own size, which is kept by the storage
+            m_imgTexture = imgTexture.convertToFormat(QImage::Format_ARGB32);
+
+            allocateStorage();
+
             m_TextureUpdateWorker = new CTextureUpdater(this);
             connect(m_TextureUpdateWorker, SIGNAL(updateFinished()), this, SLOT(onUpdateFinished()));
-            m_TextureUpdateWorker->start();
         }
+        else
+        {
+            QImage tImage = QGLWidget::convertToGLFormat(imgTexture);
 
-        glBindTexture(GL_TEXTURE_2D, m_uiGLTexture);
-
-        tImage = tImage.scaled(size.width(), size.height(), Qt::IgnoreAspectRatio);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tImage.width(), tImage.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, tImage.bits());
+            tImage = tImage.scaled(size.width(), size.height(), Qt::IgnoreAspectRatio);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tImage.width(), tImage.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, tImage.bits());
 
-        GL_glGenerateMipmap(GL_TEXTURE_2D);
+            GL_glGenerateMipmap(GL_TEXTURE_2D);
+        }
     }
 }
 
@@ -123,6 +197,11 @@ CTexture::~CTexture()
 
     m_pScene->makeCurrentRenderingContext();
 
+    if (m_uiUnpackBuffer != 0)
+    {
+        GL_glDeleteBuffers(1, &m_uiUnpackBuffer);
+    }
+
     glDeleteTextures(1, &m_uiGLTexture);
 }
 
@@ -132,13 +211,7 @@ void CTexture::update(double dDeltaTime)
 {
     if (m_bIsDynamic && m_pUpdater != nullptr && m_TextureUpdateWorker != nullptr)
     {
-        m_iUpdateCounter++;
-
-        if (m_iUpdateCounter > 3)
-        {
-            m_TextureUpdateWorker->setDeltaTime(dDeltaTime);
-            m_TextureUpdateWorker->work();
-        }
+        m_TextureUpdateWorker->work(dDeltaTime);
     }
 }
 
@@ -186,22 +259,183 @@ void CTexture::unlock()
 
 //-------------------------------------------------------------------------------------------------
 
+void CTexture::invalidate(const QRect& rRect)
+{
+    m_bReportsDirtyRects = true;
+
+    QRect rDirty = rRect.isNull() ? m_imgTexture.rect() : rRect.intersected(m_imgTexture.rect());
+
+    if (rDirty.isEmpty())
+    {
+        return;
+    }
+
+    for (int iIndex = 0; iIndex < m_vDirtyRects.count(); iIndex++)
+    {
+        if (m_vDirtyRects[iIndex].contains(rDirty))
+        {
+            return;
+        }
+    }
+
+    m_vDirtyRects.append(rDirty);
+
+    // Many small uploads cost more than a larger one
+    if (m_vDirtyRects.count() > TEXTURE_DIRTY_RECTS)
+    {
+        QRect rBounds;
+
+        foreach (QRect rPart, m_vDirtyRects)
+        {
+            rBounds = rBounds.united(rPart);
+        }
+
+        m_vDirtyRects.clear();
+        m_vDirtyRects.append(rBounds);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
 void CTexture::onUpdateFinished()
 {
     if (lock())
     {
-        m_pScene->makeCurrentRenderingContext();
+        if (m_vDirtyRects.count() > 0)
+        {
+            qint64 iStartNS = m_tClock.nsecsElapsed();
 
-        GL_glActiveTexture(GL_TEXTURE1 + 0);
+            m_pScene->makeCurrentRenderingContext();
 
-        glBindTexture(GL_TEXTURE_2D, m_uiGLTexture);
+            GL_glActiveTexture(GL_TEXTURE1 + 0);
 
-        QImage tImage = QGLWidget::convertToGLFormat(m_imgTexture);
+            glBindTexture(GL_TEXTURE_2D, m_uiGLTexture);
+
+            // Producers may replace the image, only those in native BGRA order are uploaded without conversion
+            if (m_imgTexture.format() != QImage::Format_ARGB32 && m_imgTexture.format() != QImage::Format_RGB32)
+            {
+                m_imgTexture = m_imgTexture.convertToFormat(QImage::Format_ARGB32);
+            }
+
+            if (m_imgTexture.size() != m_sStorageSize)
+            {
+                allocateStorage();
+
+                m_iUploadedBytes += (qint64) m_imgTexture.width() * (qint64) m_imgTexture.height() * 4;
+            }
+            else
+            {
+                qint64 iBytes = 0;
 
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tImage.width(), tImage.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, tImage.bits());
+                foreach (QRect rDirty, m_vDirtyRects)
+                {
+                    iBytes += (qint64) rDirty.width() * (qint64) rDirty.height() * 4;
+                }
 
-        m_iUpdateCounter = 0;
+                uchar* pMapped = nullptr;
+
+                if (m_pScene->glExtension()->hasPixelBuffers())
+                {
+                    if (m_uiUnpackBuffer == 0)
+                    {
+                        GL_glGenBuffers(1, &m_uiUnpackBuffer);
+                    }
+
+                    // Orphaning the buffer lets the driver keep the previous one until it is consumed
+                    GL_glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_uiUnpackBuffer);
+                    GL_glBufferData(GL_PIXEL_UNPACK_BUFFER, iBytes, nullptr, GL_STREAM_DRAW);
+
+                    pMapped = (uchar*) GL_glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+
+                    if (pMapped != nullptr)
+                    {
+                        copyDirtyRects(pMapped);
+
+                        if (GL_glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE)
+                        {
+                            // The contents were lost, the rectangles go through memory
+                            pMapped = nullptr;
+                        }
+                    }
+
+                    if (pMapped != nullptr)
+                    {
+                        uploadDirtyRects(nullptr);
+                    }
+
+                    GL_glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                }
+
+                if (pMapped == nullptr)
+                {
+                    m_vStaging.resize(iBytes);
+
+                    copyDirtyRects(m_vStaging.data());
+                    uploadDirtyRects(m_vStaging.constData());
+                }
+
+                m_iUploadedBytes += iBytes;
+            }
+
+            m_vDirtyRects.clear();
+
+            qint64 iEndNS = m_tClock.nsecsElapsed();
+
+            m_iUploadCount++;
+            m_iUploadTimeNS += iEndNS - iStartNS;
+
+            if (m_iDirtySinceNS >= 0)
+            {
+                m_iLatencyNS += iEndNS - m_iDirtySinceNS;
+                m_iDirtySinceNS = -1;
+            }
+        }
 
         unlock();
     }
 }
+
+//-------------------------------------------------------------------------------------------------
+
+void CTexture::allocateStorage()
+{
+    QImage tImage = m_imgTexture.mirrored();
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, tImage.width(), tImage.height(), 0, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, tImage.constBits());
+
+    m_sStorageSize = m_imgTexture.size();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CTexture::copyDirtyRects(uchar* pTarget) const
+{
+    foreach (QRect rDirty, m_vDirtyRects)
+    {
+        int iRowBytes = rDirty.width() * 4;
+
+        for (int y = rDirty.bottom(); y >= rDirty.top(); y--)
+        {
+            memcpy(pTarget, m_imgTexture.constScanLine(y) + rDirty.left() * 4, iRowBytes);
+            pTarget += iRowBytes;
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CTexture::uploadDirtyRects(const uchar* pSource)
+{
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    foreach (QRect rDirty, m_vDirtyRects)
+    {
+        // OpenGL rows start at the bottom of the image
+        int iGLTop = m_imgTexture.height() - 1 - rDirty.bottom();
+
+        glTexSubImage2D(GL_TEXTURE_2D, 0, rDirty.left(), iGLTop, rDirty.width(), rDirty.height(), GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, pSource);
+
+        pSource += rDirty.width() * rDirty.height() * 4;
+    }
+}
@@ -4,8 +4,12 @@
 // Qt
 #include <QImage>
 #include <QtOpenGL>
-#include <QThread>
+#include <QRunnable>
 #include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QRect>
 
 // qt-plus
 #include "CXMLNode.h"
@@ -26,26 +30,32 @@ class CTexture;
 
 //-------------------------------------------------------------------------------------------------
 
-class QUICK3D_EXPORT CTextureUpdater : public QThread
+//! Maximum number of dirty rectangles of a texture, more are merged into their bounding rectangle
+#define TEXTURE_DIRTY_RECTS     8
+
+//-------------------------------------------------------------------------------------------------
+
+//! Runs the updater of a dynamic texture as a job of the global thread pool, when an update is requested
+class QUICK3D_EXPORT CTextureUpdater : public QObject, public QRunnable
 {
     Q_OBJECT
 
 public:
 
-    //!
+    //! Constructor
     CTextureUpdater(CTexture* pTexture);
 
-    //!
-    void setDeltaTime(double dDeltaTime);
+    //! Destructor, waits for the running job
+    virtual ~CTextureUpdater();
 
-    //!
+    //! Waits for the running job and refuses new requests
     void stop();
 
-    //!
-    void work();
+    //! Requests an update covering dDeltaTime seconds, starts a job if none is running
+    void work(double dDeltaTime);
 
-    //!
-    virtual void run();
+    //! Runs the requested updates, in a thread of the pool
+    virtual void run() Q_DECL_OVERRIDE;
 
 signals:
 
@@ -53,10 +63,14 @@ signals:
 
 protected:
 
-    CTexture*   m_pTexture;
-    double      m_dDeltaTime;
-    bool        m_bStop;
-    bool        m_bWork;
+    CTexture*       m_pTexture;
+    QMutex          m_mMutex;
+    QWaitCondition  m_cIdle;
+    double          m_dDeltaTime;           // Time covered by the requests not yet served
+    qint64          m_iRequestTimeNS;       // Time of the first request not yet served, on the clock of the texture
+    bool            m_bRequested;
+    bool            m_bRunning;
+    bool            m_bStop;
 };
 
 //-------------------------------------------------------------------------------------------------
@@ -108,6 +122,18 @@ public:
     //!
     bool isDirty() const { return m_bDirty; }
 
+    //! Returns the number of uploads of a dynamic texture
+    qint64 uploadCount() const { return m_iUploadCount; }
+
+    //! Returns the number of bytes uploaded to a dynamic texture
+    qint64 uploadedBytes() const { return m_iUploadedBytes; }
+
+    //! Returns the time spent uploading, in milliseconds
+    double uploadTimeMS() const { return (double) m_iUploadTimeNS / 1000000.0; }
+
+    //! Returns the mean time from an update request to the upload of its pixels, in milliseconds
+    double uploadLatencyMS() const { return m_iUploadCount > 0 ? (double) m_iLatencyNS / (double) m_iUploadCount / 1000000.0 : 0.0; }
+
     //-------------------------------------------------------------------------------------------------
     // Control methods
     //-------------------------------------------------------------------------------------------------
@@ -124,6 +150,9 @@ public:
     //!
     void unlock();
 
+    //! Marks rRect of image() as modified, the whole image if rRect is null, call it while the texture is locked
+    void invalidate(const QRect& rRect = QRect());
+
     //-------------------------------------------------------------------------------------------------
     // Slots
     //-------------------------------------------------------------------------------------------------
@@ -138,6 +167,15 @@ public slots:
 
 protected:
 
+    //! Allocates the storage of a dynamic texture, with the pixels of image()
+    void allocateStorage();
+
+    //! Copies the dirty rectangles of image() into pTarget, bottom row first as OpenGL expects them
+    void copyDirtyRects(uchar* pTarget) const;
+
+    //! Uploads the dirty rectangles from pSource, a buffer offset when a pixel buffer is bound
+    void uploadDirtyRects(const uchar* pSource);
+
     //-------------------------------------------------------------------------------------------------
     // Properties
     //-------------------------------------------------------------------------------------------------
@@ -153,6 +191,15 @@ protected:
     QImage              m_imgTexture;
     bool                m_bIsDynamic;
     bool                m_bDirty;
-    int                 m_iUpdateFPS;
-    int                 m_iUpdateCounter;
+    QSize               m_sStorageSize;             // Size of the texture storage, to re-allocate it when image() is resized
+    GLuint              m_uiUnpackBuffer;           // Pixel buffer the dirty rectangles are streamed through
+    QVector<uchar>      m_vStaging;                 // Rows of the dirty rectangles, without pixel buffers
+    QVector<QRect>      m_vDirtyRects;              // Rectangles of image() not yet uploaded
+    bool                m_bReportsDirtyRects;       // False until the updater calls invalidate(), the whole image is uploaded meanwhile
+    QElapsedTimer       m_tClock;                   // Clock of the update requests
+    qint64              m_iDirtySinceNS;            // Request time of the oldest pixels not yet uploaded, -1 if none
+    qint64              m_iUploadCount;
+    qint64              m_iUploadedBytes;
+    qint64              m_iUploadTimeNS;
+    qint64              m_iLatencyNS;
 };
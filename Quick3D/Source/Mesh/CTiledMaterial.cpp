@@ -19,6 +19,8 @@ CTiledMaterial::CTiledMaterial(C3DScene* pScene)
     , m_iLevels(18)
 {
     connect(&m_tClient, SIGNAL(tileReady(QString)), this, SLOT(onTileReady(QString)));
+
+    m_tGarbageTimer.start();
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -31,9 +33,12 @@ CTiledMaterial::~CTiledMaterial()
 
 void CTiledMaterial::onTileReady(QString sTileName)
 {
-    if (m_mTiles.contains(sTileName))
+    // Always take the image, so that the client does not keep tiles destroyed meanwhile
+    QImage image = m_tClient.getTile(sTileName);
+
+    if (m_mTiles.contains(sTileName) && m_mTiles[sTileName].m_pTexture == nullptr && image.isNull() == false)
     {
-        m_mTiles[sTileName].m_pTexture = new CTexture(m_pScene, sTileName, m_tClient.getTile(sTileName), QSize(256, 256), m_vDiffuseTextures.count());
+        m_mTiles[sTileName].m_pTexture = new CTexture(m_pScene, sTileName, image, QSize(256, 256), m_vDiffuseTextures.count());
 
         LOG_METHOD_DEBUG(QString("Created texture %1").arg(m_mTiles[sTileName].m_pTexture->glTexture()));
     }
@@ -51,14 +56,27 @@ CVector2 CTiledMaterial::texCoords(const CGeoloc& gPosition, int iLevel)
 
 //-------------------------------------------------------------------------------------------------
 
-void CTiledMaterial::setCurrentPositionAndLevel(const CGeoloc& gPosition, int iLevel)
+/*!
+    Makes the tile at \a gPosition and \a iLevel current, requesting it if needed. \br\br
+    Tiles still loading are ranked by \a dDistance in tile sizes, a tile size doubling with each level,
+    so that the tiles covering most of the view come first.
+*/
+void CTiledMaterial::setCurrentPositionAndLevel(const CGeoloc& gPosition, int iLevel, double dDistance)
 {
     m_sCurrentQuadKey = quadKeyFromPositionAndLevel(gPosition, iLevel);
 
     if (quadKeyPresent(m_sCurrentQuadKey) == false)
     {
         m_mTiles[m_sCurrentQuadKey] = CTile(0, 0);
-        m_tClient.loadTile(m_sCurrentQuadKey);
+    }
+
+    CTile& tTile = m_mTiles[m_sCurrentQuadKey];
+
+    if (tTile.m_pTexture == nullptr)
+    {
+        // Requests the tile or updates its priority
+        tTile.m_tLastUsed = QDateTime::currentDateTime();
+        m_tClient.loadTile(m_sCurrentQuadKey, dDistance / pow(2.0, (double) iLevel));
     }
 
     collectGarbage();
@@ -72,7 +90,9 @@ QGLShaderProgram* CTiledMaterial::activate(CRenderContext* pContext)
 
     if (pProgram != nullptr)
     {
-        pProgram->setUniformValue("u_texture_diffuse_enable", (GLint) 0);
+        CShaderLocations* pLocations = pContext->scene()->shaders()->locations(pProgram);
+
+        pProgram->setUniformValue(pLocations->uniform(suTextureDiffuseEnable), (GLint) 0);
 
         if (m_mTiles.contains(m_sCurrentQuadKey))
         {
@@ -81,8 +101,8 @@ QGLShaderProgram* CTiledMaterial::activate(CRenderContext* pContext)
                 m_mTiles[m_sCurrentQuadKey].m_tLastUsed = QDateTime::currentDateTime();
                 m_mTiles[m_sCurrentQuadKey].m_pTexture->activate();
 
-                pProgram->setUniformValue("u_texture_diffuse_enable", (GLint) 1);
-                pProgram->setUniformValue("u_texture_diffuse_0", (GLint) 1);
+                pProgram->setUniformValue(pLocations->uniform(suTextureDiffuseEnable), (GLint) 1);
+                pProgram->setUniformValue(pLocations->uniform(suTextureDiffuse0), (GLint) 1);
             }
         }
     }
@@ -163,21 +183,28 @@ bool CTiledMaterial::quadKeyPresent(QString sKey)
 
 void CTiledMaterial::collectGarbage()
 {
-    static int iGarbageCounter = 0;
-
-    iGarbageCounter++;
-
-    if (iGarbageCounter > 2000)
+    if (m_tGarbageTimer.elapsed() > TILE_GARBAGE_PERIOD_MS)
     {
-        iGarbageCounter = 0;
+        m_tGarbageTimer.start();
 
+        QDateTime tNow = QDateTime::currentDateTime();
         QList<QString> keys = m_mTiles.keys();
 
         for (int iIndex = 0; iIndex < keys.count(); iIndex++)
         {
             QString sKey = keys[iIndex];
+            qint64 iUnusedSeconds = m_mTiles[sKey].m_tLastUsed.secsTo(tNow);
 
-            if (m_mTiles[sKey].m_tLastUsed.secsTo(QDateTime::currentDateTime()) > 20)
+            if (m_mTiles[sKey].m_pTexture == nullptr)
+            {
+                // Tiles out of view are not worth their download
+                if (iUnusedSeconds > TILE_CANCEL_DELAY_S)
+                {
+                    m_tClient.cancelTile(sKey);
+                    m_mTiles.remove(sKey);
+                }
+            }
+            else if (iUnusedSeconds > TILE_UNUSED_DELAY_S)
             {
                 m_mTiles.remove(sKey);
             }
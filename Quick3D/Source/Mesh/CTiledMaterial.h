@@ -5,6 +5,7 @@
 #include <QtOpenGL>
 #include <QObject>
 #include <QDateTime>
+#include <QElapsedTimer>
 
 // Application
 #include "quick3d_global.h"
@@ -13,6 +14,17 @@
 #include "CMaterial.h"
 #include "CHTTPMapClient.h"
 
+//-------------------------------------------------------------------------------------------------
+
+//! Interval between two garbage collections of tiles
+#define TILE_GARBAGE_PERIOD_MS      1000
+
+//! Time after which a tile still loading and no longer drawn is cancelled
+#define TILE_CANCEL_DELAY_S         2
+
+//! Time after which a loaded tile no longer drawn is destroyed
+#define TILE_UNUSED_DELAY_S         20
+
 //-------------------------------------------------------------------------------------------------
 // Forward declarations
 
@@ -76,8 +88,8 @@ public:
     //!
     void setLevels(int value) { m_iLevels = value; }
 
-    //! Dfinit la golocalisation et le niveau
-    void setCurrentPositionAndLevel(const CGeoloc& gPosition, int iLevel);
+    //! Sets the current tile from a position and level, dDistance to the camera ranks its download
+    void setCurrentPositionAndLevel(const CGeoloc& gPosition, int iLevel, double dDistance = 0.0);
 
     //-------------------------------------------------------------------------------------------------
     // Getters
@@ -135,4 +147,5 @@ protected:
     CHTTPMapClient          m_tClient;
     QMap<QString, CTile>    m_mTiles;
     QString                 m_sCurrentQuadKey;
+    QElapsedTimer           m_tGarbageTimer;
 };
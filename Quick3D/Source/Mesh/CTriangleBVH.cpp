@@ -0,0 +1,489 @@
+
+// Application
+#include "CTriangleBVH.h"
+#include "CBoundingBox.h"
+#include "CFace.h"
+
+//-------------------------------------------------------------------------------------------------
+
+using namespace Math;
+
+//-------------------------------------------------------------------------------------------------
+
+// Leaves are made below this number of triangles
+#define TRIANGLE_BVH_LEAF_SIZE      4
+
+// Leaves may hold up to this number of triangles when splitting them does not pay
+#define TRIANGLE_BVH_MAX_LEAF_SIZE  16
+
+// Number of bins of the surface area heuristic
+#define TRIANGLE_BVH_BINS           12
+
+// Leaves are forced at this depth, which keeps the traversal stack bounded
+#define TRIANGLE_BVH_MAX_DEPTH      48
+
+// Traversal cost of a node relative to a triangle test
+#define TRIANGLE_BVH_NODE_COST      1.0
+
+// Relative padding of triangle bounds, covers rounding in CFace::intersectTriangle() for rays down to its grazing limit
+#define TRIANGLE_BVH_PADDING        1e-6
+
+//-------------------------------------------------------------------------------------------------
+
+// Returns half the surface area of a box
+static inline double halfArea(const CVector3& vMinimum, const CVector3& vMaximum)
+{
+    CVector3 vSize = vMaximum - vMinimum;
+
+    return vSize.X * vSize.Y + vSize.Y * vSize.Z + vSize.Z * vSize.X;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+// Grows a box to include another
+static inline void growBounds(CVector3& vMinimum, CVector3& vMaximum, const CVector3& vOtherMinimum, const CVector3& vOtherMaximum)
+{
+    for (int iAxis = 0; iAxis < 3; iAxis++)
+    {
+        vMinimum[iAxis] = qMin(vMinimum[iAxis], vOtherMinimum[iAxis]);
+        vMaximum[iAxis] = qMax(vMaximum[iAxis], vOtherMaximum[iAxis]);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    \class CTriangleBVH
+    \brief A bounding volume hierarchy over the triangles of a mesh.
+    \inmodule Quick3D
+    \sa CFace::intersectTriangle(), CSceneBVH
+
+    Triangles are added in local space, then build() splits them using a binned surface area heuristic.
+    Nodes are stored in a flat array and the triangles of each leaf are contiguous. \br\br
+    intersect() returns exactly what testing every triangle in order of addition would return :
+    CFace::intersectTriangle() is called on the same vertices, hits behind the ray origin count like it does,
+    and the first added triangle wins when two hits are at the same distance. \br
+    Queries do not modify the tree and may run concurrently.
+*/
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Constructs an empty CTriangleBVH.
+*/
+CTriangleBVH::CTriangleBVH()
+{
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Destroys a CTriangleBVH.
+*/
+CTriangleBVH::~CTriangleBVH()
+{
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Removes all triangles and nodes.
+*/
+void CTriangleBVH::clear()
+{
+    m_vNodes.clear();
+    m_vTriangles.clear();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Adds the triangle (\a v1, \a v2, \a v3). Its index is the number of triangles added before it.
+*/
+void CTriangleBVH::addTriangle(const CVector3& v1, const CVector3& v2, const CVector3& v3)
+{
+    m_vTriangles.append(CTriangleBVHTriangle(v1, v2, v3, m_vTriangles.count()));
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Builds the nodes over the added triangles, which are then reordered by leaf.
+*/
+void CTriangleBVH::build()
+{
+    m_vNodes.resize(0);
+
+    int iCount = m_vTriangles.count();
+
+    if (iCount == 0)
+    {
+        return;
+    }
+
+    // Triangle bounds, padded relatively to the magnitude of the coordinates
+    double dMagnitude = 0.0;
+
+    foreach (const CTriangleBVHTriangle& tTriangle, m_vTriangles)
+    {
+        for (int iAxis = 0; iAxis < 3; iAxis++)
+        {
+            dMagnitude = qMax(dMagnitude, fabs(tTriangle.m_v1[iAxis]));
+            dMagnitude = qMax(dMagnitude, fabs(tTriangle.m_v2[iAxis]));
+            dMagnitude = qMax(dMagnitude, fabs(tTriangle.m_v3[iAxis]));
+        }
+    }
+
+    double dPadding = TRIANGLE_BVH_PADDING * (dMagnitude + 1.0);
+    CVector3 vPadding(dPadding, dPadding, dPadding);
+
+    m_vOrder.resize(iCount);
+    m_vMinimums.resize(iCount);
+    m_vMaximums.resize(iCount);
+    m_vCenters.resize(iCount);
+
+    for (int iIndex = 0; iIndex < iCount; iIndex++)
+    {
+        const CTriangleBVHTriangle& tTriangle = m_vTriangles[iIndex];
+        CVector3 vMinimum = tTriangle.m_v1;
+        CVector3 vMaximum = tTriangle.m_v1;
+
+        growBounds(vMinimum, vMaximum, tTriangle.m_v2, tTriangle.m_v2);
+        growBounds(vMinimum, vMaximum, tTriangle.m_v3, tTriangle.m_v3);
+
+        m_vOrder[iIndex] = iIndex;
+        m_vMinimums[iIndex] = vMinimum - vPadding;
+        m_vMaximums[iIndex] = vMaximum + vPadding;
+        m_vCenters[iIndex] = (vMinimum + vMaximum) * 0.5;
+    }
+
+    m_vNodes.reserve((iCount * 2) / TRIANGLE_BVH_LEAF_SIZE + 1);
+
+    buildRecurse(0, iCount, 0);
+
+    // Store the triangles in leaf order
+    QVector<CTriangleBVHTriangle> vSorted(iCount);
+
+    for (int iIndex = 0; iIndex < iCount; iIndex++)
+    {
+        vSorted[iIndex] = m_vTriangles[m_vOrder[iIndex]];
+    }
+
+    m_vTriangles = vSorted;
+
+    m_vOrder.clear();
+    m_vMinimums.clear();
+    m_vMaximums.clear();
+    m_vCenters.clear();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Builds a node over the \a iCount triangles of the build order starting at \a iFirst, \a iDepth being the depth of the node. \br\br
+    Triangle centers are binned along each axis, and the split with the least estimated cost is kept,
+    unless testing all triangles is cheaper.
+*/
+int CTriangleBVH::buildRecurse(int iFirst, int iCount, int iDepth)
+{
+    int iNodeIndex = m_vNodes.count();
+
+    m_vNodes.append(CTriangleBVHNode());
+
+    // Compute the node bounds and the bounds of the centers
+    CVector3 vMinimum = m_vMinimums[m_vOrder[iFirst]];
+    CVector3 vMaximum = m_vMaximums[m_vOrder[iFirst]];
+    CVector3 vCenterMinimum = m_vCenters[m_vOrder[iFirst]];
+    CVector3 vCenterMaximum = vCenterMinimum;
+
+    for (int iIndex = iFirst + 1; iIndex < iFirst + iCount; iIndex++)
+    {
+        int iTriangle = m_vOrder[iIndex];
+
+        growBounds(vMinimum, vMaximum, m_vMinimums[iTriangle], m_vMaximums[iTriangle]);
+        growBounds(vCenterMinimum, vCenterMaximum, m_vCenters[iTriangle], m_vCenters[iTriangle]);
+    }
+
+    m_vNodes[iNodeIndex].m_vMinimum = vMinimum;
+    m_vNodes[iNodeIndex].m_vMaximum = vMaximum;
+
+    if (iCount <= TRIANGLE_BVH_LEAF_SIZE || iDepth >= TRIANGLE_BVH_MAX_DEPTH)
+    {
+        makeLeaf(iNodeIndex, iFirst, iCount);
+        return iNodeIndex;
+    }
+
+    // Find the best binned split
+    int iBestAxis = -1;
+    int iBestBin = 0;
+    double dBestCost = 0.0;
+
+    for (int iAxis = 0; iAxis < 3; iAxis++)
+    {
+        double dExtent = vCenterMaximum[iAxis] - vCenterMinimum[iAxis];
+
+        if (dExtent <= 0.0)
+        {
+            continue;
+        }
+
+        double dScale = (double) TRIANGLE_BVH_BINS / dExtent;
+
+        int vBinCounts[TRIANGLE_BVH_BINS];
+        CVector3 vBinMinimums[TRIANGLE_BVH_BINS];
+        CVector3 vBinMaximums[TRIANGLE_BVH_BINS];
+
+        for (int iBin = 0; iBin < TRIANGLE_BVH_BINS; iBin++)
+        {
+            vBinCounts[iBin] = 0;
+        }
+
+        for (int iIndex = iFirst; iIndex < iFirst + iCount; iIndex++)
+        {
+            int iTriangle = m_vOrder[iIndex];
+            int iBin = qMin((int) ((m_vCenters[iTriangle][iAxis] - vCenterMinimum[iAxis]) * dScale), TRIANGLE_BVH_BINS - 1);
+
+            if (vBinCounts[iBin] == 0)
+            {
+                vBinMinimums[iBin] = m_vMinimums[iTriangle];
+                vBinMaximums[iBin] = m_vMaximums[iTriangle];
+            }
+            else
+            {
+                growBounds(vBinMinimums[iBin], vBinMaximums[iBin], m_vMinimums[iTriangle], m_vMaximums[iTriangle]);
+            }
+
+            vBinCounts[iBin]++;
+        }
+
+        // Sweep from the right to get the cost of the right side of each split
+        double vRightCosts[TRIANGLE_BVH_BINS];
+        int iRightCount = 0;
+        CVector3 vRightMinimum;
+        CVector3 vRightMaximum;
+
+        for (int iBin = TRIANGLE_BVH_BINS - 1; iBin > 0; iBin--)
+        {
+            if (vBinCounts[iBin] > 0)
+            {
+                if (iRightCount == 0)
+                {
+                    vRightMinimum = vBinMinimums[iBin];
+                    vRightMaximum = vBinMaximums[iBin];
+                }
+                else
+                {
+                    growBounds(vRightMinimum, vRightMaximum, vBinMinimums[iBin], vBinMaximums[iBin]);
+                }
+
+                iRightCount += vBinCounts[iBin];
+            }
+
+            vRightCosts[iBin] = iRightCount > 0 ? halfArea(vRightMinimum, vRightMaximum) * (double) iRightCount : 0.0;
+        }
+
+        // Sweep from the left, splitting before each bin
+        int iLeftCount = 0;
+        CVector3 vLeftMinimum;
+        CVector3 vLeftMaximum;
+
+        for (int iBin = 0; iBin < TRIANGLE_BVH_BINS - 1; iBin++)
+        {
+            if (vBinCounts[iBin] > 0)
+            {
+                if (iLeftCount == 0)
+                {
+                    vLeftMinimum = vBinMinimums[iBin];
+                    vLeftMaximum = vBinMaximums[iBin];
+                }
+                else
+                {
+                    growBounds(vLeftMinimum, vLeftMaximum, vBinMinimums[iBin], vBinMaximums[iBin]);
+                }
+
+                iLeftCount += vBinCounts[iBin];
+            }
+
+            if (iLeftCount == 0 || iLeftCount == iCount)
+            {
+                continue;
+            }
+
+            double dCost = halfArea(vLeftMinimum, vLeftMaximum) * (double) iLeftCount + vRightCosts[iBin + 1];
+
+            if (iBestAxis < 0 || dCost < dBestCost)
+            {
+                iBestAxis = iAxis;
+                iBestBin = iBin;
+                dBestCost = dCost;
+            }
+        }
+    }
+
+    // Compare with the cost of a leaf, both relative to the node area
+    double dNodeArea = halfArea(vMinimum, vMaximum);
+    double dLeafCost = (double) iCount;
+    double dSplitCost = TRIANGLE_BVH_NODE_COST + (dNodeArea > 0.0 ? dBestCost / dNodeArea : (double) iCount);
+
+    if (iBestAxis < 0)
+    {
+        // All centers are the same, split in two halves unless the leaf is small enough
+        if (iCount <= TRIANGLE_BVH_MAX_LEAF_SIZE)
+        {
+            makeLeaf(iNodeIndex, iFirst, iCount);
+            return iNodeIndex;
+        }
+
+        buildRecurse(iFirst, iCount / 2, iDepth + 1);
+        int iRight = buildRecurse(iFirst + iCount / 2, iCount - iCount / 2, iDepth + 1);
+
+        m_vNodes[iNodeIndex].m_iFirst = iRight;
+
+        return iNodeIndex;
+    }
+
+    if (iCount <= TRIANGLE_BVH_MAX_LEAF_SIZE && dLeafCost <= dSplitCost)
+    {
+        makeLeaf(iNodeIndex, iFirst, iCount);
+        return iNodeIndex;
+    }
+
+    // Partition the triangles on the chosen bin
+    double dScale = (double) TRIANGLE_BVH_BINS / (vCenterMaximum[iBestAxis] - vCenterMinimum[iBestAxis]);
+    int iLeft = iFirst;
+    int iRight = iFirst + iCount - 1;
+
+    while (iLeft <= iRight)
+    {
+        int iTriangle = m_vOrder[iLeft];
+        int iBin = qMin((int) ((m_vCenters[iTriangle][iBestAxis] - vCenterMinimum[iBestAxis]) * dScale), TRIANGLE_BVH_BINS - 1);
+
+        if (iBin <= iBestBin)
+        {
+            iLeft++;
+        }
+        else
+        {
+            qSwap(m_vOrder[iLeft], m_vOrder[iRight]);
+            iRight--;
+        }
+    }
+
+    int iLeftCount = iLeft - iFirst;
+
+    // The left child directly follows its parent, the node array may grow in between
+    buildRecurse(iFirst, iLeftCount, iDepth + 1);
+    int iRightNode = buildRecurse(iFirst + iLeftCount, iCount - iLeftCount, iDepth + 1);
+
+    m_vNodes[iNodeIndex].m_iFirst = iRightNode;
+
+    return iNodeIndex;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Makes the node at \a iNodeIndex a leaf over the \a iCount triangles of the build order starting at \a iFirst.
+*/
+void CTriangleBVH::makeLeaf(int iNodeIndex, int iFirst, int iCount)
+{
+    m_vNodes[iNodeIndex].m_iFirst = iFirst;
+    m_vNodes[iNodeIndex].m_iCount = iCount;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Returns the nearest intersection of \a ray with the triangles. \br\br
+    Distance and normal are those CFace::intersectTriangle() returns for the nearest triangle. Nodes are visited
+    nearest first and skipped when they are entered beyond the nearest hit found so far.
+*/
+RayTracingResult CTriangleBVH::intersect(const CRay3& ray) const
+{
+    RayTracingResult dReturnResult(Q3D_INFINITY);
+    int iBestIndex = -1;
+
+    if (m_vNodes.isEmpty())
+    {
+        return dReturnResult;
+    }
+
+    CVector3 vInverse = CBoundingBox::inverseDirection(ray.vNormal);
+    double dEntry = 0.0;
+
+    int vStack[TRIANGLE_BVH_MAX_DEPTH + 2];
+    double vStackEntry[TRIANGLE_BVH_MAX_DEPTH + 2];
+    int iStackSize = 0;
+
+    if (CBoundingBox::lineEntry(ray.vOrigin, vInverse, m_vNodes[0].m_vMinimum, m_vNodes[0].m_vMaximum, dReturnResult.m_dDistance, dEntry))
+    {
+        vStack[iStackSize] = 0;
+        vStackEntry[iStackSize] = dEntry;
+        iStackSize++;
+    }
+
+    while (iStackSize > 0)
+    {
+        iStackSize--;
+
+        if (vStackEntry[iStackSize] > dReturnResult.m_dDistance)
+        {
+            continue;
+        }
+
+        int iNodeIndex = vStack[iStackSize];
+        const CTriangleBVHNode& tNode = m_vNodes[iNodeIndex];
+
+        if (tNode.m_iCount > 0)
+        {
+            for (int iIndex = tNode.m_iFirst; iIndex < tNode.m_iFirst + tNode.m_iCount; iIndex++)
+            {
+                const CTriangleBVHTriangle& tTriangle = m_vTriangles[iIndex];
+
+                RayTracingResult dNewResult = CFace::intersectTriangle(ray, tTriangle.m_v1, tTriangle.m_v2, tTriangle.m_v3);
+
+                if (
+                        dNewResult.m_dDistance < dReturnResult.m_dDistance ||
+                        (iBestIndex >= 0 && dNewResult.m_dDistance == dReturnResult.m_dDistance && tTriangle.m_iIndex < iBestIndex)
+                        )
+                {
+                    dReturnResult = dNewResult;
+                    iBestIndex = tTriangle.m_iIndex;
+                }
+            }
+        }
+        else
+        {
+            int iLeft = iNodeIndex + 1;
+            int iRight = tNode.m_iFirst;
+            double dLeft = 0.0;
+            double dRight = 0.0;
+
+            bool bLeft = CBoundingBox::lineEntry(ray.vOrigin, vInverse, m_vNodes[iLeft].m_vMinimum, m_vNodes[iLeft].m_vMaximum, dReturnResult.m_dDistance, dLeft);
+            bool bRight = CBoundingBox::lineEntry(ray.vOrigin, vInverse, m_vNodes[iRight].m_vMinimum, m_vNodes[iRight].m_vMaximum, dReturnResult.m_dDistance, dRight);
+
+            // Push the farthest child first, so that the nearest is visited first
+            if (bLeft && bRight && dLeft > dRight)
+            {
+                qSwap(iLeft, iRight);
+                qSwap(dLeft, dRight);
+            }
+
+            if (bRight)
+            {
+                vStack[iStackSize] = iRight;
+                vStackEntry[iStackSize] = dRight;
+                iStackSize++;
+            }
+
+            if (bLeft)
+            {
+                vStack[iStackSize] = iLeft;
+                vStackEntry[iStackSize] = dLeft;
+                iStackSize++;
+            }
+        }
+    }
+
+    return dReturnResult;
+}
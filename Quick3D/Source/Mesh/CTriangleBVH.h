@@ -0,0 +1,127 @@
+
+#pragma once
+
+// Qt
+#include <QVector>
+
+// Application
+#include "quick3d_global.h"
+#include "CVector3.h"
+#include "CRay3.h"
+
+//-------------------------------------------------------------------------------------------------
+
+//! A node of CTriangleBVH
+class QUICK3D_EXPORT CTriangleBVHNode
+{
+public:
+
+    //! Default constructor
+    CTriangleBVHNode()
+        : m_iFirst(0)
+        , m_iCount(0)
+    {
+    }
+
+    Math::CVector3  m_vMinimum;
+    Math::CVector3  m_vMaximum;
+    int             m_iFirst;       // First triangle if m_iCount > 0, else right child (the left child follows the node)
+    int             m_iCount;       // Number of triangles, 0 for inner nodes
+};
+
+//-------------------------------------------------------------------------------------------------
+
+//! A triangle of CTriangleBVH, with its vertices copied so that leaves are contiguous in memory
+class QUICK3D_EXPORT CTriangleBVHTriangle
+{
+public:
+
+    //! Default constructor
+    CTriangleBVHTriangle()
+        : m_iIndex(0)
+    {
+    }
+
+    //! Constructor with parameters
+    CTriangleBVHTriangle(const Math::CVector3& v1, const Math::CVector3& v2, const Math::CVector3& v3, int iIndex)
+        : m_v1(v1)
+        , m_v2(v2)
+        , m_v3(v3)
+        , m_iIndex(iIndex)
+    {
+    }
+
+    Math::CVector3  m_v1;
+    Math::CVector3  m_v2;
+    Math::CVector3  m_v3;
+    int             m_iIndex;       // Order of addition, breaks ties between hits at the same distance
+};
+
+//-------------------------------------------------------------------------------------------------
+
+//! Bounding volume hierarchy over the triangles of a mesh, in local space
+class QUICK3D_EXPORT CTriangleBVH
+{
+public:
+
+    //-------------------------------------------------------------------------------------------------
+    // Constructors and destructor
+    //-------------------------------------------------------------------------------------------------
+
+    //!
+    CTriangleBVH();
+
+    //!
+    virtual ~CTriangleBVH();
+
+    //-------------------------------------------------------------------------------------------------
+    // Getters
+    //-------------------------------------------------------------------------------------------------
+
+    //! Returns the number of triangles
+    int triangleCount() const { return m_vTriangles.count(); }
+
+    //! Returns the number of nodes, 0 until build() is called
+    int nodeCount() const { return m_vNodes.count(); }
+
+    //-------------------------------------------------------------------------------------------------
+    // Control methods
+    //-------------------------------------------------------------------------------------------------
+
+    //! Removes all triangles and nodes
+    void clear();
+
+    //! Adds a triangle, vertices are given in the order expected by CFace::intersectTriangle()
+    void addTriangle(const Math::CVector3& v1, const Math::CVector3& v2, const Math::CVector3& v3);
+
+    //! Builds the nodes over the added triangles
+    void build();
+
+    //! Returns the nearest intersection of ray, as testing all triangles in order with CFace::intersectTriangle() would
+    Math::RayTracingResult intersect(const Math::CRay3& ray) const;
+
+    //-------------------------------------------------------------------------------------------------
+    // Protected control methods
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    //! Builds a node over iCount triangles of m_vOrder from iFirst, returns its index
+    int buildRecurse(int iFirst, int iCount, int iDepth);
+
+    //! Makes a node a leaf over iCount triangles of m_vOrder from iFirst
+    void makeLeaf(int iNodeIndex, int iFirst, int iCount);
+
+    //-------------------------------------------------------------------------------------------------
+    // Properties
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    QVector<CTriangleBVHNode>       m_vNodes;           // Depth first, a parent is before its children
+    QVector<CTriangleBVHTriangle>   m_vTriangles;       // Ordered by leaf after build()
+    QVector<int>                    m_vOrder;           // Build only : triangle indices, partitioned in place
+    QVector<Math::CVector3>         m_vMinimums;        // Build only : padded bounds of each triangle
+    QVector<Math::CVector3>         m_vMaximums;
+    QVector<Math::CVector3>         m_vCenters;         // Build only : center of the bounds of each triangle
+};
@@ -83,6 +83,15 @@ public:
     //!
     double altitude() const { return m_dAltitude; }
 
+    //!
+    Math::CVector3 diffTexWeight_0_1_2() const { return m_vDiffTexWeight_0_1_2; }
+
+    //!
+    Math::CVector3 diffTexWeight_3_4_5() const { return m_vDiffTexWeight_3_4_5; }
+
+    //!
+    Math::CVector3 diffTexWeight_6_7_8() const { return m_vDiffTexWeight_6_7_8; }
+
     //-------------------------------------------------------------------------------------------------
     // Static methods
     //-------------------------------------------------------------------------------------------------
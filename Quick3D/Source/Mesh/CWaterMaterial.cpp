@@ -27,10 +27,12 @@ QGLShaderProgram* CWaterMaterial::activate(CRenderContext* pContext)
 
     if (pProgram != nullptr)
     {
+        CShaderLocations* pLocations = pContext->scene()->shaders()->locations(pProgram);
+
         double dAmplitude = m_pScene->windLevel() * 4.0;
 
-        pProgram->setUniformValue("u_wave_enable", (GLint) 1);
-        pProgram->setUniformValue("u_wave_amplitude", (GLfloat) (float) dAmplitude);
+        pProgram->setUniformValue(pLocations->uniform(suWaveEnable), (GLint) 1);
+        pProgram->setUniformValue(pLocations->uniform(suWaveAmplitude), (GLfloat) (float) dAmplitude);
     }
 
     return pProgram;
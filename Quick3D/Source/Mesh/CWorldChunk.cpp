@@ -37,12 +37,19 @@ CWorldChunk::~CWorldChunk()
 {
     CComponent::decComponentCounter(ClassName_CWorldChunk);
 
-    // Remove this from workers
-    CWorkerManager::getInstance()->removeWorker(this);
+    // The terrain may finish in a pool thread, it must not queue this chunk again
+    if (m_pTerrain)
+    {
+        disconnect(m_pTerrain.data(), SIGNAL(workFinished()), this, SLOT(onTerrainFinished()));
+    }
 
     {
+        // Waits for an onTerrainFinished() already running
         QMutexLocker locker(&m_mMutex);
 
+        // Remove this from workers
+        CWorkerManager::getInstance()->removeWorker(this);
+
         LOG_METHOD_DEBUG(QString("Deleting %1 CWorldChunk::CBoundedMeshInstances for tile at lat %2, lon %3")
                   .arg(m_vBoundedMeshes.count())
                   .arg(geoloc().Latitude)
@@ -60,7 +67,16 @@ CWorldChunk::~CWorldChunk()
 
 void CWorldChunk::setTerrain(QSP<CTerrain> value, bool bGenerateNow)
 {
-    m_pTerrain = value;
+    if (m_pTerrain)
+    {
+        disconnect(m_pTerrain.data(), SIGNAL(workFinished()), this, SLOT(onTerrainFinished()));
+    }
+
+    {
+        QMutexLocker locker(&m_mMutex);
+
+        m_pTerrain = value;
+    }
 
     if (m_pTerrain && m_pTerrain->level() < 2)
     {
@@ -70,14 +86,34 @@ void CWorldChunk::setTerrain(QSP<CTerrain> value, bool bGenerateNow)
         }
         else
         {
-            // Add this to workers for detail generation
-            CWorkerManager::getInstance()->addWorker(this);
+            // Detail generation is queued once the terrain is built
+            connect(m_pTerrain.data(), SIGNAL(workFinished()), this, SLOT(onTerrainFinished()), Qt::DirectConnection);
+
+            if (m_pTerrain->isOK())
+            {
+                onTerrainFinished();
+            }
         }
     }
 }
 
 //-------------------------------------------------------------------------------------------------
 
+void CWorldChunk::onTerrainFinished()
+{
+    // Called from the pool thread that built the terrain
+    QMutexLocker locker(&m_mMutex);
+
+    if (m_pTerrain && m_pTerrain->isOK())
+    {
+        setWorkPriority(m_pTerrain->workPriority());
+
+        CWorkerManager::getInstance()->addWorker(this);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
 void CWorldChunk::setWater(QSP<CTerrain> value)
 {
     m_pWater = value;
@@ -251,7 +287,9 @@ void CWorldChunk::paint(CRenderContext* pContext)
 
                 if (pTiled != nullptr)
                 {
-                    pTiled->setCurrentPositionAndLevel(m_gOriginalGeoloc, m_pTerrain->level());
+                    double dDistance = (pContext->internalCameraMatrix() * worldBounds().center()).magnitude();
+
+                    pTiled->setCurrentPositionAndLevel(m_gOriginalGeoloc, m_pTerrain->level(), dDistance);
                 }
 
                 m_pTerrain->paint(pContext);
@@ -405,12 +443,9 @@ void CWorldChunk::clearTerrain()
 
 void CWorldChunk::work()
 {
-    while (true)
+    if (m_pTerrain == nullptr || m_pTerrain->isOK() == false)
     {
-        if (m_pTerrain == nullptr) return;
-        if (m_bStopRequested) return;
-        if (m_pTerrain->isOK() == true) break;
-        msleep(50);
+        return;
     }
 
     if (m_pTerrain != nullptr)
@@ -463,6 +498,12 @@ void CWorldChunk::work()
 
                 if (m_bStopRequested) return;
             }
+
+            // Instance transforms are ready before the chunk is drawn
+            foreach (CBoundedMeshInstances* pBounded, m_vBoundedMeshes)
+            {
+                pBounded->buildInstances();
+            }
         }
     }
 
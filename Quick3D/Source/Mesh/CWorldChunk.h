@@ -154,6 +154,15 @@ public:
     //!
     bool checkPositionFree(CGeoloc gPosition, double dRadius);
 
+    //-------------------------------------------------------------------------------------------------
+    // Slots
+    //-------------------------------------------------------------------------------------------------
+
+protected slots:
+
+    //! Queues detail generation when the terrain has been built
+    void onTerrainFinished();
+
     //-------------------------------------------------------------------------------------------------
     // Properties
     //-------------------------------------------------------------------------------------------------
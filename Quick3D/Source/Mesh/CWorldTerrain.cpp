@@ -12,6 +12,7 @@
 #include "CSRTMField.h"
 #include "CHGTField.h"
 #include "CBILField.h"
+#include "CElevationTileCache.h"
 
 //-------------------------------------------------------------------------------------------------
 
@@ -19,6 +20,14 @@ using namespace Math;
 
 #define LAT_MAX  90.0
 
+// Terrain generation priorities
+#define PRIORITY_MAX_DISTANCE_KM    100000
+#define PRIORITY_IN_FRUSTUM         (PRIORITY_MAX_DISTANCE_KM * 2)
+
+// Height tile prefetching, in degrees
+#define PREFETCH_DISTANCE_DEG       1.0
+#define PREFETCH_MIN_MOVE_DEG       0.0001
+
 //-------------------------------------------------------------------------------------------------
 
 /*!
@@ -55,6 +64,7 @@ CWorldTerrain::CWorldTerrain(C3DScene* pScene, CGeoloc gCameraPosition, CHeightF
     , m_pMaterial(nullptr)
     , m_iLevels(15)
     , m_iTerrainResolution(31)
+    , m_gLastCameraGeoloc(gCameraPosition)
 {
     CComponent::incComponentCounter(ClassName_CWorldTerrain);
 
@@ -137,6 +147,14 @@ void CWorldTerrain::loadParameters(const QString& sBaseFile, const CXMLNode& xCo
     QString sType = xHeightNode.attributes()[ParamName_Type];
     QString sPath = xHeightNode.attributes()[ParamName_Path];
 
+    // Budget of the elevation data cache shared by all fields, in megabytes
+    if (xHeightNode.attributes()[ParamName_CacheMB].isEmpty() == false)
+    {
+        qint64 iCacheMB = xHeightNode.attributes()[ParamName_CacheMB].toLongLong();
+
+        CElevationTileCache::getInstance()->setBudget(qMax(iCacheMB, (qint64) 16) * 1024 * 1024);
+    }
+
     if (sType.toLower() == "srtm")
     {
         m_pHeights = new CSRTMField(m_xParameters, sPath);
@@ -267,6 +285,7 @@ void CWorldTerrain::paint(CRenderContext* pContext)
     {
         iBuildCounter = 0;
         buildRecurse(m_pRoot, pContext, m_iLevels);
+        prefetchAhead(pContext);
     }
 
     QVector<QSP<CWorldChunk> > vChunkCollect;
@@ -295,6 +314,64 @@ void CWorldTerrain::paint(CRenderContext* pContext)
 
 //-------------------------------------------------------------------------------------------------
 
+/*!
+    Returns the topology shared by all patches of \a iNumPoints points, with a skirt if \a bSkirt is \c true. \br\br
+    Patches of a given resolution thus share one index buffer, and only generate their vertices.
+*/
+QSP<CTerrainTopology> CWorldTerrain::topology(int iNumPoints, bool bSkirt)
+{
+    iNumPoints = CTerrainTopology::validNumPoints(iNumPoints);
+
+    int iKey = CTerrainTopology::key(iNumPoints, bSkirt);
+
+    if (m_mTopologies.contains(iKey) == false)
+    {
+        m_mTopologies[iKey] = QSP<CTerrainTopology>(new CTerrainTopology(m_pScene, iNumPoints, bSkirt));
+    }
+
+    return m_mTopologies[iKey];
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Queues the height tiles on the camera's path for background loading, using \a pContext. \br\br
+    The direction of travel is the camera's movement since the last call, projected PREFETCH_DISTANCE_DEG ahead.
+    Tiles are thus read from disk before the terrain workers need them.
+*/
+void CWorldTerrain::prefetchAhead(CRenderContext* pContext)
+{
+    if (m_pHeights == nullptr)
+    {
+        return;
+    }
+
+    CGeoloc gCamera = pContext->camera()->geoloc();
+
+    double dLatDelta = gCamera.Latitude - m_gLastCameraGeoloc.Latitude;
+    double dLonDelta = Angles::angleDifferenceDegree(gCamera.Longitude, m_gLastCameraGeoloc.Longitude);
+    double dMove = sqrt(dLatDelta * dLatDelta + dLonDelta * dLonDelta);
+
+    if (dMove < PREFETCH_MIN_MOVE_DEG)
+    {
+        return;
+    }
+
+    m_gLastCameraGeoloc = gCamera;
+
+    double dScale = PREFETCH_DISTANCE_DEG / dMove;
+
+    CGeoloc gAhead(
+                qBound(-LAT_MAX, gCamera.Latitude + dLatDelta * dScale, LAT_MAX),
+                gCamera.Longitude + dLonDelta * dScale,
+                0.0
+                );
+
+    m_pHeights->prefetchAlong(gCamera, gAhead);
+}
+
+//-------------------------------------------------------------------------------------------------
+
 /*!
     Updates the terrain using \a dDeltaTimeS, which is the elapsed seconds since the last frame.
 */
@@ -362,6 +439,30 @@ bool CWorldTerrain::enoughDetail(QSP<CWorldChunk> pChunk, CRenderContext* pConte
 
 //-------------------------------------------------------------------------------------------------
 
+/*!
+    Returns the scheduling priority of the terrain generation for \a pChunk. \br\br
+    Chunks inside the viewing frustum come first, then chunks are ordered by distance to the camera. \br
+    \a pContext is the rendering context.
+*/
+int CWorldTerrain::workPriority(QSP<CWorldChunk> pChunk, CRenderContext* pContext)
+{
+    CBoundingBox bWorldBounds = pChunk->worldBounds();
+    CVector3 vPosition = pContext->internalCameraMatrix() * bWorldBounds.center();
+
+    double dDistance_km = (bWorldBounds.center() - pContext->camera()->geoloc().toVector3()).magnitude() / 1000.0;
+
+    int iPriority = PRIORITY_MAX_DISTANCE_KM - (int) Angles::clipDouble(dDistance_km, 0.0, (double) PRIORITY_MAX_DISTANCE_KM);
+
+    if (pContext->camera()->contains(vPosition, bWorldBounds.radius()))
+    {
+        iPriority += PRIORITY_IN_FRUSTUM;
+    }
+
+    return iPriority;
+}
+
+//-------------------------------------------------------------------------------------------------
+
 /*!
     Called by paint() to build necessary terrain patches given the camera location. \br\br
     \a pChunk is any chunk in the chunk tree of the terrain. \br
@@ -401,7 +502,8 @@ void CWorldTerrain::buildRecurse(QSP<CWorldChunk> pChunk, CRenderContext* pConte
                         iLevel,
                         m_iLevels,
                         false,
-                        m_bGenerateNow
+                        m_bGenerateNow,
+                        topology(m_iTerrainResolution, true)
                         ));
 
             pTerrain->setMaterial(m_pMaterial);
@@ -427,7 +529,8 @@ void CWorldTerrain::buildRecurse(QSP<CWorldChunk> pChunk, CRenderContext* pConte
                                 iLevel,
                                 m_iLevels,
                                 true,
-                                m_bGenerateNow
+                                m_bGenerateNow,
+                                topology((int) ((double) m_iTerrainResolution * 0.75), false)
                                 ));
 
                     pWater->setInheritTransform(false);
@@ -439,6 +542,19 @@ void CWorldTerrain::buildRecurse(QSP<CWorldChunk> pChunk, CRenderContext* pConte
 
             pChunk->setUsedNow();
         }
+
+        // Keep the build order of pending tiles in sync with the camera
+        if (pChunk->terrain() && pChunk->terrain()->isOK() == false)
+        {
+            int iPriority = workPriority(pChunk, pContext);
+
+            pChunk->terrain()->setWorkPriority(iPriority);
+
+            if (pChunk->water())
+            {
+                pChunk->water()->setWorkPriority(iPriority);
+            }
+        }
     }
     else
     {
@@ -757,6 +873,107 @@ double CWorldTerrain::getHeightAt(const CGeoloc& gPosition, double* pRigidness)
 
 //-------------------------------------------------------------------------------------------------
 
+/*!
+    Fills \a pHeights with the heights at the \a iCount geolocations in \a pPositions. \br\br
+    Positions are grouped by terrain tile, and each tile answers its group in one call.
+    Results are the same as getHeightAt(), rigidness excepted.
+    \a bForPhysics
+*/
+void CWorldTerrain::getHeightsAt(const CGeoloc* pPositions, double* pHeights, int iCount, bool bForPhysics)
+{
+    QMap<CWorldChunk*, QVector<int> > mBatches;
+
+    for (int iIndex = 0; iIndex < iCount; iIndex++)
+    {
+        pHeights[iIndex] = Q3D_INFINITY;
+
+        if (m_pRoot != nullptr)
+        {
+            CWorldChunk* pChunk = readyChunkAt(pPositions[iIndex], m_pRoot);
+
+            if (pChunk != nullptr)
+            {
+                mBatches[pChunk].append(iIndex);
+            }
+        }
+    }
+
+    QVector<double> vWaterHeights(iCount);
+
+    for (QMap<CWorldChunk*, QVector<int> >::const_iterator iBatch = mBatches.constBegin(); iBatch != mBatches.constEnd(); ++iBatch)
+    {
+        const QVector<int>& vIndices = iBatch.value();
+
+        iBatch.key()->terrain()->getHeightsAt(pPositions, vIndices.constData(), vIndices.count(), pHeights);
+
+        if (iBatch.key()->water())
+        {
+            iBatch.key()->water()->getHeightsAt(pPositions, vIndices.constData(), vIndices.count(), vWaterHeights.data());
+
+            foreach (int iIndex, vIndices)
+            {
+                if (vWaterHeights[iIndex] != Q3D_INFINITY && vWaterHeights[iIndex] > pHeights[iIndex])
+                {
+                    pHeights[iIndex] = vWaterHeights[iIndex];
+                }
+            }
+        }
+
+        // Positions the tile could not answer go through the parent tiles
+        foreach (int iIndex, vIndices)
+        {
+            if (pHeights[iIndex] == Q3D_INFINITY)
+            {
+                pHeights[iIndex] = getHeightAtRecurse(pPositions[iIndex], m_pRoot);
+            }
+        }
+    }
+
+    Q_UNUSED(bForPhysics);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Returns the deepest chunk under \a gPosition, starting at \a pChunk, whose terrain is built. \br\br
+    This is the chunk getHeightAtRecurse() takes the height from.
+*/
+CWorldChunk* CWorldTerrain::readyChunkAt(const CGeoloc& gPosition, QSP<CWorldChunk> pChunk) const
+{
+    double dDiffLatitude = Math::Angles::angleDifferenceDegree(gPosition.Latitude, pChunk->geoloc().Latitude);
+    double dDiffLongitude = Math::Angles::angleDifferenceDegree(gPosition.Longitude, pChunk->geoloc().Longitude);
+
+    if (
+            fabs(dDiffLatitude) < pChunk->size().Latitude * 0.5 &&
+            fabs(dDiffLongitude) < pChunk->size().Longitude * 0.5
+            )
+    {
+        foreach (QSP<CComponent> pChildComponent, pChunk->childComponents())
+        {
+            QSP<CWorldChunk> pChild = QSP_CAST(CWorldChunk, pChildComponent);
+
+            if (pChild != nullptr)
+            {
+                CWorldChunk* pReady = readyChunkAt(gPosition, pChild);
+
+                if (pReady != nullptr)
+                {
+                    return pReady;
+                }
+            }
+        }
+
+        if (pChunk->terrain() && pChunk->terrain()->isOK())
+        {
+            return pChunk.data();
+        }
+    }
+
+    return nullptr;
+}
+
+//-------------------------------------------------------------------------------------------------
+
 double CWorldTerrain::getHeightAtRecurse(const CGeoloc& gPosition, QSP<CWorldChunk> pChunk, double* pRigidness)
 {
     double dDiffLatitude = Math::Angles::angleDifferenceDegree(gPosition.Latitude, pChunk->geoloc().Latitude);
@@ -126,6 +126,9 @@ public:
     //!
     virtual double getHeightAt(const CGeoloc& gPosition, double* pRigidness = nullptr);
 
+    //! Fills pHeights with the altitudes at the iCount geolocations in pPositions
+    virtual void getHeightsAt(const CGeoloc* pPositions, double* pHeights, int iCount, bool bForPhysics = true) Q_DECL_OVERRIDE;
+
     //!
     virtual void flatten(const CGeoloc& gPosition, double dRadius_m) Q_DECL_OVERRIDE;
 
@@ -147,15 +150,27 @@ protected:
     //!
     bool enoughDetail(QSP<CWorldChunk> pChunk, CRenderContext* pContext, int iLevel);
 
+    //!
+    int workPriority(QSP<CWorldChunk> pChunk, CRenderContext* pContext);
+
     //!
     void paintRecurse(QVector<QSP<CWorldChunk> >& vChunkCollect, CRenderContext* pContext, QSP<CWorldChunk> pChunk, int iLevel, bool bForcePaint);
 
     //!
     void buildRecurse(QSP<CWorldChunk> pChunk, CRenderContext* pContext, int iLevel);
 
+    //! Queues the height tiles ahead of the camera for background loading
+    void prefetchAhead(CRenderContext* pContext);
+
+    //! Returns the topology shared by patches of iNumPoints, creating it if needed
+    QSP<CTerrainTopology> topology(int iNumPoints, bool bSkirt);
+
     //!
     double getHeightAtRecurse(const CGeoloc& gPosition, QSP<CWorldChunk> pChunk, double* pRigidness = nullptr);
 
+    //! Returns the deepest chunk under gPosition whose terrain is built, or nullptr
+    CWorldChunk* readyChunkAt(const CGeoloc& gPosition, QSP<CWorldChunk> pChunk) const;
+
     //!
     void collectGarbage();
 
@@ -179,10 +194,12 @@ protected:
     int                         m_iLevels;
     int                         m_iTerrainResolution;
     CXMLNode                    m_xParameters;
+    CGeoloc                     m_gLastCameraGeoloc;    // Camera position at the last prefetch
 
     // Shared data
 
     QSP<CWorldChunk>            m_pRoot;
     QSP<CMaterial>              m_pMaterial;
     QVector<QSP<CComponent> >   m_vGenerators;
+    QMap<int, QSP<CTerrainTopology> >   m_mTopologies;      // Patch topologies, by CTerrainTopology::key()
 };
@@ -5,6 +5,8 @@
 
 // Qt
 #include <QtOpenGL>
+#include <QtConcurrent>
+#include <QHash>
 #include <GL/glu.h>
 
 // qt-plus
@@ -18,10 +20,12 @@
 #include "COBJLoader.h"
 #include "CMaterial.h"
 #include "CHeightField.h"
+#include "CElevationTileCache.h"
 #include "CWorldTerrain.h"
 #include "CTrajectorable.h"
 #include "CController.h"
 #include "CStandardController.h"
+#include "CSimulationScheduler.h"
 
 //-------------------------------------------------------------------------------------------------
 
@@ -43,12 +47,16 @@ using namespace Math;
     \a bForDisplay tells if the scene will be displayed
 */
 C3DScene::C3DScene(bool bForDisplay)
-    : m_pRessourcesManager(nullptr)
+    : m_pGLExtension(nullptr)
+    , m_pRessourcesManager(nullptr)
     , m_pBuildingGenerator(nullptr)
     , m_pTreeGenerator(nullptr)
     , m_vShaders(nullptr)
     , m_pController(nullptr)
     , m_pDefaultController(nullptr)
+    , m_pSimulationScheduler(nullptr)
+    , m_mSimulationMutex(QMutex::Recursive)
+    , m_iUpdateGroupRevision(-1)
     , m_bForDisplay(bForDisplay)
     , m_bFrustumCheck(true)
     , m_bEditMode(false)
@@ -66,12 +74,14 @@ C3DScene::C3DScene(bool bForDisplay)
     , m_bforceSmallFOV(false)
     , m_bForceIR(false)
     , m_bStreamView(false)
+    , m_bParallelUpdate(true)
     , m_bDepthComputing(false)
     , m_dTime(0.0)
     , m_dSunIntensity(0.0)
     , m_dOverlookFOV(90.0)
 {
     m_pSegments = QSP<CMeshGeometry>(new CMeshGeometry(this));
+    m_pSegments->setDynamic(true);
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -81,6 +91,9 @@ C3DScene::C3DScene(bool bForDisplay)
 */
 C3DScene::~C3DScene()
 {
+    // Stops the simulation thread, if any
+    if (m_pSimulationScheduler != nullptr) delete m_pSimulationScheduler;
+
     clearComponents();
     clearViewports();
 
@@ -114,6 +127,8 @@ void C3DScene::clear()
 */
 void C3DScene::clearComponents()
 {
+    QMutexLocker locker(&m_mSimulationMutex);
+
     // Destruction des composants
 
     foreach (QSP<CComponent> pComponent, m_vComponents)
@@ -122,6 +137,7 @@ void C3DScene::clearComponents()
     }
 
     m_vComponents.clear();
+    m_tRayTree.clear();
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -167,7 +183,10 @@ void C3DScene::init(QVector<QSP<CComponent> > vComponents)
     //-----------------------------------------------
     // Assign components
 
+    QMutexLocker locker(&m_mSimulationMutex);
+
     m_vComponents = vComponents;
+    m_tRayTree.clear();
 
     foreach(QSP<CComponent> pComponent, m_vComponents)
     {
@@ -332,6 +351,31 @@ void C3DScene::forceIR(bool value)
 
 //-------------------------------------------------------------------------------------------------
 
+/*!
+    Steps the simulation \a dStepsPerSecond times per simulated second, whatever the frame rate.
+    If \a dStepsPerSecond is 0, the simulation is stepped once per frame with the frame's elapsed time. \br\br
+    The scheduler may then be started in its own thread, see simulationScheduler().
+*/
+void C3DScene::setSimulationRate(double dStepsPerSecond)
+{
+    if (dStepsPerSecond > 0.0)
+    {
+        if (m_pSimulationScheduler == nullptr)
+        {
+            m_pSimulationScheduler = new CSimulationScheduler(this);
+        }
+
+        m_pSimulationScheduler->setStepRate(dStepsPerSecond);
+    }
+    else if (m_pSimulationScheduler != nullptr)
+    {
+        delete m_pSimulationScheduler;
+        m_pSimulationScheduler = nullptr;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
 /*!
     Returns a vector of all lights.
 */
@@ -427,13 +471,157 @@ void C3DScene::getLightsByTagRecurse(QVector<QSP<CLight> >& vLights, const QStri
 //-------------------------------------------------------------------------------------------------
 
 /*!
-    Updates the scene using elapsed time in \a dDeltaTimeS.
+    Groups the root objects for stepScene(), unless neither the components nor their update dependencies changed. \br\br
+    Root objects whose hierarchies depend on each other, see CComponent::addUpdateDependency(), end up in the same group.
+    A group containing a root object that is not update thread safe is updated in the calling thread.
+*/
+void C3DScene::checkUpdateGroups()
+{
+    int iRevision = CComponent::updateDependencyRevision();
+    bool bChanged = (iRevision != m_iUpdateGroupRevision || m_vUpdateGroupRoots.count() != m_vComponents.count());
+
+    for (int iIndex = 0; bChanged == false && iIndex < m_vComponents.count(); iIndex++)
+    {
+        bChanged = (m_vUpdateGroupRoots[iIndex] != m_vComponents[iIndex].data());
+    }
+
+    if (bChanged == false)
+    {
+        return;
+    }
+
+    m_iUpdateGroupRevision = iRevision;
+    m_vUpdateGroupRoots.clear();
+    m_vParallelGroups.clear();
+    m_vSerialRoots.clear();
+
+    QHash<CComponent*, int> mRootIndices;
+    QVector<int> vParents(m_vComponents.count());
+
+    for (int iIndex = 0; iIndex < m_vComponents.count(); iIndex++)
+    {
+        m_vUpdateGroupRoots.append(m_vComponents[iIndex].data());
+        mRootIndices[m_vComponents[iIndex].data()] = iIndex;
+        vParents[iIndex] = iIndex;
+    }
+
+    // Union-find over root objects
+    auto findGroup = [&vParents](int iIndex)
+    {
+        while (vParents[iIndex] != iIndex)
+        {
+            vParents[iIndex] = vParents[vParents[iIndex]];
+            iIndex = vParents[iIndex];
+        }
+
+        return iIndex;
+    };
+
+    for (int iIndex = 0; iIndex < m_vComponents.count(); iIndex++)
+    {
+        QVector<CComponent*> vDependencies;
+
+        getUpdateDependenciesRecurse(vDependencies, m_vComponents[iIndex].data());
+
+        foreach (CComponent* pDependency, vDependencies)
+        {
+            // Dependencies outside the scene are ignored
+            int iOther = mRootIndices.value(pDependency->root().data(), -1);
+
+            if (iOther != -1)
+            {
+                vParents[findGroup(iIndex)] = findGroup(iOther);
+            }
+        }
+    }
+
+    // Groups keep the scene order of their root objects
+    QVector<int> vGroupOfRoot(m_vComponents.count(), -1);
+    QVector<QVector<int> > vGroups;
+    QVector<bool> vSerialGroups;
+
+    for (int iIndex = 0; iIndex < m_vComponents.count(); iIndex++)
+    {
+        int iRoot = findGroup(iIndex);
+
+        if (vGroupOfRoot[iRoot] == -1)
+        {
+            vGroupOfRoot[iRoot] = vGroups.count();
+            vGroups.append(QVector<int>());
+            vSerialGroups.append(false);
+        }
+
+        int iGroup = vGroupOfRoot[iRoot];
+
+        vGroups[iGroup].append(iIndex);
+
+        if (m_vComponents[iIndex]->isUpdateThreadSafe() == false)
+        {
+            vSerialGroups[iGroup] = true;
+        }
+    }
+
+    for (int iGroup = 0; iGroup < vGroups.count(); iGroup++)
+    {
+        if (vSerialGroups[iGroup])
+        {
+            m_vSerialRoots += vGroups[iGroup];
+        }
+        else
+        {
+            m_vParallelGroups.append(vGroups[iGroup]);
+        }
+    }
+
+    qSort(m_vSerialRoots);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void C3DScene::getUpdateDependenciesRecurse(QVector<CComponent*>& vDependencies, CComponent* pComponent)
+{
+    foreach (QSP<CComponent> pDependency, pComponent->updateDependencies())
+    {
+        vDependencies.append(pDependency.data());
+    }
+
+    foreach (QSP<CComponent> pChild, pComponent->childComponents())
+    {
+        getUpdateDependenciesRecurse(vDependencies, pChild.data());
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Updates the scene using elapsed time in \a dDeltaTimeS. \br\br
+    Without a simulation rate, the scene is stepped once with the elapsed time, clipped to one second.
+    Otherwise the steps due are run, unless the scheduler runs in its own thread.
 */
 void C3DScene::updateScene(double dDeltaTimeS)
 {
     m_FPS.append(1.0 / dDeltaTimeS);
 
-    dDeltaTimeS = Angles::clipDouble(dDeltaTimeS, 0.0, 1.0);
+    if (m_pSimulationScheduler == nullptr)
+    {
+        stepScene(Angles::clipDouble(dDeltaTimeS, 0.0, 1.0));
+    }
+    else if (m_pSimulationScheduler->isRunning() == false)
+    {
+        m_pSimulationScheduler->advance(dDeltaTimeS);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Runs one simulation step of \a dStepS seconds : updates the controller, the components and their collisions. \br\br
+    Root objects that are not update thread safe are updated first, in scene order and in the calling thread.
+    The other ones are then updated by group of dependent objects, groups running concurrently if parallelUpdate() is \c true.
+*/
+void C3DScene::stepScene(double dStepS)
+{
+    QMutexLocker locker(&m_mSimulationMutex);
 
     if (m_bEditMode == false)
     {
@@ -442,25 +630,103 @@ void C3DScene::updateScene(double dDeltaTimeS)
 
     if (m_pController != nullptr)
     {
-        m_pController->update(dDeltaTimeS);
+        m_pController->update(dStepS);
     }
 
     if (m_bEditMode == true)
     {
-        dDeltaTimeS = 0.0;
+        dStepS = 0.0;
     }
 
     foreach (QSP<CComponent> pComponent, m_vComponents)
     {
-        pComponent->update(dDeltaTimeS);
+        pComponent->savePreviousWorldTransform();
     }
 
-    foreach (QSP<CComponent> pComponent, m_vComponents)
+    checkUpdateGroups();
+
+    foreach (int iIndex, m_vSerialRoots)
+    {
+        m_vComponents[iIndex]->update(dStepS);
+    }
+
+    foreach (int iIndex, m_vSerialRoots)
+    {
+        m_vComponents[iIndex]->postUpdate(dStepS);
+    }
+
+    const QVector<QSP<CComponent> >& vComponents = m_vComponents;
+
+    auto updateGroup = [&vComponents, dStepS](const QVector<int>& vGroup)
+    {
+        for (int iIndex = 0; iIndex < vGroup.count(); iIndex++)
+        {
+            vComponents[vGroup[iIndex]]->update(dStepS);
+        }
+
+        for (int iIndex = 0; iIndex < vGroup.count(); iIndex++)
+        {
+            vComponents[vGroup[iIndex]]->postUpdate(dStepS);
+        }
+    };
+
+    if (m_bParallelUpdate && m_vParallelGroups.count() > 1)
+    {
+        // The simulation lock stays held so that m_vComponents does not change under the pool threads
+        // Thread safe updates must therefore not call scene methods that lock it, see CComponent::isUpdateThreadSafe()
+        QtConcurrent::blockingMap(m_vParallelGroups, updateGroup);
+    }
+    else
+    {
+        for (int iGroup = 0; iGroup < m_vParallelGroups.count(); iGroup++)
+        {
+            updateGroup(m_vParallelGroups[iGroup]);
+        }
+    }
+
+    CPhysicalComponent::computeCollisions(m_vComponents, dStepS, m_tCollisions, &m_tStatistics);
+
+    m_tRayTree.update(m_vComponents);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Locks the simulation for rendering. If the simulation has a fixed rate, the transforms of components are replaced
+    by their interpolation between the last two steps, according to the time elapsed since the last step. \br\br
+    Must be followed by endInterpolation().
+*/
+void C3DScene::beginInterpolation()
+{
+    m_mSimulationMutex.lock();
+
+    if (m_pSimulationScheduler != nullptr)
+    {
+        double dFactor = m_pSimulationScheduler->interpolationFactor();
+
+        foreach (QSP<CComponent> pComponent, m_vComponents)
+        {
+            pComponent->interpolateWorldTransform(dFactor);
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Restores the transforms replaced by beginInterpolation() and unlocks the simulation.
+*/
+void C3DScene::endInterpolation()
+{
+    if (m_pSimulationScheduler != nullptr)
     {
-        pComponent->postUpdate(dDeltaTimeS);
+        foreach (QSP<CComponent> pComponent, m_vComponents)
+        {
+            pComponent->restoreWorldTransform();
+        }
     }
 
-    CPhysicalComponent::computeCollisions(m_vComponents, dDeltaTimeS);
+    m_mSimulationMutex.unlock();
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -510,7 +776,8 @@ void C3DScene::paintShadowCastingComponents(CRenderContext* pContext)
 //-------------------------------------------------------------------------------------------------
 
 /*!
-    Sets up the environment of the scene.
+    Sets up the environment of the scene in \a pProgram. \br\br
+    Called by CMaterial::activate() the first time \a pProgram is used with \a pContext, uniforms keeping their values for the rest of the context.
 */
 void C3DScene::setupEnvironment(CRenderContext* pContext, QGLShaderProgram* pProgram, bool bBackgroundItem)
 {
@@ -536,12 +803,27 @@ void C3DScene::makeCurrentRenderingContext()
 
 //-------------------------------------------------------------------------------------------------
 
+/*!
+    Makes the OpenGL context of this scene the current one and binds the frame buffer it renders into,
+    for instance after a shadow map has been drawn.
+*/
+void C3DScene::bindRenderTarget()
+{
+    // This scene has no frame buffer of its own
+    makeCurrentRenderingContext();
+}
+
+//-------------------------------------------------------------------------------------------------
+
 /*!
     Adds \a pComponent to the scene.
 */
 void C3DScene::addComponent(QSP<CComponent> pComponent)
 {
+    QMutexLocker locker(&m_mSimulationMutex);
+
     m_vComponents.append(pComponent);
+    m_tRayTree.clear();
     pComponent->solveLinks(this);
     autoResolveHeightFields();
 }
@@ -585,12 +867,15 @@ void C3DScene::autoResolveHeightFields()
 */
 void C3DScene::deleteComponentsByTag(const QString& sTag)
 {
+    QMutexLocker locker(&m_mSimulationMutex);
+
     for (int iIndex = 0; iIndex < m_vComponents.count(); iIndex++)
     {
         if (m_vComponents[iIndex]->tag() == sTag)
         {
             m_vComponents[iIndex]->clearLinks(this);
             m_vComponents.remove(iIndex);
+            m_tRayTree.clear();
             iIndex--;
         }
     }
@@ -599,10 +884,16 @@ void C3DScene::deleteComponentsByTag(const QString& sTag)
 //-------------------------------------------------------------------------------------------------
 
 /*!
-    Checks if \a rRay intersects components in the scene.
+    Checks if \a rRay intersects components in the scene. \br\br
+    Uses the ray tree refreshed by updateScene(), or walks all components if it is not up to date.
 */
 RayTracingResult C3DScene::intersect(Math::CRay3 rRay) const
 {
+    if (m_tRayTree.isValid())
+    {
+        return m_tRayTree.intersect(rRay);
+    }
+
     RayTracingResult dReturnResult(Q3D_INFINITY);
 
     foreach (QSP<CComponent> pComponent, m_vComponents)
@@ -620,6 +911,30 @@ RayTracingResult C3DScene::intersect(Math::CRay3 rRay) const
 
 //-------------------------------------------------------------------------------------------------
 
+/*!
+    Returns \c true if \a rRay intersects a component of the scene closer than \a dMaxDistance. \br\br
+    Stops at the first hit, which makes it cheaper than intersect() for occlusion tests.
+*/
+bool C3DScene::intersectAny(Math::CRay3 rRay, double dMaxDistance) const
+{
+    if (m_tRayTree.isValid())
+    {
+        return m_tRayTree.intersectAny(rRay, dMaxDistance);
+    }
+
+    foreach (QSP<CComponent> pComponent, m_vComponents)
+    {
+        if (intersectRecurse(pComponent, rRay).m_dDistance < dMaxDistance)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//-------------------------------------------------------------------------------------------------
+
 /*!
     Checks if \a ray intersects the component specified by \a pComponent, or any of its children.
 */
@@ -660,6 +975,8 @@ RayTracingResult C3DScene::intersectRecurse(QSP<CComponent> pComponent, const Ma
 */
 void C3DScene::addSegment(Math::CVector3 vStart, Math::CVector3 vEnd)
 {
+    QMutexLocker locker(&m_mSegmentMutex);
+
     if (m_pSegments->vertices().count() > 1000) return;
 
     if (m_bEditMode == false)
@@ -704,9 +1021,11 @@ QString C3DScene::debugInfo()
 
     return QString(
                 "FPS %1 - LLA (%2, %3, %4) Rotation (%5, %6, %7) Kts %8 Velocity (%9, %10, %11) Torque (%12, %13, %14) \n"
-                "Render : meshes %15 polys %16 chunks %17 \n"
+                "Render : meshes %15 polys %16 chunks %17 uploads %28 bytes in %29 us draw calls %34 state calls %35 readbacks %36 in %37 us \n"
+                "Collisions : proxies %30 pairs %31 hits %32 in %33 us \n"
                 "Components %18, chunks %19, terrains %20, bmi %21 \n"
                 "Allocated bytes : %22 \n"
+                "Elevation cache : %23 / %24 bytes, hits %25 misses %26 evictions %27 \n"
                 )
             .arg((int) m_FPS.getAverage())
             .arg(QString::number(ControlledGeoloc.Latitude, 'f', 6))
@@ -733,6 +1052,26 @@ QString C3DScene::debugInfo()
             .arg(CComponent::componentCounter()[ClassName_CBoundedMeshInstances])
 
             .arg(CMemoryMonitor::getInstance()->allocatedBytes())
+
+            .arg(CElevationTileCache::getInstance()->residentBytes())
+            .arg(CElevationTileCache::getInstance()->budget())
+            .arg(CElevationTileCache::getInstance()->hits())
+            .arg(CElevationTileCache::getInstance()->misses())
+            .arg(CElevationTileCache::getInstance()->evictions())
+
+            .arg(m_tStatistics.m_iNumBytesUploaded)
+            .arg(m_tStatistics.m_iUploadTimeUS)
+
+            .arg(m_tStatistics.m_iNumCollisionProxies)
+            .arg(m_tStatistics.m_iNumCollisionPairs)
+            .arg(m_tStatistics.m_iNumCollisions)
+            .arg(m_tStatistics.m_iCollisionTimeUS)
+
+            .arg(m_tStatistics.m_iNumDrawCalls)
+            .arg(m_tStatistics.m_iNumStateCalls)
+
+            .arg(m_tStatistics.m_iNumReadbacks)
+            .arg(m_tStatistics.m_iReadbackTimeUS)
             ;
 }
 
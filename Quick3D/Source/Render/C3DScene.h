@@ -4,6 +4,7 @@
 // Qt
 #include <QGLWidget>
 #include <QImage>
+#include <QMutex>
 #include <QTime>
 
 // qt-plus
@@ -13,6 +14,8 @@
 // Application
 #include "quick3d_global.h"
 #include "C3DSceneStatistics.h"
+#include "CCollisionBroadphase.h"
+#include "CSceneBVH.h"
 #include "CVector3.h"
 #include "CMatrix4.h"
 #include "CDumpable.h"
@@ -37,6 +40,7 @@
 
 class CView;
 class CController;
+class CSimulationScheduler;
 
 //-------------------------------------------------------------------------------------------------
 
@@ -121,6 +125,12 @@ public:
     //!
     void setOverlookFOV(double value) { m_dOverlookFOV = value; }
 
+    //! Steps the simulation dStepsPerSecond times per simulated second, or once per frame if 0
+    void setSimulationRate(double dStepsPerSecond);
+
+    //! Sets whether independent root objects are updated concurrently
+    void setParallelUpdate(bool value) { m_bParallelUpdate = value; }
+
     //-------------------------------------------------------------------------------------------------
     // Getters
     //-------------------------------------------------------------------------------------------------
@@ -191,9 +201,6 @@ public:
     //!
     bool depthComputing() const { return m_bDepthComputing; }
 
-    //!
-    const QImage& frameBuffer() const { return m_imgFrameBuffer; }
-
     //!
     bool editMode() const { return m_bEditMode; }
 
@@ -215,6 +222,15 @@ public:
     //!
     double overlookFOV() const { return m_dOverlookFOV; }
 
+    //! Returns the fixed step scheduler, nullptr if the simulation is stepped once per frame
+    CSimulationScheduler* simulationScheduler() const { return m_pSimulationScheduler; }
+
+    //! Returns the mutex held while the simulation is stepped or rendered
+    QMutex* simulationMutex() { return &m_mSimulationMutex; }
+
+    //! Returns true if independent root objects are updated concurrently
+    bool parallelUpdate() const { return m_bParallelUpdate; }
+
     //-------------------------------------------------------------------------------------------------
     // Control methods
     //-------------------------------------------------------------------------------------------------
@@ -234,7 +250,7 @@ public:
     //! Sets up shaders
     virtual void initShaders();
 
-    //! Sets up the environment
+    //! Sets up the environment uniforms of pProgram, called once per program and render context
     virtual void setupEnvironment(CRenderContext* pContext, QGLShaderProgram* pProgram, bool bBackgroundItem);
 
     //! Sets up the ligths
@@ -243,12 +259,24 @@ public:
     //!
     virtual void makeCurrentRenderingContext();
 
+    //! Makes the context current and binds the frame buffer the scene renders into
+    virtual void bindRenderTarget();
+
     //!
     void autoResolveHeightFields();
 
     //! Updates the scene using elapsed time in \a dDeltaTimeS.
     void updateScene(double dDeltaTime);
 
+    //! Runs one simulation step of dStepS seconds
+    void stepScene(double dStepS);
+
+    //! Locks the simulation and makes components render between their last two steps
+    void beginInterpolation();
+
+    //! Restores the simulated transforms and unlocks the simulation
+    void endInterpolation();
+
     //! Paints all components, using \a pContext.
     void paintComponents(CRenderContext* pContext);
 
@@ -264,6 +292,9 @@ public:
     //! Ray intersection
     virtual Math::RayTracingResult intersect(Math::CRay3 rRay) const;
 
+    //! Returns true if rRay hits a component closer than dMaxDistance
+    virtual bool intersectAny(Math::CRay3 rRay, double dMaxDistance = Q3D_INFINITY) const;
+
     //! Ray intersection
     virtual Math::RayTracingResult intersectComponentHierarchy(QSP<CComponent> pComponent, Math::CRay3 aRay) const;
 
@@ -291,6 +322,12 @@ protected:
     //!
     static void getLightsByTagRecurse(QVector<QSP<CLight> >& vLights, const QString &sTag, QSP<CComponent> pComponent);
 
+    //! Groups root objects that depend on each other, if components or their dependencies changed
+    void checkUpdateGroups();
+
+    //! Adds the update dependencies of pComponent and its children to vDependencies
+    static void getUpdateDependenciesRecurse(QVector<CComponent*>& vDependencies, CComponent* pComponent);
+
     //-------------------------------------------------------------------------------------------------
     // Properties
     //-------------------------------------------------------------------------------------------------
@@ -310,10 +347,19 @@ protected:
     CShaderCollection*                      m_vShaders;
     CController*                            m_pController;
     CController*                            m_pDefaultController;
+    CSimulationScheduler*                   m_pSimulationScheduler;
+    QMutex                                  m_mSimulationMutex;
+    QMutex                                  m_mSegmentMutex;            // Segments are added by components updated in parallel
+    QVector<CComponent*>                    m_vUpdateGroupRoots;        // Root objects the update groups were made for
+    QVector<QVector<int> >                  m_vParallelGroups;          // Indices of root objects updated together, concurrently with other groups
+    QVector<int>                            m_vSerialRoots;             // Indices of root objects updated in the calling thread
+    int                                     m_iUpdateGroupRevision;     // CComponent::updateDependencyRevision() when the groups were made
     Math::CVector3                          m_vWorldOrigin;
     QTime                                   m_tTimeOfDay;
     CAverager<double>                       m_FPS;
     CFog                                    m_tFog;
+    CCollisionBroadphase                    m_tCollisions;
+    CSceneBVH                               m_tRayTree;
     CInterpolator<Math::CVector4>           m_iSunColor;
     bool                                    m_bForDisplay;
     bool                                    m_bFrustumCheck;
@@ -329,11 +375,11 @@ protected:
     bool                                    m_bforceSmallFOV;
     bool                                    m_bForceIR;
     bool                                    m_bStreamView;
+    bool                                    m_bParallelUpdate;
     bool                                    m_bDepthComputing;
     double                                  m_dTime;
     double                                  m_dSunIntensity;
     double                                  m_dOverlookFOV;
-    QImage                                  m_imgFrameBuffer;
 
     // Shared data
 
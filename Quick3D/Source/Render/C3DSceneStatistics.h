@@ -1,6 +1,9 @@
 
 #pragma once
 
+// Qt
+#include <QtGlobal>
+
 class C3DSceneStatistics
 {
 public:
@@ -11,9 +14,20 @@ public:
         , m_iNumChunksDrawn(0)
         , m_iNumFrustumTests(0)
         , m_iNumRayIntersectionTests(0)
+        , m_iNumBytesUploaded(0)
+        , m_iUploadTimeUS(0)
+        , m_iNumDrawCalls(0)
+        , m_iNumStateCalls(0)
+        , m_iNumReadbacks(0)
+        , m_iReadbackTimeUS(0)
+        , m_iNumCollisionProxies(0)
+        , m_iNumCollisionPairs(0)
+        , m_iNumCollisions(0)
+        , m_iCollisionTimeUS(0)
     {
     }
 
+    // Collision counters are written once per update and are not reset with render counters
     void reset()
     {
         m_iNumMeshesDrawn = 0;
@@ -21,6 +35,12 @@ public:
         m_iNumChunksDrawn = 0;
         m_iNumFrustumTests = 0;
         m_iNumRayIntersectionTests = 0;
+        m_iNumBytesUploaded = 0;
+        m_iUploadTimeUS = 0;
+        m_iNumDrawCalls = 0;
+        m_iNumStateCalls = 0;
+        m_iNumReadbacks = 0;
+        m_iReadbackTimeUS = 0;
     }
 
     int     m_iNumMeshesDrawn;
@@ -28,4 +48,14 @@ public:
     int     m_iNumChunksDrawn;
     int     m_iNumFrustumTests;
     int     m_iNumRayIntersectionTests;
+    qint64  m_iNumBytesUploaded;            // Vertex and index bytes given to OpenGL
+    qint64  m_iUploadTimeUS;                // Time spent in buffer uploads, microseconds
+    int     m_iNumDrawCalls;                // glDrawElements() and glDrawElementsInstanced() calls
+    int     m_iNumStateCalls;               // Buffer, vertex array and uniform calls made around the draw calls
+    int     m_iNumReadbacks;                // Viewport rectangles read back from the frame buffer
+    qint64  m_iReadbackTimeUS;              // Time spent issuing and mapping readbacks, microseconds
+    int     m_iNumCollisionProxies;         // Components given to the broadphase
+    int     m_iNumCollisionPairs;           // Pairs given to the narrowphase
+    int     m_iNumCollisions;               // Pairs whose bounding spheres intersect
+    qint64  m_iCollisionTimeUS;             // Time spent in computeCollisions(), microseconds
 };
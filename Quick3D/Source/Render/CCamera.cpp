@@ -1,6 +1,9 @@
 
 // Qt
 #include <QColor>
+#include <QRect>
+#include <QWaitCondition>
+#include <QtConcurrent>
 
 // qt-plus
 #include "CLogger.h"
@@ -9,9 +12,11 @@
 // Application
 #include "CCamera.h"
 #include "C3DScene.h"
-#include "CGLWidgetScene.h"
+#include "CGLScene.h"
+#include "CDepthCube.h"
 #include "CRenderContext.h"
 #include "CImageUtilities.h"
+#include "CSceneBVH.h"
 
 //-------------------------------------------------------------------------------------------------
 
@@ -22,6 +27,9 @@ using namespace Math;
 #define DEFAULT_FOV	80.0
 #define SMALL_FOV	10.0
 
+// Size in pixels of the tiles traced by each thread in renderDepth_RayTraced()
+#define RAYTRACE_TILE_SIZE  64
+
 //-------------------------------------------------------------------------------------------------
 
 inline CVector2 degreesToPixels(double dCameraFOVW, double dCameraFOVH, CVector2 vAnglesDegrees)
@@ -188,6 +196,10 @@ void CCamera::render(C3DScene* pScene, CViewport* pViewport, bool bForceWideFOV,
             pScene->m_tStatistics.m_iNumChunksDrawn += Context.tStatistics.m_iNumChunksDrawn;
             pScene->m_tStatistics.m_iNumFrustumTests += Context.tStatistics.m_iNumFrustumTests;
             pScene->m_tStatistics.m_iNumRayIntersectionTests += Context.tStatistics.m_iNumRayIntersectionTests;
+            pScene->m_tStatistics.m_iNumBytesUploaded += Context.tStatistics.m_iNumBytesUploaded;
+            pScene->m_tStatistics.m_iUploadTimeUS += Context.tStatistics.m_iUploadTimeUS;
+            pScene->m_tStatistics.m_iNumDrawCalls += Context.tStatistics.m_iNumDrawCalls;
+            pScene->m_tStatistics.m_iNumStateCalls += Context.tStatistics.m_iNumStateCalls;
         }
 
         pScene->setRenderingShadows(false);
@@ -347,6 +359,10 @@ void CCamera::render(C3DScene* pScene, CViewport* pViewport, bool bForceWideFOV,
     pScene->m_tStatistics.m_iNumChunksDrawn += Context.tStatistics.m_iNumChunksDrawn;
     pScene->m_tStatistics.m_iNumFrustumTests += Context.tStatistics.m_iNumFrustumTests;
     pScene->m_tStatistics.m_iNumRayIntersectionTests += Context.tStatistics.m_iNumRayIntersectionTests;
+    pScene->m_tStatistics.m_iNumBytesUploaded += Context.tStatistics.m_iNumBytesUploaded;
+    pScene->m_tStatistics.m_iUploadTimeUS += Context.tStatistics.m_iUploadTimeUS;
+    pScene->m_tStatistics.m_iNumDrawCalls += Context.tStatistics.m_iNumDrawCalls;
+    pScene->m_tStatistics.m_iNumStateCalls += Context.tStatistics.m_iNumStateCalls;
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -375,88 +391,165 @@ void CCamera::renderDepth_RayTraced
         }
     }
 
-    for (int iTilt = 0; iTilt < tParams.m_sResolution.height(); iTilt++)
+    int iWidth = tParams.m_sResolution.width();
+    int iHeight = tParams.m_sResolution.height();
+
+    // Components subject to ray-tracing, in scene order
+    QVector<QSP<CComponent> > vTargets;
+
+    foreach (QSP<CComponent> pComponent, pScene->components())
     {
-        if (pProgressListener != nullptr)
+        if (pComponent->isVisible() && pComponent->isRaytracable())
         {
-            double dPercent = (((double) (iTilt * tParams.m_sResolution.width())) / (double) (tParams.m_sResolution.width() * tParams.m_sResolution.height())) * 100.0;
-            pProgressListener->notifyProgress("", dPercent);
+            vTargets.append(pComponent);
         }
+    }
 
-        for (int iPan = 0; iPan < tParams.m_sResolution.width(); iPan++)
-        {
-            double dPanNormalized = (double) iPan / (double) tParams.m_sResolution.width();
-            double dTiltNormalized = (double) iTilt / (double) tParams.m_sResolution.height();
+    CSceneBVH tTargets;
+    tTargets.update(vTargets, false);
+
+    // Rotations of each column and row
+    QVector<CMatrix4> vPanRotations(iWidth);
+    QVector<CMatrix4> vTiltRotations(iHeight);
+
+    for (int iPan = 0; iPan < iWidth; iPan++)
+    {
+        double dPanNormalized = (double) iPan / (double) iWidth;
+        double dCurrentPan = Math::Angles::toRad(tParams.m_vStartPanTiltDegrees.Y + (dPanNormalized * (tParams.m_vEndPanTiltDegrees.Y - tParams.m_vStartPanTiltDegrees.Y)));
 
-            double dCurrentPan = Math::Angles::toRad(tParams.m_vStartPanTiltDegrees.Y + (dPanNormalized * (tParams.m_vEndPanTiltDegrees.Y - tParams.m_vStartPanTiltDegrees.Y)));
-            double dCurrentTilt = Math::Angles::toRad(tParams.m_vStartPanTiltDegrees.X + (dTiltNormalized * (tParams.m_vEndPanTiltDegrees.X - tParams.m_vStartPanTiltDegrees.X)));
+        vPanRotations[iPan] = CMatrix4().makeRotation(CVector3(0.0, dCurrentPan, 0.0));
+    }
+
+    for (int iTilt = 0; iTilt < iHeight; iTilt++)
+    {
+        double dTiltNormalized = (double) iTilt / (double) iHeight;
+        double dCurrentTilt = Math::Angles::toRad(tParams.m_vStartPanTiltDegrees.X + (dTiltNormalized * (tParams.m_vEndPanTiltDegrees.X - tParams.m_vStartPanTiltDegrees.X)));
+
+        vTiltRotations[iTilt] = CMatrix4().makeRotation(CVector3(dCurrentTilt, 0.0, 0.0));
+    }
 
-            // Create the ray for the current pixel
-            CRay3 rCameraRay;
+    CMatrix4 mWorldTransform = worldTransform();
 
-            // Ray points to +Z
-            rCameraRay.vOrigin = CVector3(0.0, 0.0, 0.0);
-            rCameraRay.vNormal = CVector3(0.0, 0.0, 1.0);
+    // Make room for the matrices, detached once here so that threads write in place
+    int iDetectionBase = tParams.m_vDetection.count();
+    int iEdgesBase = tParams.m_vEdges.count();
+    int iDepthBase = tParams.m_vDepth.count();
 
-            // Apply current angles to ray
-            rCameraRay = CMatrix4().makeRotation(CVector3(dCurrentTilt, 0.0, 0.0)) * rCameraRay;
-            rCameraRay = CMatrix4().makeRotation(CVector3(0.0, dCurrentPan, 0.0)) * rCameraRay;
+    tParams.m_vDetection.resize(iDetectionBase + iWidth * iHeight);
+    tParams.m_vEdges.resize(iEdgesBase + iWidth * iHeight);
+    tParams.m_vDepth.resize(iDepthBase + iWidth * iHeight);
 
-            // Apply camera transform to ray
-            rCameraRay = worldTransform() * rCameraRay;
+    char* pDetection = tParams.m_vDetection.data() + iDetectionBase;
+    char* pEdges = tParams.m_vEdges.data() + iEdgesBase;
+    double* pDepth = tParams.m_vDepth.data() + iDepthBase;
+
+    const QVector<CGeoZone>& vZones = tParams.m_vZones;
+
+    QVector<QRect> vTiles;
+
+    for (int iTilt = 0; iTilt < iHeight; iTilt += RAYTRACE_TILE_SIZE)
+    {
+        for (int iPan = 0; iPan < iWidth; iPan += RAYTRACE_TILE_SIZE)
+        {
+            vTiles.append(QRect(iPan, iTilt, qMin(RAYTRACE_TILE_SIZE, iWidth - iPan), qMin(RAYTRACE_TILE_SIZE, iHeight - iTilt)));
+        }
+    }
 
-            // Initialize tracing distance
-            RayTracingResult dResult(Q3D_INFINITY);
+    QMutex mProgressMutex;
+    QWaitCondition tTileDone;
+    int iTilesDone = 0;
 
-            foreach (QSP<CComponent> pComponent, pScene->components())
+    auto traceTile = [&](const QRect& rTile)
+    {
+        for (int iTilt = rTile.top(); iTilt <= rTile.bottom(); iTilt++)
+        {
+            for (int iPan = rTile.left(); iPan <= rTile.right(); iPan++)
             {
-                // Is the component subject to ray-tracing?
-                if (pComponent->isVisible() && pComponent->isRaytracable())
-                {
-                    RayTracingResult dNewResult = pComponent->intersect(rCameraRay);
+                // Create the ray for the current pixel
+                CRay3 rCameraRay;
 
-                    // Keep the returned distance if less than the one already computed
-                    if (dNewResult.m_dDistance < dResult.m_dDistance)
-                    {
-                        dResult = dNewResult;
-                    }
+                // Ray points to +Z
+                rCameraRay.vOrigin = CVector3(0.0, 0.0, 0.0);
+                rCameraRay.vNormal = CVector3(0.0, 0.0, 1.0);
+
+                // Apply current angles to ray
+                rCameraRay = vTiltRotations[iTilt] * rCameraRay;
+                rCameraRay = vPanRotations[iPan] * rCameraRay;
+
+                // Apply camera transform to ray
+                rCameraRay = mWorldTransform * rCameraRay;
+
+                RayTracingResult dResult = tTargets.intersect(rCameraRay);
+
+                CGeoZone::EGeoZoneFlag eDetectionFlag = CGeoZone::gzfUnknown;
+                int iDotRayNormal = 0;
+
+                if (dResult.m_dDistance >= 0.0 && dResult.m_dDistance < Q3D_INFINITY && dResult.m_dDistance < dMaxDistance)
+                {
+                    CVector3 vIntersectionPoint3D = rCameraRay.vOrigin + rCameraRay.vNormal * dResult.m_dDistance;
+                    CGeoloc gIntersectionPoint(vIntersectionPoint3D);
+                    CVector3 vLocalIntersectionPoint3D = gIntersectionPoint.toVector3(gReference);
+
+                    // Get the current flag for detection zones
+                    eDetectionFlag = categorizePointFromZones(
+                                vZones,
+                                CVector2(vLocalIntersectionPoint3D.X, vLocalIntersectionPoint3D.Z)
+                                );
+
+                    iDotRayNormal = (int) (rCameraRay.vNormal.dot(dResult.m_vNormal) * -255.0);
+                    iDotRayNormal = Math::Angles::clipInt(iDotRayNormal, 0, 255);
+                }
+                else
+                {
+                    dResult.m_dDistance = -1.0;
                 }
+
+                // Fill matrices
+                int iPixel = iTilt * iWidth + iPan;
+
+                pDetection[iPixel] = (char) eDetectionFlag;
+                pEdges[iPixel] = (char) iDotRayNormal;
+                pDepth[iPixel] = dResult.m_dDistance;
             }
+        }
 
-            CGeoZone::EGeoZoneFlag eDetectionFlag = CGeoZone::gzfUnknown;
-            int iDotRayNormal = 0;
+        QMutexLocker locker(&mProgressMutex);
+        iTilesDone++;
+        tTileDone.wakeAll();
+    };
 
-            if (dResult.m_dDistance >= 0.0 && dResult.m_dDistance < Q3D_INFINITY && dResult.m_dDistance < dMaxDistance)
-            {
-                CVector3 vIntersectionPoint3D = rCameraRay.vOrigin + rCameraRay.vNormal * dResult.m_dDistance;
-                CGeoloc gIntersectionPoint(vIntersectionPoint3D);
-                CVector3 vLocalIntersectionPoint3D = gIntersectionPoint.toVector3(gReference);
-
-                // Get the current flag for detection zones
-                eDetectionFlag = categorizePointFromZones(
-                            tParams.m_vZones,
-                            CVector2(vLocalIntersectionPoint3D.X, vLocalIntersectionPoint3D.Z)
-                            );
+    QFuture<void> tFuture = QtConcurrent::map(vTiles, traceTile);
 
-                iDotRayNormal = (int) (rCameraRay.vNormal.dot(dResult.m_vNormal) * -255.0);
-                iDotRayNormal = Math::Angles::clipInt(iDotRayNormal, 0, 255);
-            }
-            else
+    if (pProgressListener != nullptr)
+    {
+        QMutexLocker locker(&mProgressMutex);
+        int iTilesReported = 0;
+
+        pProgressListener->notifyProgress("", 0.0);
+
+        while (iTilesReported < vTiles.count())
+        {
+            while (iTilesDone == iTilesReported)
             {
-                dResult.m_dDistance = -1.0;
+                tTileDone.wait(&mProgressMutex);
             }
 
-            // Fill matrices
-            tParams.m_vDetection.append((char) eDetectionFlag);
-            tParams.m_vEdges.append((char) iDotRayNormal);
-            tParams.m_vDepth.append(dResult.m_dDistance);
+            iTilesReported = iTilesDone;
+
+            double dPercent = ((double) iTilesReported / (double) vTiles.count()) * 100.0;
+
+            locker.unlock();
+            pProgressListener->notifyProgress("", dPercent);
+            locker.relock();
         }
     }
+
+    tFuture.waitForFinished();
 }
 
 //-------------------------------------------------------------------------------------------------
 
-QImage getFrameBuffer(CGLWidgetScene* pScene, QSize sSize)
+QImage getFrameBuffer(CGLScene* pScene, QSize sSize)
 {
     QImage imgFrame(sSize, QImage::Format_RGB888);
 
@@ -474,7 +567,7 @@ QImage getFrameBuffer(CGLWidgetScene* pScene, QSize sSize)
 #define RENDER_SUBDIVISIONS_PAN			32
 #define RENDER_SUBDIVISIONS_TILT		16
 
-void CCamera::renderDepth_CubeMapped
+void CCamera::renderDepth_Tiled
 (
         C3DScene* pScene,
         double dMaxDistance,
@@ -482,11 +575,11 @@ void CCamera::renderDepth_CubeMapped
         IProgressListener* pProgressListener
         )
 {
-    CGLWidgetScene* pGLWidgetScene = dynamic_cast<CGLWidgetScene*>(pScene);
+    CGLScene* pGLScene = dynamic_cast<CGLScene*>(pScene);
 
-    if (pGLWidgetScene != nullptr)
+    if (pGLScene != nullptr)
     {
-        START_SAMPLE("CCamera::renderDepth_CubeMapped:prepare");
+        START_SAMPLE("CCamera::renderDepth_Tiled:prepare");
 
         CGeoloc gReference = geoloc();
 
@@ -542,30 +635,30 @@ void CCamera::renderDepth_CubeMapped
         CVector2 vMapSize((double) sMapSize.width(), (double) sMapSize.height());
 
         // Sauvegarde des paramtres de la camra
-        QRect rOldGeometry = pGLWidgetScene->geometry();
-        CViewport* pOldViewport = pGLWidgetScene->viewports()[0];
-        CViewport* pNewViewport = new CViewport(pGLWidgetScene);
+        QSize sOldSize = pGLScene->renderSize();
+        CViewport* pOldViewport = pGLScene->viewports()[0];
+        CViewport* pNewViewport = new CViewport(pGLScene);
         CVector3 vCameraInitialRotation = rotation();
         CVector3 vCameraAttitude = tParams.m_vAttitude.degreesToRadians() * -1.0;
         CVector3 vCameraHeading(0.0, Math::Angles::toRad(tParams.m_dCameraTrueHeadingDegrees), 0.0);
         double dOldFOV = m_dFOV;
 
         // Cration du viewport pour le rendu de la scne
-        pGLWidgetScene->setGeometry(0, 0, sMapSize.width(), sMapSize.height());
-        pGLWidgetScene->viewports()[0] = pNewViewport;
-        pGLWidgetScene->viewports()[0]->setSize(vMapSize);
-        pGLWidgetScene->viewports()[0]->setCamera(QSP<CCamera>(this));
-        pGLWidgetScene->viewports()[0]->setEnabled(true);
-        pGLWidgetScene->setDepthComputing(true);
-        pGLWidgetScene->setShaderQuality(0.0);
-        pGLWidgetScene->updateScene(1.0);
+        pGLScene->setRenderSize(sMapSize);
+        pGLScene->viewports()[0] = pNewViewport;
+        pGLScene->viewports()[0]->setSize(vMapSize);
+        pGLScene->viewports()[0]->setCamera(QSP<CCamera>(this));
+        pGLScene->viewports()[0]->setEnabled(true);
+        pGLScene->setDepthComputing(true);
+        pGLScene->setShaderQuality(0.0);
+        pGLScene->updateScene(1.0);
 
         // Cration du cube-map de rfrence
         QImage imgImage(QSize(sMapSize.width() * RENDER_SUBDIVISIONS_PAN, sMapSize.height() * RENDER_SUBDIVISIONS_TILT), QImage::Format_RGB888);
 
-        STOP_SAMPLE("CCamera::renderDepth_CubeMapped:prepare");
+        STOP_SAMPLE("CCamera::renderDepth_Tiled:prepare");
 
-        START_SAMPLE("CCamera::renderDepth_CubeMapped:render");
+        START_SAMPLE("CCamera::renderDepth_Tiled:render");
 
         // Rglage du FOV camra horizontal (le FOV vertical est fonction de la taille du viewport)
         m_dFOV = dFOV_Tilt;
@@ -602,20 +695,20 @@ void CCamera::renderDepth_CubeMapped
                 setRotation(anAxis.eulerAngles());
 
                 // Rendu OpenGL
-                pGLWidgetScene->paintGL();
+                pGLScene->renderFrame();
 
                 // Copie de l'image rendue dans l'image complte
                 CImageUtilities::blitWhole(
                             imgImage,
                             QPoint(sMapSize.width() * iPanIndex, sMapSize.height() * iTiltIndex),
-                            getFrameBuffer(pGLWidgetScene, sMapSize)
+                            getFrameBuffer(pGLScene, sMapSize)
                             );
             }
         }
 
-        STOP_SAMPLE("CCamera::renderDepth_CubeMapped:render");
+        STOP_SAMPLE("CCamera::renderDepth_Tiled:render");
 
-        START_SAMPLE("CCamera::renderDepth_CubeMapped:postprocess");
+        START_SAMPLE("CCamera::renderDepth_Tiled:postprocess");
 
         // Pour tests : sauvegarde de l'image finale telle que rendue par OpenGL
         // imgImage.save("d:\\Pano.png");
@@ -713,15 +806,15 @@ void CCamera::renderDepth_CubeMapped
             }
         }
 
-        STOP_SAMPLE("CCamera::renderDepth_CubeMapped:postprocess");
+        STOP_SAMPLE("CCamera::renderDepth_Tiled:postprocess");
 
-        START_SAMPLE("CCamera::renderDepth_CubeMapped:cleanup");
+        START_SAMPLE("CCamera::renderDepth_Tiled:cleanup");
 
         // Get the scene settings
-        pGLWidgetScene->setGeometry(rOldGeometry);
-        pGLWidgetScene->viewports()[0] = pOldViewport;
-        pGLWidgetScene->setDepthComputing(false);
-        pGLWidgetScene->setShaderQuality(0.5);
+        pGLScene->setRenderSize(sOldSize);
+        pGLScene->viewports()[0] = pOldViewport;
+        pGLScene->setDepthComputing(false);
+        pGLScene->setShaderQuality(0.5);
 
         // Restore camera settings
         setRotation(vCameraInitialRotation);
@@ -730,8 +823,244 @@ void CCamera::renderDepth_CubeMapped
         // Destroy the temporary viewport
         delete pNewViewport;
 
-        STOP_SAMPLE("CCamera::renderDepth_CubeMapped:cleanup");
+        STOP_SAMPLE("CCamera::renderDepth_Tiled:cleanup");
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+// Cube faces are powers of two between these sizes
+#define DEPTH_CUBE_SIZE_MIN				64
+#define DEPTH_CUBE_SIZE_MAX				2048
+
+void CCamera::renderDepth_CubeMapped
+(
+        C3DScene* pScene,
+        double dMaxDistance,
+        CPanoramicMatrixParams& tParams,
+        IProgressListener* pProgressListener
+        )
+{
+    CGLScene* pGLScene = dynamic_cast<CGLScene*>(pScene);
+
+    if (pGLScene == nullptr)
+    {
+        return;
+    }
+
+    START_SAMPLE("CCamera::renderDepth_CubeMapped:prepare");
+
+    int iWidth = tParams.m_sResolution.width();
+    int iHeight = tParams.m_sResolution.height();
+
+    // The center pixel of a face spans 2 / size radians, which must not exceed a matrix pixel
+    double dPanStep = fabs(Math::Angles::toRad(tParams.m_vEndPanTiltDegrees.Y - tParams.m_vStartPanTiltDegrees.Y)) / (double) iWidth;
+    double dTiltStep = fabs(Math::Angles::toRad(tParams.m_vEndPanTiltDegrees.X - tParams.m_vStartPanTiltDegrees.X)) / (double) iHeight;
+    double dStep = qMin(dPanStep, dTiltStep);
+
+    int iFaceSize = DEPTH_CUBE_SIZE_MIN;
+
+    while (iFaceSize < DEPTH_CUBE_SIZE_MAX && 2.0 / (double) iFaceSize > dStep)
+    {
+        iFaceSize *= 2;
     }
+
+    // The target and pixel buffers are kept by the scene for the next captures of the same size
+    CDepthCube& tCube = *pGLScene->depthCube();
+
+    if (tCube.begin(iFaceSize) == false)
+    {
+        STOP_SAMPLE("CCamera::renderDepth_CubeMapped:prepare");
+
+        // No float targets, fall back to 8 bit tiles
+        renderDepth_Tiled(pScene, dMaxDistance, tParams, pProgressListener);
+        return;
+    }
+
+    CGeoloc gReference = geoloc();
+
+    // Create polygons in local 3D space and viewed from top (X et Z)
+    for (QVector<CGeoZone>::iterator gZone = tParams.m_vZones.begin(); gZone != tParams.m_vZones.end(); gZone++)
+    {
+        (*gZone).getLocalPoints().clear();
+
+        foreach (const CGeoloc& gPoint, (*gZone).getPoints())
+        {
+            CVector3 vPoint = gPoint.toVector3(gReference);
+            (*gZone).getLocalPoints().append(CVector2(vPoint.X, vPoint.Z));
+        }
+    }
+
+    // Save camera and scene settings
+    CViewport* pOldViewport = pGLScene->viewports()[0];
+    CViewport* pNewViewport = new CViewport(pGLScene);
+    CVector3 vCameraInitialRotation = rotation();
+    CVector3 vCameraAttitude = tParams.m_vAttitude.degreesToRadians() * -1.0;
+    CVector3 vCameraHeading(0.0, Math::Angles::toRad(tParams.m_dCameraTrueHeadingDegrees), 0.0);
+    double dOldFOV = m_dFOV;
+
+    // Square viewport, a face has 90 degrees both ways
+    pGLScene->viewports()[0] = pNewViewport;
+    pGLScene->viewports()[0]->setSize(CVector2((double) iFaceSize, (double) iFaceSize));
+    pGLScene->viewports()[0]->setCamera(QSP<CCamera>(this));
+    pGLScene->viewports()[0]->setEnabled(true);
+    pGLScene->setDepthComputing(true);
+    pGLScene->setShaderQuality(0.0);
+    pGLScene->updateScene(1.0);
+
+    m_dFOV = 90.0;
+
+    STOP_SAMPLE("CCamera::renderDepth_CubeMapped:prepare");
+
+    START_SAMPLE("CCamera::renderDepth_CubeMapped:render");
+
+    if (pProgressListener != nullptr)
+    {
+        pProgressListener->notifyProgress("", 0.0);
+    }
+
+    for (int iFace = 0; iFace < DEPTH_CUBE_FACES; iFace++)
+    {
+        // Same orientation chain as the tiles, with the angles of the face
+        Math::CAxis anAxis;
+        anAxis = anAxis.rotate(CDepthCube::faceAngles(iFace));
+        anAxis = anAxis.rotate(CVector3(0.0, vCameraAttitude.Y, 0.0));
+        anAxis = anAxis.rotate(CVector3(vCameraAttitude.X, 0.0, 0.0));
+        anAxis = anAxis.rotate(CVector3(0.0, 0.0, vCameraAttitude.Z));
+        anAxis = anAxis.rotate(vCameraHeading);
+
+        setRotation(anAxis.eulerAngles());
+
+        pGLScene->renderFrame();
+
+        // Returns at once, the GPU renders the next face while this one is copied
+        tCube.readFace(iFace);
+
+        if (pProgressListener != nullptr)
+        {
+            pProgressListener->notifyProgress("", ((double) (iFace + 1) / (double) DEPTH_CUBE_FACES) * 100.0);
+        }
+    }
+
+    tCube.end();
+
+    STOP_SAMPLE("CCamera::renderDepth_CubeMapped:render");
+
+    START_SAMPLE("CCamera::renderDepth_CubeMapped:postprocess");
+
+    // Sines and cosines of each column and row
+    QVector<float> vPanSin(iWidth);
+    QVector<float> vPanCos(iWidth);
+    QVector<float> vTiltSin(iHeight);
+    QVector<float> vTiltCos(iHeight);
+
+    for (int iPan = 0; iPan < iWidth; iPan++)
+    {
+        double dPanNormalized = (double) iPan / (double) iWidth;
+        double dCurrentPan = Math::Angles::toRad(tParams.m_vStartPanTiltDegrees.Y + (dPanNormalized * (tParams.m_vEndPanTiltDegrees.Y - tParams.m_vStartPanTiltDegrees.Y)));
+
+        vPanSin[iPan] = (float) sin(dCurrentPan);
+        vPanCos[iPan] = (float) cos(dCurrentPan);
+    }
+
+    for (int iTilt = 0; iTilt < iHeight; iTilt++)
+    {
+        double dTiltNormalized = (double) iTilt / (double) iHeight;
+        double dCurrentTilt = Math::Angles::toRad(tParams.m_vStartPanTiltDegrees.X + (dTiltNormalized * (tParams.m_vEndPanTiltDegrees.X - tParams.m_vStartPanTiltDegrees.X)));
+
+        vTiltSin[iTilt] = (float) sin(dCurrentTilt);
+        vTiltCos[iTilt] = (float) cos(dCurrentTilt);
+    }
+
+    CMatrix4 mHeading = CMatrix4().makeRotation(vCameraHeading);
+
+    // Make room for the matrices, detached once here so that threads write in place
+    int iDetectionBase = tParams.m_vDetection.count();
+    int iEdgesBase = tParams.m_vEdges.count();
+    int iDepthBase = tParams.m_vDepth.count();
+
+    tParams.m_vDetection.resize(iDetectionBase + iWidth * iHeight);
+    tParams.m_vEdges.resize(iEdgesBase + iWidth * iHeight);
+    tParams.m_vDepth.resize(iDepthBase + iWidth * iHeight);
+
+    char* pDetection = tParams.m_vDetection.data() + iDetectionBase;
+    char* pEdges = tParams.m_vEdges.data() + iEdgesBase;
+    double* pDepth = tParams.m_vDepth.data() + iDepthBase;
+
+    const QVector<CGeoZone>& vZones = tParams.m_vZones;
+    const float* pPanSin = vPanSin.constData();
+    const float* pPanCos = vPanCos.constData();
+
+    QVector<int> vRows(iHeight);
+
+    for (int iTilt = 0; iTilt < iHeight; iTilt++)
+    {
+        vRows[iTilt] = iTilt;
+    }
+
+    auto decodeRow = [&](int iTilt)
+    {
+        float fTiltSin = vTiltSin[iTilt];
+        float fTiltCos = vTiltCos[iTilt];
+        int iRowStart = iTilt * iWidth;
+
+        for (int iPan = 0; iPan < iWidth; iPan++)
+        {
+            // Direction of the pixel, the front vector of an axis rotated by tilt then pan
+            float fX = pPanSin[iPan] * fTiltCos;
+            float fY = -fTiltSin;
+            float fZ = pPanCos[iPan] * fTiltCos;
+
+            const float* pTexel = tCube.texel(fX, fY, fZ);
+
+            double dDistance = -1.0;
+            CGeoZone::EGeoZoneFlag eDetectionFlag = CGeoZone::gzfUnknown;
+            int iDotRayNormal = -127;
+
+            // Blue is only written by the clear color, where nothing was hit
+            if (pTexel[2] < 0.5f)
+            {
+                dDistance = (double) pTexel[0] * 10000.0;
+
+                // Same scale as the 8 bit tiles
+                iDotRayNormal = (int) (pTexel[1] * 255.0f + 0.5f);
+
+                if (vZones.count() > 0)
+                {
+                    CVector3 vIntersectionPoint3D = mHeading * (CVector3(fX, fY, fZ) * dDistance);
+
+                    eDetectionFlag = categorizePointFromZones(
+                                vZones,
+                                CVector2(vIntersectionPoint3D.X, vIntersectionPoint3D.Z)
+                                );
+                }
+            }
+
+            pDetection[iRowStart + iPan] = (char) eDetectionFlag;
+            pEdges[iRowStart + iPan] = (char) iDotRayNormal;
+            pDepth[iRowStart + iPan] = dDistance;
+        }
+    };
+
+    QtConcurrent::blockingMap(vRows, decodeRow);
+
+    STOP_SAMPLE("CCamera::renderDepth_CubeMapped:postprocess");
+
+    START_SAMPLE("CCamera::renderDepth_CubeMapped:cleanup");
+
+    // Restore scene settings
+    pGLScene->viewports()[0] = pOldViewport;
+    pGLScene->setDepthComputing(false);
+    pGLScene->setShaderQuality(0.5);
+
+    // Restore camera settings
+    setRotation(vCameraInitialRotation);
+    m_dFOV = dOldFOV;
+
+    // Destroy the temporary viewport
+    delete pNewViewport;
+
+    STOP_SAMPLE("CCamera::renderDepth_CubeMapped:cleanup");
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -158,6 +158,7 @@ public:
     virtual void render(C3DScene* pScene, CViewport* pViewport, bool bForceWideFOV, bool bForceSmallFOV, bool bForceIR, bool bOverlook);
 
     //! Generates a depth matrix using ray tracing technique
+    //! Tiles of pixels are traced in parallel, progress is notified from the calling thread
     virtual void renderDepth_RayTraced(
             C3DScene* pScene,
             double dMaxDistance,
@@ -166,6 +167,7 @@ public:
             );
 
     //! Generates a depth matrix using cube mapping technique
+    //! Six faces are rendered into float targets and read back together, pixels are decoded in parallel
     virtual void renderDepth_CubeMapped(
             C3DScene* pScene,
             double dMaxDistance,
@@ -173,6 +175,15 @@ public:
             IProgressListener* pProgressListener
             );
 
+    //! Generates a depth matrix from 32 x 16 tiles rendered into 8 bit targets
+    //! Used when float targets are not available, and to compare with renderDepth_CubeMapped()
+    virtual void renderDepth_Tiled(
+            C3DScene* pScene,
+            double dMaxDistance,
+            CPanoramicMatrixParams& tParams,
+            IProgressListener* pProgressListener
+            );
+
     //! Computes the frustum (visualization pyramid) of the camera
     void computeFrustum(double dVerticalFOV, double dAspectRatio, double dMinDistance, double dMaxDistance);
 
@@ -0,0 +1,242 @@
+
+// Std
+#include <string.h>
+
+// qt-plus
+#include "CLogger.h"
+
+// Application
+#include "CDepthCube.h"
+#include "Angles.h"
+#include "CAxis.h"
+#include "CGLScene.h"
+
+//-------------------------------------------------------------------------------------------------
+
+using namespace Math;
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    \class CDepthCube
+    \brief Captures the distance and incidence seen around a camera into six 90 degree faces with float precision.
+    \inmodule Quick3D
+    \sa CCamera, CFrameReadback
+
+    While a capture runs, the scene renders into a 32 bit float color target. With depth computing enabled,
+    the standard shader writes the distance divided by 10000 in red, the incidence in green, and the clear color is white,
+    so blue tells where nothing was hit. \br\br
+    Each face is rendered once, then read into a pixel pack buffer of its own, which returns at once
+    so that the GPU renders the next face meanwhile. end() maps the six buffers in a row. \br\br
+    Faces are oriented in the pan and tilt frame of CCamera::renderDepth_CubeMapped(), with faceAngles().
+    texel() looks a direction up in the faces.
+*/
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Constructs a CDepthCube for \a pScene.
+*/
+CDepthCube::CDepthCube(CGLScene* pScene)
+    : m_pScene(pScene)
+    , m_pTarget(nullptr)
+    , m_iFaceSize(0)
+{
+    for (int iFace = 0; iFace < DEPTH_CUBE_FACES; iFace++)
+    {
+        m_iPBO[iFace] = 0;
+
+        CAxis aFace = CAxis().rotate(faceAngles(iFace));
+
+        // The faces look along the axes, rounding removes the errors of sine and cosine
+        CVector3 vFront(qRound(aFace.Front.X), qRound(aFace.Front.Y), qRound(aFace.Front.Z));
+
+        m_fRight[iFace][0] = (float) qRound(aFace.Right.X);
+        m_fRight[iFace][1] = (float) qRound(aFace.Right.Y);
+        m_fRight[iFace][2] = (float) qRound(aFace.Right.Z);
+
+        m_fUp[iFace][0] = (float) qRound(aFace.Up.X);
+        m_fUp[iFace][1] = (float) qRound(aFace.Up.Y);
+        m_fUp[iFace][2] = (float) qRound(aFace.Up.Z);
+
+        if (vFront.X != 0.0) m_iFaceOfAxis[0][vFront.X < 0.0 ? 1 : 0] = iFace;
+        if (vFront.Y != 0.0) m_iFaceOfAxis[1][vFront.Y < 0.0 ? 1 : 0] = iFace;
+        if (vFront.Z != 0.0) m_iFaceOfAxis[2][vFront.Z < 0.0 ? 1 : 0] = iFace;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Destroys a CDepthCube.
+*/
+CDepthCube::~CDepthCube()
+{
+    if (m_pTarget != nullptr)
+    {
+        m_pScene->makeCurrentRenderingContext();
+    }
+
+    clear();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Returns the orientation of face \a iFace as euler angles in radians, tilt in X and pan in Y.
+    The faces look front, right, back, left, down and up.
+*/
+CVector3 CDepthCube::faceAngles(int iFace)
+{
+    static const double dAngles[DEPTH_CUBE_FACES][2] =
+    {
+        {   0.0,    0.0 },
+        {   0.0,   90.0 },
+        {   0.0,  180.0 },
+        {   0.0,  -90.0 },
+        {  90.0,    0.0 },
+        { -90.0,    0.0 }
+    };
+
+    return CVector3(Angles::toRad(dAngles[iFace][0]), Angles::toRad(dAngles[iFace][1]), 0.0);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Makes the scene render into a float target of \a iFaceSize by \a iFaceSize pixels.
+    The target is kept for the next captures of the same size. \br\br
+    Returns \c false if the context has no float targets or the target cannot be created,
+    the scene then renders into its surface.
+*/
+bool CDepthCube::begin(int iFaceSize)
+{
+    if (m_pScene->glExtension() == nullptr || m_pScene->glExtension()->hasFloatTargets() == false)
+    {
+        return false;
+    }
+
+    m_pScene->makeCurrentRenderingContext();
+
+    if (iFaceSize != m_iFaceSize)
+    {
+        clear();
+
+        m_pTarget = new QOpenGLFramebufferObject(iFaceSize, iFaceSize, QOpenGLFramebufferObject::Depth, GL_TEXTURE_2D, GL_RGBA32F);
+
+        if (m_pTarget->isValid() == false)
+        {
+            LOG_METHOD_ERROR(QString("Could not create a %1 x %1 float frame buffer").arg(iFaceSize));
+
+            clear();
+            return false;
+        }
+
+        if (m_pScene->glExtension()->hasPixelBuffers())
+        {
+            GL_glGenBuffers(DEPTH_CUBE_FACES, m_iPBO);
+
+            for (int iFace = 0; iFace < DEPTH_CUBE_FACES; iFace++)
+            {
+                GL_glBindBuffer(GL_PIXEL_PACK_BUFFER, m_iPBO[iFace]);
+                GL_glBufferData(GL_PIXEL_PACK_BUFFER, iFaceSize * iFaceSize * DEPTH_CUBE_CHANNELS * sizeof(float), nullptr, GL_STREAM_READ);
+            }
+
+            GL_glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+
+        m_iFaceSize = iFaceSize;
+        m_vTexels.resize(DEPTH_CUBE_FACES * iFaceSize * iFaceSize * DEPTH_CUBE_CHANNELS);
+    }
+
+    m_pScene->setRenderTarget(m_pTarget);
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Starts reading face \a iFace, which the scene has just rendered.
+    Without pixel buffer support, the read waits for the GPU.
+*/
+void CDepthCube::readFace(int iFace)
+{
+    m_pScene->bindRenderTarget();
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    if (m_iPBO[0] != 0)
+    {
+        GL_glBindBuffer(GL_PIXEL_PACK_BUFFER, m_iPBO[iFace]);
+        glReadPixels(0, 0, m_iFaceSize, m_iFaceSize, GL_RGB, GL_FLOAT, nullptr);
+        GL_glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    else
+    {
+        float* pFace = m_vTexels.data() + iFace * m_iFaceSize * m_iFaceSize * DEPTH_CUBE_CHANNELS;
+
+        glReadPixels(0, 0, m_iFaceSize, m_iFaceSize, GL_RGB, GL_FLOAT, pFace);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Waits for the reads and copies the faces to memory. The scene renders into its surface again.
+*/
+void CDepthCube::end()
+{
+    m_pScene->setRenderTarget(nullptr);
+    m_pScene->bindRenderTarget();
+
+    if (m_iPBO[0] != 0)
+    {
+        int iFaceFloats = m_iFaceSize * m_iFaceSize * DEPTH_CUBE_CHANNELS;
+
+        for (int iFace = 0; iFace < DEPTH_CUBE_FACES; iFace++)
+        {
+            GL_glBindBuffer(GL_PIXEL_PACK_BUFFER, m_iPBO[iFace]);
+
+            const float* pData = (const float*) GL_glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+
+            if (pData != nullptr)
+            {
+                memcpy(m_vTexels.data() + iFace * iFaceFloats, pData, iFaceFloats * sizeof(float));
+            }
+
+            GL_glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+
+        GL_glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Deletes the target and the pixel buffers, the context must be current.
+*/
+void CDepthCube::clear()
+{
+    if (m_pScene->renderTarget() == m_pTarget)
+    {
+        m_pScene->setRenderTarget(nullptr);
+    }
+
+    delete m_pTarget;
+    m_pTarget = nullptr;
+
+    if (m_iPBO[0] != 0)
+    {
+        GL_glDeleteBuffers(DEPTH_CUBE_FACES, m_iPBO);
+    }
+
+    for (int iFace = 0; iFace < DEPTH_CUBE_FACES; iFace++)
+    {
+        m_iPBO[iFace] = 0;
+    }
+
+    m_iFaceSize = 0;
+    m_vTexels.clear();
+}
@@ -0,0 +1,137 @@
+
+#pragma once
+
+// Std
+#include <math.h>
+
+// Qt
+#include <QOpenGLFramebufferObject>
+#include <QVector>
+
+// Application
+#include "quick3d_global.h"
+#include "CVector3.h"
+#include "CGLExtension.h"
+
+//-------------------------------------------------------------------------------------------------
+// Forward declarations
+
+class CGLScene;
+
+//-------------------------------------------------------------------------------------------------
+
+//! Number of faces of the cube
+#define DEPTH_CUBE_FACES        6
+
+//! Number of floats of a texel : normalized distance, incidence and 1 where nothing was hit
+#define DEPTH_CUBE_CHANNELS     3
+
+//-------------------------------------------------------------------------------------------------
+
+//! Captures the distance and incidence seen around a camera into six 90 degree faces with float precision
+class QUICK3D_EXPORT CDepthCube
+{
+public:
+
+    //-------------------------------------------------------------------------------------------------
+    // Constructors and destructor
+    //-------------------------------------------------------------------------------------------------
+
+    //! Constructor
+    CDepthCube(CGLScene* pScene);
+
+    //! Destructor
+    virtual ~CDepthCube();
+
+    //-------------------------------------------------------------------------------------------------
+    // Getters
+    //-------------------------------------------------------------------------------------------------
+
+    //! Returns the width and height of a face, in pixels
+    int faceSize() const { return m_iFaceSize; }
+
+    //! Returns the pan and tilt of face iFace as euler angles in radians, tilt in X and pan in Y
+    static Math::CVector3 faceAngles(int iFace);
+
+    //! Returns the texel seen in direction (fX, fY, fZ) of the pan and tilt frame, the direction needs not be normalized
+    inline const float* texel(float fX, float fY, float fZ) const
+    {
+        float fAbsX = fabsf(fX);
+        float fAbsY = fabsf(fY);
+        float fAbsZ = fabsf(fZ);
+
+        // The face is the one of the major axis, whose front vector is that axis
+        int iFace;
+        float fMajor;
+
+        if (fAbsX >= fAbsY && fAbsX >= fAbsZ)
+        {
+            iFace = m_iFaceOfAxis[0][fX < 0.0f ? 1 : 0];
+            fMajor = fAbsX;
+        }
+        else if (fAbsY >= fAbsZ)
+        {
+            iFace = m_iFaceOfAxis[1][fY < 0.0f ? 1 : 0];
+            fMajor = fAbsY;
+        }
+        else
+        {
+            iFace = m_iFaceOfAxis[2][fZ < 0.0f ? 1 : 0];
+            fMajor = fAbsZ;
+        }
+
+        const float* pRight = m_fRight[iFace];
+        const float* pUp = m_fUp[iFace];
+
+        float fScale = (0.5f * (float) m_iFaceSize) / fMajor;
+        float fHalfSize = 0.5f * (float) m_iFaceSize;
+
+        // Rows start at the bottom, as OpenGL reads them
+        int iColumn = (int) ((fX * pRight[0] + fY * pRight[1] + fZ * pRight[2]) * fScale + fHalfSize);
+        int iRow = (int) ((fX * pUp[0] + fY * pUp[1] + fZ * pUp[2]) * fScale + fHalfSize);
+
+        if (iColumn >= m_iFaceSize) iColumn = m_iFaceSize - 1;
+        if (iRow >= m_iFaceSize) iRow = m_iFaceSize - 1;
+        if (iColumn < 0) iColumn = 0;
+        if (iRow < 0) iRow = 0;
+
+        return m_vTexels.constData() + ((iFace * m_iFaceSize + iRow) * m_iFaceSize + iColumn) * DEPTH_CUBE_CHANNELS;
+    }
+
+    //-------------------------------------------------------------------------------------------------
+    // Control methods
+    //-------------------------------------------------------------------------------------------------
+
+    //! Makes the scene render into a float target of iFaceSize pixels, returns false if it cannot be created
+    bool begin(int iFaceSize);
+
+    //! Starts reading face iFace, which the scene has just rendered
+    void readFace(int iFace);
+
+    //! Waits for the reads and copies the faces to memory, the scene renders into its surface again
+    void end();
+
+    //-------------------------------------------------------------------------------------------------
+    // Protected methods
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    //! Deletes the target and the pixel buffers
+    void clear();
+
+    //-------------------------------------------------------------------------------------------------
+    // Properties
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    CGLScene*                   m_pScene;
+    QOpenGLFramebufferObject*   m_pTarget;
+    GLuint                      m_iPBO [DEPTH_CUBE_FACES];
+    int                         m_iFaceSize;
+    int                         m_iFaceOfAxis [3][2];               // Face looking along +X, -X, +Y, -Y, +Z and -Z
+    float                       m_fRight [DEPTH_CUBE_FACES][3];     // Right vector of each face in the pan and tilt frame
+    float                       m_fUp [DEPTH_CUBE_FACES][3];        // Up vector of each face in the pan and tilt frame
+    QVector<float>              m_vTexels;                          // The faces, one after the other
+};
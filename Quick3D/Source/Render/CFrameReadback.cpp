@@ -0,0 +1,183 @@
+
+// Std
+#include <string.h>
+
+// Application
+#include "CFrameReadback.h"
+#include "C3DScene.h"
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    \class CFrameReadback
+    \brief Reads a rectangle of the frame buffer back without waiting for the GPU.
+    \inmodule Quick3D
+    \sa CViewport
+
+    Each read copies the rectangle into one of FRAME_READBACK_BUFFERS pixel pack buffers, which returns at once.
+    The buffer is mapped when its turn comes again, so the GPU has had FRAME_READBACK_BUFFERS - 1 frames to fill it,
+    and frame() lags that many reads behind the rendered frame. \br\br
+    Pixels are read as 32 bit BGRA words, the layout of QImage::Format_RGB32, so that mapping only needs one copy
+    which also flips the rows. \br\br
+    Without pixel buffer support, reads are synchronous.
+*/
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Constructs a CFrameReadback for \a pScene.
+*/
+CFrameReadback::CFrameReadback(C3DScene* pScene)
+    : m_pScene(pScene)
+    , m_iNext(0)
+{
+    for (int iIndex = 0; iIndex < FRAME_READBACK_BUFFERS; iIndex++)
+    {
+        m_iPBO[iIndex] = 0;
+        m_bPending[iIndex] = false;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Destroys a CFrameReadback.
+*/
+CFrameReadback::~CFrameReadback()
+{
+    if (m_iPBO[0] != 0)
+    {
+        m_pScene->makeCurrentRenderingContext();
+    }
+
+    clear();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Starts reading \a rRect of the current frame buffer, whose height is \a iFrameHeight.
+    \a rRect has its origin at the top-left corner of the frame buffer. \br\br
+    Returns \c true if frame() has been replaced by a frame read earlier.
+    A change of rectangle size drops the reads in progress.
+*/
+bool CFrameReadback::read(const QRect& rRect, int iFrameHeight)
+{
+    if (rRect.width() <= 0 || rRect.height() <= 0)
+    {
+        return false;
+    }
+
+    // OpenGL rows start at the bottom
+    QRect rGLRect(rRect.x(), iFrameHeight - rRect.y() - rRect.height(), rRect.width(), rRect.height());
+
+    if (m_pScene->glExtension()->hasPixelBuffers() == false)
+    {
+        return readDirect(rGLRect);
+    }
+
+    if (rRect.size() != m_sSize)
+    {
+        createBuffers(rRect.size());
+    }
+
+    bool bNewFrame = false;
+
+    GL_glBindBuffer(GL_PIXEL_PACK_BUFFER, m_iPBO[m_iNext]);
+
+    // The oldest read of the ring, the GPU has finished it
+    if (m_bPending[m_iNext])
+    {
+        const uchar* pData = (const uchar*) GL_glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+
+        if (pData != nullptr)
+        {
+            // A new image, the previous one may still be encoded by a streamer
+            QImage imgFrame(m_sSize, QImage::Format_RGB32);
+            int iLineBytes = m_sSize.width() * 4;
+
+            for (int iLine = 0; iLine < m_sSize.height(); iLine++)
+            {
+                memcpy(imgFrame.scanLine(m_sSize.height() - 1 - iLine), pData + iLine * iLineBytes, iLineBytes);
+            }
+
+            m_imgFrame = imgFrame;
+            bNewFrame = true;
+        }
+
+        GL_glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+
+        m_bPending[m_iNext] = false;
+    }
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(rGLRect.x(), rGLRect.y(), rGLRect.width(), rGLRect.height(), GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, nullptr);
+
+    GL_glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    m_bPending[m_iNext] = true;
+    m_iNext = (m_iNext + 1) % FRAME_READBACK_BUFFERS;
+
+    return bNewFrame;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Deletes the pixel buffers and forgets the reads in progress. frame() is kept.
+*/
+void CFrameReadback::clear()
+{
+    if (m_iPBO[0] != 0)
+    {
+        GL_glDeleteBuffers(FRAME_READBACK_BUFFERS, m_iPBO);
+    }
+
+    for (int iIndex = 0; iIndex < FRAME_READBACK_BUFFERS; iIndex++)
+    {
+        m_iPBO[iIndex] = 0;
+        m_bPending[iIndex] = false;
+    }
+
+    m_iNext = 0;
+    m_sSize = QSize();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Creates the pixel buffers for frames of size \a sSize.
+*/
+void CFrameReadback::createBuffers(const QSize& sSize)
+{
+    clear();
+
+    GL_glGenBuffers(FRAME_READBACK_BUFFERS, m_iPBO);
+
+    for (int iIndex = 0; iIndex < FRAME_READBACK_BUFFERS; iIndex++)
+    {
+        GL_glBindBuffer(GL_PIXEL_PACK_BUFFER, m_iPBO[iIndex]);
+        GL_glBufferData(GL_PIXEL_PACK_BUFFER, sSize.width() * sSize.height() * 4, nullptr, GL_STREAM_READ);
+    }
+
+    GL_glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    m_sSize = sSize;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Reads \a rGLRect into frame(), waiting for the GPU to finish the frame.
+*/
+bool CFrameReadback::readDirect(const QRect& rGLRect)
+{
+    QImage imgFrame(rGLRect.size(), QImage::Format_RGB32);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(rGLRect.x(), rGLRect.y(), rGLRect.width(), rGLRect.height(), GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, imgFrame.bits());
+
+    m_imgFrame = imgFrame.mirrored();
+
+    return true;
+}
@@ -0,0 +1,80 @@
+
+#pragma once
+
+// Qt
+#include <QImage>
+#include <QRect>
+
+// Application
+#include "quick3d_global.h"
+#include "CGLExtension.h"
+
+//-------------------------------------------------------------------------------------------------
+// Forward declarations
+
+class C3DScene;
+
+//-------------------------------------------------------------------------------------------------
+
+//! Number of pixel buffers in the ring, a frame is mapped this number of reads minus one after it was read
+#define FRAME_READBACK_BUFFERS  3
+
+//-------------------------------------------------------------------------------------------------
+
+//! Reads a rectangle of the frame buffer back through a ring of pixel buffer objects
+class QUICK3D_EXPORT CFrameReadback
+{
+public:
+
+    //-------------------------------------------------------------------------------------------------
+    // Constructors and destructor
+    //-------------------------------------------------------------------------------------------------
+
+    //! Constructor
+    CFrameReadback(C3DScene* pScene);
+
+    //! Destructor
+    virtual ~CFrameReadback();
+
+    //-------------------------------------------------------------------------------------------------
+    // Getters
+    //-------------------------------------------------------------------------------------------------
+
+    //! Returns the last frame read back, top row first
+    const QImage& frame() const { return m_imgFrame; }
+
+    //-------------------------------------------------------------------------------------------------
+    // Control methods
+    //-------------------------------------------------------------------------------------------------
+
+    //! Starts reading rRect of the frame buffer, given with a top-left origin, returns true if frame() holds a new frame
+    bool read(const QRect& rRect, int iFrameHeight);
+
+    //! Deletes the pixel buffers and forgets the reads in progress
+    void clear();
+
+    //-------------------------------------------------------------------------------------------------
+    // Protected methods
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    //! Creates the pixel buffers for frames of size sSize
+    void createBuffers(const QSize& sSize);
+
+    //! Reads rGLRect directly into frame(), when pixel buffers are not available
+    bool readDirect(const QRect& rGLRect);
+
+    //-------------------------------------------------------------------------------------------------
+    // Properties
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    C3DScene*       m_pScene;
+    GLuint          m_iPBO [FRAME_READBACK_BUFFERS];
+    bool            m_bPending [FRAME_READBACK_BUFFERS];    // Buffers holding a read not mapped yet
+    int             m_iNext;                                // Buffer used by the next read
+    QSize           m_sSize;                                // Size of the buffered frames
+    QImage          m_imgFrame;
+};
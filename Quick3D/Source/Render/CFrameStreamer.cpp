@@ -0,0 +1,126 @@
+
+// Qt
+#include <QMutexLocker>
+
+// Application
+#include "CFrameStreamer.h"
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    \class CFrameStreamer
+    \brief Encodes and sends frames to an MJPEG server in a worker thread.
+    \inmodule Quick3D
+    \sa CViewport, CFrameReadback
+
+    The server and its connections live in a worker thread, where CMJPEGServer::sendImage() does the JPEG encoding.
+    The rendering thread only queues frames with submit(), which never waits. \br\br
+    At most FRAME_STREAMER_QUEUE_SIZE frames wait for the encoder. When it lags, the oldest waiting frame is dropped,
+    so that clients always get the most recent frames.
+*/
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Constructs a CFrameStreamer whose server listens on \a iPort, and starts its thread.
+*/
+CFrameStreamer::CFrameStreamer(int iPort)
+    : m_pServer(new CMJPEGServer(iPort))
+    , m_bSendScheduled(false)
+    , m_iSentCount(0)
+    , m_iDroppedCount(0)
+{
+    m_pServer->moveToThread(&m_tThread);
+
+    // The server is the context, so frames are sent in its thread
+    connect(this, &CFrameStreamer::frameQueued, m_pServer, [this]() { sendFrames(); }, Qt::QueuedConnection);
+
+    m_tThread.start(QThread::LowPriority);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Destroys a CFrameStreamer, dropping the waiting frames.
+*/
+CFrameStreamer::~CFrameStreamer()
+{
+    m_tThread.quit();
+    m_tThread.wait();
+
+    delete m_pServer;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+qint64 CFrameStreamer::sentCount()
+{
+    QMutexLocker locker(&m_mMutex);
+
+    return m_iSentCount;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+qint64 CFrameStreamer::droppedCount()
+{
+    QMutexLocker locker(&m_mMutex);
+
+    return m_iDroppedCount;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Queues \a imgFrame for sending. The image is shared, not copied, and must not be modified afterwards.
+*/
+void CFrameStreamer::submit(const QImage& imgFrame)
+{
+    QMutexLocker locker(&m_mMutex);
+
+    if (m_lFrames.count() >= FRAME_STREAMER_QUEUE_SIZE)
+    {
+        m_lFrames.removeFirst();
+        m_iDroppedCount++;
+    }
+
+    m_lFrames.append(imgFrame);
+
+    if (m_bSendScheduled == false)
+    {
+        m_bSendScheduled = true;
+
+        emit frameQueued();
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Sends the waiting frames, oldest first. Runs in the worker thread.
+*/
+void CFrameStreamer::sendFrames()
+{
+    forever
+    {
+        QImage imgFrame;
+
+        {
+            QMutexLocker locker(&m_mMutex);
+
+            if (m_lFrames.count() == 0)
+            {
+                m_bSendScheduled = false;
+                return;
+            }
+
+            imgFrame = m_lFrames.takeFirst();
+        }
+
+        m_pServer->sendImage(imgFrame);
+
+        QMutexLocker locker(&m_mMutex);
+
+        m_iSentCount++;
+    }
+}
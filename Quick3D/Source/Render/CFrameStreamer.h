@@ -0,0 +1,84 @@
+
+#pragma once
+
+// Qt
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QImage>
+#include <QList>
+
+// qt-plus
+#include "CMJPEGServer.h"
+
+// Application
+#include "quick3d_global.h"
+
+//-------------------------------------------------------------------------------------------------
+
+//! Number of frames waiting for the encoder, the oldest one is dropped when a frame arrives on a full queue
+#define FRAME_STREAMER_QUEUE_SIZE   2
+
+//-------------------------------------------------------------------------------------------------
+
+//! Encodes and sends frames to an MJPEG server in a worker thread
+class QUICK3D_EXPORT CFrameStreamer : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    //-------------------------------------------------------------------------------------------------
+    // Constructors and destructor
+    //-------------------------------------------------------------------------------------------------
+
+    //! Constructor, the server listens on iPort
+    CFrameStreamer(int iPort);
+
+    //! Destructor, stops the thread
+    virtual ~CFrameStreamer();
+
+    //-------------------------------------------------------------------------------------------------
+    // Getters
+    //-------------------------------------------------------------------------------------------------
+
+    //! Returns the number of frames sent to the server
+    qint64 sentCount();
+
+    //! Returns the number of frames dropped because the encoder lagged
+    qint64 droppedCount();
+
+    //-------------------------------------------------------------------------------------------------
+    // Control methods
+    //-------------------------------------------------------------------------------------------------
+
+    //! Queues imgFrame for sending, never waits for the encoder
+    void submit(const QImage& imgFrame);
+
+    //-------------------------------------------------------------------------------------------------
+    // Protected methods
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    //! Sends the queued frames, in the worker thread
+    void sendFrames();
+
+signals:
+
+    void frameQueued();
+
+    //-------------------------------------------------------------------------------------------------
+    // Properties
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    QThread             m_tThread;
+    CMJPEGServer*       m_pServer;              // Lives in m_tThread, encodes in sendImage()
+    QMutex              m_mMutex;               // Protects the members below
+    QList<QImage>       m_lFrames;              // Frames waiting for the encoder, oldest first
+    bool                m_bSendScheduled;
+    qint64              m_iSentCount;
+    qint64              m_iDroppedCount;
+};
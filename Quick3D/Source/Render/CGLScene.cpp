@@ -0,0 +1,527 @@
+
+// Qt
+#include <QElapsedTimer>
+
+// qt-plus
+#include "CLogger.h"
+
+// Application
+#include "CVector3.h"
+#include "CGLScene.h"
+#include "CRessourcesManager.h"
+#include "CTreeGenerator.h"
+#include "CBuildingGenerator.h"
+#include "CDepthCube.h"
+
+//-------------------------------------------------------------------------------------------------
+
+using namespace Math;
+
+//-------------------------------------------------------------------------------------------------
+
+#define ATMOSPHERE_ALTITUDE     100000.0
+
+//-------------------------------------------------------------------------------------------------
+
+CGLScene::CGLScene(bool bForDisplay)
+    : C3DScene(bForDisplay)
+    , m_pRenderTarget(nullptr)
+    , m_pDepthCube(nullptr)
+{
+}
+
+//-------------------------------------------------------------------------------------------------
+
+CGLScene::~CGLScene()
+{
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CGLScene::createRenderingResources()
+{
+    m_pGLExtension = new CGLExtension();
+    m_pRessourcesManager = new CRessourcesManager(this);
+    m_pBuildingGenerator = new CBuildingGenerator(this);
+    m_pTreeGenerator = new CTreeGenerator(this);
+    m_vShaders = new CShaderCollection();
+
+    CMaterial* pMaterial = new CMaterial(this);
+    pMaterial->diffuse() = CVector4(1.0, 0.0, 0.0, 1.0);
+    pMaterial->setLines(true);
+    m_pSegments->setMaterial(QSP<CMaterial>(pMaterial));
+    m_pSegments->setGLType(GL_LINES);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+CDepthCube* CGLScene::depthCube()
+{
+    if (m_pDepthCube == nullptr)
+    {
+        m_pDepthCube = new CDepthCube(this);
+    }
+
+    return m_pDepthCube;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CGLScene::bindSurface()
+{
+    QOpenGLFramebufferObject::bindDefault();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CGLScene::bindRenderTarget()
+{
+    makeCurrentRenderingContext();
+
+    if (m_pRenderTarget != nullptr)
+    {
+        m_pRenderTarget->bind();
+    }
+    else
+    {
+        bindSurface();
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CGLScene::renderFrame()
+{
+    if (m_bForDisplay)
+    {
+        m_tStatistics.reset();
+
+        bindRenderTarget();
+
+        //-------------------------------------------------------------------------------------------------
+        // Clear frame buffer
+
+        if (m_bDepthComputing)
+        {
+            glClearColor(1.0, 1.0, 1.0, 1.0);
+        }
+        else
+        {
+            glClearColor(m_tFog.color().X, m_tFog.color().Y, m_tFog.color().Z, 1.0);
+        }
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        //-------------------------------------------------------------------------------------------------
+        // Hold the simulation, components are drawn between their last two steps
+
+        beginInterpolation();
+
+        //-------------------------------------------------------------------------------------------------
+        // Compute world origin
+
+        if (m_pViewports.count() > 0 && m_pViewports[0]->camera())
+        {
+            m_vWorldOrigin = m_pViewports[0]->camera()->worldPosition();
+
+            m_vWorldOrigin.X = m_vWorldOrigin.X - fmod(m_vWorldOrigin.X, 1000.0);
+            m_vWorldOrigin.Y = m_vWorldOrigin.Y - fmod(m_vWorldOrigin.Y, 1000.0);
+            m_vWorldOrigin.Z = m_vWorldOrigin.Z - fmod(m_vWorldOrigin.Z, 1000.0);
+        }
+
+        //-------------------------------------------------------------------------------------------------
+        // Render cameras
+
+        foreach (int iIndex, m_pViewports.keys())
+        {
+            if (m_pViewports[iIndex]->isEnabled() && m_pViewports[iIndex]->camera())
+            {
+                m_pViewports[iIndex]->camera()->render(this, m_pViewports[iIndex], m_bforceWideFOV, m_bforceSmallFOV, m_bForceIR, m_bOverlookScene);
+            }
+        }
+
+        endInterpolation();
+
+        //-------------------------------------------------------------------------------------------------
+        // Read back the viewports whose frames are used, the frames are mapped a few paints later
+
+        QElapsedTimer tTimer;
+        tTimer.start();
+
+        foreach (int iIndex, m_pViewports.keys())
+        {
+            if (m_pViewports[iIndex]->isEnabled() && (m_pViewports[iIndex]->streamView() || m_pViewports[iIndex]->needFrameBuffer()))
+            {
+                m_pViewports[iIndex]->readFrame(renderSize());
+                m_tStatistics.m_iNumReadbacks++;
+            }
+        }
+
+        m_tStatistics.m_iReadbackTimeUS = tTimer.nsecsElapsed() / 1000;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CGLScene::init(QVector<QSP<CComponent> > vComponents)
+{
+    LOG_METHOD_DEBUG("");
+
+    if (m_bForDisplay)
+    {
+        makeCurrentRenderingContext();
+
+        initShaders();
+    }
+
+    C3DScene::init(vComponents);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CGLScene::initShaders()
+{
+    bool bResult = false;
+    LOG_METHOD_DEBUG("");
+
+    m_vShaders->clear();
+
+    if (m_bForDisplay)
+    {
+        makeCurrentRenderingContext();
+
+        setlocale(LC_NUMERIC, "C");
+
+        //-----------------------------------------------
+        // Standard mesh
+
+        bResult = tryAddShaderProgram_VGF(SP_Standard_Mesh,
+                                ":/Resources/Shaders/GLSL4/VS_Standard.c",
+                                ":/Resources/Shaders/GLSL4/GS_Standard_Triangle.c",
+                                ":/Resources/Shaders/GLSL4/FS_Standard.c"
+                                );
+
+        if (bResult == false)
+        {
+            tryAddShaderProgram_VF(SP_Standard_Mesh,
+                                    ":/Resources/Shaders/GLSL1/VS_Standard.c",
+                                    ":/Resources/Shaders/GLSL1/FS_Standard.c"
+                                    );
+        }
+
+        //-----------------------------------------------
+        // Standard billboard
+
+        bResult = tryAddShaderProgram_VGF(SP_Standard_Billboard,
+                                ":/Resources/Shaders/GLSL4/VS_Standard.c",
+                                ":/Resources/Shaders/GLSL4/GS_Standard_Billboard.c",
+                                ":/Resources/Shaders/GLSL4/FS_Standard.c"
+                                );
+
+        if (bResult == false)
+        {
+            tryAddShaderProgram_VF(SP_Standard_Billboard,
+                                    ":/Resources/Shaders/GLSL1/VS_Standard.c",
+                                    ":/Resources/Shaders/GLSL1/FS_Standard.c"
+                                    );
+        }
+
+        //-----------------------------------------------
+        // Standard lines
+
+        bResult = tryAddShaderProgram_VGF(SP_Special_Lines,
+                                ":/Resources/Shaders/GLSL4/VS_Standard.c",
+                                ":/Resources/Shaders/GLSL4/GS_Standard_Line.c",
+                                ":/Resources/Shaders/GLSL4/FS_Special_Line.c"
+                                );
+
+        if (bResult == false)
+        {
+            tryAddShaderProgram_VF(SP_Special_Lines,
+                                    ":/Resources/Shaders/GLSL1/VS_Standard.c",
+                                    ":/Resources/Shaders/GLSL1/FS_Special_Line.c"
+                                    );
+        }
+
+        //-----------------------------------------------
+
+        setlocale(LC_ALL, "");
+    }
+
+    C3DScene::initShaders();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CGLScene::setupEnvironment(CRenderContext* pContext, QGLShaderProgram* pProgram, bool bBackgroundItem)
+{
+    if (m_bForDisplay)
+    {
+        CShaderLocations* pLocations = m_vShaders->locations(pProgram);
+
+        // Transfer all render parameters to active shader
+
+        pProgram->setUniformValue(pLocations->uniform(suResolution), QVector2D(renderSize().width(), renderSize().height()));
+        pProgram->setUniformValue(pLocations->uniform(suTime), (GLfloat) m_dTime);
+        pProgram->setUniformValue(pLocations->uniform(suShaderQuality), (GLfloat) m_dShaderQuality);
+        pProgram->setUniformValue(pLocations->uniform(suRenderingShadows), (GLint) m_bRenderingShadows);
+        pProgram->setUniformValue(pLocations->uniform(suNormalsOnly), (GLint) m_bNormalsOnly);
+
+        // Camera
+
+        CVector3 vCamTruePos = pContext->camera()->worldPosition();
+        CVector3 vCamPos = pContext->camera()->worldPosition() - m_vWorldOrigin;
+        CVector3 vCamRot = pContext->camera()->worldRotation();
+        CVector3 vWorldUp = pContext->camera()->worldPosition().normalized();
+
+        QMatrix4x4 mCameraMatrix;
+        mCameraMatrix.setToIdentity();
+        mCameraMatrix.rotate(Math::Angles::toDeg(vCamRot.Y), QVector3D(0, 1, 0));
+        mCameraMatrix.rotate(Math::Angles::toDeg(vCamRot.X), QVector3D(1, 0, 0));
+        mCameraMatrix.rotate(Math::Angles::toDeg(vCamRot.Z), QVector3D(0, 0, 1));
+
+        QVector3D vFront = (QVector3D(0.0, 0.0, 1.0) * mCameraMatrix) - (QVector3D(0.0, 0.0, 0.0) * mCameraMatrix);
+        QVector3D vUp = (QVector3D(0.0, 1.0, 0.0) * mCameraMatrix) - (QVector3D(0.0, 0.0, 0.0) * mCameraMatrix);
+
+        pProgram->setUniformValue(pLocations->uniform(suDepthComputing), m_bDepthComputing ? 1 : 0);
+
+        pProgram->setUniformValue(pLocations->uniform(suCameraTruePosition), QVector3D(vCamTruePos.X, vCamTruePos.Y, vCamTruePos.Z));
+        pProgram->setUniformValue(pLocations->uniform(suCameraPosition), QVector3D(vCamPos.X, vCamPos.Y, vCamPos.Z));
+        pProgram->setUniformValue(pLocations->uniform(suCameraDirection), QVector3D(vFront.x(), vFront.y(), vFront.z()));
+        pProgram->setUniformValue(pLocations->uniform(suCameraUp), QVector3D(vUp.x(), vUp.y(), vUp.z()));
+        pProgram->setUniformValue(pLocations->uniform(suWorldOrigin), QVector3D(m_vWorldOrigin.X, m_vWorldOrigin.Y, m_vWorldOrigin.Z));
+        pProgram->setUniformValue(pLocations->uniform(suWorldUp), QVector3D(vWorldUp.X, vWorldUp.Y, vWorldUp.Z));
+        pProgram->setUniformValue(pLocations->uniform(suCameraAltitude), (GLfloat) pContext->camera()->geoloc().Altitude);
+        pProgram->setUniformValue(pLocations->uniform(suAtmosphereAltitude), (GLfloat) ATMOSPHERE_ALTITUDE);
+
+        // Lights
+
+        pProgram->setUniformValue(pLocations->uniform(suGlobalAmbient), QVector3D(0.05, 0.05, 0.15));
+        pProgram->setUniformValue(pLocations->uniform(suShadowEnable), u_shadow_enable);
+
+        pProgram->setUniformValue(pLocations->uniform(suNumLights), (GLint) iOpenGLLightIndex);
+        pProgram->setUniformValueArray(pLocations->uniform(suLightIsSun), u_light_is_sun, MAX_GL_LIGHTS);
+        pProgram->setUniformValueArray(pLocations->uniform(suLightPosition), u_light_position, MAX_GL_LIGHTS);
+        pProgram->setUniformValueArray(pLocations->uniform(suLightScreenPosition), u_light_screen_position, MAX_GL_LIGHTS);
+        pProgram->setUniformValueArray(pLocations->uniform(suLightDirection), u_light_direction, MAX_GL_LIGHTS);
+        pProgram->setUniformValueArray(pLocations->uniform(suLightColor), u_light_color, MAX_GL_LIGHTS);
+        pProgram->setUniformValueArray(pLocations->uniform(suLightDistanceToCamera), u_light_distance_to_camera, MAX_GL_LIGHTS, 1);
+        pProgram->setUniformValueArray(pLocations->uniform(suLightDistance), u_light_distance, MAX_GL_LIGHTS, 1);
+        pProgram->setUniformValueArray(pLocations->uniform(suLightSpotAngle), u_light_spot_angle, MAX_GL_LIGHTS, 1);
+        pProgram->setUniformValueArray(pLocations->uniform(suLightOcclusion), u_light_occlusion, MAX_GL_LIGHTS, 1);
+
+        pProgram->setUniformValue(pLocations->uniform(suFogEnable), (GLint) m_tFog.enabled() ? 1 : 0);
+        pProgram->setUniformValue(pLocations->uniform(suFogDistance), (GLfloat) m_tFog.distance());
+        pProgram->setUniformValue(pLocations->uniform(suFogColor), QVector3D(m_tFog.color().X, m_tFog.color().Y, m_tFog.color().Z));
+        pProgram->setUniformValue(pLocations->uniform(suSunColor), vSunColor);
+    }
+
+    C3DScene::setupEnvironment(pContext, pProgram, bBackgroundItem);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CGLScene::setupLights(CRenderContext* pContext)
+{
+    if (m_bForDisplay)
+    {
+        m_tFog.color() = CVector3(0.2, 0.6, 1.0);
+
+        double dNormalizedTime = fabs(((double) m_tTimeOfDay.secsTo(QTime(0, 0, 0)) /  86400.0));
+        double dSunAngle = (dNormalizedTime * -360.0) + 180.0;
+
+        CGeoloc gSunPosition(0.0, dSunAngle, 100000000.0);
+        CVector3 vSunPosition = gSunPosition.toVector3();
+
+        // Compute sun intensity
+        m_dSunIntensity = vSunPosition.normalized().dot(pContext->camera()->worldPosition().normalized());
+        m_dSunIntensity = (m_dSunIntensity + 1.0) * 0.5;
+
+        if (pContext->camera()->geoloc().Altitude < 0.0)
+        {
+            double dSeaFactor = 1.0 - (fabs(pContext->camera()->geoloc().Altitude) / 1000.0);
+            if (dSeaFactor < 0.1) dSeaFactor = 0.1;
+            m_dSunIntensity *= dSeaFactor;
+        }
+
+        double dAtmosphereFactor = (ATMOSPHERE_ALTITUDE - pContext->camera()->geoloc().Altitude) / ATMOSPHERE_ALTITUDE;
+        if (dAtmosphereFactor < 0.0) dAtmosphereFactor = 0.0;
+        if (dAtmosphereFactor > 1.0) dAtmosphereFactor = 1.0;
+
+        // Compute fog distance
+        m_tFog.distance() = (1.0 - m_tFog.level()) * pContext->camera()->maxDistance();
+
+        // Underwater fog
+        if (pContext->camera()->geoloc().Altitude < 0.0)
+        {
+            m_tFog.distance() = 1000.0;
+        }
+
+        m_dSunIntensity = Math::Angles::_max(m_dSunIntensity, 1.0 - dAtmosphereFactor);
+
+        QVector<QSP<CLight> > vLights = lights();
+        QVector<QSP<CLight> > vSuns = lightsByTag("SUN");
+
+        if (vSuns.count() > 0)
+        {
+            vSuns[0]->setPosition(vSunPosition);
+
+            if (pContext->camera()->geoloc().Altitude >= 0.0)
+            {
+                vSuns[0]->material()->diffuse() = m_iSunColor.getValue(m_dSunIntensity);
+            }
+            else
+            {
+                vSuns[0]->material()->diffuse() = CVector4(0.00, 0.25, 0.50, 1.00);
+            }
+        }
+
+        // Multiply fog color with sun intensity
+        m_tFog.color() = m_tFog.color() * m_dSunIntensity;
+
+        if (vSuns.count() > 0)
+        {
+            CVector4 vColor = vSuns[0]->material()->diffuse();
+            vSunColor = QVector3D(vColor.X, vColor.Y, vColor.Z);
+        }
+        else
+        {
+            vSunColor = QVector3D();
+        }
+
+        iOpenGLLightIndex = 0;
+
+        for (int iLightIndex = 0; iLightIndex < vLights.count() && iOpenGLLightIndex < MAX_GL_LIGHTS; iLightIndex++)
+        {
+            CVector4 vColor = vLights[iLightIndex]->material()->diffuse();
+
+            if (vColor.X != 0.0 || vColor.Y != 0.0 || vColor.Z != 0.0)
+            {
+                CVector3 vLightPosition = vLights[iLightIndex]->worldPosition();
+                CVector3 vWorldPosition = vLightPosition - m_vWorldOrigin;
+                CVector3 vWorldDirection = vLights[iLightIndex]->worldDirection();
+
+                double dLightDistance = (vLightPosition - pContext->camera()->worldPosition()).magnitude();
+
+                if (vLights[iLightIndex]->tag() == "SUN" || dLightDistance < 2000.0)
+                {
+                    QVector4D vRelativePosition(vWorldPosition.X, vWorldPosition.Y, vWorldPosition.Z, 1.0);
+                    vRelativePosition = pContext->cameraMatrix() * vRelativePosition;
+                    QVector4D vProjectedPosition = pContext->cameraProjectionMatrix() * vRelativePosition;
+                    if (vProjectedPosition.w() != 0.0)
+                    {
+                        vProjectedPosition.setX(vProjectedPosition.x() / (vProjectedPosition.w() * 2.0) + 0.5);
+                        vProjectedPosition.setY(vProjectedPosition.y() / (vProjectedPosition.w() * 2.0) + 0.5);
+                        vProjectedPosition.setZ(vProjectedPosition.z() / (vProjectedPosition.w() * 2.0));
+                    }
+                    CVector3 vScreenPosition(vProjectedPosition.x(), vProjectedPosition.y(), vProjectedPosition.z());
+
+                    if (vLights[iLightIndex]->tag() == "SUN")
+                    {
+                        vWorldDirection = CVector3();
+                    }
+
+                    u_light_is_sun[iOpenGLLightIndex]               = (GLint) (vLights[iLightIndex]->tag() == "SUN");
+                    u_light_position[iOpenGLLightIndex]             = QVector3D(vWorldPosition.X, vWorldPosition.Y, vWorldPosition.Z);
+                    u_light_screen_position[iOpenGLLightIndex]      = QVector3D(vScreenPosition.X, vScreenPosition.Y, vScreenPosition.Z);
+                    u_light_direction[iOpenGLLightIndex]            = QVector3D(vWorldDirection.X, vWorldDirection.Y, vWorldDirection.Z);
+                    u_light_color[iOpenGLLightIndex]                = QVector3D(vColor.X, vColor.Y, vColor.Z);
+                    u_light_distance_to_camera[iOpenGLLightIndex]   = (GLfloat) vRelativePosition.length();
+                    u_light_distance[iOpenGLLightIndex]             = (GLfloat) vLights[iLightIndex]->lightingDistance();
+                    u_light_spot_angle[iOpenGLLightIndex]           = (GLfloat) Math::Angles::toRad(vLights[iLightIndex]->verticalFOV());
+                    u_light_occlusion[iOpenGLLightIndex]            = (GLfloat) vLights[iLightIndex]->occlusion();
+
+                    iOpenGLLightIndex++;
+                }
+            }
+        }
+
+        if (m_dShaderQuality >= 0.90)
+        {
+            u_shadow_enable = (GLint) (vSuns.count() > 0 && vSuns[0]->castShadows());
+        }
+        else
+        {
+            u_shadow_enable = 0;
+        }
+
+        if (vSuns.count() > 0 && vSuns[0]->castShadows())
+        {
+            vSuns[0]->material()->activateShadow(pContext);
+        }
+
+        // Compute light occlusions
+        // computeLightsOcclusion(pContext);
+    }
+
+    C3DScene::setupLights(pContext);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CGLScene::computeLightsOcclusion(CRenderContext* pContext)
+{
+    QVector<QSP<CLight> > vLights = lights();
+
+    foreach (QSP<CLight> pLight, vLights)
+    {
+        CVector3 vToCamera = pContext->camera()->worldPosition() - pLight->worldPosition();
+
+        CRay3 aRay;
+        aRay.vOrigin = pLight->worldPosition();
+        aRay.vNormal = vToCamera.normalized();
+
+        bool bOccluded = pContext->scene()->intersectAny(aRay, vToCamera.magnitude());
+
+        pLight->setOcclusion(bOccluded ? 1.0 : 0.0);
+    }
+}
+
+bool CGLScene::tryAddShaderProgram_VF(const QString& sName, const QString& sVertexPath, const QString& sFragmentPath)
+{
+    QGLShaderProgram* pProgram = new QGLShaderProgram();
+
+    if (pProgram->addShaderFromSourceCode(QGLShader::Vertex, ressourcesManager()->getShaderByFilePathName(sVertexPath)) == false)
+        return false;
+
+    if (pProgram->addShaderFromSourceCode(QGLShader::Fragment, ressourcesManager()->getShaderByFilePathName(sFragmentPath)) == false)
+        return false;
+
+    if (pProgram->link())
+    {
+        m_vShaders->addShader(sName, pProgram);
+        qDebug() << QString("Using %1 for vertex shading").arg(sVertexPath);
+        qDebug() << QString("Using %1 for fragment shading").arg(sFragmentPath);
+        return true;
+    }
+
+    delete pProgram;
+    return false;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+bool CGLScene::tryAddShaderProgram_VGF(const QString& sName, const QString& sVertexPath, const QString& sGeometryPath, const QString& sFragmentPath)
+{
+    QGLShaderProgram* pProgram = new QGLShaderProgram();
+
+    if (pProgram->addShaderFromSourceCode(QGLShader::Vertex, ressourcesManager()->getShaderByFilePathName(sVertexPath)) == false)
+        return false;
+
+    if (pProgram->addShaderFromSourceCode(QGLShader::Geometry, ressourcesManager()->getShaderByFilePathName(sGeometryPath)) == false)
+        return false;
+
+    if (pProgram->addShaderFromSourceCode(QGLShader::Fragment, ressourcesManager()->getShaderByFilePathName(sFragmentPath)) == false)
+        return false;
+
+    if (pProgram->link())
+    {
+        m_vShaders->addShader(sName, pProgram);
+        qDebug() << QString("Using %1 for vertex shading").arg(sVertexPath);
+        qDebug() << QString("Using %1 for fragment shading").arg(sFragmentPath);
+        return true;
+    }
+
+    delete pProgram;
+    return false;
+}
@@ -0,0 +1,137 @@
+
+#pragma once
+
+// Qt
+#include <QImage>
+#include <QOpenGLFramebufferObject>
+#include <QSize>
+#include <QTime>
+
+// qt-plus
+#include "CInterpolator.h"
+
+// Application
+#include "quick3d_global.h"
+#include "CVector3.h"
+#include "CMatrix4.h"
+#include "C3DScene.h"
+#include "CMeshGeometry.h"
+
+//-------------------------------------------------------------------------------------------------
+// Forward declarations
+
+class CDepthCube;
+
+//-------------------------------------------------------------------------------------------------
+
+#define MAX_GL_LIGHTS   8
+
+//-------------------------------------------------------------------------------------------------
+
+//! Renders a scene with OpenGL into the surface of the current context, window or frame buffer object
+class QUICK3D_EXPORT CGLScene : public C3DScene
+{
+public:
+
+    //-------------------------------------------------------------------------------------------------
+    // Constructors and destructor
+    //-------------------------------------------------------------------------------------------------
+
+    //! Constructor, subclasses call createRenderingResources() once their context is current
+    CGLScene(bool bForDisplay = true);
+
+    //! Destructor
+    virtual ~CGLScene();
+
+    //-------------------------------------------------------------------------------------------------
+    // Inherited methods
+    //-------------------------------------------------------------------------------------------------
+
+    //!
+    virtual void init(QVector<QSP<CComponent> > vComponents);
+
+    //!
+    virtual void initShaders();
+
+    //!
+    virtual void setupEnvironment(CRenderContext* pContext, QGLShaderProgram* pProgram, bool bBackgroundItem);
+
+    //!
+    virtual void setupLights(CRenderContext* pContext);
+
+    //!
+    virtual void computeLightsOcclusion(CRenderContext* pContext);
+
+    //! Makes the context current and binds the render target, or the surface of the scene
+    virtual void bindRenderTarget();
+
+    //-------------------------------------------------------------------------------------------------
+    // Setters
+    //-------------------------------------------------------------------------------------------------
+
+    //! Renders into pTarget instead of the surface of the scene, nullptr restores the surface
+    void setRenderTarget(QOpenGLFramebufferObject* pTarget) { m_pRenderTarget = pTarget; }
+
+    //-------------------------------------------------------------------------------------------------
+    // Getters
+    //-------------------------------------------------------------------------------------------------
+
+    //! Returns the size of the surface rendered to, in pixels
+    virtual QSize renderSize() const = 0;
+
+    //! Returns the frame buffer rendered into instead of the surface, if any
+    QOpenGLFramebufferObject* renderTarget() const { return m_pRenderTarget; }
+
+    //! Returns the cube depth matrices are captured into, created at first use and kept for the next captures
+    CDepthCube* depthCube();
+
+    //-------------------------------------------------------------------------------------------------
+    // Control methods
+    //-------------------------------------------------------------------------------------------------
+
+    //! Sets the size of the surface rendered to, in pixels
+    virtual void setRenderSize(const QSize& sSize) = 0;
+
+    //! Renders the enabled viewports into the current surface
+    void renderFrame();
+
+    //! Try to add a shader program composed of vertex, geometry and fragment shading code
+    bool tryAddShaderProgram_VGF(const QString& sName, const QString& sVertexPath, const QString& sGeometryPath, const QString& sFragmentPath);
+
+    //! Try to add a shader program composed of vertex and fragment shading code
+    bool tryAddShaderProgram_VF(const QString& sName, const QString& sVertexPath, const QString& sFragmentPath);
+
+    //-------------------------------------------------------------------------------------------------
+    // Protected methods
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    //! Creates the OpenGL extensions, resource manager, generators and shader collection, the context must be current
+    void createRenderingResources();
+
+    //! Binds the surface of the scene, the default frame buffer of the context
+    virtual void bindSurface();
+
+    //-------------------------------------------------------------------------------------------------
+    // Properties
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    QOpenGLFramebufferObject*   m_pRenderTarget;    // Not owned, nullptr to render into the surface
+    CDepthCube*                 m_pDepthCube;       // Deleted by subclasses while their context is current
+
+    GLint           iOpenGLLightIndex;
+    GLint           u_shadow_enable;
+    GLint           u_light_is_sun [MAX_GL_LIGHTS];
+    QVector3D       u_light_position [MAX_GL_LIGHTS];
+    QVector3D       u_light_screen_position [MAX_GL_LIGHTS];
+    QVector3D       u_light_direction [MAX_GL_LIGHTS];
+    QVector3D       u_light_color [MAX_GL_LIGHTS];
+    GLfloat         u_light_distance_to_camera [MAX_GL_LIGHTS];
+    GLfloat         u_light_distance [MAX_GL_LIGHTS];
+    GLfloat         u_light_spot_angle [MAX_GL_LIGHTS];
+    GLfloat         u_light_occlusion [MAX_GL_LIGHTS];
+    QVector3D       vSunColor;
+};
@@ -0,0 +1,218 @@
+
+// qt-plus
+#include "CLogger.h"
+
+// Application
+#include "COffscreenScene.h"
+
+//-------------------------------------------------------------------------------------------------
+
+// Same buffers as the widget scene, the compatibility profile keeps the GLSL1 fallback usable
+static QSurfaceFormat sceneFormat()
+{
+    QSurfaceFormat tFormat;
+
+    tFormat.setDepthBufferSize(24);
+    tFormat.setStencilBufferSize(8);
+    tFormat.setProfile(QSurfaceFormat::CompatibilityProfile);
+
+    return tFormat;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    \class COffscreenScene
+    \brief Renders a scene into a frame buffer object, without a window.
+    \inmodule Quick3D
+    \sa CGLWidgetScene, CGLScene
+
+    The scene owns its OpenGL context, so several scenes can render at the same time, each one in its own thread. \br\br
+    A scene must be created and used in the same thread. Some platforms back offscreen surfaces with hidden windows,
+    in which case the surfaces are made in the GUI thread with createSurface() and given to the scenes. \br\br
+    On machines without a display, the application runs with an EGL based platform plugin, \c eglfs for instance,
+    which gives pbuffer or surfaceless contexts.
+*/
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Constructs a COffscreenScene rendering into a frame buffer of size \a sSize. \br\br
+    The scene uses \a pSurface, which it does not own, or creates its own surface if \a pSurface is \c nullptr.
+    If no context can be created, the scene is not valid and behaves as a scene that is not displayed.
+*/
+COffscreenScene::COffscreenScene(const QSize& sSize, QOffscreenSurface* pSurface)
+    : CGLScene(true)
+    , m_pSurface(pSurface)
+    , m_pContext(nullptr)
+    , m_pFrameBuffer(nullptr)
+    , m_bOwnsSurface(pSurface == nullptr)
+{
+    if (m_pSurface == nullptr)
+    {
+        m_pSurface = createSurface();
+    }
+
+    m_pContext = new QOpenGLContext();
+    m_pContext->setFormat(sceneFormat());
+
+    if (m_pSurface->isValid() && m_pContext->create() && m_pContext->makeCurrent(m_pSurface))
+    {
+        setRenderSize(sSize);
+    }
+
+    if (isValid())
+    {
+        createRenderingResources();
+    }
+    else
+    {
+        LOG_METHOD_ERROR("Could not create an offscreen OpenGL context");
+
+        m_bForDisplay = false;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Destroys a COffscreenScene, deleting its OpenGL objects while the context exists.
+*/
+COffscreenScene::~COffscreenScene()
+{
+    if (isValid())
+    {
+        makeCurrentRenderingContext();
+
+        clear();
+
+        delete m_pDepthCube;
+        m_pDepthCube = nullptr;
+
+        m_pSegments.reset();
+
+        delete m_pTreeGenerator;
+        m_pTreeGenerator = nullptr;
+
+        delete m_pBuildingGenerator;
+        m_pBuildingGenerator = nullptr;
+
+        delete m_pRessourcesManager;
+        m_pRessourcesManager = nullptr;
+
+        delete m_vShaders;
+        m_vShaders = nullptr;
+
+        delete m_pFrameBuffer;
+        m_pFrameBuffer = nullptr;
+
+        m_pContext->doneCurrent();
+    }
+
+    delete m_pContext;
+    m_pContext = nullptr;
+
+    if (m_bOwnsSurface)
+    {
+        delete m_pSurface;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+QSize COffscreenScene::renderSize() const
+{
+    return m_pFrameBuffer != nullptr ? m_pFrameBuffer->size() : QSize();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Recreates the frame buffer with size \a sSize, the previous frame is lost.
+    The current frame buffer stays in use if the new one cannot be created.
+*/
+void COffscreenScene::setRenderSize(const QSize& sSize)
+{
+    if (m_pFrameBuffer != nullptr && m_pFrameBuffer->size() == sSize)
+    {
+        return;
+    }
+
+    if (m_pContext->makeCurrent(m_pSurface))
+    {
+        QOpenGLFramebufferObject* pFrameBuffer = new QOpenGLFramebufferObject(sSize, QOpenGLFramebufferObject::CombinedDepthStencil);
+
+        // The previous frame buffer is kept if the new one cannot be made
+        if (pFrameBuffer->isValid())
+        {
+            delete m_pFrameBuffer;
+            m_pFrameBuffer = pFrameBuffer;
+        }
+        else
+        {
+            LOG_METHOD_ERROR(QString("Could not create a %1 x %2 frame buffer").arg(sSize.width()).arg(sSize.height()));
+
+            delete pFrameBuffer;
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Makes the context current if another one is.
+*/
+void COffscreenScene::makeCurrentRenderingContext()
+{
+    if (m_pFrameBuffer != nullptr && QOpenGLContext::currentContext() != m_pContext)
+    {
+        m_pContext->makeCurrent(m_pSurface);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Binds the frame buffer of the scene, which stands for a window surface.
+*/
+void COffscreenScene::bindSurface()
+{
+    if (m_pFrameBuffer != nullptr)
+    {
+        m_pFrameBuffer->bind();
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Renders the enabled viewports and returns the frame buffer contents.
+*/
+QImage COffscreenScene::renderImage()
+{
+    if (isValid() == false)
+    {
+        return QImage();
+    }
+
+    renderFrame();
+
+    makeCurrentRenderingContext();
+
+    return m_pFrameBuffer->toImage();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Creates a surface for a COffscreenScene. Call this in the GUI thread when scenes are created in other threads.
+*/
+QOffscreenSurface* COffscreenScene::createSurface()
+{
+    QOffscreenSurface* pSurface = new QOffscreenSurface();
+
+    pSurface->setFormat(sceneFormat());
+    pSurface->create();
+
+    return pSurface;
+}
@@ -0,0 +1,82 @@
+
+#pragma once
+
+// Qt
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+
+// Application
+#include "quick3d_global.h"
+#include "CGLScene.h"
+
+//-------------------------------------------------------------------------------------------------
+
+//! Renders a scene into a frame buffer object, without a window
+class QUICK3D_EXPORT COffscreenScene : public CGLScene
+{
+public:
+
+    //-------------------------------------------------------------------------------------------------
+    // Constructors and destructor
+    //-------------------------------------------------------------------------------------------------
+
+    //! Constructor, creates a context rendering into a frame buffer of size sSize, on pSurface if given
+    COffscreenScene(const QSize& sSize = QSize(512, 512), QOffscreenSurface* pSurface = nullptr);
+
+    //! Destructor
+    virtual ~COffscreenScene();
+
+    //-------------------------------------------------------------------------------------------------
+    // Getters
+    //-------------------------------------------------------------------------------------------------
+
+    //! Returns true if the context and frame buffer could be created
+    bool isValid() const { return m_pFrameBuffer != nullptr; }
+
+    //! Returns the context of the scene
+    QOpenGLContext* context() const { return m_pContext; }
+
+    //-------------------------------------------------------------------------------------------------
+    // Inherited methods
+    //-------------------------------------------------------------------------------------------------
+
+    //! Returns the size of the frame buffer
+    virtual QSize renderSize() const;
+
+    //! Recreates the frame buffer with size sSize
+    virtual void setRenderSize(const QSize& sSize);
+
+    //! Makes the context current
+    virtual void makeCurrentRenderingContext();
+
+    //-------------------------------------------------------------------------------------------------
+    // Control methods
+    //-------------------------------------------------------------------------------------------------
+
+    //! Renders a frame and returns it
+    QImage renderImage();
+
+    //! Creates a surface for a scene, in the GUI thread where some platforms require it
+    static QOffscreenSurface* createSurface();
+
+    //-------------------------------------------------------------------------------------------------
+    // Protected methods
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    //! Binds the frame buffer of the scene
+    virtual void bindSurface();
+
+    //-------------------------------------------------------------------------------------------------
+    // Properties
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    QOffscreenSurface*          m_pSurface;
+    QOpenGLContext*             m_pContext;
+    QOpenGLFramebufferObject*   m_pFrameBuffer;
+    bool                        m_bOwnsSurface;
+};
@@ -11,6 +11,10 @@ using namespace Math;
 
 //-------------------------------------------------------------------------------------------------
 
+QAtomicInt CRenderContext::m_iNextSerial(0);
+
+//-------------------------------------------------------------------------------------------------
+
 CRenderContext::CRenderContext(
         QMatrix4x4 cameraProjectionMatrix,
         QMatrix4x4 cameraMatrix,
@@ -31,9 +35,11 @@ CRenderContext::CRenderContext(
     , m_pCamera(pCamera)
     , m_pMeshByMaterial(new CMeshByMaterial())
     , m_pFog(nullptr)
+    , m_iSerial(m_iNextSerial.fetchAndAddOrdered(1))
     , bUseIR(false)
     , bUseInversePolarity(false)
     , pActiveMaterial(nullptr)
+    , iCurrentVBO(0)
 {
 }
 
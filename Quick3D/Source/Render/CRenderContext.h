@@ -4,6 +4,7 @@
 // Qt
 #include <QPainter>
 #include <QMatrix4x4>
+#include <QAtomicInt>
 
 // Application
 #include "quick3d_global.h"
@@ -58,12 +59,14 @@ public:
     CCamera*            camera()                    { return m_pCamera; }
     CFog*               fog()                       { return m_pFog; }
     CMeshByMaterial*    meshByMaterial()            { return m_pMeshByMaterial; }
+    int                 serial() const              { return m_iSerial; }
 
     void                addGeometry(CComponent* pContainer, CMeshGeometry* pGeometry);
 
     bool                bUseIR;
     bool                bUseInversePolarity;
     CMaterial*          pActiveMaterial;
+    GLuint              iCurrentVBO;                // Last VBO whose attributes were given to OpenGL in this pass, without vertex arrays
 
     C3DSceneStatistics  tStatistics;
 
@@ -79,5 +82,7 @@ protected:
     CMeshByMaterial*    m_pMeshByMaterial;
     CCamera*            m_pCamera;
     CFog*               m_pFog;
+    int                 m_iSerial;                  // Unique among contexts, tells shader programs when per context uniforms must be set
 
+    static QAtomicInt   m_iNextSerial;
 };
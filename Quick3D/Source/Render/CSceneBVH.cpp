@@ -0,0 +1,565 @@
+
+// Application
+#include "CSceneBVH.h"
+
+//-------------------------------------------------------------------------------------------------
+
+using namespace Math;
+
+//-------------------------------------------------------------------------------------------------
+
+// Maximum number of components in a leaf node
+#define BVH_LEAF_SIZE           4
+
+// Growth of the root area, since the last build, above which the tree is rebuilt instead of refit
+#define BVH_REBUILD_GROWTH      2.0
+
+// Depth of the traversal stack, a median split tree of 2^32 leaves is shallower
+#define BVH_STACK_SIZE          64
+
+//-------------------------------------------------------------------------------------------------
+
+// Orders leaves by the center of their bounds on one axis
+class CLeafCenterLessThan
+{
+public:
+
+    CLeafCenterLessThan(int iAxis)
+        : m_iAxis(iAxis)
+    {
+    }
+
+    bool operator()(const CSceneBVHLeaf& tFirst, const CSceneBVHLeaf& tSecond) const
+    {
+        return
+                tFirst.m_vMinimum[m_iAxis] + tFirst.m_vMaximum[m_iAxis] <
+                tSecond.m_vMinimum[m_iAxis] + tSecond.m_vMaximum[m_iAxis];
+    }
+
+protected:
+
+    int m_iAxis;
+};
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    \class CSceneBVH
+    \brief A bounding volume hierarchy over the raytracable components of a scene.
+    \inmodule Quick3D
+    \sa C3DScene::intersect(), C3DScene::intersectAny()
+
+    The tree holds the same components as those visited by C3DScene::intersectRecurse(), and a query
+    returns the same result as the walk, but only calls intersect() on components whose bounds the ray crosses.
+    Like the walk, the first component in visit order wins when two hits are at the same distance. \br
+    Components whose world bounds are empty, like CWorldTerrain, are kept aside and tested by every query. \br\br
+    update() is called once per frame by C3DScene::updateScene(). The nodes are refit to the moved components,
+    and the tree is rebuilt only when components were added or removed, or when the refit tree has grown too loose. \br
+    Queries may run concurrently from several threads, update() excludes them.
+*/
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Constructs a CSceneBVH.
+*/
+CSceneBVH::CSceneBVH()
+    : m_dBuildArea(0.0)
+    , m_iBuildCount(0)
+    , m_bValid(false)
+{
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Destroys a CSceneBVH.
+*/
+CSceneBVH::~CSceneBVH()
+{
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Releases all components and marks the tree as not valid, until the next call to update(). \br\br
+    Called when the component list of the scene changes, so that queries do not see removed components.
+*/
+void CSceneBVH::clear()
+{
+    QWriteLocker locker(&m_tLock);
+
+    m_vNodes.clear();
+    m_vLeaves.clear();
+    m_vUnbounded.clear();
+    m_vCollected.clear();
+    m_vSignature.clear();
+    m_vLeafOfVisit.clear();
+    m_dBuildArea = 0.0;
+    m_bValid = false;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Brings the tree up to date with the raytracable components of \a vComponents and, if \a bWithChildren is \c true, their children.
+*/
+void CSceneBVH::update(const QVector<QSP<CComponent> >& vComponents, bool bWithChildren)
+{
+    QWriteLocker locker(&m_tLock);
+
+    m_vCollected.resize(0);
+    m_vUnbounded.resize(0);
+
+    foreach (QSP<CComponent> pComponent, vComponents)
+    {
+        collectRecurse(pComponent, bWithChildren, m_vCollected, m_vUnbounded);
+    }
+
+    // Rebuild if the set of bounded components has changed
+    bool bRebuild = (m_bValid == false) || (m_vCollected.count() != m_vSignature.count());
+
+    for (int iIndex = 0; bRebuild == false && iIndex < m_vCollected.count(); iIndex++)
+    {
+        if (m_vCollected[iIndex].m_pComponent.data() != m_vSignature[iIndex])
+        {
+            bRebuild = true;
+        }
+    }
+
+    m_bValid = true;
+
+    if (bRebuild == false)
+    {
+        // Refit the leaves that moved
+        bool bMoved = false;
+
+        for (int iIndex = 0; iIndex < m_vCollected.count(); iIndex++)
+        {
+            CSceneBVHLeaf& tLeaf = m_vLeaves[m_vLeafOfVisit[iIndex]];
+            const CSceneBVHLeaf& tCollected = m_vCollected[iIndex];
+
+            // Unbounded components may have come or gone in between
+            tLeaf.m_iOrder = tCollected.m_iOrder;
+
+            if (tLeaf.m_vMinimum != tCollected.m_vMinimum || tLeaf.m_vMaximum != tCollected.m_vMaximum)
+            {
+                tLeaf.m_vMinimum = tCollected.m_vMinimum;
+                tLeaf.m_vMaximum = tCollected.m_vMaximum;
+                m_vNodes[tLeaf.m_iNode].m_bDirty = true;
+                bMoved = true;
+            }
+        }
+
+        if (bMoved)
+        {
+            refit();
+
+            bRebuild = rootArea() > m_dBuildArea * BVH_REBUILD_GROWTH;
+        }
+    }
+
+    if (bRebuild)
+    {
+        m_vLeaves = m_vCollected;
+        build();
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Returns the nearest intersection of \a ray with the components of the tree.
+*/
+RayTracingResult CSceneBVH::intersect(const CRay3& ray) const
+{
+    QReadLocker locker(&m_tLock);
+
+    RayTracingResult dReturnResult(Q3D_INFINITY);
+    int iBestOrder = -1;
+
+    // Keeps a hit if nearer, or as near but earlier in visit order
+    auto keep = [&](const CSceneBVHLeaf& tLeaf)
+    {
+        RayTracingResult dNewResult = tLeaf.m_pComponent->intersect(ray);
+
+        if (
+                dNewResult.m_dDistance < dReturnResult.m_dDistance ||
+                (iBestOrder >= 0 && dNewResult.m_dDistance == dReturnResult.m_dDistance && tLeaf.m_iOrder < iBestOrder)
+                )
+        {
+            dReturnResult = dNewResult;
+            iBestOrder = tLeaf.m_iOrder;
+        }
+    };
+
+    foreach (const CSceneBVHLeaf& tLeaf, m_vUnbounded)
+    {
+        keep(tLeaf);
+    }
+
+    if (m_vNodes.isEmpty())
+    {
+        return dReturnResult;
+    }
+
+    CVector3 vInverse = CBoundingBox::inverseDirection(ray.vNormal);
+    double dEntry = 0.0;
+
+    int vStack[BVH_STACK_SIZE];
+    double vStackEntry[BVH_STACK_SIZE];
+    int iStackSize = 0;
+
+    if (CBoundingBox::lineEntry(ray.vOrigin, vInverse, m_vNodes[0].m_vMinimum, m_vNodes[0].m_vMaximum, dReturnResult.m_dDistance, dEntry))
+    {
+        vStack[iStackSize] = 0;
+        vStackEntry[iStackSize] = dEntry;
+        iStackSize++;
+    }
+
+    while (iStackSize > 0)
+    {
+        iStackSize--;
+
+        // Skip nodes entered beyond the nearest hit found since they were pushed
+        if (vStackEntry[iStackSize] > dReturnResult.m_dDistance)
+        {
+            continue;
+        }
+
+        int iNodeIndex = vStack[iStackSize];
+        const CSceneBVHNode& tNode = m_vNodes[iNodeIndex];
+
+        if (tNode.m_iCount > 0)
+        {
+            for (int iLeaf = tNode.m_iFirst; iLeaf < tNode.m_iFirst + tNode.m_iCount; iLeaf++)
+            {
+                const CSceneBVHLeaf& tLeaf = m_vLeaves[iLeaf];
+
+                if (CBoundingBox::lineEntry(ray.vOrigin, vInverse, tLeaf.m_vMinimum, tLeaf.m_vMaximum, dReturnResult.m_dDistance, dEntry))
+                {
+                    keep(tLeaf);
+                }
+            }
+        }
+        else
+        {
+            int iLeft = iNodeIndex + 1;
+            int iRight = tNode.m_iFirst;
+            double dLeft = 0.0;
+            double dRight = 0.0;
+
+            bool bLeft = CBoundingBox::lineEntry(ray.vOrigin, vInverse, m_vNodes[iLeft].m_vMinimum, m_vNodes[iLeft].m_vMaximum, dReturnResult.m_dDistance, dLeft);
+            bool bRight = CBoundingBox::lineEntry(ray.vOrigin, vInverse, m_vNodes[iRight].m_vMinimum, m_vNodes[iRight].m_vMaximum, dReturnResult.m_dDistance, dRight);
+
+            // Push the farthest child first, so that the nearest is visited first
+            if (bLeft && bRight && dLeft > dRight)
+            {
+                qSwap(iLeft, iRight);
+                qSwap(dLeft, dRight);
+            }
+
+            if (bRight)
+            {
+                vStack[iStackSize] = iRight;
+                vStackEntry[iStackSize] = dRight;
+                iStackSize++;
+            }
+
+            if (bLeft)
+            {
+                vStack[iStackSize] = iLeft;
+                vStackEntry[iStackSize] = dLeft;
+                iStackSize++;
+            }
+        }
+    }
+
+    return dReturnResult;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Returns \c true if \a ray hits a component of the tree closer than \a dMaxDistance. \br\br
+    The traversal stops at the first hit found, which needs not be the nearest.
+*/
+bool CSceneBVH::intersectAny(const CRay3& ray, double dMaxDistance) const
+{
+    QReadLocker locker(&m_tLock);
+
+    foreach (const CSceneBVHLeaf& tLeaf, m_vUnbounded)
+    {
+        if (tLeaf.m_pComponent->intersect(ray).m_dDistance < dMaxDistance)
+        {
+            return true;
+        }
+    }
+
+    if (m_vNodes.isEmpty())
+    {
+        return false;
+    }
+
+    CVector3 vInverse = CBoundingBox::inverseDirection(ray.vNormal);
+    double dEntry = 0.0;
+
+    int vStack[BVH_STACK_SIZE];
+    int iStackSize = 0;
+
+    vStack[iStackSize++] = 0;
+
+    while (iStackSize > 0)
+    {
+        int iNodeIndex = vStack[--iStackSize];
+        const CSceneBVHNode& tNode = m_vNodes[iNodeIndex];
+
+        if (CBoundingBox::lineEntry(ray.vOrigin, vInverse, tNode.m_vMinimum, tNode.m_vMaximum, dMaxDistance, dEntry) == false)
+        {
+            continue;
+        }
+
+        if (tNode.m_iCount > 0)
+        {
+            for (int iLeaf = tNode.m_iFirst; iLeaf < tNode.m_iFirst + tNode.m_iCount; iLeaf++)
+            {
+                const CSceneBVHLeaf& tLeaf = m_vLeaves[iLeaf];
+
+                if (CBoundingBox::lineEntry(ray.vOrigin, vInverse, tLeaf.m_vMinimum, tLeaf.m_vMaximum, dMaxDistance, dEntry))
+                {
+                    if (tLeaf.m_pComponent->intersect(ray).m_dDistance < dMaxDistance)
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+        else
+        {
+            vStack[iStackSize++] = tNode.m_iFirst;
+            vStack[iStackSize++] = iNodeIndex + 1;
+        }
+    }
+
+    return false;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Adds \a pComponent to \a vLeaves, or to \a vUnbounded if it has no world bounds, and does the same for its children if \a bWithChildren is \c true.
+    Like C3DScene::intersectRecurse(), children of a component that is not raytracable are ignored. \br\br
+    The leaf bounds enclose the world bounds of the component in any orientation around its position,
+    since CComponent::worldBounds() is not rotated while CComponent::intersect() is.
+*/
+void CSceneBVH::collectRecurse(QSP<CComponent> pComponent, bool bWithChildren, QVector<CSceneBVHLeaf>& vLeaves, QVector<CSceneBVHLeaf>& vUnbounded)
+{
+    if (pComponent->isRaytracable() == false)
+    {
+        return;
+    }
+
+    CSceneBVHLeaf tLeaf;
+    tLeaf.m_pComponent = pComponent;
+    tLeaf.m_iOrder = vLeaves.count() + vUnbounded.count();
+
+    CBoundingBox bBounds = pComponent->worldBounds();
+    CVector3 vMinimum = bBounds.minimum();
+    CVector3 vMaximum = bBounds.maximum();
+
+    if (vMinimum.X < vMaximum.X || vMinimum.Y < vMaximum.Y || vMinimum.Z < vMaximum.Z)
+    {
+        CVector3 vPosition = pComponent->worldPosition();
+        CVector3 vExtent;
+
+        for (int iAxis = 0; iAxis < 3; iAxis++)
+        {
+            vExtent[iAxis] = qMax(fabs(vMinimum[iAxis] - vPosition[iAxis]), fabs(vMaximum[iAxis] - vPosition[iAxis]));
+        }
+
+        double dRadius = vExtent.magnitude();
+
+        tLeaf.m_vMinimum = vPosition - CVector3(dRadius, dRadius, dRadius);
+        tLeaf.m_vMaximum = vPosition + CVector3(dRadius, dRadius, dRadius);
+        tLeaf.m_iVisit = vLeaves.count();
+
+        vLeaves.append(tLeaf);
+    }
+    else
+    {
+        vUnbounded.append(tLeaf);
+    }
+
+    if (bWithChildren)
+    {
+        foreach (QSP<CComponent> pChild, pComponent->childComponents())
+        {
+            collectRecurse(pChild, bWithChildren, vLeaves, vUnbounded);
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Builds the nodes over the leaves, which are reordered so that each leaf node holds a contiguous range.
+*/
+void CSceneBVH::build()
+{
+    m_vNodes.resize(0);
+    m_vNodes.reserve(qMax(1, (m_vLeaves.count() * 2) / BVH_LEAF_SIZE + 1));
+
+    if (m_vLeaves.count() > 0)
+    {
+        buildRecurse(-1, 0, m_vLeaves.count());
+    }
+
+    m_vSignature.resize(m_vLeaves.count());
+    m_vLeafOfVisit.resize(m_vLeaves.count());
+
+    for (int iIndex = 0; iIndex < m_vLeaves.count(); iIndex++)
+    {
+        m_vSignature[m_vLeaves[iIndex].m_iVisit] = m_vLeaves[iIndex].m_pComponent.data();
+        m_vLeafOfVisit[m_vLeaves[iIndex].m_iVisit] = iIndex;
+    }
+
+    m_dBuildArea = rootArea();
+    m_iBuildCount++;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Builds a node over the \a iCount leaves starting at \a iFirst, child of \a iParent. \br\br
+    Leaves are split at the median of their centers, along the axis where the centers spread the most.
+*/
+int CSceneBVH::buildRecurse(int iParent, int iFirst, int iCount)
+{
+    int iNodeIndex = m_vNodes.count();
+
+    m_vNodes.append(CSceneBVHNode());
+    m_vNodes[iNodeIndex].m_iParent = iParent;
+
+    // Compute the node bounds and the spread of the leaf centers
+    CVector3 vMinimum = m_vLeaves[iFirst].m_vMinimum;
+    CVector3 vMaximum = m_vLeaves[iFirst].m_vMaximum;
+    CVector3 vCenterMinimum = (vMinimum + vMaximum) * 0.5;
+    CVector3 vCenterMaximum = vCenterMinimum;
+
+    for (int iLeaf = iFirst + 1; iLeaf < iFirst + iCount; iLeaf++)
+    {
+        const CSceneBVHLeaf& tLeaf = m_vLeaves[iLeaf];
+        CVector3 vCenter = (tLeaf.m_vMinimum + tLeaf.m_vMaximum) * 0.5;
+
+        for (int iAxis = 0; iAxis < 3; iAxis++)
+        {
+            vMinimum[iAxis] = qMin(vMinimum[iAxis], tLeaf.m_vMinimum[iAxis]);
+            vMaximum[iAxis] = qMax(vMaximum[iAxis], tLeaf.m_vMaximum[iAxis]);
+            vCenterMinimum[iAxis] = qMin(vCenterMinimum[iAxis], vCenter[iAxis]);
+            vCenterMaximum[iAxis] = qMax(vCenterMaximum[iAxis], vCenter[iAxis]);
+        }
+    }
+
+    m_vNodes[iNodeIndex].m_vMinimum = vMinimum;
+    m_vNodes[iNodeIndex].m_vMaximum = vMaximum;
+
+    if (iCount <= BVH_LEAF_SIZE)
+    {
+        m_vNodes[iNodeIndex].m_iFirst = iFirst;
+        m_vNodes[iNodeIndex].m_iCount = iCount;
+
+        for (int iLeaf = iFirst; iLeaf < iFirst + iCount; iLeaf++)
+        {
+            m_vLeaves[iLeaf].m_iNode = iNodeIndex;
+        }
+
+        return iNodeIndex;
+    }
+
+    CVector3 vSpread = vCenterMaximum - vCenterMinimum;
+    int iAxis = 0;
+
+    if (vSpread.Y > vSpread[iAxis]) iAxis = 1;
+    if (vSpread.Z > vSpread[iAxis]) iAxis = 2;
+
+    qSort(m_vLeaves.begin() + iFirst, m_vLeaves.begin() + iFirst + iCount, CLeafCenterLessThan(iAxis));
+
+    int iHalf = iCount / 2;
+
+    // The left child directly follows its parent
+    buildRecurse(iNodeIndex, iFirst, iHalf);
+    int iRight = buildRecurse(iNodeIndex, iFirst + iHalf, iCount - iHalf);
+
+    m_vNodes[iNodeIndex].m_iFirst = iRight;
+
+    return iNodeIndex;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Recomputes the bounds of dirty nodes and of their ancestors. \br\br
+    Nodes are stored parents first, so a reverse pass sees every child before its parent.
+*/
+void CSceneBVH::refit()
+{
+    for (int iNodeIndex = m_vNodes.count() - 1; iNodeIndex >= 0; iNodeIndex--)
+    {
+        CSceneBVHNode& tNode = m_vNodes[iNodeIndex];
+
+        if (tNode.m_bDirty == false)
+        {
+            continue;
+        }
+
+        tNode.m_bDirty = false;
+
+        if (tNode.m_iCount > 0)
+        {
+            tNode.m_vMinimum = m_vLeaves[tNode.m_iFirst].m_vMinimum;
+            tNode.m_vMaximum = m_vLeaves[tNode.m_iFirst].m_vMaximum;
+
+            for (int iLeaf = tNode.m_iFirst + 1; iLeaf < tNode.m_iFirst + tNode.m_iCount; iLeaf++)
+            {
+                for (int iAxis = 0; iAxis < 3; iAxis++)
+                {
+                    tNode.m_vMinimum[iAxis] = qMin(tNode.m_vMinimum[iAxis], m_vLeaves[iLeaf].m_vMinimum[iAxis]);
+                    tNode.m_vMaximum[iAxis] = qMax(tNode.m_vMaximum[iAxis], m_vLeaves[iLeaf].m_vMaximum[iAxis]);
+                }
+            }
+        }
+        else
+        {
+            const CSceneBVHNode& tLeft = m_vNodes[iNodeIndex + 1];
+            const CSceneBVHNode& tRight = m_vNodes[tNode.m_iFirst];
+
+            for (int iAxis = 0; iAxis < 3; iAxis++)
+            {
+                tNode.m_vMinimum[iAxis] = qMin(tLeft.m_vMinimum[iAxis], tRight.m_vMinimum[iAxis]);
+                tNode.m_vMaximum[iAxis] = qMax(tLeft.m_vMaximum[iAxis], tRight.m_vMaximum[iAxis]);
+            }
+        }
+
+        if (tNode.m_iParent >= 0)
+        {
+            m_vNodes[tNode.m_iParent].m_bDirty = true;
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Returns the surface area of the root node, 0 if the tree is empty.
+*/
+double CSceneBVH::rootArea() const
+{
+    if (m_vNodes.isEmpty())
+    {
+        return 0.0;
+    }
+
+    CVector3 vSize = m_vNodes[0].m_vMaximum - m_vNodes[0].m_vMinimum;
+
+    return 2.0 * (vSize.X * vSize.Y + vSize.Y * vSize.Z + vSize.Z * vSize.X);
+}
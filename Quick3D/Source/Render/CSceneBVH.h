@@ -0,0 +1,151 @@
+
+#pragma once
+
+// Qt
+#include <QReadWriteLock>
+#include <QVector>
+
+// Application
+#include "quick3d_global.h"
+#include "CQ3DConstants.h"
+#include "CVector3.h"
+#include "CRay3.h"
+#include "CBoundingBox.h"
+#include "CComponent.h"
+
+//-------------------------------------------------------------------------------------------------
+
+//! A node of CSceneBVH
+class QUICK3D_EXPORT CSceneBVHNode
+{
+public:
+
+    //! Default constructor
+    CSceneBVHNode()
+        : m_iParent(-1)
+        , m_iFirst(0)
+        , m_iCount(0)
+        , m_bDirty(false)
+    {
+    }
+
+    Math::CVector3  m_vMinimum;
+    Math::CVector3  m_vMaximum;
+    int             m_iParent;      // Index of the parent node, -1 for the root
+    int             m_iFirst;       // First leaf if m_iCount > 0, else right child (the left child follows the node)
+    int             m_iCount;       // Number of leaves, 0 for inner nodes
+    bool            m_bDirty;       // Bounds must be refit
+};
+
+//-------------------------------------------------------------------------------------------------
+
+//! A raytracable component in CSceneBVH
+class QUICK3D_EXPORT CSceneBVHLeaf
+{
+public:
+
+    //! Default constructor
+    CSceneBVHLeaf()
+        : m_iVisit(-1)
+        , m_iOrder(-1)
+        , m_iNode(-1)
+    {
+    }
+
+    QSP<CComponent>     m_pComponent;
+    Math::CVector3      m_vMinimum;
+    Math::CVector3      m_vMaximum;
+    int                 m_iVisit;       // Index among the bounded components, in visit order
+    int                 m_iOrder;       // Index among all components in the visit order of C3DScene::intersectRecurse(), breaks ties
+    int                 m_iNode;        // Node holding the leaf
+};
+
+//-------------------------------------------------------------------------------------------------
+
+//! Bounding volume hierarchy over the world bounds of the raytracable components of a scene
+class QUICK3D_EXPORT CSceneBVH
+{
+public:
+
+    //-------------------------------------------------------------------------------------------------
+    // Constructors and destructor
+    //-------------------------------------------------------------------------------------------------
+
+    //!
+    CSceneBVH();
+
+    //!
+    virtual ~CSceneBVH();
+
+    //-------------------------------------------------------------------------------------------------
+    // Getters
+    //-------------------------------------------------------------------------------------------------
+
+    //! Returns true if update() has been called at least once
+    bool isValid() const { QReadLocker locker(&m_tLock); return m_bValid; }
+
+    //! Returns the number of components in the tree
+    int leafCount() const { return m_vLeaves.count(); }
+
+    //! Returns the number of components without bounds, tested by every query
+    int unboundedCount() const { return m_vUnbounded.count(); }
+
+    //! Returns the number of full builds since creation
+    int buildCount() const { return m_iBuildCount; }
+
+    //-------------------------------------------------------------------------------------------------
+    // Control methods
+    //-------------------------------------------------------------------------------------------------
+
+    //! Releases all components, queries are answered by the caller until the next update()
+    void clear();
+
+    //! Refits the tree to the components' current bounds, rebuilding it if components were added or removed
+    //! If bWithChildren is false, the children of vComponents are not added
+    void update(const QVector<QSP<CComponent> >& vComponents, bool bWithChildren = true);
+
+    //! Returns the nearest intersection of ray
+    Math::RayTracingResult intersect(const Math::CRay3& ray) const;
+
+    //! Returns true as soon as ray hits something closer than dMaxDistance
+    bool intersectAny(const Math::CRay3& ray, double dMaxDistance = Q3D_INFINITY) const;
+
+    //-------------------------------------------------------------------------------------------------
+    // Protected control methods
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    //! Adds pComponent and its children to vLeaves and vUnbounded, as C3DScene::intersectRecurse() would visit them
+    static void collectRecurse(QSP<CComponent> pComponent, bool bWithChildren, QVector<CSceneBVHLeaf>& vLeaves, QVector<CSceneBVHLeaf>& vUnbounded);
+
+    //! Builds the nodes over m_vLeaves
+    void build();
+
+    //! Builds a node over iCount leaves from iFirst, returns its index
+    int buildRecurse(int iParent, int iFirst, int iCount);
+
+    //! Recomputes the bounds of dirty nodes, children first
+    void refit();
+
+    //! Returns the surface area of the root node
+    double rootArea() const;
+
+
+    //-------------------------------------------------------------------------------------------------
+    // Properties
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    mutable QReadWriteLock      m_tLock;
+    QVector<CSceneBVHNode>      m_vNodes;           // Depth first, a parent is before its children
+    QVector<CSceneBVHLeaf>      m_vLeaves;          // Ordered by node
+    QVector<CSceneBVHLeaf>      m_vUnbounded;       // Components without world bounds
+    QVector<CComponent*>        m_vSignature;       // Bounded components at last build, in visit order
+    QVector<int>                m_vLeafOfVisit;     // Index in m_vLeaves of each component of m_vSignature
+    QVector<CSceneBVHLeaf>      m_vCollected;       // Scratch list of update()
+    double                      m_dBuildArea;       // Root area at last build, a tree refit too far is rebuilt
+    int                         m_iBuildCount;
+    bool                        m_bValid;
+};
@@ -0,0 +1,308 @@
+
+// Std
+#include <math.h>
+
+// Qt
+#include <QMutexLocker>
+
+// qt-plus
+#include "CLogger.h"
+
+// Application
+#include "CSimulationScheduler.h"
+#include "C3DScene.h"
+
+//-------------------------------------------------------------------------------------------------
+
+#define DEFAULT_STEP_RATE           60.0
+#define DEFAULT_MAX_CATCH_UP_STEPS  8
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    \class CSimulationScheduler
+    \brief Steps the simulation of a scene at a fixed rate.
+    \inmodule Quick3D
+    \sa C3DScene
+
+    Components and controllers are updated with a constant time step, whatever the frame rate.
+    Elapsed time is accumulated and as many steps as due are run, up to a catch-up limit beyond which time is dropped. \br\br
+    The scheduler can be advanced by the rendering loop through C3DScene::updateScene(), or run in its own thread with start().
+    In both cases, rendering interpolates component transforms between the last two steps. \br\br
+    A thread that does not follow real time steps as fast as possible, for headless servers.
+*/
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Constructs a scheduler for \a pScene.
+*/
+CSimulationScheduler::CSimulationScheduler(C3DScene* pScene)
+    : m_pScene(pScene)
+    , m_iStopRequested(0)
+    , m_dStepS(1.0 / DEFAULT_STEP_RATE)
+    , m_dTimeScale(1.0)
+    , m_dAccumulatorS(0.0)
+    , m_iStepCount(0)
+    , m_iDroppedStepCount(0)
+    , m_iMaxCatchUpSteps(DEFAULT_MAX_CATCH_UP_STEPS)
+    , m_bRealTime(true)
+{
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Destroys a CSimulationScheduler, stopping its thread.
+*/
+CSimulationScheduler::~CSimulationScheduler()
+{
+    stop();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Sets the number of steps per simulated second to \a dStepsPerSecond.
+*/
+void CSimulationScheduler::setStepRate(double dStepsPerSecond)
+{
+    QMutexLocker locker(&m_mMutex);
+
+    if (dStepsPerSecond > 0.0)
+    {
+        m_dStepS = 1.0 / dStepsPerSecond;
+        m_dAccumulatorS = qMin(m_dAccumulatorS, m_dStepS);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Sets the maximum number of steps run by one advance to \a iValue.
+*/
+void CSimulationScheduler::setMaxCatchUpSteps(int iValue)
+{
+    QMutexLocker locker(&m_mMutex);
+
+    m_iMaxCatchUpSteps = qMax(iValue, 1);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Sets the ratio of simulated time to real time to \a dValue.
+*/
+void CSimulationScheduler::setTimeScale(double dValue)
+{
+    QMutexLocker locker(&m_mMutex);
+
+    m_dTimeScale = qMax(dValue, 0.0);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    If \a bValue is \c false, the thread steps as fast as possible instead of following real time.
+*/
+void CSimulationScheduler::setRealTime(bool bValue)
+{
+    QMutexLocker locker(&m_mMutex);
+
+    m_bRealTime = bValue;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+double CSimulationScheduler::stepSeconds() const
+{
+    QMutexLocker locker(&m_mMutex);
+
+    return m_dStepS;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+int CSimulationScheduler::maxCatchUpSteps() const
+{
+    QMutexLocker locker(&m_mMutex);
+
+    return m_iMaxCatchUpSteps;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+double CSimulationScheduler::timeScale() const
+{
+    QMutexLocker locker(&m_mMutex);
+
+    return m_dTimeScale;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+bool CSimulationScheduler::isRealTime() const
+{
+    QMutexLocker locker(&m_mMutex);
+
+    return m_bRealTime;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Returns the position of rendering between the last two steps, 0 being the previous step and 1 the last one. \br\br
+    While the thread follows real time, the time elapsed since the last steps is taken into account.
+*/
+double CSimulationScheduler::interpolationFactor() const
+{
+    QMutexLocker locker(&m_mMutex);
+
+    double dAccumulatorS = m_dAccumulatorS;
+
+    if (m_bRealTime && isRunning() && m_tSinceAdvance.isValid())
+    {
+        dAccumulatorS += ((double) m_tSinceAdvance.nsecsElapsed() / 1000000000.0) * m_dTimeScale;
+    }
+
+    return qBound(0.0, dAccumulatorS / m_dStepS, 1.0);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+qint64 CSimulationScheduler::stepCount() const
+{
+    QMutexLocker locker(&m_mMutex);
+
+    return m_iStepCount;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+qint64 CSimulationScheduler::droppedStepCount() const
+{
+    QMutexLocker locker(&m_mMutex);
+
+    return m_iDroppedStepCount;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Runs the steps due after \a dElapsedS real seconds, scaled by the time scale. Returns the number of steps run.
+*/
+int CSimulationScheduler::advance(double dElapsedS)
+{
+    return advanceSimulation(dElapsedS * timeScale());
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Requests the thread to stop and waits for it.
+*/
+void CSimulationScheduler::stop()
+{
+    m_iStopRequested.storeRelease(1);
+
+    wait();
+
+    m_iStopRequested.storeRelease(0);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Steps the scene until stop() is called, following real time or as fast as possible.
+*/
+void CSimulationScheduler::run()
+{
+    LOG_METHOD_DEBUG("START : Simulation thread");
+
+    QElapsedTimer tClock;
+    tClock.start();
+
+    qint64 iLastNS = 0;
+
+    while (m_iStopRequested.loadAcquire() == 0)
+    {
+        if (isRealTime())
+        {
+            qint64 iNowNS = tClock.nsecsElapsed();
+
+            advance((double) (iNowNS - iLastNS) / 1000000000.0);
+
+            iLastNS = iNowNS;
+
+            // Sleep until the next step is due
+            double dWaitS = 0.0;
+
+            {
+                QMutexLocker locker(&m_mMutex);
+
+                dWaitS = m_dTimeScale > 0.0 ? (m_dStepS - m_dAccumulatorS) / m_dTimeScale : m_dStepS;
+            }
+
+            if (dWaitS > 0.0)
+            {
+                QThread::usleep((unsigned long) (dWaitS * 1000000.0));
+            }
+        }
+        else
+        {
+            advanceSimulation(stepSeconds());
+
+            // Let the rendering thread take the scene between steps
+            QThread::yieldCurrentThread();
+        }
+    }
+
+    LOG_METHOD_DEBUG("FINISHED : Simulation thread");
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Adds \a dSimulatedS to the accumulated time and runs the steps due, at most the catch-up limit.
+    Returns the number of steps run. \br\br
+    The scene is locked during the steps, so that rendering never sees a partial step.
+*/
+int CSimulationScheduler::advanceSimulation(double dSimulatedS)
+{
+    QMutexLocker sceneLocker(m_pScene->simulationMutex());
+
+    int iSteps = 0;
+    double dStepS = 0.0;
+
+    {
+        QMutexLocker locker(&m_mMutex);
+
+        m_dAccumulatorS += qMax(dSimulatedS, 0.0);
+
+        double dDueSteps = floor(m_dAccumulatorS / m_dStepS);
+
+        if (dDueSteps > (double) m_iMaxCatchUpSteps)
+        {
+            m_iDroppedStepCount += (qint64) dDueSteps - m_iMaxCatchUpSteps;
+            iSteps = m_iMaxCatchUpSteps;
+        }
+        else
+        {
+            iSteps = (int) dDueSteps;
+        }
+
+        // The remainder is kept whatever the number of steps run
+        m_dAccumulatorS = qBound(0.0, m_dAccumulatorS - dDueSteps * m_dStepS, m_dStepS);
+        m_iStepCount += iSteps;
+        dStepS = m_dStepS;
+
+        m_tSinceAdvance.start();
+    }
+
+    for (int iStep = 0; iStep < iSteps; iStep++)
+    {
+        m_pScene->stepScene(dStepS);
+    }
+
+    return iSteps;
+}
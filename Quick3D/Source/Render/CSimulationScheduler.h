@@ -0,0 +1,123 @@
+
+#pragma once
+
+// Qt
+#include <QThread>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+
+// Application
+#include "quick3d_global.h"
+
+//-------------------------------------------------------------------------------------------------
+// Forward declarations
+
+class C3DScene;
+
+//-------------------------------------------------------------------------------------------------
+
+//! Steps the simulation of a scene at a fixed rate, in the calling thread or in its own
+class QUICK3D_EXPORT CSimulationScheduler : public QThread
+{
+    Q_OBJECT
+
+public:
+
+    //-------------------------------------------------------------------------------------------------
+    // Constructors and destructor
+    //-------------------------------------------------------------------------------------------------
+
+    //! Constructor
+    CSimulationScheduler(C3DScene* pScene);
+
+    //! Destructor, stops the thread
+    virtual ~CSimulationScheduler();
+
+    //-------------------------------------------------------------------------------------------------
+    // Setters
+    //-------------------------------------------------------------------------------------------------
+
+    //! Sets the number of simulation steps per simulated second
+    void setStepRate(double dStepsPerSecond);
+
+    //! Sets the maximum number of steps run to catch up with elapsed time, the excess time is dropped
+    void setMaxCatchUpSteps(int iValue);
+
+    //! Sets the ratio of simulated time to real time
+    void setTimeScale(double dValue);
+
+    //! Sets whether the thread follows real time, if false it steps as fast as possible
+    void setRealTime(bool bValue);
+
+    //-------------------------------------------------------------------------------------------------
+    // Getters
+    //-------------------------------------------------------------------------------------------------
+
+    //! Returns the duration of a step in simulated seconds
+    double stepSeconds() const;
+
+    //! Returns the maximum number of steps run to catch up with elapsed time
+    int maxCatchUpSteps() const;
+
+    //! Returns the ratio of simulated time to real time
+    double timeScale() const;
+
+    //! Returns whether the thread follows real time
+    bool isRealTime() const;
+
+    //! Returns the position of rendering between the last two steps, from 0 to 1
+    double interpolationFactor() const;
+
+    //! Returns the number of steps run
+    qint64 stepCount() const;
+
+    //! Returns the number of steps dropped by the catch-up limit
+    qint64 droppedStepCount() const;
+
+    //-------------------------------------------------------------------------------------------------
+    // Control methods
+    //-------------------------------------------------------------------------------------------------
+
+    //! Runs the steps due after dElapsedS real seconds, returns their number
+    int advance(double dElapsedS);
+
+    //! Stops the thread and waits for the current step to finish
+    void stop();
+
+    //-------------------------------------------------------------------------------------------------
+    // Inherited methods
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    //! Steps the scene until stop() is called
+    virtual void run() Q_DECL_OVERRIDE;
+
+    //-------------------------------------------------------------------------------------------------
+    // Protected control methods
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    //! Runs the steps due after dSimulatedS simulated seconds, returns their number
+    int advanceSimulation(double dSimulatedS);
+
+    //-------------------------------------------------------------------------------------------------
+    // Properties
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    C3DScene*               m_pScene;
+    mutable QMutex          m_mMutex;               // Protects the properties below
+    QElapsedTimer           m_tSinceAdvance;        // Real time since the last advance, for interpolation while threaded
+    QAtomicInt              m_iStopRequested;
+    double                  m_dStepS;               // Duration of a step in simulated seconds
+    double                  m_dTimeScale;           // Simulated seconds per real second
+    double                  m_dAccumulatorS;        // Simulated seconds not stepped yet, less than m_dStepS
+    qint64                  m_iStepCount;
+    qint64                  m_iDroppedStepCount;
+    int                     m_iMaxCatchUpSteps;
+    bool                    m_bRealTime;
+};
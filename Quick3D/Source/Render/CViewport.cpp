@@ -12,11 +12,13 @@ using namespace Math;
 
 CViewport::CViewport(C3DScene* pScene, bool bEnableMJPEGServer)
     : m_pScene(pScene)
+    , m_pStreamer(nullptr)
+    , m_pReadback(nullptr)
     , m_bEnabled(false)
     , m_bStreamView(false)
     , m_bNeedFrameBuffer(false)
+    , m_bNewFrame(false)
     , m_pCamera(nullptr)
-    , m_pServer(nullptr)
 {
     static int iPort = 6666;
 
@@ -25,7 +27,7 @@ CViewport::CViewport(C3DScene* pScene, bool bEnableMJPEGServer)
 
     if (bEnableMJPEGServer)
     {
-        m_pServer = new CMJPEGServer(iPort++);
+        m_pStreamer = new CFrameStreamer(iPort++);
     }
 }
 
@@ -33,9 +35,14 @@ CViewport::CViewport(C3DScene* pScene, bool bEnableMJPEGServer)
 
 CViewport::~CViewport()
 {
-    if (m_pServer != nullptr)
+    if (m_pReadback != nullptr)
     {
-        delete m_pServer;
+        delete m_pReadback;
+    }
+
+    if (m_pStreamer != nullptr)
+    {
+        delete m_pStreamer;
     }
 }
 
@@ -43,35 +50,44 @@ CViewport::~CViewport()
 
 void CViewport::update(double dDeltaTime)
 {
-    if ((m_bStreamView && m_pServer != nullptr) || m_bNeedFrameBuffer)
+    Q_UNUSED(dDeltaTime);
+
+    if (m_bNewFrame)
     {
-        if (m_pScene->frameBuffer().width() > 0 && m_pScene->frameBuffer().height() > 0)
+        m_bNewFrame = false;
+
+        if (m_bStreamView && m_pStreamer != nullptr)
         {
-            QRect rect((int) m_vPosition.X, (int) m_vPosition.Y, (int) m_vSize.X, (int) m_vSize.Y);
-
-            if (
-                    m_vPosition.X >= 0.0 &&
-                    m_vPosition.Y >= 0.0 &&
-                    m_vPosition.X + m_vSize.X <= m_pScene->frameBuffer().width() &&
-                    m_vPosition.Y + m_vSize.Y <= m_pScene->frameBuffer().height()
-                    )
-            {
-                m_imgFrameBuffer = createSubImage(m_pScene->frameBuffer(), rect).copy();
-
-                if (m_imgFrameBuffer.width() > 0 && m_imgFrameBuffer.height() > 0)
-                {
-                    if (m_pServer != nullptr)
-                    {
-                        m_pServer->sendImage(m_imgFrameBuffer);
-                    }
-                }
-            }
+            m_pStreamer->submit(m_imgFrameBuffer);
         }
     }
 }
 
 //-------------------------------------------------------------------------------------------------
 
+void CViewport::readFrame(const QSize& sFrameSize)
+{
+    QRect rect((int) m_vPosition.X, (int) m_vPosition.Y, (int) m_vSize.X, (int) m_vSize.Y);
+
+    if (rect.isEmpty() || QRect(QPoint(0, 0), sFrameSize).contains(rect) == false)
+    {
+        return;
+    }
+
+    if (m_pReadback == nullptr)
+    {
+        m_pReadback = new CFrameReadback(m_pScene);
+    }
+
+    if (m_pReadback->read(rect, sFrameSize.height()))
+    {
+        m_imgFrameBuffer = m_pReadback->frame();
+        m_bNewFrame = true;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
 QImage CViewport::createSubImage(const QImage& image, const QRect& rect) const
 {
     quint32 offset = rect.x() * image.depth() / 8 + rect.y() * image.bytesPerLine();
@@ -7,11 +7,10 @@
 #include <QTcpServer>
 #include <QImage>
 
-// qt-plus
-#include "CMJPEGServer.h"
-
 // Application
 #include "quick3d_global.h"
+#include "CFrameReadback.h"
+#include "CFrameStreamer.h"
 #include "CVector2.h"
 #include "CVector3.h"
 #include "CCamera.h"
@@ -84,9 +83,12 @@ public:
     //!
     bool needFrameBuffer() const { return m_bNeedFrameBuffer; }
 
-    //!
+    //! Returns the last frame read back, a few frames behind the rendered one
     const QImage& frameBuffer() const { return m_imgFrameBuffer; }
 
+    //! Returns the streamer of this viewport, nullptr if streaming is not enabled
+    CFrameStreamer* streamer() const { return m_pStreamer; }
+
     //-------------------------------------------------------------------------------------------------
     // Control methods
     //-------------------------------------------------------------------------------------------------
@@ -94,6 +96,9 @@ public:
     //!
     void update(double dDeltaTime);
 
+    //! Reads the viewport rectangle of the rendered frame back, sFrameSize being the size of the frame buffer
+    void readFrame(const QSize& sFrameSize);
+
     //!
     QImage createSubImage(const QImage& image, const QRect& rect) const;
 
@@ -108,13 +113,15 @@ public:
 protected:
 
     C3DScene*       m_pScene;               // The scene displayed in this viewport
-    CMJPEGServer*   m_pServer;              // The streaming server for this viewport
+    CFrameStreamer* m_pStreamer;            // The streaming server for this viewport
+    CFrameReadback* m_pReadback;            // Reads the viewport rectangle, created at first read
     Math::CVector2  m_vPosition;            // The viewport's position in the render window
     Math::CVector2  m_vSize;                // The viewport's size
     QImage          m_imgFrameBuffer;       // The captured frame
     bool            m_bEnabled;             // Is the viewport active?
     bool            m_bStreamView;          // Is the view streaming enabled?
     bool            m_bNeedFrameBuffer;     // Do we need the frame buffer?
+    bool            m_bNewFrame;            // Has a frame been read since the last update?
 
     // Shared data
 
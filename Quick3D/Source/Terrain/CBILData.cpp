@@ -9,11 +9,10 @@
 
 // Application
 #include "Angles.h"
+#include "CHeightField.h"
 #include "CBILData.h"
 
-#ifdef WIN32
 #include "CZip.h"
-#endif
 
 using namespace Math;
 
@@ -64,15 +63,13 @@ double swap_double( double dbl )
 //-------------------------------------------------------------------------------------------------
 
 CBILData::CBILData(double dValueForNoData)
-    : CExpendable(20)
-    , m_tMutex(QMutex::Recursive)
+    : m_tMutex(QMutex::Recursive)
     , m_dValueForNoData(dValueForNoData)
     , m_iNumCellsWidth(0)
     , m_iNumCellsHeight(0)
     , m_ui16NoDataValue(0)
     , m_vData(nullptr)
 {
-    setUsedNow();
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -86,13 +83,10 @@ CBILData::CBILData(
         const qint16* vData,
         double dValueForNoData
         )
-    : CExpendable(20)
-    , m_tMutex(QMutex::Recursive)
+    : m_tMutex(QMutex::Recursive)
     , m_dValueForNoData(dValueForNoData)
     , m_vData(nullptr)
 {
-    setUsedNow();
-
     if (iNumCellsWidth > 0 && iNumCellsHeight > 0 && vData != nullptr)
     {
         m_gGeoloc			= gGeoloc;
@@ -108,7 +102,6 @@ CBILData::CBILData(
 //-------------------------------------------------------------------------------------------------
 
 CBILData::CBILData(const CBILData& target)
-    : CExpendable(20)
 {
     *this = target;
 }
@@ -117,9 +110,11 @@ CBILData::CBILData(const CBILData& target)
 
 CBILData::~CBILData()
 {
+    detachFromCache();
+
     if (m_vData != nullptr)
     {
-        delete m_vData;
+        delete [] m_vData;
     }
 }
 
@@ -150,17 +145,12 @@ double CBILData::getHeightAt(const CGeoloc& gPosition, double* pRigidness)
 {
     QMutexLocker locker(&m_tMutex);
 
-    setUsedNow();
-
     if (pRigidness != nullptr)
     {
         *pRigidness = 1.0;
     }
 
-    if (m_vData == nullptr)
-    {
-        readData();
-    }
+    useData();
 
     if (m_vData != nullptr)
     {
@@ -232,6 +222,57 @@ double CBILData::getHeightAt(const CGeoloc& gPosition, double* pRigidness)
 
 //-------------------------------------------------------------------------------------------------
 
+/*!
+    Writes the heights at \a pPositions[\a pIndices[i]] to \a pHeights[\a pIndices[i]], for the \a iCount indices. \br\br
+    The tile is locked once for the whole batch. Heights are left untouched if the tile has no data.
+*/
+void CBILData::getHeightsAt(const CGeoloc* pPositions, const int* pIndices, int iCount, double* pHeights)
+{
+    QMutexLocker locker(&m_tMutex);
+
+    useData();
+
+    if (m_vData != nullptr)
+    {
+        double vLatPos[HEIGHTFIELD_BATCH_BLOCK];
+        double vLonPos[HEIGHTFIELD_BATCH_BLOCK];
+        double vResults[HEIGHTFIELD_BATCH_BLOCK];
+
+        for (int iStart = 0; iStart < iCount; iStart += HEIGHTFIELD_BATCH_BLOCK)
+        {
+            int iBlockCount = qMin(iCount - iStart, HEIGHTFIELD_BATCH_BLOCK);
+
+            for (int iIndex = 0; iIndex < iBlockCount; iIndex++)
+            {
+                const CGeoloc& gPosition = pPositions[pIndices[iStart + iIndex]];
+
+                double dLatDiff = Angles::clipAngleDegree(gPosition.Latitude - m_gGeoloc.Latitude);
+                double dLonDiff = Angles::clipAngleDegree(gPosition.Longitude - m_gGeoloc.Longitude);
+
+                vLatPos[iIndex] = (1.0 - (dLatDiff / m_gSize.Latitude)) * ((double) m_iNumCellsHeight - 1);
+                vLonPos[iIndex] = (dLonDiff / m_gSize.Longitude) * ((double) m_iNumCellsWidth - 1);
+            }
+
+            CHeightField::interpolateGrid(
+                        m_vData,
+                        m_iNumCellsWidth,
+                        m_iNumCellsHeight,
+                        vLatPos,
+                        vLonPos,
+                        vResults,
+                        iBlockCount
+                        );
+
+            for (int iIndex = 0; iIndex < iBlockCount; iIndex++)
+            {
+                pHeights[pIndices[iStart + iIndex]] = vResults[iIndex];
+            }
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
 bool CBILData::contains(const CGeoloc& gPosition) const
 {
     double dLatDiff1 = Math::Angles::angleDifferenceDegree(m_gGeoloc.Latitude, gPosition.Latitude);
@@ -250,6 +291,18 @@ bool CBILData::contains(const CGeoloc& gPosition) const
 
 //-------------------------------------------------------------------------------------------------
 
+bool CBILData::intersects(const CGeoloc& gPosition, const CGeoloc& gSize) const
+{
+    double dLatDiff = Math::Angles::angleDifferenceDegree(m_gGeoloc.Latitude + m_gSize.Latitude * 0.5, gPosition.Latitude);
+    double dLonDiff = Math::Angles::angleDifferenceDegree(m_gGeoloc.Longitude + m_gSize.Longitude * 0.5, gPosition.Longitude);
+
+    return
+            fabs(dLatDiff) <= (m_gSize.Latitude + gSize.Latitude) * 0.5 &&
+            fabs(dLonDiff) <= (m_gSize.Longitude + gSize.Longitude) * 0.5;
+}
+
+//-------------------------------------------------------------------------------------------------
+
 void CBILData::setFileName(QString sFileName)
 {
     LOG_METHOD_DEBUG(sFileName);
@@ -258,7 +311,7 @@ void CBILData::setFileName(QString sFileName)
 
     if (m_vData != nullptr)
     {
-        delete m_vData;
+        delete [] m_vData;
     }
 
     m_vData = nullptr;
@@ -281,7 +334,6 @@ QStringList CBILData::readHeader()
 {
     LOG_METHOD_DEBUG(m_sFileName);
 
-#ifdef WIN32
     QStringList lReturnValue;
 
     CZip zFile(m_sFileName);
@@ -312,9 +364,6 @@ QStringList CBILData::readHeader()
     }
 
     return lReturnValue;
-#else
-    return QStringList();
-#endif
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -323,30 +372,36 @@ void CBILData::readData()
 {
     LOG_METHOD_DEBUG(m_sFileName);
 
-#ifdef WIN32
-    m_vData = new qint16[m_iNumCellsWidth * m_iNumCellsHeight];
-
     if (m_sBILFileName.isEmpty() == false)
     {
+        int iNumCells = m_iNumCellsWidth * m_iNumCellsHeight;
+        qint64 iDataSize = (qint64) iNumCells * sizeof(qint16);
+
+        qint16* vData = new qint16[iNumCells];
+
+        // Decompress straight into the tile, no intermediate buffer
         CZip zFile(m_sFileName);
-        QByteArray baContent = zFile.getZipFileContent(m_sBILFileName);
-        QDataStream sStream(baContent);
+        qint64 iRead = zFile.readZipFileContent(m_sBILFileName, (char*) vData, iDataSize);
 
-        int iDataSize = (m_iNumCellsWidth * m_iNumCellsHeight) * sizeof(qint16);
+        if (iRead < iDataSize)
+        {
+            LOG_WARNING(QString("CBILData::readData() : truncated data in %1").arg(m_sFileName));
 
-        sStream.readRawData((char*) m_vData, iDataSize);
+            memset((char*) vData + qMax(iRead, (qint64) 0), 0, iDataSize - qMax(iRead, (qint64) 0));
+        }
 
         // Ajustements
 
-        for (int iIndex = 0; iIndex < (m_iNumCellsWidth * m_iNumCellsHeight); iIndex++)
+        for (int iIndex = 0; iIndex < iNumCells; iIndex++)
         {
-            if (m_vData[iIndex] == m_ui16NoDataValue)
+            if (vData[iIndex] == m_ui16NoDataValue)
             {
-                m_vData[iIndex] = (int) m_dValueForNoData;
+                vData[iIndex] = (int) m_dValueForNoData;
             }
         }
+
+        m_vData = vData;
     }
-#endif
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -359,3 +414,57 @@ void CBILData::clearData()
         m_vData = nullptr;
     }
 }
+
+//-------------------------------------------------------------------------------------------------
+
+void CBILData::useData()
+{
+    if (m_vData == nullptr)
+    {
+        readData();
+
+        if (m_vData != nullptr)
+        {
+            dataLoaded((qint64) (m_iNumCellsWidth * m_iNumCellsHeight) * sizeof(qint16));
+        }
+    }
+    else
+    {
+        touch();
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Reads the elevation data from the zip file if it is not resident. Called by the prefetch thread.
+*/
+void CBILData::prefetch()
+{
+    QMutexLocker locker(&m_tMutex);
+
+    if (m_vData == nullptr && m_sFileName.isEmpty() == false)
+    {
+        useData();
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Frees the elevation data, it will be read again from the zip file on next use. \br\br
+    Tiles built from memory have no file to reload from, they are never released.
+*/
+bool CBILData::releaseData()
+{
+    if (m_sFileName.isEmpty() || m_tMutex.tryLock() == false)
+    {
+        return false;
+    }
+
+    clearData();
+
+    m_tMutex.unlock();
+
+    return true;
+}
@@ -1,12 +1,14 @@
 
 // Qt
 #include <QDir>
+#include <QMap>
 #include <QStringList>
 
 // qt-plus
 #include "CLogger.h"
 
 // Application
+#include "CElevationTilePrefetcher.h"
 #include "CBILField.h"
 
 using namespace Math;
@@ -28,8 +30,7 @@ using namespace Math;
     \a dValueForNoData if the special value that identifies empty data.
 */
 CBILField::CBILField(CXMLNode xParameters, const QString& sPathToBILFiles, double dValueForNoData)
-    : m_tMutex(QMutex::Recursive)
-    , m_xParameters(xParameters)
+    : m_xParameters(xParameters)
     , m_dValueForNoData(dValueForNoData)
 {
     LOG_METHOD_DEBUG(sPathToBILFiles);
@@ -95,33 +96,6 @@ void CBILField::parseBILFiles()
 
 //-------------------------------------------------------------------------------------------------
 
-/*!
-    This is called by the getHeightAt() methods. Every 2000 calls, it deletes chunks which have not been used in the last 20 seconds.
-*/
-void CBILField::collectGarbage()
-{
-    QMutexLocker locker(&m_tMutex);
-
-    static int iGarbageCounter = 0;
-
-    iGarbageCounter++;
-
-    if (iGarbageCounter > 2000)
-    {
-        iGarbageCounter = 0;
-
-        for (int iIndex = 0; iIndex < m_vChunks.count(); iIndex++)
-        {
-            if (m_vChunks[iIndex]->isExpendable())
-            {
-                m_vChunks[iIndex]->clearData();
-            }
-        }
-    }
-}
-
-//-------------------------------------------------------------------------------------------------
-
 /*!
     Returns the height at the specified \a gPosition. \br\br
     \a pRigidness, if not nullptr, is filled with the terrain rigidness at the specified location. Always 1.0 for now.
@@ -138,8 +112,6 @@ double CBILField::getHeightAt(const CGeoloc& gPosition, double* pRigidness)
         }
     }
 
-    collectGarbage();
-
     return Q3D_INFINITY;
 }
 
@@ -152,11 +124,7 @@ double CBILField::getHeightAt(const CGeoloc& gPosition, double* pRigidness)
 */
 double CBILField::getHeightAt(const CVector3& vPosition, const CAxis& aAxis, double* pRigidness)
 {
-    double dReturnValue = getHeightAt(CGeoloc(vPosition), pRigidness);
-
-    collectGarbage();
-
-    return dReturnValue;
+    return getHeightAt(CGeoloc(vPosition), pRigidness);
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -168,11 +136,50 @@ double CBILField::getHeightAt(const CVector3& vPosition, const CAxis& aAxis, dou
 */
 double CBILField::getHeightAt(const Math::CVector3& vPosition, const Math::CAxis& aAxis, bool bForPhysics)
 {
-    double dReturnValue = getHeightAt(CGeoloc(vPosition), nullptr);
+    return getHeightAt(CGeoloc(vPosition), nullptr);
+}
+
+//-------------------------------------------------------------------------------------------------
 
-    collectGarbage();
+/*!
+    Fills \a pHeights with the heights at the \a iCount geolocations in \a pPositions. \br\br
+    Positions are grouped by chunk so that each chunk is locked and loaded once.
+    \a bForPhysics
+*/
+void CBILField::getHeightsAt(const CGeoloc* pPositions, double* pHeights, int iCount, bool bForPhysics)
+{
+    QMap<CBILData*, QVector<int> > mBatches;
+    CBILData* pLastChunk = nullptr;
+
+    // Group positions by tile, neighbouring positions usually fall in the same one
+    for (int iIndex = 0; iIndex < iCount; iIndex++)
+    {
+        pHeights[iIndex] = Q3D_INFINITY;
+
+        if (pLastChunk == nullptr || pLastChunk->contains(pPositions[iIndex]) == false)
+        {
+            pLastChunk = nullptr;
+
+            foreach (CBILData* pChunk, m_vChunks)
+            {
+                if (pChunk->contains(pPositions[iIndex]))
+                {
+                    pLastChunk = pChunk;
+                    break;
+                }
+            }
+        }
 
-    return dReturnValue;
+        if (pLastChunk != nullptr)
+        {
+            mBatches[pLastChunk].append(iIndex);
+        }
+    }
+
+    for (QMap<CBILData*, QVector<int> >::const_iterator iBatch = mBatches.constBegin(); iBatch != mBatches.constEnd(); ++iBatch)
+    {
+        iBatch.key()->getHeightsAt(pPositions, iBatch.value().constData(), iBatch.value().count(), pHeights);
+    }
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -186,6 +193,47 @@ void CBILField::flatten(const CGeoloc& gPosition, double dRadius)
 
 //-------------------------------------------------------------------------------------------------
 
+/*!
+    Pins the tiles under the area centered on \a gPosition, of size \a gSize, if \a bPinned is \c true. Else unpins them.
+*/
+void CBILField::setTilesPinned(const CGeoloc& gPosition, const CGeoloc& gSize, bool bPinned)
+{
+    foreach (CBILData* pChunk, m_vChunks)
+    {
+        if (pChunk->intersects(gPosition, gSize))
+        {
+            if (bPinned)
+            {
+                pChunk->pin();
+            }
+            else
+            {
+                pChunk->unpin();
+            }
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CBILField::prefetchAlong(const CGeoloc& gFrom, const CGeoloc& gTo)
+{
+    QVector<CGeoloc> vPoints = samplePath(gFrom, gTo, HEIGHTFIELD_PREFETCH_STEP);
+
+    foreach (const CGeoloc& gPoint, vPoints)
+    {
+        foreach (CBILData* pChunk, m_vChunks)
+        {
+            if (pChunk->contains(gPoint))
+            {
+                CElevationTilePrefetcher::getInstance()->enqueue(pChunk);
+            }
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
 /*!
     Adds the \a pData chunk to this field.
 */
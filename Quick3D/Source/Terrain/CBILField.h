@@ -42,6 +42,9 @@ public:
     //!
     virtual double getHeightAt(const Math::CVector3& vPosition, const Math::CAxis& aAxis, bool bForPhysics = true);
 
+    //!
+    virtual void getHeightsAt(const CGeoloc* pPositions, double* pHeights, int iCount, bool bForPhysics = true);
+
     //-------------------------------------------------------------------------------------------------
     // Control methods
     //-------------------------------------------------------------------------------------------------
@@ -49,6 +52,12 @@ public:
     //!
     virtual void flatten(const CGeoloc& gPosition, double dRadius);
 
+    //!
+    virtual void setTilesPinned(const CGeoloc& gPosition, const CGeoloc& gSize, bool bPinned);
+
+    //!
+    virtual void prefetchAlong(const CGeoloc& gFrom, const CGeoloc& gTo);
+
     //!
     void addChunk(CBILData* pData);
 
@@ -61,16 +70,12 @@ protected:
     //!
     void parseBILFiles();
 
-    //!
-    void collectGarbage();
-
     //-------------------------------------------------------------------------------------------------
     // Properties
     //-------------------------------------------------------------------------------------------------
 
 protected:
 
-    QMutex              m_tMutex;
     CXMLNode            m_xParameters;
     double              m_dValueForNoData;
     QString             m_sPath;
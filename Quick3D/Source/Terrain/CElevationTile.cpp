@@ -0,0 +1,73 @@
+
+// Application
+#include "CElevationTile.h"
+#include "CElevationTileCache.h"
+#include "CElevationTilePrefetcher.h"
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    \class CElevationTile
+    \brief The base class of elevation tiles whose data is loaded on demand and evicted by CElevationTileCache.
+    \inmodule Quick3D
+    \sa CElevationTileCache
+*/
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Constructs a CElevationTile and registers it in the cache.
+*/
+CElevationTile::CElevationTile()
+    : m_iPinCount(0)
+    , m_iReferenced(0)
+    , m_iHits(0)
+    , m_iResidentBytes(0)
+    , m_bRegistered(false)
+{
+    CElevationTileCache::getInstance()->registerTile(this);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Destroys a CElevationTile.
+*/
+CElevationTile::~CElevationTile()
+{
+    detachFromCache();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Tells the cache that \a iBytes of data have just been loaded in this tile.
+*/
+void CElevationTile::dataLoaded(qint64 iBytes)
+{
+    m_iReferenced.store(1);
+
+    CElevationTileCache::getInstance()->tileLoaded(this, iBytes);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Loads the data of this tile if it is not resident. Called by the CElevationTilePrefetcher thread. \br\br
+    The default implementation does nothing.
+*/
+void CElevationTile::prefetch()
+{
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Removes this tile from the cache and from the prefetch queue. Derived classes call this first in their destructor,
+    so that neither the cache nor the prefetch thread use a partially destroyed object.
+*/
+void CElevationTile::detachFromCache()
+{
+    CElevationTilePrefetcher::getInstance()->cancel(this);
+    CElevationTileCache::getInstance()->unregisterTile(this);
+}
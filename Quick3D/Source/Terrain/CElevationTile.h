@@ -0,0 +1,81 @@
+
+#pragma once
+
+// Qt
+#include <QAtomicInt>
+#include <QAtomicInteger>
+
+// Application
+#include "quick3d_global.h"
+
+//-------------------------------------------------------------------------------------------------
+
+//! Base class of elevation tiles whose data is managed by CElevationTileCache
+class QUICK3D_EXPORT CElevationTile
+{
+    friend class CElevationTileCache;
+    friend class CElevationTilePrefetcher;
+
+public:
+
+    //-------------------------------------------------------------------------------------------------
+    // Constructors and destructor
+    //-------------------------------------------------------------------------------------------------
+
+    //! Default constructor, registers the tile in the cache
+    CElevationTile();
+
+    //! Destructor
+    virtual ~CElevationTile();
+
+    //-------------------------------------------------------------------------------------------------
+    // Getters
+    //-------------------------------------------------------------------------------------------------
+
+    //! Returns true if the tile may not be evicted
+    bool isPinned() const { return m_iPinCount.load() > 0; }
+
+    //-------------------------------------------------------------------------------------------------
+    // Control methods
+    //-------------------------------------------------------------------------------------------------
+
+    //! Prevents eviction of the tile's data, calls must be balanced with unpin()
+    void pin() { m_iPinCount.ref(); }
+
+    //! Allows eviction of the tile's data
+    void unpin() { m_iPinCount.deref(); }
+
+    //-------------------------------------------------------------------------------------------------
+    // Protected methods
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    //! Flags the tile as recently used, lock free
+    void touch() { m_iReferenced.store(1); m_iHits.ref(); }
+
+    //! Tells the cache that iBytes of data have been loaded, may evict other tiles
+    void dataLoaded(qint64 iBytes);
+
+    //! Removes the tile from the cache, must be called first by derived destructors
+    void detachFromCache();
+
+    //! Loads the tile's data if it is not resident, called by the prefetch thread
+    virtual void prefetch();
+
+    //! Frees the tile's data, returns false if the tile is busy and cannot be freed now
+    //! Called by the cache, must never block
+    virtual bool releaseData() = 0;
+
+    //-------------------------------------------------------------------------------------------------
+    // Properties
+    //-------------------------------------------------------------------------------------------------
+
+private:
+
+    QAtomicInt              m_iPinCount;        // Number of pins
+    QAtomicInt              m_iReferenced;      // Clock reference bit
+    QAtomicInteger<qint64>  m_iHits;            // Number of accesses with resident data
+    qint64                  m_iResidentBytes;   // Bytes accounted in the cache, guarded by the cache mutex
+    bool                    m_bRegistered;      // Is the tile known to the cache? Guarded by the cache mutex
+};
@@ -0,0 +1,243 @@
+
+// Qt
+#include <QMutexLocker>
+
+// qt-plus
+#include "CLogger.h"
+
+// Application
+#include "CElevationTileCache.h"
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    \class CElevationTileCache
+    \brief Keeps the elevation data of all height field tiles under a byte budget.
+    \inmodule Quick3D
+    \sa CElevationTile
+
+    Tiles report their loads with CElevationTile::dataLoaded() and their accesses with CElevationTile::touch(). \br
+    When the resident data exceeds the budget, a clock hand sweeps the tiles : recently touched tiles get a second chance,
+    pinned tiles are skipped, and the others are asked to release their data. \br
+    Tiles are asked with a non-blocking call, so a tile busy in another thread is simply skipped.
+*/
+
+//-------------------------------------------------------------------------------------------------
+
+CElevationTileCache::CElevationTileCache()
+    : m_iClockHand(0)
+    , m_iBudget(ELEVATION_CACHE_DEFAULT_BUDGET)
+    , m_iResidentBytes(0)
+    , m_iMisses(0)
+    , m_iEvictions(0)
+    , m_iRetiredHits(0)
+{
+}
+
+//-------------------------------------------------------------------------------------------------
+
+CElevationTileCache::~CElevationTileCache()
+{
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Sets the budget of resident elevation data to \a iBytes, evicting tiles if needed.
+*/
+void CElevationTileCache::setBudget(qint64 iBytes)
+{
+    QMutexLocker locker(&m_mMutex);
+
+    m_iBudget = iBytes;
+
+    evict(nullptr);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+qint64 CElevationTileCache::budget()
+{
+    QMutexLocker locker(&m_mMutex);
+
+    return m_iBudget;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+qint64 CElevationTileCache::residentBytes()
+{
+    QMutexLocker locker(&m_mMutex);
+
+    return m_iResidentBytes;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+int CElevationTileCache::tileCount()
+{
+    QMutexLocker locker(&m_mMutex);
+
+    return m_vTiles.count();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Returns the number of accesses to tiles whose data was resident. \br\br
+    Hits are counted per tile to avoid contention, this sums them.
+*/
+qint64 CElevationTileCache::hits()
+{
+    QMutexLocker locker(&m_mMutex);
+
+    qint64 iHits = m_iRetiredHits;
+
+    foreach (CElevationTile* pTile, m_vTiles)
+    {
+        iHits += pTile->m_iHits.load();
+    }
+
+    return iHits;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+qint64 CElevationTileCache::misses()
+{
+    QMutexLocker locker(&m_mMutex);
+
+    return m_iMisses;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+qint64 CElevationTileCache::evictions()
+{
+    QMutexLocker locker(&m_mMutex);
+
+    return m_iEvictions;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CElevationTileCache::resetCounters()
+{
+    QMutexLocker locker(&m_mMutex);
+
+    foreach (CElevationTile* pTile, m_vTiles)
+    {
+        pTile->m_iHits.store(0);
+    }
+
+    m_iRetiredHits = 0;
+    m_iMisses = 0;
+    m_iEvictions = 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CElevationTileCache::registerTile(CElevationTile* pTile)
+{
+    QMutexLocker locker(&m_mMutex);
+
+    if (pTile->m_bRegistered == false)
+    {
+        pTile->m_bRegistered = true;
+        m_vTiles.append(pTile);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CElevationTileCache::unregisterTile(CElevationTile* pTile)
+{
+    QMutexLocker locker(&m_mMutex);
+
+    if (pTile->m_bRegistered)
+    {
+        int iIndex = m_vTiles.indexOf(pTile);
+
+        if (iIndex != -1)
+        {
+            m_vTiles.remove(iIndex);
+
+            if (iIndex < m_iClockHand)
+            {
+                m_iClockHand--;
+            }
+        }
+
+        m_iResidentBytes -= pTile->m_iResidentBytes;
+        m_iRetiredHits += pTile->m_iHits.load();
+
+        pTile->m_iResidentBytes = 0;
+        pTile->m_bRegistered = false;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Accounts for \a iBytes of data loaded in \a pTile, then evicts other tiles if the budget is exceeded.
+*/
+void CElevationTileCache::tileLoaded(CElevationTile* pTile, qint64 iBytes)
+{
+    QMutexLocker locker(&m_mMutex);
+
+    if (pTile->m_bRegistered)
+    {
+        m_iMisses++;
+        m_iResidentBytes += iBytes - pTile->m_iResidentBytes;
+        pTile->m_iResidentBytes = iBytes;
+
+        evict(pTile);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Evicts tiles until the resident data fits in the budget. \a pExcluded is never evicted. \br\br
+    Two full sweeps are enough to clear all reference bits, so the loop is bounded even when
+    every tile is pinned or busy ; the cache then stays over budget until tiles are unpinned.
+*/
+void CElevationTileCache::evict(CElevationTile* pExcluded)
+{
+    int iSteps = m_vTiles.count() * 2;
+
+    while (m_iResidentBytes > m_iBudget && iSteps > 0)
+    {
+        iSteps--;
+
+        if (m_iClockHand >= m_vTiles.count())
+        {
+            m_iClockHand = 0;
+        }
+
+        CElevationTile* pTile = m_vTiles[m_iClockHand++];
+
+        if (pTile == pExcluded || pTile->m_iResidentBytes == 0 || pTile->isPinned())
+        {
+            continue;
+        }
+
+        // Second chance for recently used tiles
+        if (pTile->m_iReferenced.fetchAndStoreRelaxed(0) != 0)
+        {
+            continue;
+        }
+
+        if (pTile->releaseData())
+        {
+            m_iResidentBytes -= pTile->m_iResidentBytes;
+            pTile->m_iResidentBytes = 0;
+            m_iEvictions++;
+        }
+    }
+
+    if (m_iResidentBytes > m_iBudget)
+    {
+        LOG_METHOD_DEBUG(QString("%1 bytes resident for a budget of %2").arg(m_iResidentBytes).arg(m_iBudget));
+    }
+}
@@ -0,0 +1,110 @@
+
+#pragma once
+
+// Qt
+#include <QMutex>
+#include <QVector>
+
+// qt-plus
+#include "CSingleton.h"
+
+// Application
+#include "quick3d_global.h"
+#include "CElevationTile.h"
+
+//-------------------------------------------------------------------------------------------------
+
+//! Default byte budget of elevation data
+#define ELEVATION_CACHE_DEFAULT_BUDGET  ((qint64) 1024 * 1024 * 1024)
+
+//-------------------------------------------------------------------------------------------------
+
+//! Keeps the elevation data of SRTM, BIL and HGT tiles under a byte budget, using clock eviction
+class QUICK3D_EXPORT CElevationTileCache : public CSingleton<CElevationTileCache>
+{
+    friend class CSingleton<CElevationTileCache>;
+    friend class CElevationTile;
+
+public:
+
+    //-------------------------------------------------------------------------------------------------
+    // Setters
+    //-------------------------------------------------------------------------------------------------
+
+    //! Sets the maximum number of bytes of resident elevation data, evicting tiles if needed
+    void setBudget(qint64 iBytes);
+
+    //-------------------------------------------------------------------------------------------------
+    // Getters
+    //-------------------------------------------------------------------------------------------------
+
+    //! Returns the maximum number of bytes of resident elevation data
+    qint64 budget();
+
+    //! Returns the number of bytes of resident elevation data
+    qint64 residentBytes();
+
+    //! Returns the number of registered tiles
+    int tileCount();
+
+    //! Returns the number of accesses to resident tiles
+    qint64 hits();
+
+    //! Returns the number of tile loads
+    qint64 misses();
+
+    //! Returns the number of tiles evicted
+    qint64 evictions();
+
+    //-------------------------------------------------------------------------------------------------
+    // Control methods
+    //-------------------------------------------------------------------------------------------------
+
+    //! Resets the hit, miss and eviction counters
+    void resetCounters();
+
+    //-------------------------------------------------------------------------------------------------
+    // Constructors and destructor
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    //! Default constructor
+    CElevationTileCache();
+
+    //! Destructor
+    virtual ~CElevationTileCache();
+
+    //-------------------------------------------------------------------------------------------------
+    // Protected methods
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    //! Adds a tile to the cache
+    void registerTile(CElevationTile* pTile);
+
+    //! Removes a tile from the cache
+    void unregisterTile(CElevationTile* pTile);
+
+    //! Accounts for data loaded in a tile and evicts other tiles if over budget
+    void tileLoaded(CElevationTile* pTile, qint64 iBytes);
+
+    //! Evicts tiles until the budget is met, pExcluded is never evicted
+    void evict(CElevationTile* pExcluded);
+
+    //-------------------------------------------------------------------------------------------------
+    // Properties
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    QMutex                      m_mMutex;
+    QVector<CElevationTile*>    m_vTiles;           // Registered tiles, swept by the clock hand
+    int                         m_iClockHand;       // Index of the next eviction candidate
+    qint64                      m_iBudget;          // Maximum resident bytes
+    qint64                      m_iResidentBytes;   // Current resident bytes
+    qint64                      m_iMisses;          // Number of tile loads
+    qint64                      m_iEvictions;       // Number of tiles evicted
+    qint64                      m_iRetiredHits;     // Hits of unregistered tiles
+};
@@ -0,0 +1,142 @@
+
+// Qt
+#include <QMutexLocker>
+
+// qt-plus
+#include "CLogger.h"
+
+// Application
+#include "CElevationTilePrefetcher.h"
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    \class CElevationTilePrefetcher
+    \brief Loads elevation tiles in a background thread, ahead of the terrain workers.
+    \inmodule Quick3D
+    \sa CElevationTile, CHeightField::prefetchAlong()
+
+    Tiles are loaded oldest request first, through CElevationTile::prefetch(). The thread is started on the first request.
+    Loaded tiles are accounted in the CElevationTileCache like any other load, so they may be evicted if they are not used.
+*/
+
+//-------------------------------------------------------------------------------------------------
+
+CElevationTilePrefetcher::CElevationTilePrefetcher()
+    : m_pCurrent(nullptr)
+    , m_iPrefetchCount(0)
+    , m_bStopRequested(false)
+{
+}
+
+//-------------------------------------------------------------------------------------------------
+
+CElevationTilePrefetcher::~CElevationTilePrefetcher()
+{
+    {
+        QMutexLocker locker(&m_mMutex);
+
+        m_vQueue.clear();
+        m_bStopRequested = true;
+        m_cWorkAvailable.wakeAll();
+    }
+
+    wait();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+int CElevationTilePrefetcher::pendingCount()
+{
+    QMutexLocker locker(&m_mMutex);
+
+    return m_vQueue.count();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+qint64 CElevationTilePrefetcher::prefetchCount()
+{
+    QMutexLocker locker(&m_mMutex);
+
+    return m_iPrefetchCount;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Queues \a pTile for loading. When the queue is full, the oldest request is dropped,
+    it is the one the camera is most likely to have already passed.
+*/
+void CElevationTilePrefetcher::enqueue(CElevationTile* pTile)
+{
+    QMutexLocker locker(&m_mMutex);
+
+    if (m_bStopRequested || pTile == m_pCurrent || m_vQueue.contains(pTile))
+    {
+        return;
+    }
+
+    if (m_vQueue.count() >= ELEVATION_PREFETCH_MAX_QUEUE)
+    {
+        m_vQueue.removeFirst();
+    }
+
+    m_vQueue.append(pTile);
+
+    if (isRunning() == false)
+    {
+        start(QThread::LowPriority);
+    }
+
+    m_cWorkAvailable.wakeOne();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Removes \a pTile from the queue. If the tile is being loaded, waits until it is done. \br\br
+    Called by tiles about to be destroyed.
+*/
+void CElevationTilePrefetcher::cancel(CElevationTile* pTile)
+{
+    QMutexLocker locker(&m_mMutex);
+
+    m_vQueue.removeAll(pTile);
+
+    while (m_pCurrent == pTile)
+    {
+        m_cTileDone.wait(&m_mMutex);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CElevationTilePrefetcher::run()
+{
+    LOG_METHOD_DEBUG("START : Elevation prefetch thread");
+
+    QMutexLocker locker(&m_mMutex);
+
+    while (m_bStopRequested == false)
+    {
+        if (m_vQueue.isEmpty())
+        {
+            m_cWorkAvailable.wait(&m_mMutex);
+            continue;
+        }
+
+        m_pCurrent = m_vQueue.takeFirst();
+
+        // Loading may take a while, and evicting other tiles needs their locks
+        locker.unlock();
+        m_pCurrent->prefetch();
+        locker.relock();
+
+        m_pCurrent = nullptr;
+        m_iPrefetchCount++;
+        m_cTileDone.wakeAll();
+    }
+
+    LOG_METHOD_DEBUG("FINISHED : Elevation prefetch thread");
+}
@@ -0,0 +1,87 @@
+
+#pragma once
+
+// Qt
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+
+// qt-plus
+#include "CSingleton.h"
+
+// Application
+#include "quick3d_global.h"
+#include "CElevationTile.h"
+
+//-------------------------------------------------------------------------------------------------
+
+//! Maximum number of tiles waiting to be prefetched, older requests are dropped first
+#define ELEVATION_PREFETCH_MAX_QUEUE    32
+
+//-------------------------------------------------------------------------------------------------
+
+//! Loads elevation tiles in a background thread before the terrain needs them
+class QUICK3D_EXPORT CElevationTilePrefetcher : public QThread, public CSingleton<CElevationTilePrefetcher>
+{
+    Q_OBJECT
+
+    friend class CSingleton<CElevationTilePrefetcher>;
+
+public:
+
+    //-------------------------------------------------------------------------------------------------
+    // Getters
+    //-------------------------------------------------------------------------------------------------
+
+    //! Returns the number of tiles waiting to be prefetched
+    int pendingCount();
+
+    //! Returns the number of tiles prefetched so far
+    qint64 prefetchCount();
+
+    //-------------------------------------------------------------------------------------------------
+    // Control methods
+    //-------------------------------------------------------------------------------------------------
+
+    //! Queues a tile for loading, does nothing if it is already queued
+    void enqueue(CElevationTile* pTile);
+
+    //! Removes a tile from the queue, waits if it is being loaded
+    void cancel(CElevationTile* pTile);
+
+    //-------------------------------------------------------------------------------------------------
+    // Constructors and destructor
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    //! Default constructor
+    CElevationTilePrefetcher();
+
+    //! Destructor
+    virtual ~CElevationTilePrefetcher();
+
+    //-------------------------------------------------------------------------------------------------
+    // Protected methods
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    //!
+    virtual void run() Q_DECL_OVERRIDE;
+
+    //-------------------------------------------------------------------------------------------------
+    // Properties
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    QMutex                      m_mMutex;           // Protects all members below
+    QWaitCondition              m_cWorkAvailable;   // Signaled when a tile is queued or on stop
+    QWaitCondition              m_cTileDone;        // Signaled when m_pCurrent is done
+    QVector<CElevationTile*>    m_vQueue;           // Tiles to load, oldest first
+    CElevationTile*             m_pCurrent;         // Tile being loaded
+    qint64                      m_iPrefetchCount;   // Number of tiles loaded
+    bool                        m_bStopRequested;   // Is the thread stopping?
+};
@@ -1,9 +1,16 @@
 
+// Std
+#include <cmath>
+
 // Qt
+#include <QtEndian>
+#include <QFileInfo>
 #include <QMutexLocker>
+#include <QVector>
 
 // Application
 #include "Angles.h"
+#include "CHeightField.h"
 #include "CHGTData.h"
 
 //-------------------------------------------------------------------------------------------------
@@ -14,11 +21,13 @@ using namespace Math;
 
 CHGTData::CHGTData(const CGeoloc& gGeoloc, const CGeoloc& gSize)
     : m_tMutex(QMutex::Recursive)
+    , m_pData(nullptr)
+    , m_iReaders(0)
     , m_gGeoloc(gGeoloc)
     , m_gSize(gSize)
     , m_iNumCellsWidth(1201)
     , m_iNumCellsHeight(1201)
-    , m_pFile(nullptr)
+    , m_bFileError(false)
 {
 }
 
@@ -26,19 +35,14 @@ CHGTData::CHGTData(const CGeoloc& gGeoloc, const CGeoloc& gSize)
 
 CHGTData::~CHGTData()
 {
-    if (m_pFile != nullptr)
-    {
-        m_pFile->close();
-        delete m_pFile;
-    }
+    detachFromCache();
+    closeFile();
 }
 
 //-------------------------------------------------------------------------------------------------
 
 double CHGTData::getHeightAt(const CGeoloc& gPosition, double* pRigidness)
 {
-    QMutexLocker locker(&m_tMutex);
-
     if (pRigidness != nullptr) *pRigidness = 1.0;
 
     double dLatDiff = gPosition.Latitude - m_gGeoloc.Latitude;
@@ -50,41 +54,17 @@ double CHGTData::getHeightAt(const CGeoloc& gPosition, double* pRigidness)
     double dLatPos = (1.0 - (dLatDiff / m_gSize.Latitude)) * ((double) m_iNumCellsHeight - 1);
     double dLonPos = (dLonDiff / m_gSize.Longitude) * ((double) m_iNumCellsWidth - 1);
 
-    double d1 = 0.0;
-    double d2 = 0.0;
-    double d3 = 0.0;
-    double d4 = 0.0;
+    int iRow = (int) dLatPos;
+    int iCol = (int) dLonPos;
 
-    for (int iLatOfs = 0; iLatOfs < 2; iLatOfs++)
-    {
-        for (int iLonOfs = 0; iLonOfs < 2; iLonOfs++)
-        {
-            if (
-                    ((int) dLatPos + iLatOfs) >= 0 && ((int) dLatPos + iLatOfs) < (m_iNumCellsHeight) &&
-                    ((int) dLonPos + iLonOfs) >= 0 && ((int) dLonPos + iLonOfs) < (m_iNumCellsWidth)
-                    )
-            {
-                short sData;
-                int iOffset = ((((int) dLatPos + iLatOfs) * m_iNumCellsWidth) + ((int) dLonPos + iLonOfs)) * sizeof(short);
-                if (m_pFile->seek(iOffset))
-                {
-                    m_pFile->read((char*) &sData, sizeof(short));
-                    unsigned short* pShort = (unsigned short*) &sData;
-                    *pShort = ((*pShort & 0x00FF) << 8) | ((*pShort & 0xFF00) >> 8);
-
-                    if (iLatOfs == 0 && iLonOfs == 0) d1 = (double) sData;
-                    else if (iLatOfs == 0 && iLonOfs == 1) d2 = (double) sData;
-                    else if (iLatOfs == 1 && iLonOfs == 0) d3 = (double) sData;
-                    else if (iLatOfs == 1 && iLonOfs == 1) d4 = (double) sData;
-                }
-            }
-        }
-    }
+    const uchar* pData = acquireData();
 
-    if (d1 == 0.0) d1 = -100.0;
-    if (d2 == 0.0) d2 = -100.0;
-    if (d3 == 0.0) d3 = -100.0;
-    if (d4 == 0.0) d4 = -100.0;
+    double d1 = readCell(pData, iRow + 0, iCol + 0);
+    double d2 = readCell(pData, iRow + 0, iCol + 1);
+    double d3 = readCell(pData, iRow + 1, iCol + 0);
+    double d4 = readCell(pData, iRow + 1, iCol + 1);
+
+    releaseReader(pData);
 
     double fx = dLonPos - ((double) (int) dLonPos);
     double fy = dLatPos - ((double) (int) dLatPos);
@@ -101,6 +81,170 @@ double CHGTData::getHeightAt(const CGeoloc& gPosition, double* pRigidness)
 
 //-------------------------------------------------------------------------------------------------
 
+/*!
+    Writes the heights at \a pPositions[\a pIndices[i]] to \a pHeights[\a pIndices[i]], for the \a iCount indices. \br\br
+    All corners are fetched first, then interpolated together.
+*/
+void CHGTData::getHeightsAt(const CGeoloc* pPositions, const int* pIndices, int iCount, double* pHeights)
+{
+    QVector<double> vLatPos(iCount);
+    QVector<double> vLonPos(iCount);
+    QVector<double> vCorners(iCount * 4);
+    QVector<double> vResults(iCount);
+
+    double* pCorners1 = vCorners.data();
+    double* pCorners2 = pCorners1 + iCount;
+    double* pCorners3 = pCorners2 + iCount;
+    double* pCorners4 = pCorners3 + iCount;
+
+    const uchar* pData = acquireData();
+
+    for (int iIndex = 0; iIndex < iCount; iIndex++)
+    {
+        const CGeoloc& gPosition = pPositions[pIndices[iIndex]];
+
+        double dLatDiff = Angles::clipAngleDegree(gPosition.Latitude - m_gGeoloc.Latitude);
+        double dLonDiff = Angles::clipAngleDegree(gPosition.Longitude - m_gGeoloc.Longitude);
+
+        vLatPos[iIndex] = (1.0 - (dLatDiff / m_gSize.Latitude)) * ((double) m_iNumCellsHeight - 1);
+        vLonPos[iIndex] = (dLonDiff / m_gSize.Longitude) * ((double) m_iNumCellsWidth - 1);
+
+        int iRow = (int) vLatPos[iIndex];
+        int iCol = (int) vLonPos[iIndex];
+
+        pCorners1[iIndex] = readCell(pData, iRow + 0, iCol + 0);
+        pCorners2[iIndex] = readCell(pData, iRow + 0, iCol + 1);
+        pCorners3[iIndex] = readCell(pData, iRow + 1, iCol + 0);
+        pCorners4[iIndex] = readCell(pData, iRow + 1, iCol + 1);
+    }
+
+    releaseReader(pData);
+
+    CHeightField::interpolateCorners(
+                pCorners1,
+                pCorners2,
+                pCorners3,
+                pCorners4,
+                vLatPos.constData(),
+                vLonPos.constData(),
+                vResults.data(),
+                iCount
+                );
+
+    for (int iIndex = 0; iIndex < iCount; iIndex++)
+    {
+        pHeights[pIndices[iIndex]] = vResults[iIndex];
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Returns the mapped samples, mapping the file if needed, or \c nullptr if the file is not available. \br\br
+    The caller is registered as a reader until releaseReader() is called, so the mapping cannot be evicted meanwhile.
+    No lock is taken when the file is already mapped.
+*/
+const uchar* CHGTData::acquireData()
+{
+    while (true)
+    {
+        // The reader count is raised before the pointer is read, releaseData() does the opposite
+        m_iReaders.ref();
+
+        const uchar* pData = m_pData.fetchAndAddOrdered(0);
+
+        if (pData != nullptr)
+        {
+            touch();
+            return pData;
+        }
+
+        m_iReaders.deref();
+
+        if (mapFile() == false)
+        {
+            return nullptr;
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CHGTData::releaseReader(const uchar* pData)
+{
+    if (pData != nullptr)
+    {
+        m_iReaders.deref();
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+bool CHGTData::mapFile()
+{
+    qint64 iBytes = 0;
+
+    {
+        QMutexLocker locker(&m_tMutex);
+
+        if (m_pData.load() != nullptr)
+        {
+            return true;
+        }
+
+        if (m_bFileError)
+        {
+            return false;
+        }
+
+        if (m_tFile.isOpen() == false && m_tFile.open(QIODevice::ReadOnly) == false)
+        {
+            m_bFileError = true;
+            return false;
+        }
+
+        iBytes = m_tFile.size();
+
+        uchar* pData = nullptr;
+
+        if ((qint64) m_iNumCellsWidth * m_iNumCellsHeight * sizeof(qint16) <= iBytes)
+        {
+            pData = m_tFile.map(0, iBytes);
+        }
+
+        if (pData == nullptr)
+        {
+            m_bFileError = true;
+            return false;
+        }
+
+        m_pData.storeRelease(pData);
+    }
+
+    dataLoaded(iBytes);
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+double CHGTData::readCell(const uchar* pData, int iRow, int iCol) const
+{
+    if (pData != nullptr && iRow >= 0 && iRow < m_iNumCellsHeight && iCol >= 0 && iCol < m_iNumCellsWidth)
+    {
+        qint16 iValue = qFromBigEndian<qint16>(pData + ((iRow * m_iNumCellsWidth) + iCol) * sizeof(qint16));
+
+        if (iValue != 0)
+        {
+            return (double) iValue;
+        }
+    }
+
+    return -100.0;
+}
+
+//-------------------------------------------------------------------------------------------------
+
 bool CHGTData::contains(const CGeoloc& gPosition) const
 {
     double dLatDiff1 = Math::Angles::angleDifferenceDegree(m_gGeoloc.Latitude, gPosition.Latitude);
@@ -119,16 +263,120 @@ bool CHGTData::contains(const CGeoloc& gPosition) const
 
 //-------------------------------------------------------------------------------------------------
 
+bool CHGTData::intersects(const CGeoloc& gPosition, const CGeoloc& gSize) const
+{
+    double dLatDiff = Math::Angles::angleDifferenceDegree(m_gGeoloc.Latitude + m_gSize.Latitude * 0.5, gPosition.Latitude);
+    double dLonDiff = Math::Angles::angleDifferenceDegree(m_gGeoloc.Longitude + m_gSize.Longitude * 0.5, gPosition.Longitude);
+
+    return
+            fabs(dLatDiff) <= (m_gSize.Latitude + gSize.Latitude) * 0.5 &&
+            fabs(dLonDiff) <= (m_gSize.Longitude + gSize.Longitude) * 0.5;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Sets the HGT file of this tile to \a sFileName. The file is mapped on first use. \br\br
+    The grid size is deduced from the file size : 1201 for 3 arc-second tiles, 3601 for 1 arc-second tiles.
+    Must not be called while other threads read this tile.
+*/
 void CHGTData::setFileName(QString sFileName)
 {
+    closeFile();
+
     m_sFileName = sFileName;
+    m_tFile.setFileName(m_sFileName);
+    m_bFileError = false;
+
+    qint64 iSize = QFileInfo(m_sFileName).size();
+    int iSide = (int) sqrt((double) (iSize / (qint64) sizeof(qint16)));
 
-    if (m_pFile != nullptr)
+    if ((qint64) iSide * iSide * sizeof(qint16) == iSize)
     {
-        m_pFile->close();
-        delete m_pFile;
+        m_iNumCellsWidth = iSide;
+        m_iNumCellsHeight = iSide;
     }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CHGTData::closeFile()
+{
+    QMutexLocker locker(&m_tMutex);
+
+    const uchar* pData = m_pData.fetchAndStoreOrdered(nullptr);
+
+    if (pData != nullptr)
+    {
+        m_tFile.unmap((uchar*) pData);
+    }
+
+    if (m_tFile.isOpen())
+    {
+        m_tFile.close();
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Maps the file and reads one byte per page, so that the first height queries do not wait on disk. \br\br
+    Called by the prefetch thread.
+*/
+void CHGTData::prefetch()
+{
+    if (mapFile() == false)
+    {
+        return;
+    }
+
+    m_iReaders.ref();
+
+    const uchar* pData = m_pData.fetchAndAddOrdered(0);
+
+    if (pData != nullptr)
+    {
+        qint64 iBytes = (qint64) m_iNumCellsWidth * m_iNumCellsHeight * sizeof(qint16);
+        volatile uchar ucSum = 0;
+
+        for (qint64 iOffset = 0; iOffset < iBytes; iOffset += 4096)
+        {
+            ucSum += pData[iOffset];
+        }
+    }
+
+    m_iReaders.deref();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Unmaps the file, unless the tile is being mapped or read by another thread. \br\br
+    The pointer is cleared before the reader count is checked, so a reader either sees the mapping
+    and is counted, or sees \c nullptr and waits on the mutex to map the file again.
+*/
+bool CHGTData::releaseData()
+{
+    if (m_tMutex.tryLock() == false)
+    {
+        return false;
+    }
+
+    const uchar* pData = m_pData.fetchAndStoreOrdered(nullptr);
+
+    if (pData != nullptr)
+    {
+        if (m_iReaders.fetchAndAddOrdered(0) != 0)
+        {
+            m_pData.storeRelease(pData);
+            m_tMutex.unlock();
+            return false;
+        }
+
+        m_tFile.unmap((uchar*) pData);
+    }
+
+    m_tMutex.unlock();
 
-    m_pFile = new QFile(m_sFileName);
-    m_pFile->open(QIODevice::ReadOnly);
+    return true;
 }
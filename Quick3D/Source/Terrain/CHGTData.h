@@ -4,8 +4,10 @@
 //-------------------------------------------------------------------------------------------------
 
 // Qt
-#include <QMutex>
 #include <QFile>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QAtomicPointer>
 
 // qt-plus
 #include "CXMLNode.h"
@@ -14,6 +16,7 @@
 #include "quick3d_global.h"
 #include "CVector3.h"
 #include "CGeoloc.h"
+#include "CElevationTile.h"
 
 //-------------------------------------------------------------------------------------------------
 
@@ -38,7 +41,8 @@
 */
 
 //! HGT tile data storage class
-class QUICK3D_EXPORT CHGTData
+//! The file is mapped read-only on first use, concurrent readers need no lock
+class QUICK3D_EXPORT CHGTData : public CElevationTile
 {
 public:
 
@@ -66,12 +70,18 @@ public:
     //! Returns the altitude at the specified geolocation
     double getHeightAt(const CGeoloc& gPosition, double* pRigidness = nullptr);
 
+    //! Writes the altitudes at the geolocations pPositions[pIndices[i]] to pHeights[pIndices[i]], for i in [0, iCount[
+    void getHeightsAt(const CGeoloc* pPositions, const int* pIndices, int iCount, double* pHeights);
+
     //! Returns the number of cells on the width axis
     int numCellsWidth() { return m_iNumCellsWidth; }
 
     //! Returns the number of cells on the height axis
     int numCellsHeight() { return m_iNumCellsHeight; }
 
+    //! Returns \c true if the file is mapped in memory
+    bool isMapped() const { return m_pData.load() != nullptr; }
+
     //-------------------------------------------------------------------------------------------------
     // Control methods
     //-------------------------------------------------------------------------------------------------
@@ -79,23 +89,50 @@ public:
     //! Returns \c true if the tile contains the specified geolocation
     bool contains(const CGeoloc& gPosition) const;
 
+    //! Returns \c true if the tile intersects the area centered on gPosition, of size gSize
+    bool intersects(const CGeoloc& gPosition, const CGeoloc& gSize) const;
+
     //-------------------------------------------------------------------------------------------------
     // Protected methods
     //-------------------------------------------------------------------------------------------------
 
 protected:
 
+    //! Returns the mapped samples and registers the caller as a reader, or nullptr if the file is not available
+    const uchar* acquireData();
+
+    //! Unregisters a reader, pData is the value returned by acquireData()
+    void releaseReader(const uchar* pData);
+
+    //! Maps the file if it is not already, returns false on failure
+    bool mapFile();
+
+    //! Returns the elevation of a cell in pData, or -100.0 if it is missing or zero
+    double readCell(const uchar* pData, int iRow, int iCol) const;
+
+    //! Unmaps and closes the file
+    void closeFile();
+
+    //! Maps the file and faults its pages in
+    virtual void prefetch() Q_DECL_OVERRIDE;
+
+    //! Unmaps the file if no reader uses it
+    virtual bool releaseData() Q_DECL_OVERRIDE;
+
     //-------------------------------------------------------------------------------------------------
     // Properties
     //-------------------------------------------------------------------------------------------------
 
 protected:
 
-    QMutex      m_tMutex;
-    QFile*      m_pFile;
-    QString     m_sFileName;
-    CGeoloc     m_gGeoloc;
-    CGeoloc     m_gSize;
-    int         m_iNumCellsWidth;
-    int         m_iNumCellsHeight;
+    QMutex                      m_tMutex;           // Protects mapping and unmapping, readers do not take it
+    QFile                       m_tFile;
+    QAtomicPointer<const uchar> m_pData;            // Big endian samples, mapped from m_tFile
+    QAtomicInt                  m_iReaders;         // Number of threads reading m_pData
+    QString                     m_sFileName;
+    CGeoloc                     m_gGeoloc;
+    CGeoloc                     m_gSize;
+    int                         m_iNumCellsWidth;
+    int                         m_iNumCellsHeight;
+    bool                        m_bFileError;       // Set when the file cannot be mapped, avoids retrying on each sample
 };
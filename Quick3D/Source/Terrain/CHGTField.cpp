@@ -1,9 +1,12 @@
 
 // Qt
 #include <QDir>
+#include <QHash>
+#include <QMap>
 #include <QStringList>
 
 // Application
+#include "CElevationTilePrefetcher.h"
 #include "CHGTField.h"
 
 //-------------------------------------------------------------------------------------------------
@@ -66,23 +69,63 @@ void CHGTField::parseFiles()
         pChunk->setFileName(m_sPath + "/" + sFile);
 
         m_vChunks.append(pChunk);
+        m_mChunkIndex[tileKey((int) dLat, (int) dLon)] = pChunk;
     }
 }
 
 //-------------------------------------------------------------------------------------------------
 
-double CHGTField::getHeightAt(const CGeoloc& gPosition, double* pRigidness)
+/*!
+    Returns the index key of the one degree tile whose south west corner is at \a iLatitude, \a iLongitude.
+*/
+int CHGTField::tileKey(int iLatitude, int iLongitude)
 {
-    if (pRigidness != nullptr) *pRigidness = 1.0;
+    iLatitude = ((iLatitude % 360) + 360) % 360;
+    iLongitude = ((iLongitude % 360) + 360) % 360;
 
-    foreach (CHGTData* pChunk, m_vChunks)
+    return iLatitude * 360 + iLongitude;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Returns the tile containing \a gPosition, or \c nullptr if none is loaded.
+*/
+CHGTData* CHGTField::chunkAt(const CGeoloc& gPosition) const
+{
+    int iLatitude = (int) floor(Angles::clipAngleDegree(gPosition.Latitude));
+    int iLongitude = (int) floor(Angles::clipAngleDegree(gPosition.Longitude));
+
+    // Positions on a tile edge also belong to the south and west neighbours
+    for (int iLatOfs = 0; iLatOfs >= -1; iLatOfs--)
     {
-        if (pChunk->contains(gPosition))
+        for (int iLonOfs = 0; iLonOfs >= -1; iLonOfs--)
         {
-            return pChunk->getHeightAt(gPosition, pRigidness);
+            CHGTData* pChunk = m_mChunkIndex.value(tileKey(iLatitude + iLatOfs, iLongitude + iLonOfs), nullptr);
+
+            if (pChunk != nullptr && pChunk->contains(gPosition))
+            {
+                return pChunk;
+            }
         }
     }
 
+    return nullptr;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+double CHGTField::getHeightAt(const CGeoloc& gPosition, double* pRigidness)
+{
+    if (pRigidness != nullptr) *pRigidness = 1.0;
+
+    CHGTData* pChunk = chunkAt(gPosition);
+
+    if (pChunk != nullptr)
+    {
+        return pChunk->getHeightAt(gPosition, pRigidness);
+    }
+
     return Q3D_INFINITY;
 }
 
@@ -109,6 +152,80 @@ double CHGTField::getHeightAt(const Math::CVector3& vPosition, const Math::CAxis
 
 //-------------------------------------------------------------------------------------------------
 
+void CHGTField::getHeightsAt(const CGeoloc* pPositions, double* pHeights, int iCount, bool bForPhysics)
+{
+    QMap<CHGTData*, QVector<int> > mBatches;
+    CHGTData* pLastChunk = nullptr;
+
+    // Group positions by tile, neighbouring positions usually fall in the same one
+    for (int iIndex = 0; iIndex < iCount; iIndex++)
+    {
+        pHeights[iIndex] = Q3D_INFINITY;
+
+        if (pLastChunk == nullptr || pLastChunk->contains(pPositions[iIndex]) == false)
+        {
+            pLastChunk = chunkAt(pPositions[iIndex]);
+        }
+
+        if (pLastChunk != nullptr)
+        {
+            mBatches[pLastChunk].append(iIndex);
+        }
+    }
+
+    for (QMap<CHGTData*, QVector<int> >::const_iterator iBatch = mBatches.constBegin(); iBatch != mBatches.constEnd(); ++iBatch)
+    {
+        iBatch.key()->getHeightsAt(pPositions, iBatch.value().constData(), iBatch.value().count(), pHeights);
+    }
+
+    if (!bForPhysics)
+    {
+        for (int iIndex = 0; iIndex < iCount; iIndex++)
+        {
+            if (pHeights[iIndex] < 0.0) pHeights[iIndex] = 0.0;
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
 void CHGTField::flatten(const CGeoloc& gPosition, double dRadius)
 {
 }
+
+//-------------------------------------------------------------------------------------------------
+
+void CHGTField::setTilesPinned(const CGeoloc& gPosition, const CGeoloc& gSize, bool bPinned)
+{
+    foreach (CHGTData* pChunk, m_vChunks)
+    {
+        if (pChunk->intersects(gPosition, gSize))
+        {
+            if (bPinned)
+            {
+                pChunk->pin();
+            }
+            else
+            {
+                pChunk->unpin();
+            }
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CHGTField::prefetchAlong(const CGeoloc& gFrom, const CGeoloc& gTo)
+{
+    QVector<CGeoloc> vPoints = samplePath(gFrom, gTo, HEIGHTFIELD_PREFETCH_STEP);
+
+    foreach (const CGeoloc& gPoint, vPoints)
+    {
+        CHGTData* pChunk = chunkAt(gPoint);
+
+        if (pChunk != nullptr)
+        {
+            CElevationTilePrefetcher::getInstance()->enqueue(pChunk);
+        }
+    }
+}
@@ -1,6 +1,9 @@
 
 #pragma once
 
+// Qt
+#include <QHash>
+
 // qt-plus
 #include "CXMLNode.h"
 
@@ -44,6 +47,9 @@ public:
     //!
     virtual double getHeightAt(const Math::CVector3& vPosition, const Math::CAxis& aAxis, bool bForPhysics = true);
 
+    //!
+    virtual void getHeightsAt(const CGeoloc* pPositions, double* pHeights, int iCount, bool bForPhysics = true);
+
     //-------------------------------------------------------------------------------------------------
     // Control methods
     //-------------------------------------------------------------------------------------------------
@@ -51,6 +57,12 @@ public:
     //!
     virtual void flatten(const CGeoloc& gPosition, double dRadius);
 
+    //!
+    virtual void setTilesPinned(const CGeoloc& gPosition, const CGeoloc& gSize, bool bPinned);
+
+    //!
+    virtual void prefetchAlong(const CGeoloc& gFrom, const CGeoloc& gTo);
+
     //-------------------------------------------------------------------------------------------------
     // Protected methods
     //-------------------------------------------------------------------------------------------------
@@ -60,13 +72,20 @@ protected:
     //!
     void parseFiles();
 
+    //! Returns the tile containing gPosition, or nullptr
+    CHGTData* chunkAt(const CGeoloc& gPosition) const;
+
+    //! Returns the index key of a one degree tile
+    static int tileKey(int iLatitude, int iLongitude);
+
     //-------------------------------------------------------------------------------------------------
     // Properties
     //-------------------------------------------------------------------------------------------------
 
 protected:
 
-    CXMLNode            m_xParameters;
-    QString             m_sPath;
-    QVector<CHGTData*>  m_vChunks;
+    CXMLNode                m_xParameters;
+    QString                 m_sPath;
+    QVector<CHGTData*>      m_vChunks;
+    QHash<int, CHGTData*>   m_mChunkIndex;      // Tiles by tileKey(), for constant time lookups
 };
@@ -1,4 +1,7 @@
 
+// Qt
+#include <QtConcurrent>
+
 // qt-plus
 #include "CLogger.h"
 
@@ -8,46 +11,159 @@
 
 //-------------------------------------------------------------------------------------------------
 
-CHTTPMapClient::CHTTPMapClient()
-    : m_pReply(nullptr)
+// Stores downloaded data, or reads stored data if baData is empty, and decodes it
+static QImage decodeTile(QSharedPointer<CTileStore> pStore, QString sTileName, QByteArray baData)
 {
-    m_sTilePath = QCoreApplication::applicationDirPath() + "/Tiles";
+    if (baData.isEmpty())
+    {
+        baData = pStore->read(sTileName);
+    }
+    else
+    {
+        pStore->write(sTileName, baData);
+    }
+
+    QImage image;
 
-    if (!QDir().exists(m_sTilePath))
+    if (image.loadFromData(baData, "JPG"))
     {
-        QDir().mkpath(m_sTilePath);
+        return image.convertToFormat(QImage::Format_RGB888);
     }
 
+    return QImage();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+CHTTPMapClient::CHTTPMapClient()
+    : m_iMaxConnections(TILES_DEFAULT_CONNECTIONS)
+    , m_bDispatchScheduled(false)
+{
+    setTilePath(QCoreApplication::applicationDirPath() + "/Tiles");
+
     CXMLNode xParameters = CPreferencesManager::getInstance()->preferences();
     CXMLNode xTiles = xParameters.getNodeByTagName(TILES_PARAM);
     CXMLNode xServerURL = xTiles.getNodeByTagName(TILES_PARAM_SERVER_URL);
+    CXMLNode xConnections = xTiles.getNodeByTagName(TILES_PARAM_CONNECTIONS);
 
     if (xServerURL.isEmpty() == false)
     {
         m_sTileServerURL = xServerURL.attributes()["Value"];
     }
+
+    if (xConnections.isEmpty() == false)
+    {
+        setMaxConnections(xConnections.attributes()["Value"].toInt());
+    }
 }
 
 //-------------------------------------------------------------------------------------------------
 
 CHTTPMapClient::~CHTTPMapClient()
 {
+    foreach (QNetworkReply* pReply, m_mReplies.keys())
+    {
+        pReply->disconnect(this);
+        pReply->abort();
+        pReply->deleteLater();
+    }
+
+    // Decoding threads use the store
+    foreach (QFutureWatcher<QImage>* pWatcher, m_mDecodes.keys())
+    {
+        pWatcher->disconnect(this);
+        pWatcher->waitForFinished();
+        delete pWatcher;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CHTTPMapClient::setTilePath(const QString& sPath)
+{
+    m_pStore = CTileStore::shared(sPath);
 }
 
 //-------------------------------------------------------------------------------------------------
 
-void CHTTPMapClient::loadTile(QString sTileName)
+void CHTTPMapClient::setMaxConnections(int iValue)
 {
-    if (m_vRequestedTiles.contains(sTileName) == false)
+    // QNetworkAccessManager opens at most 6 connections per host, more requests wait in its own queue
+    m_iMaxConnections = qBound(1, iValue, 6);
+
+    dispatchRequests();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CHTTPMapClient::loadTile(QString sTileName, double dPriority)
+{
+    if (m_mPriorities.contains(sTileName))
     {
-        m_vRequestedTiles.insert(0, sTileName);
+        // Move the request to its new place in the queue
+        m_mQueue.remove(m_mPriorities[sTileName], sTileName);
+        m_mQueue.insert(dPriority, sTileName);
+        m_mPriorities[sTileName] = dPriority;
+        return;
+    }
 
-        loadNextTile();
+    if (m_vLoadedTiles.contains(sTileName) || m_mReplies.values().contains(sTileName) || m_mDecodes.values().contains(sTileName))
+    {
+        return;
+    }
+
+    if (m_pStore->contains(sTileName))
+    {
+        startDecode(sTileName, QByteArray());
+        return;
+    }
+
+    if (m_sTileServerURL.isEmpty())
+    {
+        LOG_METHOD_ERROR(QString("Tile server URL undefined"));
+        return;
+    }
+
+    m_mQueue.insert(dPriority, sTileName);
+    m_mPriorities[sTileName] = dPriority;
+
+    // Requests made during the same event loop pass are ranked together before any is sent
+    if (m_bDispatchScheduled == false)
+    {
+        m_bDispatchScheduled = true;
+
+        QMetaObject::invokeMethod(this, "onDispatchRequests", Qt::QueuedConnection);
     }
 }
 
 //-------------------------------------------------------------------------------------------------
 
+void CHTTPMapClient::cancelTile(QString sTileName)
+{
+    if (m_mPriorities.contains(sTileName))
+    {
+        m_mQueue.remove(m_mPriorities[sTileName], sTileName);
+        m_mPriorities.remove(sTileName);
+    }
+
+    foreach (QNetworkReply* pReply, m_mReplies.keys(sTileName))
+    {
+        LOG_METHOD_DEBUG(QString("Cancelling tile %1").arg(sTileName));
+
+        // httpFinished() is called with OperationCanceledError
+        pReply->abort();
+    }
+
+    foreach (QFutureWatcher<QImage>* pWatcher, m_mDecodes.keys(sTileName))
+    {
+        m_mDecodes[pWatcher] = QString();
+    }
+
+    m_vLoadedTiles.remove(sTileName);
+}
+
+//-------------------------------------------------------------------------------------------------
+
 QImage CHTTPMapClient::getTile(QString sTileName)
 {
     if (m_vLoadedTiles.contains(sTileName))
@@ -64,118 +180,100 @@ QImage CHTTPMapClient::getTile(QString sTileName)
 
 //-------------------------------------------------------------------------------------------------
 
-void CHTTPMapClient::loadNextTile()
+void CHTTPMapClient::dispatchRequests()
 {
-    if (m_pReply == nullptr)
+    while (m_mReplies.count() < m_iMaxConnections && m_mQueue.count() > 0)
     {
-        if (m_vRequestedTiles.count() > 0)
-        {
-            m_sCurrentTileName = m_vRequestedTiles[0];
-            m_vRequestedTiles.remove(0);
+        QString sTileName = m_mQueue.first();
 
-            QString sFileName = m_sTilePath + "/" + m_sCurrentTileName + ".jpg";
+        m_mQueue.erase(m_mQueue.begin());
+        m_mPriorities.remove(sTileName);
 
-            if (QFile::exists(sFileName))
-            {
-                QImage img;
+        QUrl uURL = QString(m_sTileServerURL).arg(sTileName);
 
-                if (img.load(sFileName, "JPG"))
-                {
-                    m_vLoadedTiles[m_sCurrentTileName] = img;
-                }
+        QNetworkReply* pReply = m_tNetMan.get(QNetworkRequest(uURL));
 
-                emit tileReady(m_sCurrentTileName);
+        LOG_METHOD_DEBUG(QString("Requesting tile %1").arg(sTileName));
 
-                loadNextTile();
-            }
-            else
-            {
-                if (m_sTileServerURL.isEmpty() == false)
-                {
-                    m_uURL = QString(m_sTileServerURL).arg(m_sCurrentTileName);
-
-                    m_pReply = m_tNetMan.get(QNetworkRequest(m_uURL));
-
-                    LOG_METHOD_DEBUG(QString("Requesting tile %1").arg(m_sCurrentTileName));
-
-                    connect(m_pReply, SIGNAL(finished()), this, SLOT(httpFinished()));
-                    connect(m_pReply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(httpError(QNetworkReply::NetworkError)));
-                    connect(m_pReply, SIGNAL(readyRead()), this, SLOT(httpReadyRead()));
-                }
-                else
-                {
-                    LOG_METHOD_ERROR(QString("Tile server URL undefined"));
-                }
-            }
-        }
+        m_mReplies[pReply] = sTileName;
+
+        connect(pReply, SIGNAL(finished()), this, SLOT(httpFinished()));
     }
 }
 
 //-------------------------------------------------------------------------------------------------
 
-void CHTTPMapClient::httpFinished()
+void CHTTPMapClient::startDecode(QString sTileName, QByteArray baData)
 {
-    if (m_pReply != nullptr)
-    {
-        if (m_pReply->error() == QNetworkReply::NoError)
-        {
-            if (m_baIncomingData.count() > 0)
-            {
-                QString sFileName = m_sTilePath + "/" + m_sCurrentTileName + ".jpg";
+    QFutureWatcher<QImage>* pWatcher = new QFutureWatcher<QImage>(this);
 
-                QFile fImageFile(sFileName);
+    m_mDecodes[pWatcher] = sTileName;
 
-                if (fImageFile.open(QIODevice::WriteOnly))
-                {
-                    fImageFile.write(m_baIncomingData);
-                    fImageFile.close();
-                }
+    connect(pWatcher, SIGNAL(finished()), this, SLOT(onTileDecoded()));
 
-                LOG_METHOD_DEBUG(QString("Downloaded tile %1").arg(m_sCurrentTileName));
+    pWatcher->setFuture(QtConcurrent::run(decodeTile, m_pStore, sTileName, baData));
+}
 
-                QImage image;
+//-------------------------------------------------------------------------------------------------
 
-                if (image.loadFromData(m_baIncomingData, "JPG"))
-                {
-                    m_vLoadedTiles[m_sCurrentTileName] = image.convertToFormat(QImage::Format_RGB888);
-                }
+void CHTTPMapClient::onDispatchRequests()
+{
+    m_bDispatchScheduled = false;
+
+    dispatchRequests();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CHTTPMapClient::httpFinished()
+{
+    QNetworkReply* pReply = qobject_cast<QNetworkReply*>(sender());
+
+    if (pReply != nullptr && m_mReplies.contains(pReply))
+    {
+        QString sTileName = m_mReplies.take(pReply);
+
+        if (pReply->error() == QNetworkReply::NoError)
+        {
+            QByteArray baData = pReply->readAll();
 
-                emit tileReady(m_sCurrentTileName);
+            if (baData.count() > 0)
+            {
+                LOG_METHOD_DEBUG(QString("Downloaded tile %1").arg(sTileName));
+
+                startDecode(sTileName, baData);
             }
         }
-        else
+        else if (pReply->error() != QNetworkReply::OperationCanceledError)
         {
-            QNetworkReply::NetworkError err = m_pReply->error();
-
-            Q_UNUSED(err);
+            LOG_METHOD_DEBUG(QString("Tile %1 : %2").arg(sTileName).arg(pReply->errorString()));
         }
 
-        m_baIncomingData.clear();
+        pReply->deleteLater();
 
-        m_pReply->deleteLater();
-        m_pReply = nullptr;
-
-        loadNextTile();
+        dispatchRequests();
     }
 }
 
 //-------------------------------------------------------------------------------------------------
 
-void CHTTPMapClient::httpError(QNetworkReply::NetworkError code)
+void CHTTPMapClient::onTileDecoded()
 {
-    LOG_METHOD_DEBUG(QString("Tile %1").arg(m_sCurrentTileName));
-
-    m_baIncomingData.clear();
+    QFutureWatcher<QImage>* pWatcher = static_cast<QFutureWatcher<QImage>*>(sender());
 
-    m_pReply->deleteLater();
-    m_pReply = nullptr;
+    if (pWatcher != nullptr && m_mDecodes.contains(pWatcher))
+    {
+        QString sTileName = m_mDecodes.take(pWatcher);
+        QImage image = pWatcher->result();
 
-    loadNextTile();
-}
+        // A cancelled tile stays in the store
+        if (sTileName.isEmpty() == false && image.isNull() == false)
+        {
+            m_vLoadedTiles[sTileName] = image;
 
-//-------------------------------------------------------------------------------------------------
+            emit tileReady(sTileName);
+        }
 
-void CHTTPMapClient::httpReadyRead()
-{
-    m_baIncomingData.append(m_pReply->readAll());
+        pWatcher->deleteLater();
+    }
 }
@@ -6,15 +6,24 @@
 #include <QImage>
 #include <QtNetwork>
 #include <QNetworkAccessManager>
+#include <QFutureWatcher>
+
+// Application
+#include "quick3d_global.h"
+#include "CTileStore.h"
 
 //-------------------------------------------------------------------------------------------------
 
-#define TILES_PARAM             "Tiles"
-#define TILES_PARAM_SERVER_URL  "ServerURL"
+#define TILES_PARAM                 "Tiles"
+#define TILES_PARAM_SERVER_URL      "ServerURL"
+#define TILES_PARAM_CONNECTIONS     "Connections"
+
+//! Default number of tiles downloaded at the same time
+#define TILES_DEFAULT_CONNECTIONS   4
 
 //-------------------------------------------------------------------------------------------------
 
-class CHTTPMapClient : public QObject
+class QUICK3D_EXPORT CHTTPMapClient : public QObject
 {
     Q_OBJECT
 
@@ -30,25 +39,58 @@ public:
     // Destructeur
     virtual ~CHTTPMapClient();
 
+    //-------------------------------------------------------------------------------------------------
+    // Setters
+    //-------------------------------------------------------------------------------------------------
+
+    //! Sets the directory of the tile store
+    void setTilePath(const QString& sPath);
+
+    //! Sets the tile URL, %1 being replaced by the tile name
+    void setServerURL(const QString& sURL) { m_sTileServerURL = sURL; }
+
+    //! Sets the number of tiles downloaded at the same time
+    void setMaxConnections(int iValue);
+
+    //-------------------------------------------------------------------------------------------------
+    // Getters
+    //-------------------------------------------------------------------------------------------------
+
+    //! Returns the tile store
+    CTileStore& store() { return *m_pStore; }
+
+    //! Returns the number of tiles waiting for a connection
+    int pendingCount() const { return m_mPriorities.count(); }
+
+    //! Returns the number of tiles being downloaded
+    int activeCount() const { return m_mReplies.count(); }
+
     //-------------------------------------------------------------------------------------------------
     // Control methods
     //-------------------------------------------------------------------------------------------------
 
-    //!
-    void loadTile(QString sTileName);
+    //! Requests a tile, lower dPriority first, or updates the priority of a waiting request
+    void loadTile(QString sTileName, double dPriority = 0.0);
+
+    //! Cancels the request of a tile, aborting its download
+    void cancelTile(QString sTileName);
 
     //!
     QImage getTile(QString sTileName);
 
 protected:
 
-    void loadNextTile();
+    //! Starts downloads of the best waiting tiles while connections are free
+    void dispatchRequests();
+
+    //! Reads or stores and decodes a tile in a worker thread
+    void startDecode(QString sTileName, QByteArray baData);
 
 protected slots:
 
+    void onDispatchRequests();
     void httpFinished();
-    void httpError(QNetworkReply::NetworkError code);
-    void httpReadyRead();
+    void onTileDecoded();
 
 signals:
 
@@ -56,13 +98,14 @@ signals:
 
 protected:
 
-    QString                 m_sTilePath;
-    QString                 m_sTileServerURL;
-    QUrl                    m_uURL;
-    QNetworkAccessManager   m_tNetMan;
-    QNetworkReply*          m_pReply;
-    QByteArray              m_baIncomingData;
-    QString                 m_sCurrentTileName;
-    QVector<QString>        m_vRequestedTiles;
-    QMap<QString, QImage>   m_vLoadedTiles;
+    QString                             m_sTileServerURL;
+    QNetworkAccessManager               m_tNetMan;
+    QSharedPointer<CTileStore>          m_pStore;               // Shared with the other clients of the same tile path
+    int                                 m_iMaxConnections;
+    bool                                m_bDispatchScheduled;   // Requests of an event loop pass are dispatched together
+    QMultiMap<double, QString>          m_mQueue;               // Tiles waiting for a connection, best priority first
+    QHash<QString, double>              m_mPriorities;          // Priority of each tile in m_mQueue
+    QHash<QNetworkReply*, QString>      m_mReplies;             // Tiles being downloaded
+    QHash<QFutureWatcher<QImage>*, QString> m_mDecodes;         // Tiles being decoded, empty name if cancelled
+    QMap<QString, QImage>               m_vLoadedTiles;
 };
@@ -1,9 +1,16 @@
 
+// Qt
+#include <QVector>
+
+// Std
+#include <cmath>
+
 // qt-plus
 #include "CLogger.h"
 #include "CMemoryMonitor.h"
 
 // Application
+#include "Angles.h"
 #include "CHeightField.h"
 
 //-------------------------------------------------------------------------------------------------
@@ -16,10 +23,35 @@
 
 //-------------------------------------------------------------------------------------------------
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define Q3D_HEIGHTFIELD_SSE2
+#endif
+
+//-------------------------------------------------------------------------------------------------
+
 using namespace Math;
 
 //-------------------------------------------------------------------------------------------------
 
+// Returns the elevation of a grid cell, missing cells and zeros are considered below sea level
+static inline double gridValue(const qint16* pGrid, int iNumCellsWidth, int iNumCellsHeight, int iRow, int iCol)
+{
+    if (iRow >= 0 && iRow < iNumCellsHeight && iCol >= 0 && iCol < iNumCellsWidth)
+    {
+        qint16 iValue = pGrid[(iRow * iNumCellsWidth) + iCol];
+
+        if (iValue != 0)
+        {
+            return (double) iValue;
+        }
+    }
+
+    return -100.0;
+}
+
+//-------------------------------------------------------------------------------------------------
+
 /*!
     Constructs a CHeightField. \a dRigidness is a default value for terrain rigidness.
 */
@@ -78,6 +110,128 @@ double CHeightField::getHeightAt(const Math::CVector3& vPosition, const Math::CA
 
 //-------------------------------------------------------------------------------------------------
 
+/*!
+    Fills \a pHeights with the heights at the \a iCount geolocations in \a pPositions. \br\br
+    The default implementation calls getHeightAt() for each position. Subclasses holding elevation grids
+    override it in order to group the positions by tile.
+    \a bForPhysics
+*/
+void CHeightField::getHeightsAt(const CGeoloc* pPositions, double* pHeights, int iCount, bool bForPhysics)
+{
+    Q_UNUSED(bForPhysics);
+
+    for (int iIndex = 0; iIndex < iCount; iIndex++)
+    {
+        pHeights[iIndex] = getHeightAt(pPositions[iIndex], nullptr);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Interpolates \a iCount heights in \a pGrid, a grid of \a iNumCellsWidth by \a iNumCellsHeight elevations. \br\br
+    \a pLatPos and \a pLonPos are the fractional row and column of each sample. \br
+    Results are written in \a pHeights. Samples are processed in blocks of HEIGHTFIELD_BATCH_BLOCK, in stack buffers.
+*/
+void CHeightField::interpolateGrid(
+        const qint16* pGrid,
+        int iNumCellsWidth,
+        int iNumCellsHeight,
+        const double* pLatPos,
+        const double* pLonPos,
+        double* pHeights,
+        int iCount
+        )
+{
+    double pCorners1[HEIGHTFIELD_BATCH_BLOCK];
+    double pCorners2[HEIGHTFIELD_BATCH_BLOCK];
+    double pCorners3[HEIGHTFIELD_BATCH_BLOCK];
+    double pCorners4[HEIGHTFIELD_BATCH_BLOCK];
+
+    for (int iStart = 0; iStart < iCount; iStart += HEIGHTFIELD_BATCH_BLOCK)
+    {
+        int iBlockCount = qMin(iCount - iStart, HEIGHTFIELD_BATCH_BLOCK);
+
+        // Gather pass
+        for (int iIndex = 0; iIndex < iBlockCount; iIndex++)
+        {
+            int iRow = (int) pLatPos[iStart + iIndex];
+            int iCol = (int) pLonPos[iStart + iIndex];
+
+            pCorners1[iIndex] = gridValue(pGrid, iNumCellsWidth, iNumCellsHeight, iRow + 0, iCol + 0);
+            pCorners2[iIndex] = gridValue(pGrid, iNumCellsWidth, iNumCellsHeight, iRow + 0, iCol + 1);
+            pCorners3[iIndex] = gridValue(pGrid, iNumCellsWidth, iNumCellsHeight, iRow + 1, iCol + 0);
+            pCorners4[iIndex] = gridValue(pGrid, iNumCellsWidth, iNumCellsHeight, iRow + 1, iCol + 1);
+        }
+
+        interpolateCorners(
+                    pCorners1, pCorners2, pCorners3, pCorners4,
+                    pLatPos + iStart, pLonPos + iStart, pHeights + iStart, iBlockCount
+                    );
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Interpolates \a iCount heights using the four corners of each sample in \a pCorners1 to \a pCorners4. \br\br
+    \a pLatPos and \a pLonPos are the fractional row and column of each sample. \br
+    Results are written in \a pHeights. The SSE2 path gives the same results as the scalar one.
+*/
+void CHeightField::interpolateCorners(
+        const double* pCorners1,
+        const double* pCorners2,
+        const double* pCorners3,
+        const double* pCorners4,
+        const double* pLatPos,
+        const double* pLonPos,
+        double* pHeights,
+        int iCount
+        )
+{
+    int iIndex = 0;
+
+#ifdef Q3D_HEIGHTFIELD_SSE2
+    const __m128d mOne = _mm_set1_pd(1.0);
+
+    for (; iIndex + 1 < iCount; iIndex += 2)
+    {
+        __m128d mLonPos = _mm_loadu_pd(pLonPos + iIndex);
+        __m128d mLatPos = _mm_loadu_pd(pLatPos + iIndex);
+
+        // Truncation towards zero, as the (int) casts of the scalar path
+        __m128d fx = _mm_sub_pd(mLonPos, _mm_cvtepi32_pd(_mm_cvttpd_epi32(mLonPos)));
+        __m128d fy = _mm_sub_pd(mLatPos, _mm_cvtepi32_pd(_mm_cvttpd_epi32(mLatPos)));
+        __m128d fx1 = _mm_sub_pd(mOne, fx);
+        __m128d fy1 = _mm_sub_pd(mOne, fy);
+
+        __m128d mResult = _mm_mul_pd(_mm_loadu_pd(pCorners1 + iIndex), _mm_mul_pd(fx1, fy1));
+        mResult = _mm_add_pd(mResult, _mm_mul_pd(_mm_loadu_pd(pCorners2 + iIndex), _mm_mul_pd(fx, fy1)));
+        mResult = _mm_add_pd(mResult, _mm_mul_pd(_mm_loadu_pd(pCorners3 + iIndex), _mm_mul_pd(fx1, fy)));
+        mResult = _mm_add_pd(mResult, _mm_mul_pd(_mm_loadu_pd(pCorners4 + iIndex), _mm_mul_pd(fx, fy)));
+
+        _mm_storeu_pd(pHeights + iIndex, mResult);
+    }
+#endif
+
+    for (; iIndex < iCount; iIndex++)
+    {
+        double fx = pLonPos[iIndex] - ((double) (int) pLonPos[iIndex]);
+        double fy = pLatPos[iIndex] - ((double) (int) pLatPos[iIndex]);
+        double fx1 = 1.0 - fx;
+        double fy1 = 1.0 - fy;
+
+        double w1 = fx1 * fy1;
+        double w2 = fx  * fy1;
+        double w3 = fx1 * fy;
+        double w4 = fx  * fy;
+
+        pHeights[iIndex] = pCorners1[iIndex] * w1 + pCorners2[iIndex] * w2 + pCorners3[iIndex] * w3 + pCorners4[iIndex] * w4;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
 /*!
     Returns \c true if the terrain is generated by functions (has no significant amount of data in memory). \br
     Returns false by default, can be overridden by subclasses if they are low memory consumers.
@@ -95,3 +249,59 @@ bool CHeightField::isGenerated()
 void CHeightField::flatten(const CGeoloc& gPosition, double dRadius_m)
 {
 }
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Pins the data tiles under the area centered on \a gPosition, of size \a gSize, if \a bPinned is \c true. Else unpins them. \br\br
+    Pinned tiles are never evicted from the CElevationTileCache. Calls must be balanced.
+    The default implementation does nothing.
+*/
+void CHeightField::setTilesPinned(const CGeoloc& gPosition, const CGeoloc& gSize, bool bPinned)
+{
+    Q_UNUSED(gPosition);
+    Q_UNUSED(gSize);
+    Q_UNUSED(bPinned);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Queues the data tiles found on the segment from \a gFrom to \a gTo in the CElevationTilePrefetcher,
+    nearest first. \br\br
+    The default implementation does nothing.
+*/
+void CHeightField::prefetchAlong(const CGeoloc& gFrom, const CGeoloc& gTo)
+{
+    Q_UNUSED(gFrom);
+    Q_UNUSED(gTo);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Returns points along the segment from \a gFrom to \a gTo, spaced at most \a dStepDegrees apart. \br\br
+    \a gFrom is excluded and \a gTo is included. Longitudes take the short way around the antimeridian.
+*/
+QVector<CGeoloc> CHeightField::samplePath(const CGeoloc& gFrom, const CGeoloc& gTo, double dStepDegrees)
+{
+    QVector<CGeoloc> vPoints;
+
+    double dLatDelta = gTo.Latitude - gFrom.Latitude;
+    double dLonDelta = Angles::angleDifferenceDegree(gTo.Longitude, gFrom.Longitude);
+    double dLength = qMax(fabs(dLatDelta), fabs(dLonDelta));
+
+    int iSteps = qMax(1, (int) ceil(dLength / dStepDegrees));
+
+    for (int iStep = 1; iStep <= iSteps; iStep++)
+    {
+        double dRatio = (double) iStep / (double) iSteps;
+
+        double dLongitude = gFrom.Longitude + dLonDelta * dRatio;
+        dLongitude += (dLongitude > 180.0) ? -360.0 : (dLongitude < -180.0) ? 360.0 : 0.0;
+
+        vPoints.append(CGeoloc(gFrom.Latitude + dLatDelta * dRatio, dLongitude, 0.0));
+    }
+
+    return vPoints;
+}
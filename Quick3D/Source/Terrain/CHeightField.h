@@ -1,6 +1,9 @@
 
 #pragma once
 
+// Qt
+#include <QVector>
+
 // Application
 #include "quick3d_global.h"
 #include "CVector3.h"
@@ -10,6 +13,14 @@
 
 //-------------------------------------------------------------------------------------------------
 
+//! Spacing of the points sampled by prefetchAlong(), in degrees
+#define HEIGHTFIELD_PREFETCH_STEP   0.25
+
+//! Number of samples interpolated at once by batch queries, sized for stack buffers
+#define HEIGHTFIELD_BATCH_BLOCK     64
+
+//-------------------------------------------------------------------------------------------------
+
 class QUICK3D_EXPORT CHeightField
 {
 public:
@@ -41,6 +52,9 @@ public:
     //! Returns the altitude at the specified geolocation
     virtual double getHeightAt(const Math::CVector3& vPosition, const Math::CAxis& aAxis, bool bForPhysics = true);
 
+    //! Fills pHeights with the altitudes at the iCount geolocations in pPositions
+    virtual void getHeightsAt(const CGeoloc* pPositions, double* pHeights, int iCount, bool bForPhysics = true);
+
     //! Returns the terrain rigidness at the specified geolocation
     double getRigidness() const { return m_dRigidness; }
 
@@ -54,6 +68,42 @@ public:
     //!
     virtual void flatten(const CGeoloc& gPosition, double dRadius_m);
 
+    //! Pins or unpins the data tiles under the area centered on gPosition, of size gSize
+    virtual void setTilesPinned(const CGeoloc& gPosition, const CGeoloc& gSize, bool bPinned);
+
+    //! Queues the data tiles on the segment from gFrom to gTo for background loading
+    virtual void prefetchAlong(const CGeoloc& gFrom, const CGeoloc& gTo);
+
+    //-------------------------------------------------------------------------------------------------
+    // Static methods
+    //-------------------------------------------------------------------------------------------------
+
+    //! Returns points along the segment from gFrom to gTo, spaced at most dStepDegrees apart, gFrom excluded
+    static QVector<CGeoloc> samplePath(const CGeoloc& gFrom, const CGeoloc& gTo, double dStepDegrees);
+
+    //! Bilinear interpolation of iCount samples in a grid of elevations
+    static void interpolateGrid(
+            const qint16* pGrid,
+            int iNumCellsWidth,
+            int iNumCellsHeight,
+            const double* pLatPos,
+            const double* pLonPos,
+            double* pHeights,
+            int iCount
+            );
+
+    //! Bilinear interpolation of iCount samples whose corners are already fetched, in structure of arrays layout
+    static void interpolateCorners(
+            const double* pCorners1,
+            const double* pCorners2,
+            const double* pCorners3,
+            const double* pCorners4,
+            const double* pLatPos,
+            const double* pLonPos,
+            double* pHeights,
+            int iCount
+            );
+
     //-------------------------------------------------------------------------------------------------
     // Properties
     //-------------------------------------------------------------------------------------------------
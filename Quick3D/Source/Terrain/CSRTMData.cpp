@@ -8,6 +8,7 @@
 #include "Angles.h"
 
 // Application
+#include "CHeightField.h"
 #include "CSRTMData.h"
 
 using namespace Math;
@@ -119,6 +120,8 @@ CSRTMData::CSRTMData(const CSRTMData& target)
 
 CSRTMData::~CSRTMData()
 {
+    detachFromCache();
+
     if (m_vData != nullptr)
     {
         delete m_vData;
@@ -157,10 +160,7 @@ double CSRTMData::getHeightAt(const CGeoloc& gPosition, double* pRigidness)
         *pRigidness = 1.0;
     }
 
-    if (m_vData == nullptr)
-    {
-        readSRTMData();
-    }
+    useData();
 
     if (m_vData != nullptr)
     {
@@ -232,6 +232,57 @@ double CSRTMData::getHeightAt(const CGeoloc& gPosition, double* pRigidness)
 
 //-------------------------------------------------------------------------------------------------
 
+/*!
+    Writes the heights at \a pPositions[\a pIndices[i]] to \a pHeights[\a pIndices[i]], for the \a iCount indices. \br\br
+    The tile is locked once for the whole batch. Heights are left untouched if the tile has no data.
+*/
+void CSRTMData::getHeightsAt(const CGeoloc* pPositions, const int* pIndices, int iCount, double* pHeights)
+{
+    QMutexLocker locker(&m_tMutex);
+
+    useData();
+
+    if (m_vData != nullptr)
+    {
+        double vLatPos[HEIGHTFIELD_BATCH_BLOCK];
+        double vLonPos[HEIGHTFIELD_BATCH_BLOCK];
+        double vResults[HEIGHTFIELD_BATCH_BLOCK];
+
+        for (int iStart = 0; iStart < iCount; iStart += HEIGHTFIELD_BATCH_BLOCK)
+        {
+            int iBlockCount = qMin(iCount - iStart, HEIGHTFIELD_BATCH_BLOCK);
+
+            for (int iIndex = 0; iIndex < iBlockCount; iIndex++)
+            {
+                const CGeoloc& gPosition = pPositions[pIndices[iStart + iIndex]];
+
+                double dLatDiff = Angles::clipAngleDegree(gPosition.Latitude - m_gGeoloc.Latitude);
+                double dLonDiff = Angles::clipAngleDegree(gPosition.Longitude - m_gGeoloc.Longitude);
+
+                vLatPos[iIndex] = (1.0 - (dLatDiff / m_gSize.Latitude)) * ((double) m_iNumCellsHeight - 1);
+                vLonPos[iIndex] = (dLonDiff / m_gSize.Longitude) * ((double) m_iNumCellsWidth - 1);
+            }
+
+            CHeightField::interpolateGrid(
+                        m_vData,
+                        m_iNumCellsWidth,
+                        m_iNumCellsHeight,
+                        vLatPos,
+                        vLonPos,
+                        vResults,
+                        iBlockCount
+                        );
+
+            for (int iIndex = 0; iIndex < iBlockCount; iIndex++)
+            {
+                pHeights[pIndices[iStart + iIndex]] = vResults[iIndex];
+            }
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
 bool CSRTMData::contains(const CGeoloc& gPosition) const
 {
     double dLatDiff1 = Math::Angles::angleDifferenceDegree(m_gGeoloc.Latitude, gPosition.Latitude);
@@ -250,6 +301,18 @@ bool CSRTMData::contains(const CGeoloc& gPosition) const
 
 //-------------------------------------------------------------------------------------------------
 
+bool CSRTMData::intersects(const CGeoloc& gPosition, const CGeoloc& gSize) const
+{
+    double dLatDiff = Math::Angles::angleDifferenceDegree(m_gGeoloc.Latitude + m_gSize.Latitude * 0.5, gPosition.Latitude);
+    double dLonDiff = Math::Angles::angleDifferenceDegree(m_gGeoloc.Longitude + m_gSize.Longitude * 0.5, gPosition.Longitude);
+
+    return
+            fabs(dLatDiff) <= (m_gSize.Latitude + gSize.Latitude) * 0.5 &&
+            fabs(dLonDiff) <= (m_gSize.Longitude + gSize.Longitude) * 0.5;
+}
+
+//-------------------------------------------------------------------------------------------------
+
 void CSRTMData::setFileName(QString sFileName)
 {
     m_sFileName = sFileName;
@@ -404,3 +467,58 @@ void CSRTMData::readSRTMData()
         }
     }
 }
+
+//-------------------------------------------------------------------------------------------------
+
+void CSRTMData::useData()
+{
+    if (m_vData == nullptr)
+    {
+        readSRTMData();
+
+        dataLoaded((qint64) (m_iNumCellsWidth * m_iNumCellsHeight) * sizeof(qint16));
+    }
+    else
+    {
+        touch();
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Reads the elevation data from the file if it is not resident. Called by the prefetch thread.
+*/
+void CSRTMData::prefetch()
+{
+    QMutexLocker locker(&m_tMutex);
+
+    if (m_vData == nullptr && m_sFileName.isEmpty() == false)
+    {
+        useData();
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Frees the elevation data, it will be read again from the file on next use. \br\br
+    Tiles built from memory have no file to reload from, they are never released.
+*/
+bool CSRTMData::releaseData()
+{
+    if (m_sFileName.isEmpty() || m_tMutex.tryLock() == false)
+    {
+        return false;
+    }
+
+    if (m_vData != nullptr)
+    {
+        delete [] m_vData;
+        m_vData = nullptr;
+    }
+
+    m_tMutex.unlock();
+
+    return true;
+}
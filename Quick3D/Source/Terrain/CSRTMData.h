@@ -12,6 +12,7 @@
 #include "quick3d_global.h"
 #include "CVector3.h"
 #include "CGeoloc.h"
+#include "CElevationTile.h"
 
 /*
 
@@ -34,7 +35,7 @@
 */
 
 //! SRTM tile data storage class
-class QUICK3D_EXPORT CSRTMData
+class QUICK3D_EXPORT CSRTMData : public CElevationTile
 {
 public:
 
@@ -74,6 +75,9 @@ public:
     //! Returns the altitude at the specified geolocation
     double getHeightAt(const CGeoloc& gPosition, double* pRigidness = nullptr);
 
+    //! Writes the altitudes at the geolocations pPositions[pIndices[i]] to pHeights[pIndices[i]], for i in [0, iCount[
+    void getHeightsAt(const CGeoloc* pPositions, const int* pIndices, int iCount, double* pHeights);
+
     //! Returns the number of cells on the width axis
     int getNumCellsWidth() const { return m_iNumCellsWidth; }
 
@@ -93,6 +97,9 @@ public:
     //! Returns \c true if the tile contains the specified geolocation
     bool contains(const CGeoloc& gPosition) const;
 
+    //! Returns \c true if the tile intersects the area centered on gPosition, of size gSize
+    bool intersects(const CGeoloc& gPosition, const CGeoloc& gSize) const;
+
     //! Assign operator
     CSRTMData& operator = (const CSRTMData& target);
 
@@ -108,6 +115,15 @@ protected:
     //! Reads the data of the m_sFileName file
     void readSRTMData();
 
+    //! Loads the data if needed and reports the access to the cache
+    void useData();
+
+    //! Loads the data if it is not resident
+    virtual void prefetch() Q_DECL_OVERRIDE;
+
+    //! Frees the data if the tile is not in use
+    virtual bool releaseData() Q_DECL_OVERRIDE;
+
     //-------------------------------------------------------------------------------------------------
     // Properties
     //-------------------------------------------------------------------------------------------------
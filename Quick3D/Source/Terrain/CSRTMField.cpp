@@ -1,9 +1,11 @@
 
 // Qt
 #include <QDir>
+#include <QMap>
 #include <QStringList>
 
 // Application
+#include "CElevationTilePrefetcher.h"
 #include "CSRTMField.h"
 
 using namespace Math;
@@ -93,12 +95,90 @@ double CSRTMField::getHeightAt(const Math::CVector3& vPosition, const Math::CAxi
 
 //-------------------------------------------------------------------------------------------------
 
+void CSRTMField::getHeightsAt(const CGeoloc* pPositions, double* pHeights, int iCount, bool bForPhysics)
+{
+    QMap<CSRTMData*, QVector<int> > mBatches;
+    CSRTMData* pLastChunk = nullptr;
+
+    // Group positions by tile, neighbouring positions usually fall in the same one
+    for (int iIndex = 0; iIndex < iCount; iIndex++)
+    {
+        pHeights[iIndex] = Q3D_INFINITY;
+
+        if (pLastChunk == nullptr || pLastChunk->contains(pPositions[iIndex]) == false)
+        {
+            pLastChunk = nullptr;
+
+            foreach (CSRTMData* pChunk, m_vChunks)
+            {
+                if (pChunk->contains(pPositions[iIndex]))
+                {
+                    pLastChunk = pChunk;
+                    break;
+                }
+            }
+        }
+
+        if (pLastChunk != nullptr)
+        {
+            mBatches[pLastChunk].append(iIndex);
+        }
+    }
+
+    for (QMap<CSRTMData*, QVector<int> >::const_iterator iBatch = mBatches.constBegin(); iBatch != mBatches.constEnd(); ++iBatch)
+    {
+        iBatch.key()->getHeightsAt(pPositions, iBatch.value().constData(), iBatch.value().count(), pHeights);
+    }
+
+    Q_UNUSED(bForPhysics);
+}
+
+//-------------------------------------------------------------------------------------------------
+
 void CSRTMField::flatten(const CGeoloc& gPosition, double dRadius)
 {
 }
 
 //-------------------------------------------------------------------------------------------------
 
+void CSRTMField::setTilesPinned(const CGeoloc& gPosition, const CGeoloc& gSize, bool bPinned)
+{
+    foreach (CSRTMData* pChunk, m_vChunks)
+    {
+        if (pChunk->intersects(gPosition, gSize))
+        {
+            if (bPinned)
+            {
+                pChunk->pin();
+            }
+            else
+            {
+                pChunk->unpin();
+            }
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CSRTMField::prefetchAlong(const CGeoloc& gFrom, const CGeoloc& gTo)
+{
+    QVector<CGeoloc> vPoints = samplePath(gFrom, gTo, HEIGHTFIELD_PREFETCH_STEP);
+
+    foreach (const CGeoloc& gPoint, vPoints)
+    {
+        foreach (CSRTMData* pChunk, m_vChunks)
+        {
+            if (pChunk->contains(gPoint))
+            {
+                CElevationTilePrefetcher::getInstance()->enqueue(pChunk);
+            }
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
 void CSRTMField::addChunk(CSRTMData* pData)
 {
     m_vChunks.append(pData);
@@ -44,6 +44,9 @@ public:
     //!
     virtual double getHeightAt(const Math::CVector3& vPosition, const Math::CAxis& aAxis, bool bForPhysics = true);
 
+    //!
+    virtual void getHeightsAt(const CGeoloc* pPositions, double* pHeights, int iCount, bool bForPhysics = true);
+
     //-------------------------------------------------------------------------------------------------
     // Control methods
     //-------------------------------------------------------------------------------------------------
@@ -51,6 +54,12 @@ public:
     //!
     virtual void flatten(const CGeoloc& gPosition, double dRadius);
 
+    //!
+    virtual void setTilesPinned(const CGeoloc& gPosition, const CGeoloc& gSize, bool bPinned);
+
+    //!
+    virtual void prefetchAlong(const CGeoloc& gFrom, const CGeoloc& gTo);
+
     //!
     void addChunk(CSRTMData* pData);
 
@@ -12,6 +12,9 @@
 
 using namespace Math;
 
+// Skirt depth, in grid cells
+#define SKIRT_DEPTH_CELLS   1.0
+
 //-------------------------------------------------------------------------------------------------
 
 CInterpolator<double> CTerrain::m_iAltitudes_Sand;
@@ -32,7 +35,8 @@ CTerrain::CTerrain(
         int iLevel,
         int iMaxLevel,
         bool bIsWater,
-        bool bGenerateNow
+        bool bGenerateNow,
+        QSP<CTerrainTopology> pTopology
         )
     : CComponent(pScene)
     , CHeightField(1.0)
@@ -41,12 +45,14 @@ CTerrain::CTerrain(
     , m_gOriginalSize(gOriginalSize)
     , m_gSize(gSize)
     , m_pMesh(nullptr)
+    , m_pTopology(pTopology)
     , m_iNumPoints(iPoints)
     , m_iLevel(iLevel)
     , m_iMaxLevel(iMaxLevel)
     , m_bAllHeightsOverSea(false)
     , m_bIsWater(bIsWater)
     , m_bOK(false)
+    , m_bTilesPinned(false)
 {
     CComponent::incComponentCounter(ClassName_CTerrain);
 
@@ -54,7 +60,13 @@ CTerrain::CTerrain(
 
     setName(QString("Terrain%1").arg(sGeolocName));
 
-    if (m_iNumPoints % 2 == 0) m_iNumPoints++;
+    m_iNumPoints = CTerrainTopology::validNumPoints(m_iNumPoints);
+
+    if (m_pTopology != nullptr && m_pTopology->numPoints() != m_iNumPoints)
+    {
+        LOG_METHOD_WARNING(QString("Topology does not match %1 points, using own faces").arg(m_iNumPoints));
+        m_pTopology.reset();
+    }
 
     if (m_iAltitudes_Sand.count() == 0)
     {
@@ -94,6 +106,14 @@ CTerrain::CTerrain(
         m_pMesh->setMaterial(pScene->ressourcesManager()->getWaterMaterial());
     }
 
+    // Keep elevation data under detailed terrain resident, see work()
+    if (m_pHeights != nullptr && m_pHeights->isGenerated() == false && m_iLevel < m_iMaxLevel / 2)
+    {
+        m_bTilesPinned = true;
+        m_gPinnedGeoloc = gGeoloc;
+        m_pHeights->setTilesPinned(m_gPinnedGeoloc, m_gSize, true);
+    }
+
     if (bGenerateNow)
     {
         work();
@@ -114,14 +134,14 @@ CTerrain::~CTerrain()
     // Remove this from workers
     CWorkerManager::getInstance()->removeWorker(this);
 
-    if (m_pMesh != nullptr)
+    if (m_bTilesPinned)
     {
-        delete m_pMesh;
+        m_pHeights->setTilesPinned(m_gPinnedGeoloc, m_gSize, false);
     }
 
-    foreach (CMeshGeometry* pSeam, m_vSeams)
+    if (m_pMesh != nullptr)
     {
-        delete pSeam;
+        delete m_pMesh;
     }
 }
 
@@ -165,28 +185,6 @@ int CTerrain::getPointIndexForXZ (int iX, int iZ) const
 
 //-------------------------------------------------------------------------------------------------
 
-int CTerrain::getFaceIndexForVertices(int v1, int v2, int v3, int v4) const
-{
-    if (m_pMesh != nullptr)
-    {
-        QString sKey = QString("%1%2%3%4")
-                .arg(v1)
-                .arg(v2)
-                .arg(v3)
-                .arg(v4)
-                ;
-
-        if (m_mVerticesToFace.contains(sKey))
-        {
-            return m_mVerticesToFace[sKey];
-        }
-    }
-
-    return -1;
-}
-
-//-------------------------------------------------------------------------------------------------
-
 void CTerrain::paint(CRenderContext* pContext)
 {
     m_pMesh->paint(pContext, this);
@@ -224,81 +222,43 @@ double CTerrain::getHeightAt(const CGeoloc& gPosition, double* pRigidness)
         return 0.0;
     }
 
-    double dLatitudeDiff = Math::Angles::angleDifferenceDegree(gPosition.Latitude, geoloc().Latitude);
-    double dLongitudeDiff = Math::Angles::angleDifferenceDegree(gPosition.Longitude, geoloc().Longitude);
-
-    CGeoloc gLocalGeoloc(dLatitudeDiff, dLongitudeDiff, 0.0);
-    CVector3 vCenter = geoloc().toVector3();
-    CVector3 vLocal = gPosition.toVector3() - vCenter;
-    CVector3 vUp = vCenter.normalized();
+    return gridHeightAt(gPosition);
+}
 
-    int iX = (int) (((gLocalGeoloc.Longitude / (m_gSize.Longitude)) + 0.5) * (m_iNumPoints - 1));
-    int iZ = (int) (((gLocalGeoloc.Latitude / (m_gSize.Latitude)) + 0.5) * (m_iNumPoints - 1));
+//-------------------------------------------------------------------------------------------------
 
-    for (int iIterZ = iZ - 2; iIterZ <= iZ + 2; iIterZ++)
+void CTerrain::getHeightsAt(const CGeoloc* pPositions, double* pHeights, int iCount, bool bForPhysics)
+{
+    if (m_bOK == false || m_bIsWater)
     {
-        for (int iIterX = iX - 2; iIterX <= iX + 2; iIterX++)
-        {
-            int iIndex1 = getPointIndexForXZ(iIterX + 0, iIterZ + 0);
-            int iIndex2 = getPointIndexForXZ(iIterX + 1, iIterZ + 0);
-            int iIndex3 = getPointIndexForXZ(iIterX + 1, iIterZ + 1);
-            int iIndex4 = getPointIndexForXZ(iIterX + 0, iIterZ + 1);
-
-            if (
-                    /*
-                        // Skirt
-                        iIndex1 >= 1 && iIndex2 >= 1 && iIndex3 >= 1 && iIndex4 >= 1 &&
-                        iIndex1 < m_pMesh->getVertices().count() - 1 &&
-                        iIndex2 < m_pMesh->getVertices().count() - 1 &&
-                        iIndex3 < m_pMesh->getVertices().count() - 1 &&
-                        iIndex4 < m_pMesh->getVertices().count() - 1
-                        */
-                    // No skirt
-                    iIndex1 >= 0 && iIndex2 >= 0 && iIndex3 >= 0 && iIndex4 >= 0 &&
-                    iIndex1 < m_pMesh->vertices().count() &&
-                    iIndex2 < m_pMesh->vertices().count() &&
-                    iIndex3 < m_pMesh->vertices().count() &&
-                    iIndex4 < m_pMesh->vertices().count()
-                    )
-            {
-                CVector3 v1(m_pMesh->vertices()[iIndex1].position());
-                CVector3 v2(m_pMesh->vertices()[iIndex2].position());
-                CVector3 v3(m_pMesh->vertices()[iIndex3].position());
-                CVector3 v4(m_pMesh->vertices()[iIndex4].position());
-
-                CRay3 ray(vLocal + vUp * 50000.0, vUp * -1.0);
-
-                RayTracingResult dResult(0.0);
-
-                int iFaceIndex = getFaceIndexForVertices(iIndex1, iIndex2, iIndex3, iIndex4);
-
-                if (iFaceIndex != -1)
-                {
-                    dResult = CFace::intersectTriangle(
-                                ray,
-                                v1, v2, v3
-                                );
+        CHeightField::getHeightsAt(pPositions, pHeights, iCount, bForPhysics);
+        return;
+    }
 
-                    if (dResult.m_dDistance < Q3D_INFINITY)
-                    {
-                        return CGeoloc(vCenter + ray.vOrigin + ray.vNormal * dResult.m_dDistance).Altitude;
-                    }
+    for (int iIndex = 0; iIndex < iCount; iIndex++)
+    {
+        pHeights[iIndex] = gridHeightAt(pPositions[iIndex]);
+    }
+}
 
-                    dResult = CFace::intersectTriangle(
-                                ray,
-                                v1, v3, v4
-                                );
+//-------------------------------------------------------------------------------------------------
 
-                    if (dResult.m_dDistance < Q3D_INFINITY)
-                    {
-                        return CGeoloc(vCenter + ray.vOrigin + ray.vNormal * dResult.m_dDistance).Altitude;
-                    }
-                }
-            }
+void CTerrain::getHeightsAt(const CGeoloc* pPositions, const int* pIndices, int iCount, double* pHeights)
+{
+    if (m_bOK == false || m_bIsWater)
+    {
+        for (int iIndex = 0; iIndex < iCount; iIndex++)
+        {
+            pHeights[pIndices[iIndex]] = getHeightAt(pPositions[pIndices[iIndex]]);
         }
+
+        return;
     }
 
-    return Q3D_INFINITY;
+    for (int iIndex = 0; iIndex < iCount; iIndex++)
+    {
+        pHeights[pIndices[iIndex]] = gridHeightAt(pPositions[pIndices[iIndex]]);
+    }
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -310,23 +270,27 @@ void CTerrain::work()
     m_bAllHeightsOverSea = true;
     int vVertexCount = 0;
 
+    {
+        QMutexLocker locker(&m_mTriangleTreeMutex);
+
+        m_iTriangleTreeReady.storeRelease(0);
+        m_tTriangleTree.clear();
+    }
+
     CPerlin* pPerlin = CPerlin::getInstance();
 
     // Initial patch
-    if (m_bIsWater == false && m_iLevel < m_iMaxLevel / 2)
+    if (m_pTopology != nullptr)
     {
-        // Skirt
-        // m_pMesh->createQuadPatch(m_iNumPoints, 1);
-        // m_iNumPoints += 2;
-        m_pMesh->createQuadPatch(m_iNumPoints, 0);
+        // Only vertices are generated, triangles are shared
+        m_pMesh->clear();
+        m_pTopology->createVertices(m_pMesh->vertices());
     }
     else
     {
         m_pMesh->createQuadPatch(m_iNumPoints, 0);
     }
 
-    buildVerticesToFaceMap();
-
     CVector3 vFinalCenter = geoloc().toVector3();
 
     // Get the mesh's material
@@ -339,7 +303,14 @@ void CTerrain::work()
 
     CTiledMaterial* pTiledMaterial = dynamic_cast<CTiledMaterial*>(pMaterial);
 
-    // Move vertices
+    // Geolocations of the vertices, used for batched height queries
+    QVector<CGeoloc> vGeolocs(m_pMesh->vertices().count());
+
+    // Ground and northward points, giving the front vector of each vertex's topocentric axis
+    QVector<CGeoloc> vGround(vGeolocs.count());
+    QVector<CGeoloc> vNorth(vGeolocs.count());
+
+    // Compute vertex geolocations
     for (int iIndex = 0; iIndex < m_pMesh->vertices().count(); iIndex++)
     {
         CGeoloc gPosition;
@@ -353,27 +324,28 @@ void CTerrain::work()
             gPosition = pMaterial->transformGeoloc(gPosition);
         }
 
-        /*
-        // Skirt
-        if (m_bIsWater == false && m_iLevel < m_iMaxLevel / 2)
-        {
-            if (
-                gPosition.Latitude < geoloc().Latitude - m_gSize.Latitude * 0.5 ||
-                gPosition.Latitude > geoloc().Latitude + m_gSize.Latitude * 0.5 ||
-                gPosition.Longitude < geoloc().Longitude - m_gSize.Longitude * 0.5 ||
-                gPosition.Longitude > geoloc().Longitude + m_gSize.Longitude * 0.5
-                )
-            {
-                gPosition.Altitude = -m_gSize.Longitude * 100.0;
-            }
-        }
-        */
+        vGeolocs[iIndex] = gPosition;
+        vGround[iIndex] = CGeoloc(gPosition.Latitude, gPosition.Longitude, 0.0);
+        vNorth[iIndex] = CGeoloc(qMin(gPosition.Latitude + 0.001, 90.0), gPosition.Longitude, 0.0);
+    }
 
-        CAxis aTopocentricAxis = gPosition.getTopocentricAxis();
+    // Convert them in batches, as CGeoloc::getTopocentricAxis() would
+    QVector<CVector3> vPositions(vGeolocs.count());
+    QVector<CVector3> vGroundPositions(vGeolocs.count());
+    QVector<CVector3> vNorthPositions(vGeolocs.count());
 
-        m_pMesh->vertices()[iIndex].position() = gPosition.toVector3();
+    CGeoloc::toVector3(vGeolocs.constData(), vPositions.data(), vGeolocs.count());
+    CGeoloc::toVector3(vGround.constData(), vGroundPositions.data(), vGround.count());
+    CGeoloc::toVector3(vNorth.constData(), vNorthPositions.data(), vNorth.count());
+
+    // Move vertices
+    for (int iIndex = 0; iIndex < m_pMesh->vertices().count(); iIndex++)
+    {
+        const CGeoloc& gPosition = vGeolocs[iIndex];
+
+        m_pMesh->vertices()[iIndex].position() = vPositions[iIndex];
         m_pMesh->vertices()[iIndex].normal() = m_pMesh->vertices()[iIndex].position().normalized();
-        m_pMesh->vertices()[iIndex].tangent() = aTopocentricAxis.Front;
+        m_pMesh->vertices()[iIndex].tangent() = (vNorthPositions[iIndex] - vGroundPositions[iIndex]).normalized();
         m_pMesh->vertices()[iIndex].gravity() = m_pMesh->vertices()[iIndex].normal() * -1.0;
 
         if (pMaterial != nullptr && pTiledMaterial == nullptr)
@@ -393,6 +365,18 @@ void CTerrain::work()
         }
     }
 
+    // Query heights of non-generated fields in one batch, so that each tile is locked and loaded once
+    // This test is important: with non-generated terrain, we don't want to load too much data in RAM
+    // We therefore get an altitude only for levels that are close to sea (x < niveau max / 2)
+    QVector<double> vHeights;
+    bool bBatchedHeights = m_pHeights != nullptr && m_pHeights->isGenerated() == false && m_iLevel < m_iMaxLevel / 2;
+
+    if (bBatchedHeights)
+    {
+        vHeights.resize(vGeolocs.count());
+        m_pHeights->getHeightsAt(vGeolocs.constData(), vHeights.data(), vGeolocs.count(), false);
+    }
+
     // Loop over vertices
     for (int iIndex = 0; iIndex < m_pMesh->vertices().count(); iIndex++)
     {
@@ -400,10 +384,11 @@ void CTerrain::work()
 
         if (m_pHeights != nullptr)
         {
-            // This test is important: with non-generated terrain, we don't want to load too much data in RAM
-            // We therefore get an altitude only for levels that are close to sea (x < niveau max / 2)
-
-            if (m_pHeights->isGenerated() || m_iLevel < m_iMaxLevel / 2)
+            if (bBatchedHeights)
+            {
+                dTerrainAltitude = vHeights[iIndex];
+            }
+            else if (m_pHeights->isGenerated())
             {
                 dTerrainAltitude = m_pHeights->getHeightAt(
                             m_pMesh->vertices()[iIndex].position(),
@@ -453,7 +438,14 @@ void CTerrain::work()
         }
     }
 
-    m_pMesh->computeNormals();
+    if (m_pTopology != nullptr)
+    {
+        computeGridNormals();
+    }
+    else
+    {
+        m_pMesh->computeNormals();
+    }
 
     vVertexCount = 0;
 
@@ -499,8 +491,19 @@ void CTerrain::work()
             }
         }
 
+        // Skirt vertices copy their border vertex once it is complete
+        if (m_pTopology != nullptr)
+        {
+            buildSkirt();
+        }
+
         // Remove underwater if terrain is large
-        if (m_bIsWater == false && m_iLevel >= m_iMaxLevel / 2)
+        if (m_bIsWater == false && m_iLevel >= m_iMaxLevel / 2 && m_pTopology != nullptr)
+        {
+            // Shared triangles cannot be removed, the tile gets its own faces if needed
+            buildOverseaFaces();
+        }
+        else if (m_bIsWater == false && m_iLevel >= m_iMaxLevel / 2)
         {
             for (int iFaceIndex = 0; iFaceIndex < m_pMesh->faces().count(); iFaceIndex++)
             {
@@ -528,9 +531,26 @@ void CTerrain::work()
         }
     }
 
+    // Other materials do not use texture weights, but the skirt is still needed
+    if (m_pTopology != nullptr && (pMaterial == nullptr || pTiledMaterial != nullptr))
+    {
+        buildSkirt();
+    }
+
     // Update mesh
+    if (m_pTopology != nullptr && m_pMesh->faces().count() == 0)
+    {
+        m_pMesh->setSharedIndices(m_pTopology->indices());
+    }
+    else
+    {
+        m_pMesh->setSharedIndices(QSP<CSharedIndexBuffer>());
+    }
+
     m_pMesh->setGeometryDirty(true);
 
+    buildHeightGrid(vGeolocs);
+
     // Terrain is ready
     m_bOK = true;
 
@@ -541,7 +561,7 @@ void CTerrain::work()
         );
         */
 
-    if (m_pMesh->faces().count() == 0)
+    if (m_pMesh->faces().count() == 0 && m_pMesh->sharedIndices() == nullptr)
     {
         LOG_METHOD_WARNING(QString("No faces in %1").arg(m_sName));
     }
@@ -585,6 +605,11 @@ RayTracingResult CTerrain::intersect(Math::CRay3 ray)
 {
     if (m_pMesh != nullptr)
     {
+        if (m_pMesh->sharedIndices() != nullptr)
+        {
+            return intersectGrid(ray);
+        }
+
         return m_pMesh->intersect(this, ray);
     }
 
@@ -593,31 +618,251 @@ RayTracingResult CTerrain::intersect(Math::CRay3 ray)
 
 //-------------------------------------------------------------------------------------------------
 
-void CTerrain::buildVerticesToFaceMap()
+double CTerrain::gridHeightAt(const CGeoloc& gPosition) const
 {
-    m_mVerticesToFace.clear();
+    int iX = 0;
+    int iZ = 0;
+    double fx = 0.0;
+    double fz = 0.0;
+
+    // Bring the longitude in the 360 degrees following the first column, in order to handle the date line
+    double dLongitude = gPosition.Longitude - m_vColumnLongitudes[0];
+    dLongitude = m_vColumnLongitudes[0] + dLongitude - floor(dLongitude / 360.0) * 360.0;
+
+    if (
+            locateInAxis(m_vColumnLongitudes, dLongitude, iX, fx) == false ||
+            locateInAxis(m_vRowLatitudes, gPosition.Latitude, iZ, fz) == false
+            )
+    {
+        return Q3D_INFINITY;
+    }
 
-    if (m_pMesh != nullptr)
+    double h1 = m_vGridAltitudes[getPointIndexForXZ(iX + 0, iZ + 0)];
+    double h2 = m_vGridAltitudes[getPointIndexForXZ(iX + 1, iZ + 0)];
+    double h3 = m_vGridAltitudes[getPointIndexForXZ(iX + 1, iZ + 1)];
+    double h4 = m_vGridAltitudes[getPointIndexForXZ(iX + 0, iZ + 1)];
+
+    // Same triangles as the mesh : (v1, v2, v3) and (v1, v3, v4)
+    if (fx >= fz)
+    {
+        return h1 + fx * (h2 - h1) + fz * (h3 - h2);
+    }
+
+    return h1 + fz * (h4 - h1) + fx * (h3 - h4);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CTerrain::buildHeightGrid(const QVector<CGeoloc>& vGeolocs)
+{
+    m_vGridAltitudes.resize(m_iNumPoints * m_iNumPoints);
+    m_vRowLatitudes.resize(m_iNumPoints);
+    m_vColumnLongitudes.resize(m_iNumPoints);
+
+    for (int iIndex = 0; iIndex < m_vGridAltitudes.count(); iIndex++)
     {
-        for (int iIndex = 0; iIndex < m_pMesh->faces().count(); iIndex++)
+        m_vGridAltitudes[iIndex] = m_pMesh->vertices()[iIndex].altitude();
+    }
+
+    // Vertex longitudes are not wrapped, so they increase along the row
+    for (int iIndex = 0; iIndex < m_iNumPoints; iIndex++)
+    {
+        m_vRowLatitudes[iIndex] = vGeolocs[getPointIndexForXZ(0, iIndex)].Latitude;
+        m_vColumnLongitudes[iIndex] = vGeolocs[getPointIndexForXZ(iIndex, 0)].Longitude;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+bool CTerrain::locateInAxis(const QVector<double>& vAxis, double dValue, int& iCell, double& dFraction)
+{
+    int iLast = vAxis.count() - 1;
+
+    if (iLast < 1 || dValue < vAxis[0] || dValue > vAxis[iLast])
+    {
+        return false;
+    }
+
+    // Guess assuming regular spacing, then walk to the right cell if the axis is not linear
+    iCell = qBound(0, (int) (((dValue - vAxis[0]) / (vAxis[iLast] - vAxis[0])) * iLast), iLast - 1);
+
+    while (iCell > 0 && dValue < vAxis[iCell]) iCell--;
+    while (iCell < iLast - 1 && dValue > vAxis[iCell + 1]) iCell++;
+
+    double dSpan = vAxis[iCell + 1] - vAxis[iCell];
+
+    dFraction = dSpan > 0.0 ? (dValue - vAxis[iCell]) / dSpan : 0.0;
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CTerrain::computeGridNormals()
+{
+    QVector<CVertex>& vVertices = m_pMesh->vertices();
+
+    for (int iZ = 0; iZ < m_iNumPoints; iZ++)
+    {
+        for (int iX = 0; iX < m_iNumPoints; iX++)
         {
-            if (m_pMesh->faces()[iIndex].indices().count() == 4)
+            CVector3 vLeft = vVertices[getPointIndexForXZ(qMax(iX - 1, 0), iZ)].position();
+            CVector3 vRight = vVertices[getPointIndexForXZ(qMin(iX + 1, m_iNumPoints - 1), iZ)].position();
+            CVector3 vBack = vVertices[getPointIndexForXZ(iX, qMax(iZ - 1, 0))].position();
+            CVector3 vFront = vVertices[getPointIndexForXZ(iX, qMin(iZ + 1, m_iNumPoints - 1))].position();
+
+            CVertex& vertex = vVertices[getPointIndexForXZ(iX, iZ)];
+
+            CVector3 vAlongX = vRight - vLeft;
+            CVector3 vAlongZ = vFront - vBack;
+            CVector3 vNormal = vAlongZ.cross(vAlongX).normalized();
+
+            // Keep the normal on the sky side
+            if (vNormal.dot(vertex.gravity()) > 0.0)
             {
-                QString sKey = QString("%1%2%3%4")
-                        .arg(m_pMesh->faces()[iIndex].indices()[0])
-                        .arg(m_pMesh->faces()[iIndex].indices()[1])
-                        .arg(m_pMesh->faces()[iIndex].indices()[2])
-                        .arg(m_pMesh->faces()[iIndex].indices()[3])
-                        ;
-
-                m_mVerticesToFace[sKey] = iIndex;
+                vNormal = vNormal * -1.0;
             }
+
+            vertex.normal() = vNormal;
         }
     }
 }
 
 //-------------------------------------------------------------------------------------------------
 
+void CTerrain::buildSkirt()
+{
+    if (m_pTopology == nullptr || m_pTopology->hasSkirt() == false)
+    {
+        return;
+    }
+
+    QVector<CVertex>& vVertices = m_pMesh->vertices();
+    const QVector<int>& vSources = m_pTopology->skirtSources();
+
+    // Skirt vertices are moved down by SKIRT_DEPTH_CELLS grid cells
+    double dDepth = (vVertices[1].position() - vVertices[0].position()).magnitude() * SKIRT_DEPTH_CELLS;
+    int iFirstSkirt = m_pTopology->gridVertexCount();
+
+    for (int iIndex = 0; iIndex < vSources.count(); iIndex++)
+    {
+        CVertex& vertex = vVertices[iFirstSkirt + iIndex];
+
+        vertex = vVertices[vSources[iIndex]];
+        vertex.position() = vertex.position() + vertex.gravity() * dDepth;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+bool CTerrain::buildOverseaFaces()
+{
+    const QVector<GLuint>& vIndices = m_pTopology->indices()->indices();
+    const QVector<CVertex>& vVertices = m_pMesh->vertices();
+
+    QVector<CFace> vFaces;
+
+    for (int iIndex = 0; iIndex + 2 < vIndices.count(); iIndex += 3)
+    {
+        if (
+                vVertices[vIndices[iIndex + 0]].altitude() >= 0.0 ||
+                vVertices[vIndices[iIndex + 1]].altitude() >= 0.0 ||
+                vVertices[vIndices[iIndex + 2]].altitude() >= 0.0
+                )
+        {
+            vFaces.append(CFace(m_pMesh, vIndices[iIndex + 0], vIndices[iIndex + 1], vIndices[iIndex + 2]));
+        }
+    }
+
+    if (vFaces.count() == vIndices.count() / 3)
+    {
+        return false;
+    }
+
+    m_pMesh->faces() = vFaces;
+    m_pMesh->setGLType(GL_TRIANGLES);
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+RayTracingResult CTerrain::intersectGrid(const CRay3& ray)
+{
+    RayTracingResult dReturnResult(Q3D_INFINITY, this);
+
+    // Transform ray to local space
+    CRay3 rLocalRay = worldTransformInverse() * ray;
+
+    if (m_bOK)
+    {
+        checkTriangleTree();
+
+        RayTracingResult dNewResult = m_tTriangleTree.intersect(rLocalRay);
+
+        dReturnResult.m_dDistance = dNewResult.m_dDistance;
+        dReturnResult.m_vNormal = dNewResult.m_vNormal;
+
+        return dReturnResult;
+    }
+
+    const QVector<GLuint>& vIndices = m_pMesh->sharedIndices()->indices();
+    const QVector<CVertex>& vVertices = m_pMesh->vertices();
+
+    for (int iIndex = 0; iIndex + 2 < vIndices.count(); iIndex += 3)
+    {
+        RayTracingResult dNewResult = CFace::intersectTriangle(
+                    rLocalRay,
+                    vVertices[vIndices[iIndex + 0]].position(),
+                    vVertices[vIndices[iIndex + 1]].position(),
+                    vVertices[vIndices[iIndex + 2]].position()
+                    );
+
+        if (dNewResult.m_dDistance < dReturnResult.m_dDistance)
+        {
+            dReturnResult.m_dDistance = dNewResult.m_dDistance;
+            dReturnResult.m_vNormal = dNewResult.m_vNormal;
+        }
+    }
+
+    return dReturnResult;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CTerrain::checkTriangleTree()
+{
+    if (m_iTriangleTreeReady.loadAcquire() != 0)
+    {
+        return;
+    }
+
+    QMutexLocker locker(&m_mTriangleTreeMutex);
+
+    if (m_iTriangleTreeReady.loadAcquire() == 0)
+    {
+        const QVector<GLuint>& vIndices = m_pMesh->sharedIndices()->indices();
+        const QVector<CVertex>& vVertices = m_pMesh->vertices();
+
+        m_tTriangleTree.clear();
+
+        for (int iIndex = 0; iIndex + 2 < vIndices.count(); iIndex += 3)
+        {
+            m_tTriangleTree.addTriangle(
+                        vVertices[vIndices[iIndex + 0]].position(),
+                        vVertices[vIndices[iIndex + 1]].position(),
+                        vVertices[vIndices[iIndex + 2]].position()
+                        );
+        }
+
+        m_tTriangleTree.build();
+
+        m_iTriangleTreeReady.storeRelease(1);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
 void CTerrain::dump(QTextStream& stream, int iIdent)
 {
     dumpIndented(stream, iIdent, QString("[CTerrain]"));
@@ -1,6 +1,10 @@
 
 #pragma once
 
+// Qt
+#include <QAtomicInt>
+#include <QMutex>
+
 // qt-plus
 #include "CXMLNode.h"
 #include "CInterpolator.h"
@@ -11,9 +15,11 @@
 #include "CWorker.h"
 #include "CComponent.h"
 #include "CMeshGeometry.h"
+#include "CTriangleBVH.h"
 #include "CMaterial.h"
 #include "CHeightField.h"
 #include "CPerlin.h"
+#include "CTerrainTopology.h"
 
 //-------------------------------------------------------------------------------------------------
 // Forward declarations
@@ -64,7 +70,8 @@ public:
             int iLevel,
             int iMaxLevel,
             bool bIsWater,
-            bool bGenerateNow = false
+            bool bGenerateNow = false,
+            QSP<CTerrainTopology> pTopology = QSP<CTerrainTopology>()
             );
 
     //!
@@ -109,9 +116,12 @@ public:
     //!
     virtual void paint(CRenderContext* pContext) Q_DECL_OVERRIDE;
 
-    //!
+    //! Returns the altitude at gPosition, interpolated in the vertex grid
     virtual double getHeightAt(const CGeoloc& gPosition, double* pRigidness = nullptr);
 
+    //! Fills pHeights with the altitudes at the iCount geolocations in pPositions
+    virtual void getHeightsAt(const CGeoloc* pPositions, double* pHeights, int iCount, bool bForPhysics = true) Q_DECL_OVERRIDE;
+
     //!
     virtual void flatten(const CGeoloc& gPosition, double dRadius);
 
@@ -134,8 +144,8 @@ public:
     //!
     int getPointIndexForXZ(int X, int Z) const;
 
-    //!
-    int getFaceIndexForVertices(int v1, int v2, int v3, int v4) const;
+    //! Writes the heights at pPositions[pIndices[i]] to pHeights[pIndices[i]], for the iCount indices
+    void getHeightsAt(const CGeoloc* pPositions, const int* pIndices, int iCount, double* pHeights);
 
     //-------------------------------------------------------------------------------------------------
     // Protected methods
@@ -143,8 +153,29 @@ public:
 
 protected:
 
-    //!
-    void buildVerticesToFaceMap();
+    //! Returns the altitude at gPosition in the height grid, Q3D_INFINITY if outside
+    double gridHeightAt(const CGeoloc& gPosition) const;
+
+    //! Fills the height grid and its axes using the vertex geolocations
+    void buildHeightGrid(const QVector<CGeoloc>& vGeolocs);
+
+    //! Computes vertex normals from the grid neighbours, when using a shared topology
+    void computeGridNormals();
+
+    //! Copies border vertices to the skirt and moves them down
+    void buildSkirt();
+
+    //! Fills the mesh faces with shared triangles that are not fully under sea, returns false if none is removed
+    bool buildOverseaFaces();
+
+    //! Ray intersection with the shared topology triangles
+    Math::RayTracingResult intersectGrid(const Math::CRay3& ray);
+
+    //! Builds the triangle tree used by intersectGrid() if not done yet
+    void checkTriangleTree();
+
+    //! Finds the cell of dValue in the increasing values of vAxis, returns false if outside
+    static bool locateInAxis(const QVector<double>& vAxis, double dValue, int& iCell, double& dFraction);
 
     //-------------------------------------------------------------------------------------------------
     // Properties
@@ -156,15 +187,22 @@ protected:
     CGeoloc                             m_gOriginalGeoloc;
     CGeoloc                             m_gOriginalSize;
     CGeoloc                             m_gSize;
+    CGeoloc                             m_gPinnedGeoloc;
     CMeshGeometry*                      m_pMesh;
-    QVector<CMeshGeometry*>             m_vSeams;
-    QMap<QString, int>                  m_mVerticesToFace;
+    QSP<CTerrainTopology>               m_pTopology;            // Shared triangles, may be null
+    QVector<double>                     m_vGridAltitudes;       // Altitude of each grid vertex, row major
+    QVector<double>                     m_vRowLatitudes;        // Latitude of each grid row, increasing
+    QVector<double>                     m_vColumnLongitudes;    // Longitude of each grid column, increasing
+    CTriangleBVH                        m_tTriangleTree;        // Shared topology triangles, built on first ray query
+    QMutex                              m_mTriangleTreeMutex;
+    QAtomicInt                          m_iTriangleTreeReady;
     int                                 m_iNumPoints;
     int                                 m_iLevel;
     int                                 m_iMaxLevel;
     bool                                m_bAllHeightsOverSea;
     bool                                m_bIsWater;
     bool                                m_bOK;
+    bool                                m_bTilesPinned;
 
     static CInterpolator<double>        m_iAltitudes_Sand;
     static CInterpolator<double>        m_iAltitudes_Dirt;
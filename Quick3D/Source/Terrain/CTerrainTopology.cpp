@@ -0,0 +1,132 @@
+
+// Application
+#include "CTerrainTopology.h"
+#include "C3DScene.h"
+
+//-------------------------------------------------------------------------------------------------
+
+using namespace Math;
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    \class CTerrainTopology
+    \brief The triangles of a terrain patch, shared by all CTerrain of the same resolution.
+    \inmodule Quick3D
+    \sa CTerrain, CWorldTerrain, CSharedIndexBuffer
+
+    The grid is made of \c {numPoints() * numPoints()} vertices, row major, each quad being split in two triangles. \br
+    When a skirt is requested, a ring of vertices is appended after the grid, one per border vertex.
+    CTerrain copies the border vertices to the ring and moves them down, so that the cracks between patches
+    of different levels of detail are filled.
+*/
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Constructs a CTerrainTopology. \br\br
+    \a pScene is the scene owning the rendering context. \br
+    \a iNumPoints is the number of points on a side of the grid, made odd if needed. \br
+    \a bSkirt tells whether a skirt is added around the grid.
+*/
+CTerrainTopology::CTerrainTopology(C3DScene* pScene, int iNumPoints, bool bSkirt)
+    : m_iNumPoints(validNumPoints(iNumPoints))
+{
+    QVector<GLuint> vIndices;
+
+    vIndices.reserve((m_iNumPoints - 1) * (m_iNumPoints - 1) * 6 + (bSkirt ? (m_iNumPoints - 1) * 4 * 6 : 0));
+
+    // Grid, quads are split the same way CMeshGeometry triangulates faces
+    for (int z = 0; z < m_iNumPoints - 1; z++)
+    {
+        for (int x = 0; x < m_iNumPoints - 1; x++)
+        {
+            GLuint v1 = ((z + 0) * m_iNumPoints) + x + 0;
+            GLuint v2 = ((z + 0) * m_iNumPoints) + x + 1;
+            GLuint v3 = ((z + 1) * m_iNumPoints) + x + 1;
+            GLuint v4 = ((z + 1) * m_iNumPoints) + x + 0;
+
+            vIndices << v1 << v2 << v3;
+            vIndices << v1 << v3 << v4;
+        }
+    }
+
+    if (bSkirt)
+    {
+        // Border vertices, counter-clockwise so that the grid stays on the left
+        for (int x = 0; x < m_iNumPoints - 1; x++) m_vSkirtSources << x;
+        for (int z = 0; z < m_iNumPoints - 1; z++) m_vSkirtSources << (z * m_iNumPoints) + m_iNumPoints - 1;
+        for (int x = m_iNumPoints - 1; x > 0; x--) m_vSkirtSources << ((m_iNumPoints - 1) * m_iNumPoints) + x;
+        for (int z = m_iNumPoints - 1; z > 0; z--) m_vSkirtSources << (z * m_iNumPoints);
+
+        GLuint iFirstSkirt = gridVertexCount();
+
+        for (int iIndex = 0; iIndex < m_vSkirtSources.count(); iIndex++)
+        {
+            int iNext = (iIndex + 1) % m_vSkirtSources.count();
+
+            GLuint a = m_vSkirtSources[iIndex];
+            GLuint b = m_vSkirtSources[iNext];
+            GLuint sa = iFirstSkirt + iIndex;
+            GLuint sb = iFirstSkirt + iNext;
+
+            // Same winding as the grid quad it is folded from
+            vIndices << sa << sb << b;
+            vIndices << sa << b << a;
+        }
+    }
+
+    m_pIndices = QSP<CSharedIndexBuffer>(new CSharedIndexBuffer(pScene, GL_TRIANGLES, vIndices));
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Destroys a CTerrainTopology.
+*/
+CTerrainTopology::~CTerrainTopology()
+{
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Fills \a vVertices with a unit patch, X and Z going from -0.5 to 0.5. \br\br
+    Skirt vertices are copies of their grid vertex.
+*/
+void CTerrainTopology::createVertices(QVector<CVertex>& vVertices) const
+{
+    vVertices.clear();
+    vVertices.reserve(vertexCount());
+
+    for (int z = 0; z < m_iNumPoints; z++)
+    {
+        for (int x = 0; x < m_iNumPoints; x++)
+        {
+            double u = (double) x / (double) (m_iNumPoints - 1);
+            double v = (double) z / (double) (m_iNumPoints - 1);
+
+            vVertices.append(CVertex(CVector3(u - 0.5, 0.0, v - 0.5), CVector2(u, v)));
+        }
+    }
+
+    foreach (int iSource, m_vSkirtSources)
+    {
+        vVertices.append(vVertices[iSource]);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Returns the number of points used by a patch asked for \a iNumPoints : patches have an odd number of points.
+*/
+int CTerrainTopology::validNumPoints(int iNumPoints)
+{
+    if (iNumPoints % 2 == 0)
+    {
+        return iNumPoints + 1;
+    }
+
+    return iNumPoints;
+}
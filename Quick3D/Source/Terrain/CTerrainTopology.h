@@ -0,0 +1,84 @@
+
+#pragma once
+
+// Qt
+#include <QVector>
+
+// Application
+#include "quick3d_global.h"
+#include "CQ3DConstants.h"
+#include "CVertex.h"
+#include "CSharedIndexBuffer.h"
+
+//-------------------------------------------------------------------------------------------------
+// Forward declarations
+
+class C3DScene;
+
+//-------------------------------------------------------------------------------------------------
+
+//! The topology shared by all terrain patches of a given resolution
+//! Vertices are the iNumPoints x iNumPoints grid, row major, followed by the skirt ring if any
+class QUICK3D_EXPORT CTerrainTopology : public QSharedData
+{
+public:
+
+    //-------------------------------------------------------------------------------------------------
+    // Constructors and destructor
+    //-------------------------------------------------------------------------------------------------
+
+    //!
+    CTerrainTopology(C3DScene* pScene, int iNumPoints, bool bSkirt);
+
+    //!
+    virtual ~CTerrainTopology();
+
+    //-------------------------------------------------------------------------------------------------
+    // Getters
+    //-------------------------------------------------------------------------------------------------
+
+    //! Returns the number of points on a side of the grid
+    int numPoints() const { return m_iNumPoints; }
+
+    //! Returns true if the topology has a skirt
+    bool hasSkirt() const { return m_vSkirtSources.count() > 0; }
+
+    //! Returns the number of grid vertices, skirt excluded
+    int gridVertexCount() const { return m_iNumPoints * m_iNumPoints; }
+
+    //! Returns the number of vertices, skirt included
+    int vertexCount() const { return gridVertexCount() + m_vSkirtSources.count(); }
+
+    //! Returns the grid vertex copied by each skirt vertex
+    const QVector<int>& skirtSources() const { return m_vSkirtSources; }
+
+    //! Returns the triangle indices, grid first, then skirt
+    QSP<CSharedIndexBuffer> indices() const { return m_pIndices; }
+
+    //-------------------------------------------------------------------------------------------------
+    // Control methods
+    //-------------------------------------------------------------------------------------------------
+
+    //! Fills vVertices with a unit patch matching this topology, centered on the origin in the XZ plane
+    void createVertices(QVector<CVertex>& vVertices) const;
+
+    //-------------------------------------------------------------------------------------------------
+    // Static methods
+    //-------------------------------------------------------------------------------------------------
+
+    //! Returns the number of points actually used for a patch of iNumPoints, which must be odd
+    static int validNumPoints(int iNumPoints);
+
+    //! Returns a unique key for a topology
+    static int key(int iNumPoints, bool bSkirt) { return iNumPoints * 2 + (bSkirt ? 1 : 0); }
+
+    //-------------------------------------------------------------------------------------------------
+    // Properties
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    int                         m_iNumPoints;
+    QVector<int>                m_vSkirtSources;    // Grid vertex of each skirt vertex, counter-clockwise around the grid
+    QSP<CSharedIndexBuffer>     m_pIndices;         // Triangles, shared by all patches
+};
@@ -0,0 +1,312 @@
+
+// Qt
+#include <QMutexLocker>
+#include <QDataStream>
+#include <QDir>
+
+// qt-plus
+#include "CLogger.h"
+
+// Application
+#include "CTileStore.h"
+
+//-------------------------------------------------------------------------------------------------
+
+#define TILE_STORE_MAGIC        0x51334454
+#define TILE_STORE_VERSION      1
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    \class CTileStore
+    \brief Stores downloaded map tiles in a packed data file with an index.
+    \inmodule Quick3D
+    \sa CHTTPMapClient
+
+    Tile data is appended to one data file. Each write appends a record giving the name, offset and size of the tile
+    to an index file, which is read back when the store is opened. \br\br
+    A record whose data did not reach the data file, after a crash for instance, is ignored.
+    Replaced tiles leave their old data in the data file. \br\br
+    All methods are thread safe. Two stores must not use the same directory, since each one appends to the files
+    at the end it knows of, so users of a directory get the same store with shared().
+*/
+
+//-------------------------------------------------------------------------------------------------
+
+QMutex CTileStore::m_mSharedMutex;
+QHash<QString, QWeakPointer<CTileStore> > CTileStore::m_mShared;
+
+//-------------------------------------------------------------------------------------------------
+
+CTileStore::CTileStore()
+{
+}
+
+//-------------------------------------------------------------------------------------------------
+
+CTileStore::~CTileStore()
+{
+    close();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Returns the store of the directory \a sPath, opening it if no one uses it yet.
+    The store is closed when the last returned pointer is released.
+*/
+QSharedPointer<CTileStore> CTileStore::shared(const QString& sPath)
+{
+    QMutexLocker locker(&m_mSharedMutex);
+
+    QString sKey = QDir::cleanPath(QDir(sPath).absolutePath());
+    QSharedPointer<CTileStore> pStore = m_mShared.value(sKey).toStrongRef();
+
+    if (pStore.isNull())
+    {
+        pStore = QSharedPointer<CTileStore>(new CTileStore());
+        pStore->open(sKey);
+
+        m_mShared[sKey] = pStore.toWeakRef();
+    }
+
+    return pStore;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+int CTileStore::count()
+{
+    QMutexLocker locker(&m_mMutex);
+
+    return m_mEntries.count();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+qint64 CTileStore::dataBytes()
+{
+    QMutexLocker locker(&m_mMutex);
+
+    return m_fData.isOpen() ? m_fData.size() : 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Opens the store in the directory \a sPath, which is created if needed. \br\br
+    Tiles left as loose .jpg files in \a sPath are moved into the store.
+    Returns \c false if the files cannot be opened.
+*/
+bool CTileStore::open(const QString& sPath)
+{
+    close();
+
+    QMutexLocker locker(&m_mMutex);
+
+    if (QDir().exists(sPath) == false)
+    {
+        QDir().mkpath(sPath);
+    }
+
+    m_fData.setFileName(sPath + "/" + TILE_STORE_DATA_FILE);
+    m_fIndex.setFileName(sPath + "/" + TILE_STORE_INDEX_FILE);
+
+    if (m_fData.open(QIODevice::ReadWrite) == false || m_fIndex.open(QIODevice::ReadWrite) == false)
+    {
+        LOG_METHOD_ERROR(QString("Could not open tile store in %1").arg(sPath));
+
+        m_fData.close();
+        m_fIndex.close();
+
+        return false;
+    }
+
+    readIndex();
+
+    locker.unlock();
+
+    importLooseFiles(sPath);
+
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CTileStore::close()
+{
+    QMutexLocker locker(&m_mMutex);
+
+    m_fData.close();
+    m_fIndex.close();
+    m_mEntries.clear();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+bool CTileStore::contains(const QString& sName)
+{
+    QMutexLocker locker(&m_mMutex);
+
+    return m_mEntries.contains(sName);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+QByteArray CTileStore::read(const QString& sName)
+{
+    QMutexLocker locker(&m_mMutex);
+
+    if (m_mEntries.contains(sName))
+    {
+        const CEntry& tEntry = m_mEntries[sName];
+
+        if (m_fData.seek(tEntry.m_iOffset))
+        {
+            return m_fData.read(tEntry.m_iSize);
+        }
+    }
+
+    return QByteArray();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+bool CTileStore::write(const QString& sName, const QByteArray& baData)
+{
+    QMutexLocker locker(&m_mMutex);
+
+    return append(sName, baData);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+/*!
+    Reads all records of the index file. A new index file gets a header. \br\br
+    Reading stops at the first incomplete record, records pointing past the end of the data file are ignored,
+    and the index file is truncated after the last valid record.
+*/
+void CTileStore::readIndex()
+{
+    QDataStream sIndex(&m_fIndex);
+    sIndex.setVersion(QDataStream::Qt_5_0);
+
+    if (m_fIndex.size() == 0)
+    {
+        sIndex << (quint32) TILE_STORE_MAGIC << (quint32) TILE_STORE_VERSION;
+        m_fIndex.flush();
+        return;
+    }
+
+    quint32 iMagic = 0;
+    quint32 iVersion = 0;
+
+    sIndex >> iMagic >> iVersion;
+
+    if (iMagic != TILE_STORE_MAGIC || iVersion != TILE_STORE_VERSION)
+    {
+        LOG_METHOD_ERROR(QString("Unknown tile store index in %1, starting a new store").arg(m_fIndex.fileName()));
+
+        m_fIndex.resize(0);
+        m_fData.resize(0);
+        m_fIndex.seek(0);
+
+        sIndex.resetStatus();
+        sIndex << (quint32) TILE_STORE_MAGIC << (quint32) TILE_STORE_VERSION;
+        m_fIndex.flush();
+        return;
+    }
+
+    qint64 iDataSize = m_fData.size();
+    qint64 iValidEnd = m_fIndex.pos();
+
+    while (sIndex.atEnd() == false)
+    {
+        QString sName;
+        CEntry tEntry;
+
+        sIndex >> sName >> tEntry.m_iOffset >> tEntry.m_iSize;
+
+        if (sIndex.status() != QDataStream::Ok)
+        {
+            break;
+        }
+
+        if (tEntry.m_iOffset >= 0 && tEntry.m_iSize > 0 && tEntry.m_iOffset + tEntry.m_iSize <= iDataSize)
+        {
+            m_mEntries[sName] = tEntry;
+        }
+
+        iValidEnd = m_fIndex.pos();
+    }
+
+    // Drop an incomplete last record, so that new records follow valid ones
+    if (iValidEnd < m_fIndex.size())
+    {
+        m_fIndex.resize(iValidEnd);
+    }
+
+    m_fIndex.seek(m_fIndex.size());
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CTileStore::importLooseFiles(const QString& sPath)
+{
+    QFileInfoList lFiles = QDir(sPath).entryInfoList(QStringList() << "*.jpg", QDir::Files);
+
+    if (lFiles.count() > 0)
+    {
+        LOG_METHOD_DEBUG(QString("Importing %1 loose tiles into the tile store").arg(lFiles.count()));
+    }
+
+    foreach (QFileInfo tInfo, lFiles)
+    {
+        QFile fTile(tInfo.absoluteFilePath());
+
+        if (fTile.open(QIODevice::ReadOnly))
+        {
+            QByteArray baData = fTile.readAll();
+            fTile.close();
+
+            if (baData.count() > 0 && write(tInfo.completeBaseName(), baData))
+            {
+                fTile.remove();
+            }
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+bool CTileStore::append(const QString& sName, const QByteArray& baData)
+{
+    if (m_fData.isOpen() == false || baData.count() == 0)
+    {
+        return false;
+    }
+
+    CEntry tEntry;
+    tEntry.m_iOffset = m_fData.size();
+    tEntry.m_iSize = baData.count();
+
+    if (m_fData.seek(tEntry.m_iOffset) == false || m_fData.write(baData) != baData.count())
+    {
+        LOG_METHOD_ERROR(QString("Could not write tile %1").arg(sName));
+        return false;
+    }
+
+    // Data goes to disk before the record pointing to it
+    m_fData.flush();
+
+    QDataStream sIndex(&m_fIndex);
+    sIndex.setVersion(QDataStream::Qt_5_0);
+
+    m_fIndex.seek(m_fIndex.size());
+    sIndex << sName << tEntry.m_iOffset << tEntry.m_iSize;
+    m_fIndex.flush();
+
+    m_mEntries[sName] = tEntry;
+
+    return true;
+}
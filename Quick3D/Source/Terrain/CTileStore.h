@@ -0,0 +1,106 @@
+
+#pragma once
+
+// Qt
+#include <QMutex>
+#include <QFile>
+#include <QHash>
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QWeakPointer>
+
+// Application
+#include "quick3d_global.h"
+
+//-------------------------------------------------------------------------------------------------
+
+#define TILE_STORE_DATA_FILE    "Tiles.dat"
+#define TILE_STORE_INDEX_FILE   "Tiles.idx"
+
+//-------------------------------------------------------------------------------------------------
+
+//! Stores downloaded map tiles in one packed data file, indexed by tile name
+class QUICK3D_EXPORT CTileStore
+{
+public:
+
+    //-------------------------------------------------------------------------------------------------
+    // Constructors and destructor
+    //-------------------------------------------------------------------------------------------------
+
+    //! Default constructor
+    CTileStore();
+
+    //! Destructor
+    virtual ~CTileStore();
+
+    //! Returns the store of the directory sPath, opened once and shared by all its users in the process
+    static QSharedPointer<CTileStore> shared(const QString& sPath);
+
+    //-------------------------------------------------------------------------------------------------
+    // Getters
+    //-------------------------------------------------------------------------------------------------
+
+    //! Returns the number of stored tiles
+    int count();
+
+    //! Returns the size of the data file in bytes
+    qint64 dataBytes();
+
+    //-------------------------------------------------------------------------------------------------
+    // Control methods
+    //-------------------------------------------------------------------------------------------------
+
+    //! Opens the store in the directory sPath, creating it if needed, and imports loose tile files
+    bool open(const QString& sPath);
+
+    //! Closes the store
+    void close();
+
+    //! Returns true if the tile sName is stored
+    bool contains(const QString& sName);
+
+    //! Returns the data of the tile sName, empty if not stored
+    QByteArray read(const QString& sName);
+
+    //! Stores baData as the tile sName, replacing any previous data
+    bool write(const QString& sName, const QByteArray& baData);
+
+    //-------------------------------------------------------------------------------------------------
+    // Protected methods
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    //! Reads the index file, ignoring records past the end of the data file
+    void readIndex();
+
+    //! Imports the loose .jpg files of sPath, written by older versions
+    void importLooseFiles(const QString& sPath);
+
+    //! Appends baData to the data file and a record to the index, the mutex must be locked
+    bool append(const QString& sName, const QByteArray& baData);
+
+    //-------------------------------------------------------------------------------------------------
+    // Properties
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    //! Location of a tile in the data file
+    class CEntry
+    {
+    public:
+
+        qint64  m_iOffset;
+        qint32  m_iSize;
+    };
+
+    QMutex                      m_mMutex;           // Protects all members below, tiles are read and written by decoding threads
+    QFile                       m_fData;            // Tile data, appended
+    QFile                       m_fIndex;           // One record per write, the last record of a name wins
+    QHash<QString, CEntry>      m_mEntries;
+
+    static QMutex                                       m_mSharedMutex;     // Stores are shared by several map clients
+    static QHash<QString, QWeakPointer<CTileStore> >    m_mShared;          // Shared stores by absolute path
+};
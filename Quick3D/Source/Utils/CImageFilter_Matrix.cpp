@@ -1,6 +1,13 @@
 
+// Std
+#include <string.h>
+
+// Qt
+#include <QtConcurrent>
+
 // Application
 #include "CImageFilter_Matrix.h"
+#include "CImageUtilities.h"
 
 //-------------------------------------------------------------------------------------------------
 
@@ -17,7 +24,141 @@ CImageFilter_Matrix::~CImageFilter_Matrix()
 
 //-------------------------------------------------------------------------------------------------
 
+// Unpacks row iRow of a 32 bit image into three planes of doubles, the low byte first,
+// each plane having a zero column on both sides. Rows outside of the image are zero.
+static void unpackRow(double* pPlanes, const uchar* pBits, int iStride, int iWidth, int iHeight, int iRow)
+{
+    int iPlaneWidth = iWidth + 2;
+
+    if (iRow < 0 || iRow >= iHeight)
+    {
+        memset(pPlanes, 0, 3 * iPlaneWidth * sizeof(double));
+        return;
+    }
+
+    const quint32* pPixels = (const quint32*) (pBits + iRow * iStride);
+    double* pPlane0 = pPlanes + 1;
+    double* pPlane1 = pPlanes + iPlaneWidth + 1;
+    double* pPlane2 = pPlanes + 2 * iPlaneWidth + 1;
+
+    for (int x = 0; x < iWidth; x++)
+    {
+        quint32 iPixel = pPixels[x];
+
+        pPlane0[x] = (double) ((iPixel >>  0) & 0xFF);
+        pPlane1[x] = (double) ((iPixel >>  8) & 0xFF);
+        pPlane2[x] = (double) ((iPixel >> 16) & 0xFF);
+    }
+
+    pPlanes[0] = 0.0;
+    pPlanes[iPlaneWidth - 1] = 0.0;
+    pPlanes[iPlaneWidth] = 0.0;
+    pPlanes[2 * iPlaneWidth - 1] = 0.0;
+    pPlanes[2 * iPlaneWidth] = 0.0;
+    pPlanes[3 * iPlaneWidth - 1] = 0.0;
+}
+
+//-------------------------------------------------------------------------------------------------
+
 void CImageFilter_Matrix::process(QImage& imgImage)
+{
+    QImage::Format eFormat = imgImage.format();
+
+    if (eFormat != QImage::Format_RGB888 && eFormat != QImage::Format_RGB32 && eFormat != QImage::Format_ARGB32)
+    {
+        processPixels(imgImage);
+        return;
+    }
+
+    int iWidth = imgImage.width();
+    int iHeight = imgImage.height();
+    int iPlaneWidth = iWidth + 2;
+
+    QImage imgSource = imgImage.convertToFormat(QImage::Format_RGB32);
+    QImage imgTarget(imgImage.size(), QImage::Format_RGB32);
+
+    const uchar* pSourceBits = imgSource.constBits();
+    uchar* pTargetBits = imgTarget.bits();
+    int iStride = imgSource.bytesPerLine();
+
+    // Weights in the order of the sums, row by row
+    double dWeights[9];
+
+    for (int subY = -1; subY < 2; subY++)
+    {
+        for (int subX = -1; subX < 2; subX++)
+        {
+            dWeights[(subY + 1) * 3 + (subX + 1)] = m_mMatrix(subX + 1, subY + 1);
+        }
+    }
+
+    QVector<int> vBands = CImageUtilities::bandStarts(iHeight);
+
+    QtConcurrent::blockingMap(vBands, [&](int iStartRow)
+    {
+        int iEndRow = qMin(iStartRow + IMAGE_BAND_ROWS, iHeight);
+
+        // Planes of the rows above, at and below the current row, then the sums of each channel
+        QVector<double> vRows(3 * 3 * iPlaneWidth);
+        QVector<double> vSums(3 * iWidth);
+
+        double* pRows[3] = { vRows.data(), vRows.data() + 3 * iPlaneWidth, vRows.data() + 6 * iPlaneWidth };
+
+        unpackRow(pRows[0], pSourceBits, iStride, iWidth, iHeight, iStartRow - 1);
+        unpackRow(pRows[1], pSourceBits, iStride, iWidth, iHeight, iStartRow);
+
+        for (int y = iStartRow; y < iEndRow; y++)
+        {
+            unpackRow(pRows[2], pSourceBits, iStride, iWidth, iHeight, y + 1);
+
+            for (int iChannel = 0; iChannel < 3; iChannel++)
+            {
+                const double* pAbove = pRows[0] + iChannel * iPlaneWidth;
+                const double* pAt = pRows[1] + iChannel * iPlaneWidth;
+                const double* pBelow = pRows[2] + iChannel * iPlaneWidth;
+                double* pSums = vSums.data() + iChannel * iWidth;
+
+                // Same order of sums as pixel by pixel, outside pixels add zero
+                for (int x = 0; x < iWidth; x++)
+                {
+                    double dSum = pAbove[x] * dWeights[0];
+                    dSum += pAbove[x + 1] * dWeights[1];
+                    dSum += pAbove[x + 2] * dWeights[2];
+                    dSum += pAt[x] * dWeights[3];
+                    dSum += pAt[x + 1] * dWeights[4];
+                    dSum += pAt[x + 2] * dWeights[5];
+                    dSum += pBelow[x] * dWeights[6];
+                    dSum += pBelow[x + 1] * dWeights[7];
+                    dSum += pBelow[x + 2] * dWeights[8];
+
+                    pSums[x] = dSum;
+                }
+            }
+
+            // As pixel by pixel, the low byte channel is written to red
+            QRgb* pTarget = (QRgb*) (pTargetBits + y * iStride);
+            const double* pSums0 = vSums.constData();
+            const double* pSums1 = pSums0 + iWidth;
+            const double* pSums2 = pSums1 + iWidth;
+
+            for (int x = 0; x < iWidth; x++)
+            {
+                pTarget[x] = qRgb((int) pSums0[x], (int) pSums1[x], (int) pSums2[x]);
+            }
+
+            double* pFirst = pRows[0];
+            pRows[0] = pRows[1];
+            pRows[1] = pRows[2];
+            pRows[2] = pFirst;
+        }
+    });
+
+    imgImage = (eFormat == QImage::Format_RGB32) ? imgTarget : imgTarget.convertToFormat(eFormat);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CImageFilter_Matrix::processPixels(QImage& imgImage)
 {
     QImage imgSource = imgImage.copy();
 
@@ -39,9 +39,18 @@ public:
     //! Returns this object's class name
     virtual QString getClassName() const Q_DECL_OVERRIDE { return "CImageFilter_Matrix"; }
 
-    //!
+    //! Applies the matrix to imgImage, by bands of rows in parallel
     virtual void process(QImage& imgImage);
 
+    //-------------------------------------------------------------------------------------------------
+    // Protected methods
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    //! Applies the matrix pixel by pixel, for formats other than 24 and 32 bit RGB
+    void processPixels(QImage& imgImage);
+
     //-------------------------------------------------------------------------------------------------
     // Properties
     //-------------------------------------------------------------------------------------------------
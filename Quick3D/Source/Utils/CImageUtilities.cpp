@@ -1,6 +1,10 @@
 
+// Std
+#include <string.h>
+
 // Qt
 #include <QPainter>
+#include <QtConcurrent>
 
 // qt-plus
 #include "CTimeSampler.h"
@@ -81,46 +85,87 @@ void CImageUtilities::createPanoramicTextureSet(
 
 	Math::CVector2 vInputStartAngles = tParams.startAngles();
 	Math::CVector2 vInputEndAngles = tParams.endAngles();
-	Math::CVector2 vInputCenter((vInputStartAngles.X + vInputEndAngles.X) / 2.0, (vInputStartAngles.Y + vInputEndAngles.Y) / 2.0);
 	Math::CVector2 vInputSpan(vInputEndAngles.X - vInputStartAngles.X, vInputEndAngles.Y - vInputStartAngles.Y);
 
-	// Resampling sphrique de l'image d'entre vers l'image de sortie
+	double dOuputTiltFactor = imgInput.height() / vInputSpan.X;
+	double dOuputPanFactor = imgInput.width() / vInputSpan.Y;
+
+	// Pixel d'entre de chaque colonne et ligne de sortie, -1 hors de l'image d'entre
+	QVector<int> vInputPanIndices(imgOutput.width());
+	QVector<int> vInputTiltIndices(imgOutput.height());
+
+	for (int iOutputPanIndex = 0; iOutputPanIndex < imgOutput.width(); iOutputPanIndex++)
+	{
+		double dPanNormalized = (double) iOutputPanIndex / (double) imgOutput.width();
+		double dOutputPan = (dPanNormalized * 360.0) - 180.0;
+		int iInputPanIndex = (int) ((dOutputPan - vInputStartAngles.Y) * dOuputPanFactor);
+
+		vInputPanIndices[iOutputPanIndex] = (iInputPanIndex > 0 && iInputPanIndex < imgInput.width()) ? iInputPanIndex : -1;
+	}
+
 	for (int iOutputTiltIndex = 0; iOutputTiltIndex < imgOutput.height(); iOutputTiltIndex++)
 	{
-		for (int iOutputPanIndex = 0; iOutputPanIndex < imgOutput.width(); iOutputPanIndex++)
-		{
-			// Calcul du pan et tilt dans le repre de sortie
-			double dTiltNormalized	= (double) iOutputTiltIndex / (double) imgOutput.height();
-			double dPanNormalized	= (double) iOutputPanIndex / (double) imgOutput.width();
+		double dTiltNormalized = (double) iOutputTiltIndex / (double) imgOutput.height();
+		double dOutputTilt = (dTiltNormalized * 180.0) - 90.0;
+		int iInputTiltIndex = (int) ((dOutputTilt - vInputStartAngles.X) * dOuputTiltFactor);
 
-			double dOutputTilt = (dTiltNormalized * 180.0) - 90.0;
-			double dOutputPan = (dPanNormalized * 360.0) - 180.0;
+		vInputTiltIndices[iOutputTiltIndex] = (iInputTiltIndex > 0 && iInputTiltIndex < imgInput.height()) ? iInputTiltIndex : -1;
+	}
 
-			double dOuputTiltFactor = imgInput.height() / vInputSpan.X;
-			double dOuputPanFactor = imgInput.width() / vInputSpan.Y;
+	// L'entre est lue dans le format de la sortie, les pixels sont copis octet par octet
+	QImage imgSource = imgInput.convertToFormat(QImage::Format_RGB888);
 
-			double dInputTilt = (dOutputTilt - vInputStartAngles.X) * dOuputTiltFactor;
-			double dInputPan = (dOutputPan - vInputStartAngles.Y) * dOuputPanFactor;
+	const uchar* pSourceBits = imgSource.constBits();
+	uchar* pOutputBits = imgOutput.bits();
+	int iSourceStride = imgSource.bytesPerLine();
+	int iOutputStride = imgOutput.bytesPerLine();
+	int iOutputWidth = imgOutput.width();
+	int iOutputHeight = imgOutput.height();
+	const int* pInputPanIndices = vInputPanIndices.constData();
+	const int* pInputTiltIndices = vInputTiltIndices.constData();
 
-			int iInputTiltIndex = (int) dInputTilt;
-			int iInputPanIndex = (int) dInputPan;
+	QVector<int> vBands = bandStarts(iOutputHeight);
 
-			// Initialisation du pixel courant  zro
-			QRgb rgbPixel = 0;
+	// Resampling sphrique de l'image d'entre vers l'image de sortie, par bandes de lignes
+	QtConcurrent::blockingMap(vBands, [=](int iStartRow)
+	{
+		int iEndRow = qMin(iStartRow + IMAGE_BAND_ROWS, iOutputHeight);
+
+		for (int iOutputTiltIndex = iStartRow; iOutputTiltIndex < iEndRow; iOutputTiltIndex++)
+		{
+			uchar* pOutput = pOutputBits + iOutputTiltIndex * iOutputStride;
+			int iInputTiltIndex = pInputTiltIndices[iOutputTiltIndex];
 
-			// Rcupration du pixel s'il est dans les limites de l'image d'entre
-			if (
-				iInputPanIndex > 0 && iInputPanIndex < imgInput.width() &&
-				iInputTiltIndex > 0 && iInputTiltIndex < imgInput.height()
-				)
+			if (iInputTiltIndex < 0)
 			{
-				rgbPixel = imgInput.pixel(iInputPanIndex, iInputTiltIndex);
+				memset(pOutput, 0, iOutputWidth * 3);
+				continue;
 			}
 
-			// Ecriture du pixel dans l'image de sortie
-			imgOutput.setPixel(iOutputPanIndex, iOutputTiltIndex, rgbPixel);
+			const uchar* pInput = pSourceBits + iInputTiltIndex * iSourceStride;
+
+			for (int iOutputPanIndex = 0; iOutputPanIndex < iOutputWidth; iOutputPanIndex++)
+			{
+				int iInputPanIndex = pInputPanIndices[iOutputPanIndex];
+				uchar* pPixel = pOutput + iOutputPanIndex * 3;
+
+				if (iInputPanIndex < 0)
+				{
+					pPixel[0] = 0;
+					pPixel[1] = 0;
+					pPixel[2] = 0;
+				}
+				else
+				{
+					const uchar* pInputPixel = pInput + iInputPanIndex * 3;
+
+					pPixel[0] = pInputPixel[0];
+					pPixel[1] = pInputPixel[1];
+					pPixel[2] = pInputPixel[2];
+				}
+			}
 		}
-	}
+	});
 
 	// Cration des textures de sortie d'aprs la texture de sortie intermdiaire (imgOutput)
 	tParams.images().clear();
@@ -153,17 +198,42 @@ void CImageUtilities::blitPart(QImage& imgDest, QPoint pDestPosition, const QIma
 {
 	START_SAMPLE("CImageUtilities::blitPart");
 
-	for (int y = 0; y < sSize.height(); y++)
+	QRect rSource(pSourcePosition, sSize);
+	QRect rDest(pDestPosition, sSize);
+
+	// Copie des lignes entires quand les deux images ont le mme format, sans palette
+	if (
+		imgDest.format() == imgSource.format() &&
+		imgSource.depth() >= 8 && imgSource.colorCount() == 0 &&
+		imgSource.rect().contains(rSource) && imgDest.rect().contains(rDest)
+		)
 	{
-		for (int x = 0; x < sSize.width(); x++)
+		int iPixelBytes = imgSource.depth() / 8;
+		int iRowBytes = sSize.width() * iPixelBytes;
+
+		for (int y = 0; y < sSize.height(); y++)
 		{
-			imgDest.setPixel(
-				pDestPosition.x() + x,
-				pDestPosition.y() + y,
-				imgSource.pixel(pSourcePosition.x() + x, pSourcePosition.y() + y)
+			memcpy(
+				imgDest.scanLine(pDestPosition.y() + y) + pDestPosition.x() * iPixelBytes,
+				imgSource.constScanLine(pSourcePosition.y() + y) + pSourcePosition.x() * iPixelBytes,
+				iRowBytes
 				);
 		}
 	}
+	else
+	{
+		for (int y = 0; y < sSize.height(); y++)
+		{
+			for (int x = 0; x < sSize.width(); x++)
+			{
+				imgDest.setPixel(
+					pDestPosition.x() + x,
+					pDestPosition.y() + y,
+					imgSource.pixel(pSourcePosition.x() + x, pSourcePosition.y() + y)
+					);
+			}
+		}
+	}
 
 	STOP_SAMPLE("CImageUtilities::blitPart");
 }
@@ -180,3 +250,17 @@ void CImageUtilities::blitWhole(QImage& imgDest, QPoint pDestPosition, const QIm
 
 	STOP_SAMPLE("CImageUtilities::blitWhole");
 }
+
+//-------------------------------------------------------------------------------------------------
+
+QVector<int> CImageUtilities::bandStarts(int iHeight)
+{
+	QVector<int> vStarts;
+
+	for (int iRow = 0; iRow < iHeight; iRow += IMAGE_BAND_ROWS)
+	{
+		vStarts.append(iRow);
+	}
+
+	return vStarts;
+}
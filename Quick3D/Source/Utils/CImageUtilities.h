@@ -10,6 +10,11 @@
 
 //-------------------------------------------------------------------------------------------------
 
+//! Number of rows an image kernel processes in one thread
+#define IMAGE_BAND_ROWS		32
+
+//-------------------------------------------------------------------------------------------------
+
 class QUICK3D_EXPORT CSphericalTextureSet
 {
 public:
@@ -104,9 +109,12 @@ public:
 		CSphericalTextureSet& tParams
 		);
 
-	//!
+	//! Copies a rectangle of imgSource into imgDest, row by row when both have the same format
 	static void blitPart(QImage& imgDest, QPoint pDestPosition, const QImage& imgSource, QPoint pSourcePosition, QSize sSize);
 
 	//!
 	static void blitWhole(QImage& imgDest, QPoint pDestPosition, const QImage& imgSource);
+
+	//! Returns the first row of each band of IMAGE_BAND_ROWS rows, in an image of iHeight rows
+	static QVector<int> bandStarts(int iHeight);
 };
@@ -41,7 +41,8 @@ void CQuick3DUtilities::prepareSceneForMatrices_CubeMapped(CPanoramicMatrixParam
     if (m_pCMScene == nullptr)
     {
         // Cration de la scne
-        m_pCMScene = new CGLWidgetScene();
+        // Rendered offscreen, matrices are computed on machines without a display
+        m_pCMScene = new COffscreenScene(QSize(512, 512));
 
         // Cration du champ de hauteurs
         if (tParams.m_sPathToBILData.isEmpty() == false)
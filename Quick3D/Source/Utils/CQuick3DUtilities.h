@@ -17,7 +17,7 @@
 #include "CCamera.h"
 #include "CImageUtilities.h"
 #include "IProgressListener.h"
-#include "CGLWidgetScene.h"
+#include "COffscreenScene.h"
 #include "CWorldTerrain.h"
 #include "CSRTMField.h"
 #include "CBILField.h"
@@ -66,7 +66,7 @@ protected:
     // Properties
     //-------------------------------------------------------------------------------------------------
 
-    CGLWidgetScene*     m_pCMScene;
+    COffscreenScene*    m_pCMScene;
     CHeightField*       m_pCMField;
     QSP<CWorldTerrain>  m_pCMTerrain;
     QSP<CCamera>        m_pCMCamera;
@@ -183,6 +183,46 @@ QByteArray CZip::getZipFileContent(QString& sFile)
 
 //-------------------------------------------------------------------------------------------------
 
+#define UNZIP_CHUNK_SIZE	(1024 * 1024)
+
+/*!
+	Decompresses \a sFile directly into \a pBuffer, one chunk at a time, without an intermediate copy. \br\br
+	Reads at most \a iSize bytes. Returns the number of bytes read, or -1 if the entry could not be opened.
+*/
+qint64 CZip::readZipFileContent(const QString& sFile, char* pBuffer, qint64 iSize)
+{
+	qint64 iTotalRead = -1;
+
+	unzFile pFile = unzOpen(m_sFileName.toLocal8Bit().constData());
+
+	if (pFile != nullptr)
+	{
+		if (unzLocateFile(pFile, sFile.toLatin1().constData(), 2) == UNZ_OK && unzOpenCurrentFile(pFile) == UNZ_OK)
+		{
+			iTotalRead = 0;
+
+			while (iTotalRead < iSize)
+			{
+				unsigned iChunkSize = (unsigned) qMin((qint64) UNZIP_CHUNK_SIZE, iSize - iTotalRead);
+				int iRead = unzReadCurrentFile(pFile, pBuffer + iTotalRead, iChunkSize);
+
+				if (iRead <= 0)
+				{
+					break;
+				}
+
+				iTotalRead += iRead;
+			}
+
+			unzCloseCurrentFile(pFile);
+		}
+
+		unzClose(pFile);
+	}
+
+	return iTotalRead;
+}
+
 #define GZIP_WINDOWS_BIT	(MAX_WBITS + 16)
 #define GZIP_CHUNK_SIZE		(32 * 1024)
 
@@ -43,6 +43,9 @@ public:
     //! Get file content
     QByteArray getZipFileContent(QString& sFile);
 
+    //! Streams the content of sFile into pBuffer, at most iSize bytes, returns the number of bytes read or -1 on error
+    qint64 readZipFileContent(const QString& sFile, char* pBuffer, qint64 iSize);
+
     //-------------------------------------------------------------------------------------------------
     // Properties
     //-------------------------------------------------------------------------------------------------
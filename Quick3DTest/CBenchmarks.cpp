@@ -0,0 +1,1813 @@
+
+// Qt
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QtEndian>
+#include <QThread>
+#include <QThreadPool>
+
+// qt-plus
+#include "geotrans.h"
+#include "geocent.h"
+
+// Quick3D
+#include "Angles.h"
+#include "C3DScene.h"
+#include "CCamera.h"
+#include "CHeightField.h"
+#include "CHGTField.h"
+#include "CImageFilter_Matrix.h"
+#include "CImageUtilities.h"
+#include "CMatrix4.h"
+#include "CMesh.h"
+#include "CMeshGeometry.h"
+#include "COffscreenScene.h"
+#include "CRenderVertex.h"
+#include "CSceneBVH.h"
+#include "CSRTMField.h"
+#include "CTerrain.h"
+#include "CTerrestrialVehicle.h"
+#include "CTexture.h"
+
+// Application
+#include "CBenchmarks.h"
+
+//-------------------------------------------------------------------------------------------------
+
+using namespace Math;
+
+//-------------------------------------------------------------------------------------------------
+
+#define HGT_CELLS       1201
+#define HGT_SAMPLES     1000000
+
+// 64 terrain patches of 81 x 81 vertices
+#define VERTEX_SAMPLES  (81 * 81 * 64)
+
+#define TERRAIN_POINTS      81
+#define TERRAIN_SAMPLES     200000
+
+#define GEOLOC_SAMPLES      1000000
+
+#define SCENE_BOXES         5000
+#define SCENE_RAYS          2000
+
+#define TERRAIN_RAYS        2000
+
+#define MESH_POINTS         200
+#define MESH_RAYS           2000
+
+#define UPDATE_VEHICLES     1000
+#define UPDATE_STEPS        100
+
+#define OFFSCREEN_SIZE      512
+#define OFFSCREEN_POINTS    200
+#define OFFSCREEN_FRAMES    100
+
+#define DEPTH_WIDTH         600
+#define DEPTH_HEIGHT        200
+#define DEPTH_CAPTURES      3
+
+#define PANORAMA_WIDTH      8192
+#define PANORAMA_HEIGHT     4096
+#define PANORAMA_TEXTURE    1024
+
+#define STREAM_SIZE         2048
+#define STREAM_PATCH        256
+#define STREAM_UPLOADS      100
+
+//-------------------------------------------------------------------------------------------------
+
+// The HGT sampling path used before tiles were memory mapped : one locked seek and read per corner
+static double legacyHGTHeightAt(QFile& tFile, QMutex& tMutex, const CGeoloc& gTile, const CGeoloc& gPosition)
+{
+    QMutexLocker locker(&tMutex);
+
+    double dLatDiff = Angles::clipAngleDegree(gPosition.Latitude - gTile.Latitude);
+    double dLonDiff = Angles::clipAngleDegree(gPosition.Longitude - gTile.Longitude);
+
+    double dLatPos = (1.0 - dLatDiff) * ((double) HGT_CELLS - 1);
+    double dLonPos = dLonDiff * ((double) HGT_CELLS - 1);
+
+    double dCorners[4] = { 0.0, 0.0, 0.0, 0.0 };
+
+    for (int iCorner = 0; iCorner < 4; iCorner++)
+    {
+        int iRow = (int) dLatPos + iCorner / 2;
+        int iCol = (int) dLonPos + iCorner % 2;
+
+        if (iRow >= 0 && iRow < HGT_CELLS && iCol >= 0 && iCol < HGT_CELLS)
+        {
+            short sData;
+
+            if (tFile.seek(((iRow * HGT_CELLS) + iCol) * sizeof(short)))
+            {
+                tFile.read((char*) &sData, sizeof(short));
+                unsigned short* pShort = (unsigned short*) &sData;
+                *pShort = ((*pShort & 0x00FF) << 8) | ((*pShort & 0xFF00) >> 8);
+                dCorners[iCorner] = (double) sData;
+            }
+        }
+
+        if (dCorners[iCorner] == 0.0) dCorners[iCorner] = -100.0;
+    }
+
+    double fx = dLonPos - ((double) (int) dLonPos);
+    double fy = dLatPos - ((double) (int) dLatPos);
+
+    return
+            dCorners[0] * (1.0 - fx) * (1.0 - fy) +
+            dCorners[1] * fx * (1.0 - fy) +
+            dCorners[2] * (1.0 - fx) * fy +
+            dCorners[3] * fx * fy;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+// The terrain height path used before direct grid addressing : a string keyed face lookup and two ray casts per cell
+static double legacyTerrainHeightAt(CTerrain& tTerrain, const QMap<QString, int>& mVerticesToFace, const CGeoloc& gTerrain, const CGeoloc& gSize, const CGeoloc& gPosition)
+{
+    const QVector<CVertex>& vVertices = tTerrain.mesh()->vertices();
+
+    double dLatitudeDiff = Angles::angleDifferenceDegree(gPosition.Latitude, gTerrain.Latitude);
+    double dLongitudeDiff = Angles::angleDifferenceDegree(gPosition.Longitude, gTerrain.Longitude);
+
+    CVector3 vCenter = gTerrain.toVector3();
+    CVector3 vLocal = gPosition.toVector3() - vCenter;
+    CVector3 vUp = vCenter.normalized();
+
+    int iX = (int) (((dLongitudeDiff / gSize.Longitude) + 0.5) * (TERRAIN_POINTS - 1));
+    int iZ = (int) (((dLatitudeDiff / gSize.Latitude) + 0.5) * (TERRAIN_POINTS - 1));
+
+    for (int iIterZ = qMax(iZ - 2, 0); iIterZ <= qMin(iZ + 2, TERRAIN_POINTS - 2); iIterZ++)
+    {
+        for (int iIterX = qMax(iX - 2, 0); iIterX <= qMin(iX + 2, TERRAIN_POINTS - 2); iIterX++)
+        {
+            int iIndex1 = tTerrain.getPointIndexForXZ(iIterX + 0, iIterZ + 0);
+            int iIndex2 = tTerrain.getPointIndexForXZ(iIterX + 1, iIterZ + 0);
+            int iIndex3 = tTerrain.getPointIndexForXZ(iIterX + 1, iIterZ + 1);
+            int iIndex4 = tTerrain.getPointIndexForXZ(iIterX + 0, iIterZ + 1);
+
+            QString sKey = QString("%1%2%3%4").arg(iIndex1).arg(iIndex2).arg(iIndex3).arg(iIndex4);
+
+            if (mVerticesToFace.contains(sKey))
+            {
+                CRay3 ray(vLocal + vUp * 50000.0, vUp * -1.0);
+
+                RayTracingResult dResult = CFace::intersectTriangle(ray, vVertices[iIndex1].position(), vVertices[iIndex2].position(), vVertices[iIndex3].position());
+
+                if (dResult.m_dDistance < Q3D_INFINITY)
+                {
+                    return CGeoloc(vCenter + ray.vOrigin + ray.vNormal * dResult.m_dDistance).Altitude;
+                }
+
+                dResult = CFace::intersectTriangle(ray, vVertices[iIndex1].position(), vVertices[iIndex3].position(), vVertices[iIndex4].position());
+
+                if (dResult.m_dDistance < Q3D_INFINITY)
+                {
+                    return CGeoloc(vCenter + ray.vOrigin + ray.vNormal * dResult.m_dDistance).Altitude;
+                }
+            }
+        }
+    }
+
+    return Q3D_INFINITY;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+// The WGS84 conversion used before CWGS84 : GeoTrans, then an axis swap and a rotation matrix built on each call
+static CVector3 legacyToVector3_WGS84(const CGeoloc& gPosition)
+{
+    CVector3 vPosition3D;
+
+    Convert_Geodetic_To_Geocentric(
+                gPosition.Latitude * GeoTrans::fDeg2Rad,
+                gPosition.Longitude * GeoTrans::fDeg2Rad,
+                gPosition.Altitude,
+                &(vPosition3D.X), &(vPosition3D.Y), &(vPosition3D.Z)
+                );
+
+    SWAP_DOUBLE(vPosition3D.Y, vPosition3D.Z);
+
+    CMatrix4 mRotationAdjustY = CMatrix4::makeRotation(CVector3(0.0, Math::Pi / 2.0, 0.0));
+
+    return mRotationAdjustY * vPosition3D;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+// A raytracable box without geometry, standing for a mesh instance
+class CBenchBox : public CComponent
+{
+public:
+
+    CBenchBox(C3DScene* pScene, double dSize)
+        : CComponent(pScene)
+        , m_dHalfSize(dSize * 0.5)
+    {
+    }
+
+    virtual CBoundingBox worldBounds() Q_DECL_OVERRIDE
+    {
+        CVector3 vPosition = worldPosition();
+        CVector3 vHalfSize(m_dHalfSize, m_dHalfSize, m_dHalfSize);
+
+        return CBoundingBox(vPosition - vHalfSize, vPosition + vHalfSize);
+    }
+
+    virtual RayTracingResult intersect(CRay3 ray) Q_DECL_OVERRIDE
+    {
+        RayTracingResult aResult = worldBounds().intersect(ray);
+
+        return RayTracingResult(aResult.m_dDistance, this, aResult.m_vNormal);
+    }
+
+protected:
+
+    double m_dHalfSize;
+};
+
+//-------------------------------------------------------------------------------------------------
+
+// Flat ground at sea level, so that vehicles run their physics
+class CBenchFlatField : public CHeightField
+{
+public:
+
+    using CHeightField::getHeightAt;
+
+    virtual double getHeightAt(const CGeoloc& gPosition, double* pRigidness = nullptr) Q_DECL_OVERRIDE
+    {
+        Q_UNUSED(gPosition);
+
+        if (pRigidness != nullptr) *pRigidness = 1.0;
+
+        return 0.0;
+    }
+};
+
+//-------------------------------------------------------------------------------------------------
+
+// A scene of independent vehicles driving over the flat ground, the same for a given seed
+static C3DScene* createVehicleScene(CHeightField* pGround)
+{
+    C3DScene* pScene = new C3DScene();
+
+    qsrand(1234);
+
+    for (int iIndex = 0; iIndex < UPDATE_VEHICLES; iIndex++)
+    {
+        QSP<CTerrestrialVehicle> pVehicle = QSP<CTerrestrialVehicle>(new CTerrestrialVehicle(pScene));
+
+        pVehicle->setGeoloc(CGeoloc(
+                                45.0 + 0.5 * (double) qrand() / (double) RAND_MAX,
+                                5.0 + 0.5 * (double) qrand() / (double) RAND_MAX,
+                                2.0
+                                ));
+
+        pVehicle->setVelocity_ms(CVector3(
+                                     10.0 * (double) qrand() / (double) RAND_MAX,
+                                     0.0,
+                                     10.0 * (double) qrand() / (double) RAND_MAX
+                                     ));
+
+        pVehicle->addField(pGround);
+        pVehicle->computeWorldTransform();
+
+        pScene->components().append(pVehicle);
+    }
+
+    return pScene;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+// The scene query used before CSceneBVH : every component hierarchy is walked for each ray
+static RayTracingResult legacySceneIntersect(C3DScene* pScene, const QVector<QSP<CComponent> >& vComponents, const CRay3& ray)
+{
+    RayTracingResult dReturnResult(Q3D_INFINITY);
+
+    foreach (QSP<CComponent> pComponent, vComponents)
+    {
+        RayTracingResult dNewResult = pScene->intersectRecurse(pComponent, ray);
+
+        if (dNewResult.m_dDistance < dReturnResult.m_dDistance)
+        {
+            dReturnResult = dNewResult;
+        }
+    }
+
+    return dReturnResult;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+// The terrain query used before CTriangleBVH : every triangle of the shared topology is tested for each ray
+static RayTracingResult legacyTerrainIntersect(CTerrain& tTerrain, const CRay3& ray)
+{
+    RayTracingResult dReturnResult(Q3D_INFINITY);
+
+    CRay3 rLocalRay = tTerrain.worldTransformInverse() * ray;
+
+    const QVector<GLuint>& vIndices = tTerrain.mesh()->sharedIndices()->indices();
+    const QVector<CVertex>& vVertices = tTerrain.mesh()->vertices();
+
+    for (int iIndex = 0; iIndex + 2 < vIndices.count(); iIndex += 3)
+    {
+        RayTracingResult dNewResult = CFace::intersectTriangle(
+                    rLocalRay,
+                    vVertices[vIndices[iIndex + 0]].position(),
+                    vVertices[vIndices[iIndex + 1]].position(),
+                    vVertices[vIndices[iIndex + 2]].position()
+                    );
+
+        if (dNewResult.m_dDistance < dReturnResult.m_dDistance)
+        {
+            dReturnResult.m_dDistance = dNewResult.m_dDistance;
+            dReturnResult.m_vNormal = dNewResult.m_vNormal;
+        }
+    }
+
+    return dReturnResult;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+// The panoramic texture set path used before the row kernels : one pixel() and setPixel() per output pixel
+static void legacyPanoramicTextureSet(const QImage& imgInput, CSphericalTextureSet& tParams)
+{
+    int iTextureWidth = tParams.textureSize().width();
+    int iTextureHeight = tParams.textureSize().height();
+
+    QImage imgOutput(QSize(iTextureWidth * tParams.panCount(), iTextureHeight * tParams.tiltCount()), QImage::Format_RGB888);
+
+    CVector2 vInputStartAngles = tParams.startAngles();
+    CVector2 vInputSpan(tParams.endAngles().X - vInputStartAngles.X, tParams.endAngles().Y - vInputStartAngles.Y);
+
+    for (int iOutputTiltIndex = 0; iOutputTiltIndex < imgOutput.height(); iOutputTiltIndex++)
+    {
+        for (int iOutputPanIndex = 0; iOutputPanIndex < imgOutput.width(); iOutputPanIndex++)
+        {
+            double dTiltNormalized = (double) iOutputTiltIndex / (double) imgOutput.height();
+            double dPanNormalized = (double) iOutputPanIndex / (double) imgOutput.width();
+
+            double dOutputTilt = (dTiltNormalized * 180.0) - 90.0;
+            double dOutputPan = (dPanNormalized * 360.0) - 180.0;
+
+            double dInputTilt = (dOutputTilt - vInputStartAngles.X) * (imgInput.height() / vInputSpan.X);
+            double dInputPan = (dOutputPan - vInputStartAngles.Y) * (imgInput.width() / vInputSpan.Y);
+
+            int iInputTiltIndex = (int) dInputTilt;
+            int iInputPanIndex = (int) dInputPan;
+
+            QRgb rgbPixel = 0;
+
+            if (iInputPanIndex > 0 && iInputPanIndex < imgInput.width() && iInputTiltIndex > 0 && iInputTiltIndex < imgInput.height())
+            {
+                rgbPixel = imgInput.pixel(iInputPanIndex, iInputTiltIndex);
+            }
+
+            imgOutput.setPixel(iOutputPanIndex, iOutputTiltIndex, rgbPixel);
+        }
+    }
+
+    tParams.images().clear();
+
+    for (int iTiltIndex = 0; iTiltIndex < tParams.tiltCount(); iTiltIndex++)
+    {
+        tParams.images().append(QVector<QImage>());
+
+        for (int iPanIndex = 0; iPanIndex < tParams.panCount(); iPanIndex++)
+        {
+            QImage imgImage(QSize(iTextureWidth, iTextureHeight), QImage::Format_RGB888);
+
+            for (int y = 0; y < iTextureHeight; y++)
+            {
+                for (int x = 0; x < iTextureWidth; x++)
+                {
+                    imgImage.setPixel(x, y, imgOutput.pixel(iPanIndex * iTextureWidth + x, iTiltIndex * iTextureHeight + y));
+                }
+            }
+
+            tParams.images()[iTiltIndex].append(imgImage);
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+// The 3 x 3 matrix filter used before the row kernels : nine pixel() calls and bound checks per output pixel
+static void legacyMatrixFilter(const QMatrix3x3& mMatrix, QImage& imgImage)
+{
+    QImage imgSource = imgImage.copy();
+
+    for (int y = 0; y < imgImage.height(); y++)
+    {
+        for (int x = 0; x < imgImage.width(); x++)
+        {
+            double dR = 0.0;
+            double dG = 0.0;
+            double dB = 0.0;
+
+            for (int subY = -1; subY < 2; subY++)
+            {
+                for (int subX = -1; subX < 2; subX++)
+                {
+                    int offsetX = x + subX;
+                    int offsetY = y + subY;
+
+                    if (offsetX >= 0 && offsetX < imgImage.width() && offsetY >= 0 && offsetY < imgImage.height())
+                    {
+                        QRgb iPixel = imgSource.pixel(offsetX, offsetY);
+
+                        dR += (double) ((iPixel >>  0) & 0xFF) * mMatrix(subX + 1, subY + 1);
+                        dG += (double) ((iPixel >>  8) & 0xFF) * mMatrix(subX + 1, subY + 1);
+                        dB += (double) ((iPixel >> 16) & 0xFF) * mMatrix(subX + 1, subY + 1);
+                    }
+                }
+            }
+
+            imgImage.setPixel(x, y, qRgb((int) dR, (int) dG, (int) dB));
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+// Renders a bumpy patch from a camera standing above it, in a scene of its own, returns the number of frames rendered
+static int renderOffscreenFrames(QOffscreenSurface* pSurface)
+{
+    COffscreenScene* pScene = new COffscreenScene(QSize(OFFSCREEN_SIZE, OFFSCREEN_SIZE), pSurface);
+
+    if (pScene->isValid() == false)
+    {
+        delete pScene;
+        return 0;
+    }
+
+    QSP<CMeshGeometry> pGeometry = QSP<CMeshGeometry>(new CMeshGeometry(pScene, 10000.0, false));
+    pGeometry->createQuadPatch(OFFSCREEN_POINTS);
+    pGeometry->transformVertices(CMatrix4::makeScale(CVector3(1000.0, 1.0, 1000.0)));
+
+    for (int iIndex = 0; iIndex < pGeometry->vertices().count(); iIndex++)
+    {
+        pGeometry->vertices()[iIndex].position().Y = 20.0 * (double) (iIndex % 7) / 7.0;
+    }
+
+    pGeometry->setGeometryDirty(true);
+
+    QSP<CMesh> pPatch = QSP<CMesh>(new CMesh(pScene));
+    pPatch->setGeometry(pGeometry);
+    pPatch->setGeoloc(CGeoloc(45.5, 5.5, 0.0));
+
+    QSP<CCamera> pCamera = QSP<CCamera>(new CCamera(pScene));
+    pCamera->setGeoloc(CGeoloc(45.5, 5.5, 100.0));
+
+    pScene->viewports()[0] = new CViewport(pScene);
+    pScene->viewports()[0]->setSize(CVector2(OFFSCREEN_SIZE, OFFSCREEN_SIZE));
+    pScene->viewports()[0]->setCamera(pCamera);
+    pScene->viewports()[0]->setEnabled(true);
+
+    QVector<QSP<CComponent> > vComponents;
+    vComponents.append(pPatch);
+    vComponents.append(pCamera);
+    pScene->init(vComponents);
+
+    int iFrames = 0;
+
+    for (int iFrame = 0; iFrame < OFFSCREEN_FRAMES; iFrame++)
+    {
+        pScene->updateScene(1.0 / 60.0);
+
+        if (pScene->renderImage().isNull() == false)
+        {
+            iFrames++;
+        }
+    }
+
+    delete pScene;
+
+    return iFrames;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+// Renders offscreen frames in a thread, with a context of its own
+class COffscreenRenderThread : public QThread
+{
+public:
+
+    COffscreenRenderThread(QOffscreenSurface* pSurface)
+        : m_pSurface(pSurface)
+        , m_iFrames(0)
+    {
+    }
+
+    int frames() const { return m_iFrames; }
+
+protected:
+
+    virtual void run() Q_DECL_OVERRIDE
+    {
+        m_iFrames = renderOffscreenFrames(m_pSurface);
+    }
+
+    QOffscreenSurface*  m_pSurface;
+    int                 m_iFrames;
+};
+
+//-------------------------------------------------------------------------------------------------
+
+typedef void (CCamera::*DepthMethod)(C3DScene*, double, CPanoramicMatrixParams&, IProgressListener*);
+
+// Computes a full sphere depth matrix around pCamera with pMethod, returns the depths and the elapsed time
+static QVector<double> captureDepth(CCamera* pCamera, C3DScene* pScene, DepthMethod pMethod, qint64& iElapsedMS)
+{
+    QVector<CGeoZone> vZones;
+    QVector<double> vDepth;
+    QVector<char> vDetection;
+    QVector<char> vEdges;
+    QImage imgDepthImage;
+    QImage imgDetectionImage;
+    QImage imgContourImage;
+
+    CPanoramicMatrixParams tParams(vZones, vDepth, vDetection, vEdges, imgDepthImage, imgDetectionImage, imgContourImage);
+
+    tParams.m_sResolution = QSize(DEPTH_WIDTH, DEPTH_HEIGHT);
+    tParams.m_vStartPanTiltDegrees = CVector2(-90.0, -180.0);
+    tParams.m_vEndPanTiltDegrees = CVector2(90.0, 180.0);
+
+    QElapsedTimer tTimer;
+    tTimer.start();
+
+    (pCamera->*pMethod)(pScene, 10000.0, tParams, nullptr);
+
+    iElapsedMS = tTimer.elapsed();
+
+    return vDepth;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+// Prints the mean and maximum distance error of vDepth against vReference, and the pixels where they disagree on a hit
+static void reportDepthError(const QString& sName, const QVector<double>& vDepth, const QVector<double>& vReference)
+{
+    double dTotalError = 0.0;
+    double dMaxError = 0.0;
+    int iCompared = 0;
+    int iMismatches = 0;
+
+    for (int iIndex = 0; iIndex < vReference.count() && iIndex < vDepth.count(); iIndex++)
+    {
+        bool bHit = vDepth[iIndex] >= 0.0;
+        bool bReferenceHit = vReference[iIndex] >= 0.0;
+
+        if (bHit != bReferenceHit)
+        {
+            iMismatches++;
+        }
+        else if (bHit)
+        {
+            double dError = fabs(vDepth[iIndex] - vReference[iIndex]);
+
+            dTotalError += dError;
+            dMaxError = qMax(dMaxError, dError);
+            iCompared++;
+        }
+    }
+
+    qDebug() << QString("%1 : mean error %2 m, max error %3 m, %4 hit mismatches")
+                .arg(sName)
+                .arg(dTotalError / (double) qMax(iCompared, 1), 0, 'f', 2)
+                .arg(dMaxError, 0, 'f', 2)
+                .arg(iMismatches);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+// Former dynamic texture upload, converting and re-specifying the whole image each time
+static qint64 legacyStreamTexture(C3DScene* pScene, qint64& iBytes)
+{
+    QImage imgTexture(STREAM_SIZE, STREAM_SIZE, QImage::Format_ARGB32);
+    imgTexture.fill(Qt::gray);
+
+    pScene->makeCurrentRenderingContext();
+
+    GLuint uiTexture = 0;
+    glGenTextures(1, &uiTexture);
+    glBindTexture(GL_TEXTURE_2D, uiTexture);
+
+    QElapsedTimer tTimer;
+    tTimer.start();
+
+    for (int iUpload = 0; iUpload < STREAM_UPLOADS; iUpload++)
+    {
+        imgTexture.setPixel(iUpload % STREAM_PATCH, 0, qRgb(iUpload, 0, 0));
+
+        QImage tImage = QGLWidget::convertToGLFormat(imgTexture);
+
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tImage.width(), tImage.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, tImage.bits());
+    }
+
+    glFinish();
+
+    qint64 iElapsedMS = tTimer.elapsed();
+
+    glDeleteTextures(1, &uiTexture);
+
+    iBytes = (qint64) STREAM_UPLOADS * STREAM_SIZE * STREAM_SIZE * 4;
+
+    return iElapsedMS;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+// Paints a rectangle of a dynamic texture with a new color at each update
+class CTexturePainter : public CComponent
+{
+public:
+
+    CTexturePainter(C3DScene* pScene, const QRect& rArea)
+        : CComponent(pScene)
+        , m_rArea(rArea)
+        , m_uiValue(0)
+    {
+    }
+
+    virtual void updateTexture(CTexture* pTexture, double dDeltaTime) Q_DECL_OVERRIDE
+    {
+        Q_UNUSED(dDeltaTime);
+
+        m_uiValue++;
+
+        for (int y = m_rArea.top(); y <= m_rArea.bottom(); y++)
+        {
+            QRgb* pLine = (QRgb*) pTexture->image().scanLine(y);
+
+            for (int x = m_rArea.left(); x <= m_rArea.right(); x++)
+            {
+                pLine[x] = qRgb(m_uiValue, x, y);
+            }
+        }
+
+        pTexture->invalidate(m_rArea);
+    }
+
+protected:
+
+    QRect   m_rArea;
+    uint    m_uiValue;
+};
+
+//-------------------------------------------------------------------------------------------------
+
+// Requests updates of rArea in a dynamic texture, each one once the previous one is uploaded, returns the elapsed time
+static qint64 streamTexture(C3DScene* pScene, const QRect& rArea, qint64& iBytes, double& dLatencyMS)
+{
+    QImage imgTexture(STREAM_SIZE, STREAM_SIZE, QImage::Format_ARGB32);
+    imgTexture.fill(Qt::gray);
+
+    CTexture* pTexture = new CTexture(pScene, "Streamed", imgTexture, imgTexture.size(), 0, true);
+    QSP<CComponent> pPainter = QSP<CComponent>(new CTexturePainter(pScene, rArea));
+
+    pTexture->setUpdater(pPainter.data());
+
+    QElapsedTimer tTimer;
+    tTimer.start();
+
+    for (int iUpload = 0; iUpload < STREAM_UPLOADS; iUpload++)
+    {
+        qint64 iCount = pTexture->uploadCount();
+
+        pTexture->update(1.0 / 60.0);
+
+        // The upload is queued to this thread when the job ends
+        while (pTexture->uploadCount() == iCount)
+        {
+            QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+        }
+    }
+
+    pScene->makeCurrentRenderingContext();
+    glFinish();
+
+    qint64 iElapsedMS = tTimer.elapsed();
+
+    iBytes = pTexture->uploadedBytes();
+    dLatencyMS = pTexture->uploadLatencyMS();
+
+    delete pTexture;
+
+    return iElapsedMS;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+// Prints the bandwidth of iBytes uploaded in iElapsedMS
+static void reportBandwidth(const QString& sName, qint64 iBytes, qint64 iElapsedMS)
+{
+    double dSeconds = qMax((double) iElapsedMS, 1.0) / 1000.0;
+
+    qDebug() << QString("%1 : %2 MB/s")
+                .arg(sName, -32)
+                .arg((double) iBytes / dSeconds / (1024.0 * 1024.0), 0, 'f', 1);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+CBenchmarks::CBenchmarks()
+{
+}
+
+//-------------------------------------------------------------------------------------------------
+
+CBenchmarks::~CBenchmarks()
+{
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CBenchmarks::run()
+{
+    benchHGT();
+    benchVertexFormat();
+    benchTerrainHeights();
+    benchGeolocConversion();
+    benchSceneRays();
+    benchTerrainRays();
+    benchMeshRays();
+    benchParallelUpdate();
+    benchOffscreenRendering();
+    benchDepthCapture();
+    benchImageKernels();
+    benchTextureStreaming();
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CBenchmarks::report(const QString& sName, int iSamples, qint64 iElapsedMS)
+{
+    double dSeconds = qMax((double) iElapsedMS, 1.0) / 1000.0;
+
+    qDebug() << QString("%1 : %2 samples in %3 ms, %4 samples/s")
+                .arg(sName, -32)
+                .arg(iSamples)
+                .arg(iElapsedMS)
+                .arg((qint64) ((double) iSamples / dSeconds));
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CBenchmarks::benchHGT()
+{
+    qDebug() << "--------------------------------------------------";
+    qDebug() << "Benchmarking HGT sampling";
+
+    // Write a synthetic tile
+    QString sPath = QDir::tempPath() + "/Quick3DBenchmarks/HGT";
+    QDir().mkpath(sPath);
+
+    QString sFileName = sPath + "/N45E005.hgt";
+    QFile tWriter(sFileName);
+
+    if (tWriter.open(QIODevice::WriteOnly) == false)
+    {
+        qDebug() << "Could not write" << sFileName;
+        return;
+    }
+
+    QByteArray baTile(HGT_CELLS * HGT_CELLS * sizeof(qint16), 0);
+
+    for (int iIndex = 0; iIndex < HGT_CELLS * HGT_CELLS; iIndex++)
+    {
+        qToBigEndian<qint16>((qint16) ((iIndex * 7919) % 4000), (uchar*) baTile.data() + iIndex * sizeof(qint16));
+    }
+
+    tWriter.write(baTile);
+    tWriter.close();
+
+    // Random positions inside the tile
+    QVector<CGeoloc> vPositions(HGT_SAMPLES);
+    QVector<double> vHeights(HGT_SAMPLES);
+
+    qsrand(1234);
+
+    for (int iIndex = 0; iIndex < HGT_SAMPLES; iIndex++)
+    {
+        vPositions[iIndex] = CGeoloc(
+                    45.0 + (double) qrand() / (double) RAND_MAX,
+                    5.0 + (double) qrand() / (double) RAND_MAX,
+                    0.0
+                    );
+    }
+
+    QElapsedTimer tTimer;
+    double dChecksum = 0.0;
+
+    // Legacy path
+    {
+        QFile tFile(sFileName);
+        QMutex tMutex(QMutex::Recursive);
+        CGeoloc gTile(45.0, 5.0, 0.0);
+
+        tFile.open(QIODevice::ReadOnly);
+
+        tTimer.start();
+
+        for (int iIndex = 0; iIndex < HGT_SAMPLES; iIndex++)
+        {
+            vHeights[iIndex] = legacyHGTHeightAt(tFile, tMutex, gTile, vPositions[iIndex]);
+        }
+
+        report("HGT seek / read", HGT_SAMPLES, tTimer.elapsed());
+        dChecksum = vHeights[HGT_SAMPLES / 2];
+    }
+
+    CHGTField tField(CXMLNode(), sPath);
+
+    // Mapped path, one sample per call
+    {
+        tTimer.start();
+
+        for (int iIndex = 0; iIndex < HGT_SAMPLES; iIndex++)
+        {
+            vHeights[iIndex] = tField.getHeightAt(vPositions[iIndex]);
+        }
+
+        report("HGT mapped, getHeightAt()", HGT_SAMPLES, tTimer.elapsed());
+    }
+
+    // Mapped path, batched
+    {
+        tTimer.start();
+
+        tField.getHeightsAt(vPositions.constData(), vHeights.data(), HGT_SAMPLES);
+
+        report("HGT mapped, getHeightsAt()", HGT_SAMPLES, tTimer.elapsed());
+    }
+
+    qDebug() << "Checksum difference =" << fabs(dChecksum - vHeights[HGT_SAMPLES / 2]);
+
+    QFile::remove(sFileName);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CBenchmarks::benchVertexFormat()
+{
+    qDebug() << "--------------------------------------------------";
+    qDebug() << "Benchmarking render vertex formats";
+
+    QVector<CVertex> vVertices(VERTEX_SAMPLES);
+
+    for (int iIndex = 0; iIndex < VERTEX_SAMPLES; iIndex++)
+    {
+        double dAngle = (double) iIndex * 0.001;
+
+        vVertices[iIndex].position() = CVector3(cos(dAngle) * 6378137.0, sin(dAngle) * 6378137.0, (double) (iIndex % 1000));
+        vVertices[iIndex].normal() = CVector3(cos(dAngle), sin(dAngle), 0.2).normalized();
+        vVertices[iIndex].tangent() = CVector3(-sin(dAngle), cos(dAngle), 0.0);
+        vVertices[iIndex].texCoord() = CVector3(dAngle, dAngle * 0.5, 0.0);
+        vVertices[iIndex].altitude() = (double) (iIndex % 1000);
+        vVertices[iIndex].setDiffuseTextureWeight(1, 0.5);
+    }
+
+    QElapsedTimer tTimer;
+
+    // Editable vertices, as transfered before
+    {
+        tTimer.start();
+
+        CVertex* pRenderPoints = new CVertex[VERTEX_SAMPLES];
+
+        for (int iIndex = 0; iIndex < VERTEX_SAMPLES; iIndex++)
+        {
+            pRenderPoints[iIndex] = vVertices[iIndex];
+        }
+
+        report("CVertex buffer build", VERTEX_SAMPLES, tTimer.elapsed());
+
+        delete [] pRenderPoints;
+
+        qDebug() << "CVertex :" << sizeof(CVertex) << "bytes / vertex," << (sizeof(CVertex) * VERTEX_SAMPLES) / (1024 * 1024) << "MB uploaded";
+    }
+
+    // Packed vertices
+    {
+        tTimer.start();
+
+        CRenderVertex* pRenderPoints = new CRenderVertex[VERTEX_SAMPLES];
+        CVector3 vOrigin = vVertices[VERTEX_SAMPLES / 2].position();
+
+        for (int iIndex = 0; iIndex < VERTEX_SAMPLES; iIndex++)
+        {
+            pRenderPoints[iIndex].pack(vVertices[iIndex], vOrigin);
+        }
+
+        report("CRenderVertex buffer build", VERTEX_SAMPLES, tTimer.elapsed());
+
+        delete [] pRenderPoints;
+
+        qDebug() << "CRenderVertex :" << sizeof(CRenderVertex) << "bytes / vertex," << (sizeof(CRenderVertex) * VERTEX_SAMPLES) / (1024 * 1024) << "MB uploaded";
+    }
+
+    qDebug() << "Upload times are shown live in C3DScene::debugInfo()";
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CBenchmarks::benchTerrainHeights()
+{
+    qDebug() << "--------------------------------------------------";
+    qDebug() << "Benchmarking terrain height queries";
+
+    // A synthetic elevation chunk under a detailed terrain patch
+    int iCells = 201;
+    QVector<qint16> vGrid(iCells * iCells);
+
+    for (int iIndex = 0; iIndex < vGrid.count(); iIndex++)
+    {
+        vGrid[iIndex] = (qint16) ((iIndex * 7919) % 3000);
+    }
+
+    C3DScene* pScene = new C3DScene();
+    CSRTMField* pField = new CSRTMField(CXMLNode(), "./NoSRTM");
+    pField->addChunk(new CSRTMData(CGeoloc(45.0, 5.0, 0.0), CGeoloc(1.0, 1.0, 0.0), iCells, iCells, -9999, vGrid.constData()));
+
+    CGeoloc gTerrain(45.5, 5.5, 0.0);
+    CGeoloc gSize(0.5, 0.5, 0.0);
+
+    QSP<CTerrain> pTerrain = QSP<CTerrain>(new CTerrain(pScene, pField, gTerrain, gSize, gTerrain, gSize, TERRAIN_POINTS, 0, 15, false, true));
+
+    QMap<QString, int> mVerticesToFace;
+
+    for (int iIndex = 0; iIndex < pTerrain->mesh()->faces().count(); iIndex++)
+    {
+        const QVector<int>& vIndices = pTerrain->mesh()->faces()[iIndex].indices();
+
+        if (vIndices.count() == 4)
+        {
+            mVerticesToFace[QString("%1%2%3%4").arg(vIndices[0]).arg(vIndices[1]).arg(vIndices[2]).arg(vIndices[3])] = iIndex;
+        }
+    }
+
+    // Ground vehicles : four wheels a couple of meters apart, vehicles spread over the patch
+    // Aircraft : one point each, anywhere over the patch
+    QVector<CGeoloc> vGround(TERRAIN_SAMPLES);
+    QVector<CGeoloc> vAircraft(TERRAIN_SAMPLES);
+    QVector<double> vHeights(TERRAIN_SAMPLES);
+    QVector<double> vLegacyHeights(TERRAIN_SAMPLES);
+
+    qsrand(1234);
+
+    for (int iIndex = 0; iIndex < TERRAIN_SAMPLES; iIndex += 4)
+    {
+        double dLatitude = 45.3 + 0.4 * (double) qrand() / (double) RAND_MAX;
+        double dLongitude = 5.3 + 0.4 * (double) qrand() / (double) RAND_MAX;
+
+        for (int iWheel = 0; iWheel < 4 && iIndex + iWheel < TERRAIN_SAMPLES; iWheel++)
+        {
+            vGround[iIndex + iWheel] = CGeoloc(dLatitude + (iWheel / 2) * 0.00003, dLongitude + (iWheel % 2) * 0.00002, 0.0);
+        }
+    }
+
+    for (int iIndex = 0; iIndex < TERRAIN_SAMPLES; iIndex++)
+    {
+        vAircraft[iIndex] = CGeoloc(
+                    45.3 + 0.4 * (double) qrand() / (double) RAND_MAX,
+                    5.3 + 0.4 * (double) qrand() / (double) RAND_MAX,
+                    3000.0
+                    );
+    }
+
+    QElapsedTimer tTimer;
+
+    QList<QPair<QString, QVector<CGeoloc>*> > lWorkloads;
+    lWorkloads << QPair<QString, QVector<CGeoloc>*>("ground vehicles", &vGround);
+    lWorkloads << QPair<QString, QVector<CGeoloc>*>("aircraft", &vAircraft);
+
+    for (int iWorkload = 0; iWorkload < lWorkloads.count(); iWorkload++)
+    {
+        const QString& sName = lWorkloads[iWorkload].first;
+        const QVector<CGeoloc>& vPositions = *lWorkloads[iWorkload].second;
+
+        // Legacy path
+        tTimer.start();
+
+        for (int iIndex = 0; iIndex < TERRAIN_SAMPLES; iIndex++)
+        {
+            vLegacyHeights[iIndex] = legacyTerrainHeightAt(*pTerrain, mVerticesToFace, gTerrain, gSize, vPositions[iIndex]);
+        }
+
+        report("Terrain ray cast, " + sName, TERRAIN_SAMPLES, tTimer.elapsed());
+
+        // Grid, one query per call
+        tTimer.start();
+
+        for (int iIndex = 0; iIndex < TERRAIN_SAMPLES; iIndex++)
+        {
+            vHeights[iIndex] = pTerrain->getHeightAt(vPositions[iIndex]);
+        }
+
+        report("Terrain grid, " + sName, TERRAIN_SAMPLES, tTimer.elapsed());
+
+        // Grid, batched
+        tTimer.start();
+
+        pTerrain->getHeightsAt(vPositions.constData(), vHeights.data(), TERRAIN_SAMPLES);
+
+        report("Terrain grid batch, " + sName, TERRAIN_SAMPLES, tTimer.elapsed());
+
+        double dMaxDifference = 0.0;
+
+        for (int iIndex = 0; iIndex < TERRAIN_SAMPLES; iIndex++)
+        {
+            if (vLegacyHeights[iIndex] != Q3D_INFINITY)
+            {
+                dMaxDifference = qMax(dMaxDifference, fabs(vLegacyHeights[iIndex] - vHeights[iIndex]));
+            }
+        }
+
+        qDebug() << "Max difference with ray cast =" << dMaxDifference << "m";
+    }
+
+    pTerrain = QSP<CTerrain>();
+
+    delete pField;
+    delete pScene;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CBenchmarks::benchGeolocConversion()
+{
+    qDebug() << "--------------------------------------------------";
+    qDebug() << "Benchmarking geodetic to geocentric conversion";
+
+    QVector<CGeoloc> vGeolocs(GEOLOC_SAMPLES);
+    QVector<CVector3> vLegacyPositions(GEOLOC_SAMPLES);
+    QVector<CVector3> vPositions(GEOLOC_SAMPLES);
+
+    qsrand(1234);
+
+    for (int iIndex = 0; iIndex < GEOLOC_SAMPLES; iIndex++)
+    {
+        vGeolocs[iIndex] = CGeoloc(
+                    -90.0 + 180.0 * (double) qrand() / (double) RAND_MAX,
+                    -180.0 + 360.0 * (double) qrand() / (double) RAND_MAX,
+                    10000.0 * (double) qrand() / (double) RAND_MAX
+                    );
+    }
+
+    QElapsedTimer tTimer;
+
+    // Legacy path
+    {
+        tTimer.start();
+
+        for (int iIndex = 0; iIndex < GEOLOC_SAMPLES; iIndex++)
+        {
+            vLegacyPositions[iIndex] = legacyToVector3_WGS84(vGeolocs[iIndex]);
+        }
+
+        report("GeoTrans + matrix", GEOLOC_SAMPLES, tTimer.elapsed());
+    }
+
+    // Closed form, one conversion per call
+    {
+        tTimer.start();
+
+        for (int iIndex = 0; iIndex < GEOLOC_SAMPLES; iIndex++)
+        {
+            vPositions[iIndex] = vGeolocs[iIndex].toVector3();
+        }
+
+        report("CGeoloc::toVector3()", GEOLOC_SAMPLES, tTimer.elapsed());
+    }
+
+    // Closed form, batched
+    {
+        tTimer.start();
+
+        CGeoloc::toVector3(vGeolocs.constData(), vPositions.data(), GEOLOC_SAMPLES);
+
+        report("CGeoloc::toVector3() batch", GEOLOC_SAMPLES, tTimer.elapsed());
+    }
+
+    double dMaxDifference = 0.0;
+
+    for (int iIndex = 0; iIndex < GEOLOC_SAMPLES; iIndex++)
+    {
+        dMaxDifference = qMax(dMaxDifference, (vPositions[iIndex] - vLegacyPositions[iIndex]).magnitude());
+    }
+
+    qDebug() << "Max difference with GeoTrans =" << dMaxDifference << "m";
+
+    // Relative to a reference, as done for components around the camera
+    CGeoloc gReference(45.0, 5.0, 1000.0);
+
+    {
+        tTimer.start();
+
+        for (int iIndex = 0; iIndex < GEOLOC_SAMPLES; iIndex++)
+        {
+            vPositions[iIndex] = vGeolocs[iIndex].toVector3(gReference);
+        }
+
+        report("CGeoloc::toVector3(reference)", GEOLOC_SAMPLES, tTimer.elapsed());
+    }
+
+    {
+        tTimer.start();
+
+        CGeoloc::toVector3(gReference, vGeolocs.constData(), vPositions.data(), GEOLOC_SAMPLES);
+
+        report("CGeoloc::toVector3(reference) batch", GEOLOC_SAMPLES, tTimer.elapsed());
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CBenchmarks::benchSceneRays()
+{
+    qDebug() << "--------------------------------------------------";
+    qDebug() << "Benchmarking scene ray queries";
+
+    // Boxes standing for mesh instances, scattered over a few kilometers
+    C3DScene* pScene = new C3DScene();
+    QVector<QSP<CComponent> > vComponents;
+
+    qsrand(1234);
+
+    for (int iIndex = 0; iIndex < SCENE_BOXES; iIndex++)
+    {
+        QSP<CComponent> pBox = QSP<CComponent>(new CBenchBox(pScene, 5.0 + 25.0 * (double) qrand() / (double) RAND_MAX));
+
+        pBox->setGeoloc(CGeoloc(
+                            45.45 + 0.1 * (double) qrand() / (double) RAND_MAX,
+                            5.45 + 0.1 * (double) qrand() / (double) RAND_MAX,
+                            200.0 * (double) qrand() / (double) RAND_MAX
+                            ));
+
+        pBox->computeWorldTransform();
+
+        vComponents.append(pBox);
+    }
+
+    // Nearest hit rays : from above the area down to the ground
+    // Any hit rays : from the ground up to a light, limited to the light distance
+    QVector<CRay3> vRays(SCENE_RAYS);
+    QVector<CRay3> vShadowRays(SCENE_RAYS);
+    QVector<double> vShadowDistances(SCENE_RAYS);
+
+    CVector3 vLight = CGeoloc(45.5, 5.5, 3000.0).toVector3();
+
+    for (int iIndex = 0; iIndex < SCENE_RAYS; iIndex++)
+    {
+        CVector3 vFrom = CGeoloc(
+                    45.45 + 0.1 * (double) qrand() / (double) RAND_MAX,
+                    5.45 + 0.1 * (double) qrand() / (double) RAND_MAX,
+                    1500.0
+                    ).toVector3();
+
+        CVector3 vTo = CGeoloc(
+                    45.45 + 0.1 * (double) qrand() / (double) RAND_MAX,
+                    5.45 + 0.1 * (double) qrand() / (double) RAND_MAX,
+                    100.0 * (double) qrand() / (double) RAND_MAX
+                    ).toVector3();
+
+        vRays[iIndex] = CRay3(vFrom, (vTo - vFrom).normalized());
+        vShadowRays[iIndex] = CRay3(vTo, (vLight - vTo).normalized());
+        vShadowDistances[iIndex] = (vLight - vTo).magnitude();
+    }
+
+    CSceneBVH tTree;
+    QElapsedTimer tTimer;
+
+    tTimer.start();
+    tTree.update(vComponents);
+    report("BVH build", SCENE_BOXES, tTimer.elapsed());
+
+    QVector<RayTracingResult> vLegacyResults(SCENE_RAYS, RayTracingResult(Q3D_INFINITY));
+    QVector<RayTracingResult> vResults(SCENE_RAYS, RayTracingResult(Q3D_INFINITY));
+    int iLegacyOccluded = 0;
+    int iOccluded = 0;
+
+    // Nearest hit
+    tTimer.start();
+
+    for (int iIndex = 0; iIndex < SCENE_RAYS; iIndex++)
+    {
+        vLegacyResults[iIndex] = legacySceneIntersect(pScene, vComponents, vRays[iIndex]);
+    }
+
+    report("Scene walk, nearest hit", SCENE_RAYS, tTimer.elapsed());
+
+    tTimer.start();
+
+    for (int iIndex = 0; iIndex < SCENE_RAYS; iIndex++)
+    {
+        vResults[iIndex] = tTree.intersect(vRays[iIndex]);
+    }
+
+    report("Scene BVH, nearest hit", SCENE_RAYS, tTimer.elapsed());
+
+    // Any hit
+    tTimer.start();
+
+    for (int iIndex = 0; iIndex < SCENE_RAYS; iIndex++)
+    {
+        if (legacySceneIntersect(pScene, vComponents, vShadowRays[iIndex]).m_dDistance < vShadowDistances[iIndex])
+        {
+            iLegacyOccluded++;
+        }
+    }
+
+    report("Scene walk, occlusion", SCENE_RAYS, tTimer.elapsed());
+
+    tTimer.start();
+
+    for (int iIndex = 0; iIndex < SCENE_RAYS; iIndex++)
+    {
+        if (tTree.intersectAny(vShadowRays[iIndex], vShadowDistances[iIndex]))
+        {
+            iOccluded++;
+        }
+    }
+
+    report("Scene BVH, occlusion", SCENE_RAYS, tTimer.elapsed());
+
+    // Move a tenth of the boxes, then refit and rebuild
+    for (int iIndex = 0; iIndex < SCENE_BOXES; iIndex += 10)
+    {
+        CGeoloc gGeoloc = vComponents[iIndex]->geoloc();
+
+        gGeoloc.Latitude += 0.0005 * ((double) qrand() / (double) RAND_MAX - 0.5);
+        gGeoloc.Longitude += 0.0005 * ((double) qrand() / (double) RAND_MAX - 0.5);
+
+        vComponents[iIndex]->setGeoloc(gGeoloc);
+        vComponents[iIndex]->computeWorldTransform();
+    }
+
+    int iBuildCount = tTree.buildCount();
+
+    tTimer.start();
+    tTree.update(vComponents);
+    report("BVH refit, 10% moved", SCENE_BOXES, tTimer.elapsed());
+
+    qDebug() << "Rebuilt on refit :" << (tTree.buildCount() != iBuildCount);
+
+    tTimer.start();
+    tTree.clear();
+    tTree.update(vComponents);
+    report("BVH rebuild", SCENE_BOXES, tTimer.elapsed());
+
+    // Check the refit tree against the walk
+    int iMismatches = 0;
+
+    for (int iIndex = 0; iIndex < SCENE_RAYS; iIndex++)
+    {
+        RayTracingResult aLegacy = legacySceneIntersect(pScene, vComponents, vRays[iIndex]);
+        RayTracingResult aResult = tTree.intersect(vRays[iIndex]);
+
+        if (aLegacy.m_dDistance != aResult.m_dDistance)
+        {
+            iMismatches++;
+        }
+    }
+
+    for (int iIndex = 0; iIndex < SCENE_RAYS; iIndex++)
+    {
+        if (vLegacyResults[iIndex].m_dDistance != vResults[iIndex].m_dDistance)
+        {
+            iMismatches++;
+        }
+    }
+
+    qDebug() << "Occluded rays, walk :" << iLegacyOccluded << ", BVH :" << iOccluded;
+    qDebug() << "Nearest hit mismatches with walk =" << iMismatches;
+
+    tTree.clear();
+    vComponents.clear();
+
+    delete pScene;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CBenchmarks::benchTerrainRays()
+{
+    qDebug() << "--------------------------------------------------";
+    qDebug() << "Benchmarking terrain ray queries";
+
+    // The synthetic elevation chunk of benchTerrainHeights()
+    int iCells = 201;
+    QVector<qint16> vGrid(iCells * iCells);
+
+    for (int iIndex = 0; iIndex < vGrid.count(); iIndex++)
+    {
+        vGrid[iIndex] = (qint16) ((iIndex * 7919) % 3000);
+    }
+
+    C3DScene* pScene = new C3DScene();
+    CSRTMField* pField = new CSRTMField(CXMLNode(), "./NoSRTM");
+    pField->addChunk(new CSRTMData(CGeoloc(45.0, 5.0, 0.0), CGeoloc(1.0, 1.0, 0.0), iCells, iCells, -9999, vGrid.constData()));
+
+    CGeoloc gTerrain(45.5, 5.5, 0.0);
+    CGeoloc gSize(0.5, 0.5, 0.0);
+
+    QSP<CTerrain> pTerrain = QSP<CTerrain>(new CTerrain(pScene, pField, gTerrain, gSize, gTerrain, gSize, TERRAIN_POINTS, 0, 15, false, true));
+
+    // Panoramic depth rays : from a camera above the ground, in all directions
+    QVector<CRay3> vRays(TERRAIN_RAYS);
+
+    qsrand(1234);
+
+    for (int iIndex = 0; iIndex < TERRAIN_RAYS; iIndex++)
+    {
+        CVector3 vFrom = CGeoloc(
+                    45.4 + 0.2 * (double) qrand() / (double) RAND_MAX,
+                    5.4 + 0.2 * (double) qrand() / (double) RAND_MAX,
+                    3500.0
+                    ).toVector3();
+
+        CVector3 vTo = CGeoloc(
+                    45.3 + 0.4 * (double) qrand() / (double) RAND_MAX,
+                    5.3 + 0.4 * (double) qrand() / (double) RAND_MAX,
+                    4000.0 * (double) qrand() / (double) RAND_MAX
+                    ).toVector3();
+
+        vRays[iIndex] = CRay3(vFrom, (vTo - vFrom).normalized());
+    }
+
+    QVector<RayTracingResult> vLegacyResults(TERRAIN_RAYS, RayTracingResult(Q3D_INFINITY));
+    QVector<RayTracingResult> vResults(TERRAIN_RAYS, RayTracingResult(Q3D_INFINITY));
+    QElapsedTimer tTimer;
+
+    tTimer.start();
+
+    for (int iIndex = 0; iIndex < TERRAIN_RAYS; iIndex++)
+    {
+        vLegacyResults[iIndex] = legacyTerrainIntersect(*pTerrain, vRays[iIndex]);
+    }
+
+    report("Terrain triangles", TERRAIN_RAYS, tTimer.elapsed());
+
+    // The first query builds the tree
+    tTimer.start();
+    pTerrain->intersect(vRays[0]);
+    report("Terrain triangle BVH build", 1, tTimer.elapsed());
+
+    tTimer.start();
+
+    for (int iIndex = 0; iIndex < TERRAIN_RAYS; iIndex++)
+    {
+        vResults[iIndex] = pTerrain->intersect(vRays[iIndex]);
+    }
+
+    report("Terrain triangle BVH", TERRAIN_RAYS, tTimer.elapsed());
+
+    int iMismatches = 0;
+
+    for (int iIndex = 0; iIndex < TERRAIN_RAYS; iIndex++)
+    {
+        if (
+                vResults[iIndex].m_dDistance != vLegacyResults[iIndex].m_dDistance ||
+                vResults[iIndex].m_vNormal != vLegacyResults[iIndex].m_vNormal
+                )
+        {
+            iMismatches++;
+        }
+    }
+
+    qDebug() << "Mismatches with all triangles =" << iMismatches;
+
+    pTerrain = QSP<CTerrain>();
+
+    delete pField;
+    delete pScene;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CBenchmarks::benchMeshRays()
+{
+    qDebug() << "--------------------------------------------------";
+    qDebug() << "Benchmarking mesh ray queries";
+
+    // A bumpy quad patch of a kilometer, its faces span any uniform partition of the bounds
+    C3DScene* pScene = new C3DScene();
+    QSP<CComponent> pContainer = QSP<CComponent>(new CComponent(pScene));
+    pContainer->computeWorldTransform();
+
+    CMeshGeometry* pMesh = new CMeshGeometry(pScene, 10000.0, true);
+    CMeshGeometry* pFlatMesh = new CMeshGeometry(pScene, 10000.0, false);
+
+    pMesh->createQuadPatch(MESH_POINTS);
+    pMesh->transformVertices(CMatrix4::makeScale(CVector3(1000.0, 1.0, 1000.0)));
+
+    qsrand(1234);
+
+    for (int iIndex = 0; iIndex < pMesh->vertices().count(); iIndex++)
+    {
+        pMesh->vertices()[iIndex].position().Y = 20.0 * (double) qrand() / (double) RAND_MAX;
+    }
+
+    pMesh->setGeometryDirty(true);
+    pFlatMesh->merge(*pMesh);
+
+    // Rays from above the patch, towards the patch and beyond its edges
+    QVector<CRay3> vRays(MESH_RAYS);
+
+    for (int iIndex = 0; iIndex < MESH_RAYS; iIndex++)
+    {
+        CVector3 vFrom(
+                    1200.0 * ((double) qrand() / (double) RAND_MAX - 0.5),
+                    50.0 + 200.0 * (double) qrand() / (double) RAND_MAX,
+                    1200.0 * ((double) qrand() / (double) RAND_MAX - 0.5)
+                    );
+
+        CVector3 vTo(
+                    1200.0 * ((double) qrand() / (double) RAND_MAX - 0.5),
+                    0.0,
+                    1200.0 * ((double) qrand() / (double) RAND_MAX - 0.5)
+                    );
+
+        vRays[iIndex] = pContainer->worldTransform() * CRay3(vFrom, (vTo - vFrom).normalized());
+    }
+
+    QVector<RayTracingResult> vFlatResults(MESH_RAYS, RayTracingResult(Q3D_INFINITY));
+    QVector<RayTracingResult> vResults(MESH_RAYS, RayTracingResult(Q3D_INFINITY));
+    QElapsedTimer tTimer;
+
+    tTimer.start();
+
+    for (int iIndex = 0; iIndex < MESH_RAYS; iIndex++)
+    {
+        vFlatResults[iIndex] = pFlatMesh->intersect(pContainer.data(), vRays[iIndex]);
+    }
+
+    report("Mesh faces", MESH_RAYS, tTimer.elapsed());
+
+    // The first query builds the tree
+    tTimer.start();
+    pMesh->intersect(pContainer.data(), vRays[0]);
+    report("Mesh triangle BVH build", 1, tTimer.elapsed());
+
+    tTimer.start();
+
+    for (int iIndex = 0; iIndex < MESH_RAYS; iIndex++)
+    {
+        vResults[iIndex] = pMesh->intersect(pContainer.data(), vRays[iIndex]);
+    }
+
+    report("Mesh triangle BVH", MESH_RAYS, tTimer.elapsed());
+
+    int iMismatches = 0;
+
+    for (int iIndex = 0; iIndex < MESH_RAYS; iIndex++)
+    {
+        if (
+                vResults[iIndex].m_dDistance != vFlatResults[iIndex].m_dDistance ||
+                vResults[iIndex].m_vNormal != vFlatResults[iIndex].m_vNormal
+                )
+        {
+            iMismatches++;
+        }
+    }
+
+    qDebug() << "Mismatches with all faces =" << iMismatches;
+
+    delete pMesh;
+    delete pFlatMesh;
+
+    pContainer = QSP<CComponent>();
+
+    delete pScene;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CBenchmarks::benchParallelUpdate()
+{
+    qDebug() << "--------------------------------------------------";
+    qDebug() << "Benchmarking parallel component update";
+
+    CBenchFlatField tGround;
+    QElapsedTimer tTimer;
+    int iMaxThreads = QThreadPool::globalInstance()->maxThreadCount();
+
+    // Reference : all vehicles updated in the calling thread
+    C3DScene* pSerialScene = createVehicleScene(&tGround);
+    pSerialScene->setParallelUpdate(false);
+
+    tTimer.start();
+
+    for (int iStep = 0; iStep < UPDATE_STEPS; iStep++)
+    {
+        pSerialScene->stepScene(1.0 / 60.0);
+    }
+
+    report("Serial update", UPDATE_VEHICLES * UPDATE_STEPS, tTimer.elapsed());
+
+    for (int iThreads = 1; iThreads <= QThread::idealThreadCount(); iThreads++)
+    {
+        C3DScene* pScene = createVehicleScene(&tGround);
+
+        QThreadPool::globalInstance()->setMaxThreadCount(iThreads);
+
+        tTimer.start();
+
+        for (int iStep = 0; iStep < UPDATE_STEPS; iStep++)
+        {
+            pScene->stepScene(1.0 / 60.0);
+        }
+
+        report(QString("Parallel update, %1 threads").arg(iThreads), UPDATE_VEHICLES * UPDATE_STEPS, tTimer.elapsed());
+
+        // Vehicles are independent, so the result must not depend on the update order
+        int iMismatches = 0;
+
+        for (int iIndex = 0; iIndex < UPDATE_VEHICLES; iIndex++)
+        {
+            if (pScene->components()[iIndex]->worldPosition() != pSerialScene->components()[iIndex]->worldPosition())
+            {
+                iMismatches++;
+            }
+        }
+
+        if (iMismatches > 0)
+        {
+            qDebug() << "Mismatches with serial update =" << iMismatches;
+        }
+
+        delete pScene;
+    }
+
+    QThreadPool::globalInstance()->setMaxThreadCount(iMaxThreads);
+
+    delete pSerialScene;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CBenchmarks::benchOffscreenRendering()
+{
+    qDebug() << "--------------------------------------------------";
+    qDebug() << "Benchmarking offscreen rendering";
+
+    QElapsedTimer tTimer;
+
+    for (int iScenes = 1; iScenes <= QThread::idealThreadCount(); iScenes *= 2)
+    {
+        QVector<QOffscreenSurface*> vSurfaces;
+        QVector<COffscreenRenderThread*> vThreads;
+
+        // Surfaces are made in the GUI thread, each scene makes its context in its thread
+        for (int iIndex = 0; iIndex < iScenes; iIndex++)
+        {
+            vSurfaces.append(COffscreenScene::createSurface());
+            vThreads.append(new COffscreenRenderThread(vSurfaces.last()));
+        }
+
+        tTimer.start();
+
+        foreach (COffscreenRenderThread* pThread, vThreads)
+        {
+            pThread->start();
+        }
+
+        int iFrames = 0;
+
+        foreach (COffscreenRenderThread* pThread, vThreads)
+        {
+            pThread->wait();
+            iFrames += pThread->frames();
+        }
+
+        qint64 iElapsedMS = tTimer.elapsed();
+
+        qDeleteAll(vThreads);
+        qDeleteAll(vSurfaces);
+
+        if (iFrames == 0)
+        {
+            qDebug() << "No offscreen OpenGL context, run with QT_QPA_PLATFORM=eglfs on machines without a display";
+            break;
+        }
+
+        report(QString("Offscreen frames, %1 scenes").arg(iScenes), iFrames, iElapsedMS);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CBenchmarks::benchDepthCapture()
+{
+    qDebug() << "--------------------------------------------------";
+    qDebug() << "Benchmarking depth matrix capture";
+
+    COffscreenScene* pScene = new COffscreenScene(QSize(OFFSCREEN_SIZE, OFFSCREEN_SIZE));
+
+    if (pScene->isValid() == false)
+    {
+        qDebug() << "No offscreen OpenGL context, run with QT_QPA_PLATFORM=eglfs on machines without a display";
+        delete pScene;
+        return;
+    }
+
+    // A bumpy patch of 8 kilometers, seen from 100 meters above its center
+    QSP<CMeshGeometry> pGeometry = QSP<CMeshGeometry>(new CMeshGeometry(pScene, 10000.0, false));
+    pGeometry->createQuadPatch(OFFSCREEN_POINTS);
+    pGeometry->transformVertices(CMatrix4::makeScale(CVector3(8000.0, 1.0, 8000.0)));
+
+    for (int iIndex = 0; iIndex < pGeometry->vertices().count(); iIndex++)
+    {
+        pGeometry->vertices()[iIndex].position().Y = 20.0 * (double) (iIndex % 7) / 7.0;
+    }
+
+    pGeometry->setGeometryDirty(true);
+
+    QSP<CMesh> pPatch = QSP<CMesh>(new CMesh(pScene));
+    pPatch->setGeometry(pGeometry);
+    pPatch->setGeoloc(CGeoloc(45.5, 5.5, 0.0));
+
+    QSP<CCamera> pCamera = QSP<CCamera>(new CCamera(pScene));
+    pCamera->setGeoloc(CGeoloc(45.5, 5.5, 100.0));
+
+    pScene->viewports()[0] = new CViewport(pScene);
+    pScene->viewports()[0]->setSize(CVector2(OFFSCREEN_SIZE, OFFSCREEN_SIZE));
+    pScene->viewports()[0]->setCamera(pCamera);
+    pScene->viewports()[0]->setEnabled(true);
+
+    QVector<QSP<CComponent> > vComponents;
+    vComponents.append(pPatch);
+    vComponents.append(pCamera);
+    pScene->init(vComponents);
+    pScene->updateScene(1.0);
+
+    // Ray traced distances are exact, up to the interpolation of the patch
+    qint64 iElapsedMS = 0;
+    QVector<double> vReference = captureDepth(pCamera.data(), pScene, &CCamera::renderDepth_RayTraced, iElapsedMS);
+
+    report("Ray traced depth pixels", DEPTH_WIDTH * DEPTH_HEIGHT, iElapsedMS);
+
+    QVector<double> vTiled;
+    QVector<double> vCube;
+    qint64 iTiledMS = 0;
+    qint64 iCubeMS = 0;
+
+    for (int iCapture = 0; iCapture < DEPTH_CAPTURES; iCapture++)
+    {
+        vTiled = captureDepth(pCamera.data(), pScene, &CCamera::renderDepth_Tiled, iElapsedMS);
+        iTiledMS += iElapsedMS;
+
+        vCube = captureDepth(pCamera.data(), pScene, &CCamera::renderDepth_CubeMapped, iElapsedMS);
+        iCubeMS += iElapsedMS;
+    }
+
+    report("Tiled 8 bit depth pixels", DEPTH_WIDTH * DEPTH_HEIGHT * DEPTH_CAPTURES, iTiledMS);
+    report("Cube float depth pixels", DEPTH_WIDTH * DEPTH_HEIGHT * DEPTH_CAPTURES, iCubeMS);
+
+    reportDepthError("Tiled 8 bit depth", vTiled, vReference);
+    reportDepthError("Cube float depth", vCube, vReference);
+
+    delete pScene;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CBenchmarks::benchImageKernels()
+{
+    qDebug() << "--------------------------------------------------";
+    qDebug() << "Benchmarking image kernels";
+
+    // A 8k panorama of 120 x 300 degrees, with values that differ in each channel
+    QImage imgPanorama(PANORAMA_WIDTH, PANORAMA_HEIGHT, QImage::Format_RGB888);
+
+    for (int y = 0; y < PANORAMA_HEIGHT; y++)
+    {
+        uchar* pLine = imgPanorama.scanLine(y);
+
+        for (int x = 0; x < PANORAMA_WIDTH; x++)
+        {
+            pLine[x * 3 + 0] = (uchar) (x * 7 + y * 3);
+            pLine[x * 3 + 1] = (uchar) (x ^ y);
+            pLine[x * 3 + 2] = (uchar) (y * 5);
+        }
+    }
+
+    CVector2 vStartAngles(-60.0, -150.0);
+    CVector2 vEndAngles(60.0, 150.0);
+    QSize sTextureSize(PANORAMA_TEXTURE, PANORAMA_TEXTURE);
+    int iPanCount = PANORAMA_WIDTH / PANORAMA_TEXTURE;
+    int iTiltCount = PANORAMA_HEIGHT / PANORAMA_TEXTURE;
+    int iPixels = PANORAMA_WIDTH * PANORAMA_HEIGHT;
+
+    CSphericalTextureSet tLegacySet(vStartAngles, vEndAngles, iPanCount, iTiltCount, sTextureSize);
+    CSphericalTextureSet tSet(vStartAngles, vEndAngles, iPanCount, iTiltCount, sTextureSize);
+
+    QElapsedTimer tTimer;
+    tTimer.start();
+
+    legacyPanoramicTextureSet(imgPanorama, tLegacySet);
+
+    report("Panoramic texture set, pixel by pixel", iPixels, tTimer.elapsed());
+
+    tTimer.start();
+
+    CImageUtilities::createPanoramicTextureSet(imgPanorama, tSet);
+
+    report("Panoramic texture set, row kernels", iPixels, tTimer.elapsed());
+
+    int iDifferentTextures = 0;
+
+    for (int iTiltIndex = 0; iTiltIndex < iTiltCount; iTiltIndex++)
+    {
+        for (int iPanIndex = 0; iPanIndex < iPanCount; iPanIndex++)
+        {
+            if (tSet.images()[iTiltIndex][iPanIndex] != tLegacySet.images()[iTiltIndex][iPanIndex])
+            {
+                iDifferentTextures++;
+            }
+        }
+    }
+
+    qDebug() << "Different textures =" << iDifferentTextures;
+
+    // The edge matrix of the contour images
+    QMatrix3x3 mMatrix;
+
+    mMatrix(0, 0) =  1.0;
+    mMatrix(1, 0) =  1.0;
+    mMatrix(2, 0) =  1.0;
+    mMatrix(0, 1) =  0.0;
+    mMatrix(1, 1) =  0.0;
+    mMatrix(2, 1) =  0.0;
+    mMatrix(0, 2) = -1.0;
+    mMatrix(1, 2) = -1.0;
+    mMatrix(2, 2) = -1.0;
+
+    QImage imgLegacyFiltered = imgPanorama.copy();
+    QImage imgFiltered = imgPanorama.copy();
+
+    tTimer.start();
+
+    legacyMatrixFilter(mMatrix, imgLegacyFiltered);
+
+    report("Matrix filter, pixel by pixel", iPixels, tTimer.elapsed());
+
+    tTimer.start();
+
+    CImageFilter_Matrix tFilter(mMatrix);
+    tFilter.process(imgFiltered);
+
+    report("Matrix filter, row kernels", iPixels, tTimer.elapsed());
+
+    qDebug() << "Filtered images equal =" << (imgFiltered == imgLegacyFiltered);
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void CBenchmarks::benchTextureStreaming()
+{
+    qDebug() << "--------------------------------------------------";
+    qDebug() << "Benchmarking dynamic texture uploads";
+
+    COffscreenScene* pScene = new COffscreenScene(QSize(OFFSCREEN_SIZE, OFFSCREEN_SIZE));
+
+    if (pScene->isValid() == false)
+    {
+        qDebug() << "No offscreen OpenGL context, run with QT_QPA_PLATFORM=eglfs on machines without a display";
+        delete pScene;
+        return;
+    }
+
+    qDebug() << "Pixel buffers =" << pScene->glExtension()->hasPixelBuffers();
+
+    qint64 iBytes = 0;
+    double dLatencyMS = 0.0;
+    qint64 iElapsedMS = legacyStreamTexture(pScene, iBytes);
+
+    report("Full conversions and re-specs", STREAM_UPLOADS, iElapsedMS);
+    reportBandwidth("Full conversions and re-specs", iBytes, iElapsedMS);
+
+    iElapsedMS = streamTexture(pScene, QRect(0, 0, STREAM_SIZE, STREAM_SIZE), iBytes, dLatencyMS);
+
+    report("Full BGRA sub-image jobs", STREAM_UPLOADS, iElapsedMS);
+    reportBandwidth("Full BGRA sub-image jobs", iBytes, iElapsedMS);
+    qDebug() << "Full BGRA sub-image jobs, mean latency (ms) =" << dLatencyMS;
+
+    iElapsedMS = streamTexture(pScene, QRect(STREAM_PATCH, STREAM_PATCH, STREAM_PATCH, STREAM_PATCH), iBytes, dLatencyMS);
+
+    report("Dirty rectangle jobs", STREAM_UPLOADS, iElapsedMS);
+    reportBandwidth("Dirty rectangle jobs", iBytes, iElapsedMS);
+    qDebug() << "Dirty rectangle jobs, mean latency (ms) =" << dLatencyMS;
+
+    delete pScene;
+}
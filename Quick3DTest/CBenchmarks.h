@@ -0,0 +1,71 @@
+
+#pragma once
+
+// Qt
+#include <QString>
+
+class CBenchmarks
+{
+public:
+
+    //-------------------------------------------------------------------------------------------------
+    // Constructors and destructor
+    //-------------------------------------------------------------------------------------------------
+
+    //! Constructor
+    CBenchmarks();
+
+    //! Destructor
+    virtual ~CBenchmarks();
+
+    //-------------------------------------------------------------------------------------------------
+    // Control methods
+    //-------------------------------------------------------------------------------------------------
+
+    void run();
+
+    //-------------------------------------------------------------------------------------------------
+    // Protected methods
+    //-------------------------------------------------------------------------------------------------
+
+protected:
+
+    //! Prints the throughput of a benchmark
+    void report(const QString& sName, int iSamples, qint64 iElapsedMS);
+
+    //! Compares HGT sampling methods
+    void benchHGT();
+
+    //! Compares the size and build time of editable and packed render vertices
+    void benchVertexFormat();
+
+    //! Compares terrain height queries for ground vehicle and aircraft workloads
+    void benchTerrainHeights();
+
+    //! Compares the former and closed form geodetic to geocentric conversions
+    void benchGeolocConversion();
+
+    //! Compares scene ray queries through the component walk and through the scene BVH
+    void benchSceneRays();
+
+    //! Compares terrain ray queries through all triangles and through the triangle BVH
+    void benchTerrainRays();
+
+    //! Compares mesh ray queries through all faces and through the triangle BVH
+    void benchMeshRays();
+
+    //! Compares serial and parallel updates of independent vehicles, from one thread to all cores
+    void benchParallelUpdate();
+
+    //! Measures offscreen rendering, from one scene to one scene per core, each scene in its own thread
+    void benchOffscreenRendering();
+
+    //! Compares the speed and distance error of tiled 8 bit and float cube depth matrices, against ray tracing
+    void benchDepthCapture();
+
+    //! Compares pixel by pixel and threaded row kernels for panoramic texture sets and matrix filters, on a 8k panorama
+    void benchImageKernels();
+
+    //! Compares full re-specified uploads of dynamic textures with pooled jobs streaming dirty rectangles through pixel buffers
+    void benchTextureStreaming();
+};
@@ -1,15 +1,35 @@
 
 // Qt
 #include <QDebug>
+#include <QSet>
+#include <QDir>
+#include <QBuffer>
+#include <QEventLoop>
+#include <QTimer>
+#include <QTcpServer>
+#include <QTcpSocket>
 
 // qt-plus
 #include "CLogger.h"
+#include "geotrans.h"
+#include "geocent.h"
 
 // Quick3D
 #include "CComponentFactory.h"
 #include "CCamera.h"
 #include "CGeoTree.h"
 #include "CWaypoint.h"
+#include "CSRTMField.h"
+#include "CRenderVertex.h"
+#include "CTerrainTopology.h"
+#include "CCollisionBroadphase.h"
+#include "CWGS84.h"
+#include "C3DScene.h"
+#include "CSimulationScheduler.h"
+#include "CBoundedMeshInstances.h"
+#include "CTileStore.h"
+#include "CHTTPMapClient.h"
+#include "CFrameStreamer.h"
 
 // Application
 #include "CUnitTests.h"
@@ -186,4 +206,645 @@ void CUnitTests::run()
     gGeoloc = CGeoloc(gRef, CVector3(vPoint.X * dFactor, vPoint.Y * dFactor, vPoint.Z * dFactor));
 
     qDebug() << "For " << gRef.toString() << " and " << vPoint.toString() << " : " << gGeoloc.toString();
+
+    qDebug() << "--------------------------------------------------";
+    qDebug() << "Testing CHeightField::getHeightsAt()";
+
+    {
+        int iCells = 101;
+        QVector<qint16> vGrid(iCells * iCells);
+
+        for (int iIndex = 0; iIndex < vGrid.count(); iIndex++)
+        {
+            vGrid[iIndex] = (qint16) ((iIndex * 7919) % 3000) - 200;
+        }
+
+        CSRTMField tField(CXMLNode(), "./NoSRTM");
+        tField.addChunk(new CSRTMData(CGeoloc(45.0, 5.0, 0.0), CGeoloc(1.0, 1.0, 0.0), iCells, iCells, -9999, vGrid.constData()));
+        tField.addChunk(new CSRTMData(CGeoloc(45.0, 6.0, 0.0), CGeoloc(1.0, 1.0, 0.0), iCells, iCells, -9999, vGrid.constData()));
+
+        QVector<CGeoloc> vPositions;
+
+        for (int iLat = 0; iLat < 81; iLat++)
+        {
+            for (int iLon = 0; iLon < 81; iLon++)
+            {
+                vPositions << CGeoloc(45.01 + iLat * 0.0121, 5.5 + iLon * 0.0123, 0.0);
+            }
+        }
+
+        vPositions << CGeoloc(10.0, 10.0, 0.0);
+
+        QVector<double> vHeights(vPositions.count());
+        tField.getHeightsAt(vPositions.constData(), vHeights.data(), vPositions.count());
+
+        double dMaxError = 0.0;
+
+        for (int iIndex = 0; iIndex < vPositions.count(); iIndex++)
+        {
+            dMaxError = qMax(dMaxError, fabs(vHeights[iIndex] - tField.getHeightAt(vPositions[iIndex])));
+        }
+
+        qDebug() << "Samples =" << vPositions.count() << ", max error =" << dMaxError;
+    }
+
+    qDebug() << "--------------------------------------------------";
+    qDebug() << "Testing CRenderVertex encodings";
+
+    {
+        double dMaxAngleError = 0.0;
+
+        for (int iLat = -90; iLat <= 90; iLat += 5)
+        {
+            for (int iLon = -180; iLon < 180; iLon += 5)
+            {
+                CVector3 vDirection = CGeoloc((double) iLat, (double) iLon, 0.0).toVector3().normalized();
+
+                qint16 iEncoded[2];
+                CRenderVertex::encodeOctahedral(vDirection, iEncoded);
+                CVector3 vDecoded = CRenderVertex::decodeOctahedral(iEncoded);
+
+                dMaxAngleError = qMax(dMaxAngleError, acos(qMin(1.0, vDirection.dot(vDecoded))));
+            }
+        }
+
+        qDebug() << "Octahedral max angle error (degrees) =" << Angles::toDeg(dMaxAngleError);
+
+        double dMaxHalfError = 0.0;
+
+        for (int iIndex = 0; iIndex <= 1000; iIndex++)
+        {
+            float fValue = (float) iIndex / 1000.0f;
+            float fDecoded = CRenderVertex::halfToFloat(CRenderVertex::floatToHalf(fValue));
+
+            dMaxHalfError = qMax(dMaxHalfError, (double) fabs(fDecoded - fValue));
+        }
+
+        qDebug() << "Half float max error in [0, 1] =" << dMaxHalfError;
+    }
+
+    qDebug() << "--------------------------------------------------";
+    qDebug() << "Testing CTerrainTopology";
+
+    {
+        CTerrainTopology tTopology(pScene, 31, true);
+
+        const QVector<GLuint>& vIndices = tTopology.indices()->indices();
+
+        // With a consistent winding, each directed edge is used once
+        QSet<QPair<GLuint, GLuint> > sEdges;
+        int iDuplicateEdges = 0;
+
+        for (int iIndex = 0; iIndex + 2 < vIndices.count(); iIndex += 3)
+        {
+            for (int iCorner = 0; iCorner < 3; iCorner++)
+            {
+                QPair<GLuint, GLuint> pEdge(vIndices[iIndex + iCorner], vIndices[iIndex + (iCorner + 1) % 3]);
+
+                if (sEdges.contains(pEdge))
+                {
+                    iDuplicateEdges++;
+                }
+
+                sEdges.insert(pEdge);
+            }
+        }
+
+        qDebug() << "Vertices =" << tTopology.vertexCount() << ", triangles =" << vIndices.count() / 3 << ", duplicate edges =" << iDuplicateEdges;
+    }
+
+    qDebug() << "--------------------------------------------------";
+    qDebug() << "Testing CCollisionBroadphase";
+
+    {
+        CCollisionBroadphase tBroadphase;
+
+        qsrand(1234);
+
+        // Vehicles scattered around a point on the ground, one in four parked
+        for (int iIndex = 0; iIndex < 500; iIndex++)
+        {
+            CGeoloc gVehicle(
+                        45.0 + 0.02 * (double) qrand() / (double) RAND_MAX,
+                        5.0 + 0.02 * (double) qrand() / (double) RAND_MAX,
+                        0.0
+                        );
+
+            tBroadphase.addProxy(CCollisionProxy(nullptr, gVehicle.toVector3(), 5.0 + (double) (iIndex % 20), iIndex % 4 != 0));
+        }
+
+        tBroadphase.computePairs();
+        tBroadphase.computeHits();
+
+        QSet<QPair<int, int> > sHits;
+
+        foreach (const CCollisionPair& tPair, tBroadphase.pairs())
+        {
+            if (tPair.m_bHit)
+            {
+                sHits.insert(QPair<int, int>(tPair.m_iFirst, tPair.m_iSecond));
+            }
+        }
+
+        // Compare with all pairs
+        const QVector<CCollisionProxy>& vProxies = tBroadphase.proxies();
+        int iExpectedHits = 0;
+        int iMissedHits = 0;
+
+        for (int iFirst = 0; iFirst < vProxies.count(); iFirst++)
+        {
+            for (int iSecond = iFirst + 1; iSecond < vProxies.count(); iSecond++)
+            {
+                if (
+                        (vProxies[iFirst].m_bMoving || vProxies[iSecond].m_bMoving) &&
+                        (vProxies[iFirst].m_vPosition - vProxies[iSecond].m_vPosition).magnitude() < vProxies[iFirst].m_dRadius + vProxies[iSecond].m_dRadius
+                        )
+                {
+                    iExpectedHits++;
+
+                    if (sHits.contains(QPair<int, int>(iFirst, iSecond)) == false)
+                    {
+                        iMissedHits++;
+                    }
+                }
+            }
+        }
+
+        qDebug() << "Pairs =" << tBroadphase.pairs().count() << ", hits =" << sHits.count() << ", expected hits =" << iExpectedHits << ", missed hits =" << iMissedHits;
+    }
+
+    qDebug() << "--------------------------------------------------";
+    qDebug() << "Testing CWGS84 against GeoTrans";
+
+    {
+        QVector<CGeoloc> vGeolocs;
+
+        qsrand(1234);
+
+        for (int iIndex = 0; iIndex < 10000; iIndex++)
+        {
+            vGeolocs << CGeoloc(
+                            -90.0 + 180.0 * (double) qrand() / (double) RAND_MAX,
+                            -180.0 + 360.0 * (double) qrand() / (double) RAND_MAX,
+                            -500.0 + 20000.0 * (double) qrand() / (double) RAND_MAX
+                            );
+        }
+
+        QVector<CVector3> vBatch(vGeolocs.count());
+        CGeoloc::toVector3(vGeolocs.constData(), vBatch.data(), vGeolocs.count());
+
+        double dMaxPositionError = 0.0;
+        double dMaxBatchError = 0.0;
+        double dMaxAngleError = 0.0;
+        double dMaxAltitudeError = 0.0;
+
+        for (int iIndex = 0; iIndex < vGeolocs.count(); iIndex++)
+        {
+            const CGeoloc& gGeoloc = vGeolocs[iIndex];
+
+            // GeoTrans axes are X to longitude 0, Y to longitude 90, Z to the north pole
+            double dX, dY, dZ;
+
+            Convert_Geodetic_To_Geocentric(
+                        gGeoloc.Latitude * GeoTrans::fDeg2Rad,
+                        gGeoloc.Longitude * GeoTrans::fDeg2Rad,
+                        gGeoloc.Altitude,
+                        &dX, &dY, &dZ
+                        );
+
+            CVector3 vExpected(dY, dZ, -dX);
+            CVector3 vPosition = gGeoloc.toVector3();
+
+            dMaxPositionError = qMax(dMaxPositionError, (vPosition - vExpected).magnitude());
+            dMaxBatchError = qMax(dMaxBatchError, (vBatch[iIndex] - vExpected).magnitude());
+
+            double dLatitude, dLongitude, dAltitude;
+
+            Convert_Geocentric_To_Geodetic(dX, dY, dZ, &dLatitude, &dLongitude, &dAltitude);
+
+            CGeoloc gBack(vPosition);
+
+            dMaxAngleError = qMax(dMaxAngleError, fabs(gBack.Latitude - dLatitude * GeoTrans::fRad2Deg));
+            dMaxAngleError = qMax(dMaxAngleError, fabs(Angles::angleDifferenceDegree(gBack.Longitude, dLongitude * GeoTrans::fRad2Deg)));
+            dMaxAltitudeError = qMax(dMaxAltitudeError, fabs(gBack.Altitude - dAltitude));
+        }
+
+        qDebug() << "Max position error =" << dMaxPositionError << "m, batch =" << dMaxBatchError << "m";
+        qDebug() << "Max inverse error =" << dMaxAngleError << "degrees," << dMaxAltitudeError << "m";
+
+        // Reference relative conversion must go back and forth
+        CGeoloc gReference(45.0, 5.0, 1000.0);
+        double dMaxRoundTripError = 0.0;
+
+        for (int iIndex = 0; iIndex < 100; iIndex++)
+        {
+            CGeoloc gGeoloc(gReference.Latitude + vGeolocs[iIndex].Latitude / 180.0, gReference.Longitude + vGeolocs[iIndex].Longitude / 360.0, vGeolocs[iIndex].Altitude);
+            CGeoloc gBack(gReference, gGeoloc.toVector3(gReference));
+
+            dMaxRoundTripError = qMax(dMaxRoundTripError, (gBack.toVector3() - gGeoloc.toVector3()).magnitude());
+        }
+
+        qDebug() << "Max relative round trip error =" << dMaxRoundTripError << "m";
+    }
+
+    qDebug() << "--------------------------------------------------";
+    qDebug() << "Testing CSimulationScheduler";
+
+    {
+        C3DScene* pScene = new C3DScene(false);
+        pScene->setSimulationRate(50.0);
+
+        CSimulationScheduler* pScheduler = pScene->simulationScheduler();
+
+        // Two seconds of irregular frames give the same steps as two seconds of regular ones
+        qsrand(1234);
+
+        double dElapsedS = 0.0;
+
+        while (dElapsedS < 2.0)
+        {
+            double dFrameS = qMin(0.005 + 0.045 * (double) qrand() / (double) RAND_MAX, 2.0 - dElapsedS);
+
+            pScheduler->advance(dFrameS);
+            dElapsedS += dFrameS;
+        }
+
+        qint64 iSteps = pScheduler->stepCount();
+
+        // A one second hitch is caught up to the limit only
+        int iHitchSteps = pScheduler->advance(1.0);
+
+        qDebug() << "Steps in 2 s =" << iSteps << ", expected 100 (99 if the last one is not due yet)";
+        qDebug() << "Steps after a 1 s hitch =" << iHitchSteps << ", dropped =" << pScheduler->droppedStepCount();
+
+        // Interpolated transforms match their ends
+        CMatrix4 mFrom = CMatrix4::makeRotation(CVector3(0.1, 0.2, 0.3)) * CMatrix4::makeTranslation(CVector3(10.0, 20.0, 30.0));
+        CMatrix4 mTo = CMatrix4::makeRotation(CVector3(0.11, 0.21, 0.31)) * CMatrix4::makeTranslation(CVector3(11.0, 21.0, 31.0));
+        CMatrix4 mHalf = CMatrix4::interpolate(mFrom, mTo, 0.5);
+
+        double dMaxEndError = 0.0;
+
+        for (int iRow = 0; iRow < 4; iRow++)
+        {
+            for (int iColumn = 0; iColumn < 4; iColumn++)
+            {
+                dMaxEndError = qMax(dMaxEndError, fabs(CMatrix4::interpolate(mFrom, mTo, 0.0).Data[iRow][iColumn] - mFrom.Data[iRow][iColumn]));
+                dMaxEndError = qMax(dMaxEndError, fabs(CMatrix4::interpolate(mFrom, mTo, 1.0).Data[iRow][iColumn] - mTo.Data[iRow][iColumn]));
+            }
+        }
+
+        qDebug() << "Interpolation end error =" << dMaxEndError << ", half way position =" << (mHalf * CVector3()).toString();
+
+        delete pScene;
+    }
+
+    qDebug() << "--------------------------------------------------";
+    qDebug() << "Testing CComponent::computeWorldTransform()";
+
+    {
+        C3DScene* pScene = new C3DScene(false);
+
+        QSP<CComponent> pParent = QSP<CComponent>(new CComponent(pScene));
+        QSP<CComponent> pChild = QSP<CComponent>(new CComponent(pScene));
+
+        pParent->setName("Parent");
+        pChild->setName("Child");
+        pChild->setParent(pParent);
+
+        pParent->setGeoloc(CGeoloc(45.0, 5.0, 100.0));
+        pParent->setRotation(CVector3(0.1, 0.2, 0.3));
+        pChild->setPosition(CVector3(1.0, 2.0, 3.0));
+        pChild->setAnimRotation(CVector3(0.0, 0.5, 0.0));
+
+        // The transform built from scratch, as before it was cached
+        auto referenceTransform = [&pParent, &pChild]()
+        {
+            CMatrix4 mTransform;
+
+            mTransform = mTransform * CMatrix4::makeRotation(pChild->animRotation());
+            mTransform = mTransform * CMatrix4::makeRotation(pChild->ECEFRotation());
+            mTransform = mTransform * CMatrix4::makeTranslation(pChild->animPosition());
+            mTransform = mTransform * CMatrix4::makeTranslation(pChild->position());
+
+            return mTransform * pParent->worldTransform();
+        };
+
+        auto maxDifference = [](const CMatrix4& m1, const CMatrix4& m2)
+        {
+            double dMax = 0.0;
+
+            for (int iRow = 0; iRow < 4; iRow++)
+            {
+                for (int iColumn = 0; iColumn < 4; iColumn++)
+                {
+                    dMax = qMax(dMax, fabs(m1.Data[iRow][iColumn] - m2.Data[iRow][iColumn]));
+                }
+            }
+
+            return dMax;
+        };
+
+        pParent->computeWorldTransform();
+        pChild->computeWorldTransform();
+
+        double dFirstError = maxDifference(pChild->worldTransform(), referenceTransform());
+
+        // Moving the parent alone must reach the child
+        pParent->setRotation(CVector3(0.2, 0.2, 0.3));
+        pParent->computeWorldTransform();
+        pChild->computeWorldTransform();
+
+        double dParentMovedError = maxDifference(pChild->worldTransform(), referenceTransform());
+
+        // The rigid inverse undoes the transform
+        CVector3 vLocal(10.0, -20.0, 30.0);
+        double dInverseError = (pChild->worldTransformInverse() * (pChild->worldTransform() * vLocal) - vLocal).magnitude();
+
+        qDebug() << "Transform error =" << dFirstError << ", after parent moved =" << dParentMovedError << ", expected 0";
+        qDebug() << "Inverse round trip error =" << dInverseError << "m";
+
+        // Break the parent / child reference cycle
+        pParent->clearLinks(pScene);
+        delete pScene;
+    }
+
+    qDebug() << "--------------------------------------------------";
+    qDebug() << "Testing CBoundedMeshInstances::buildInstances()";
+
+    {
+        C3DScene* pScene = new C3DScene(false);
+
+        QVector<QSP<CMesh> > vLODs;
+        vLODs.append(QSP<CMesh>(new CMesh(pScene, 100.0)));
+        vLODs.append(QSP<CMesh>(new CMesh(pScene, 1000.0)));
+
+        CMeshInstance* pSource = new CMeshInstance(vLODs);
+
+        CVector3 vCenter = CGeoloc(45.0, 5.0, 0.0).toVector3();
+
+        CBoundedMeshInstances* pBounded = new CBoundedMeshInstances(pScene);
+        pBounded->setBounds(CBoundingBox(vCenter - CVector3(500.0, 500.0, 500.0), vCenter + CVector3(500.0, 500.0, 500.0)));
+
+        // Trees placed like CVegetationGenerator does
+        qsrand(4321);
+
+        for (int iIndex = 0; iIndex < 500; iIndex++)
+        {
+            CMeshInstance* pInstance = pSource->clone();
+
+            pInstance->setGeoloc(CGeoloc(
+                                     45.0 + ((double) qrand() / (double) RAND_MAX - 0.5) * 0.008,
+                                     5.0 + ((double) qrand() / (double) RAND_MAX - 0.5) * 0.008,
+                                     0.0
+                                     ));
+            pInstance->setRotation(CVector3(0.0, ((double) qrand() / (double) RAND_MAX) * Math::Pi * 2.0, 0.0));
+            pInstance->computeWorldTransform();
+
+            pBounded->add(pInstance);
+        }
+
+        pBounded->buildInstances();
+
+        // With the world origin at the center of the bounds, the base matrix is the identity
+        // and each instance transform must place points where the world transform of the instance does
+        double dMaxError = 0.0;
+        double dSortedStep = 0.0;
+        double dUnsortedStep = 0.0;
+        int iNumInstances = 0;
+
+        foreach (CMeshInstanceGroup* pGroup, pBounded->instanceGroups())
+        {
+            for (int iInstance = 0; iInstance < pGroup->m_vInstances.count(); iInstance++)
+            {
+                CMeshInstance* pInstance = pGroup->m_vInstances[iInstance];
+                CVector3 vPosition = pInstance->worldPosition();
+
+                QMatrix4x4 mInstance = QMatrix4x4(pGroup->m_vTransforms.constData() + iInstance * 16).transposed();
+
+                // Points off every axis, a wrong rotation order moves them
+                CVector3 vLocalPoints[3] = { CVector3(1.0, 2.0, 3.0), CVector3(-4.0, 0.5, 2.0), CVector3(3.0, -2.0, -5.0) };
+
+                for (int iPoint = 0; iPoint < 3; iPoint++)
+                {
+                    CVector3 vExpected = (pInstance->worldTransform() * vLocalPoints[iPoint]) - vCenter;
+                    QVector3D vMapped = mInstance.map(QVector3D(vLocalPoints[iPoint].X, vLocalPoints[iPoint].Y, vLocalPoints[iPoint].Z));
+
+                    dMaxError = qMax(dMaxError, (CVector3(vMapped.x(), vMapped.y(), vMapped.z()) - vExpected).magnitude());
+                }
+
+                if (iInstance > 0)
+                {
+                    dSortedStep += (vPosition - pGroup->m_vInstances[iInstance - 1]->worldPosition()).magnitude();
+                }
+            }
+
+            iNumInstances += pGroup->m_vInstances.count();
+        }
+
+        for (int iIndex = 1; iIndex < pBounded->meshes().count(); iIndex++)
+        {
+            dUnsortedStep += (pBounded->meshes()[iIndex]->worldPosition() - pBounded->meshes()[iIndex - 1]->worldPosition()).magnitude();
+        }
+
+        qDebug() << "Groups =" << pBounded->instanceGroups().count() << ", instances =" << iNumInstances << ", expected 1 and 500";
+        qDebug() << "Transform error =" << dMaxError << "m, expected below 0.001";
+        qDebug() << "Mean step between instances =" << dSortedStep / (iNumInstances - 1) << "m, unsorted =" << dUnsortedStep / (iNumInstances - 1) << "m";
+
+        delete pBounded;
+        delete pSource;
+        vLODs.clear();
+        delete pScene;
+    }
+
+    qDebug() << "--------------------------------------------------";
+    qDebug() << "Testing CTileStore";
+
+    {
+        QString sPath = QDir::tempPath() + "/Quick3DTileStoreTest";
+        QDir(sPath).removeRecursively();
+        QDir().mkpath(sPath);
+
+        // A tile left as a loose file by an older version
+        QFile fLoose(sPath + "/a0.jpg");
+        fLoose.open(QIODevice::WriteOnly);
+        fLoose.write("loose");
+        fLoose.close();
+
+        {
+            CTileStore tStore;
+            tStore.open(sPath);
+            tStore.write("a1", "first");
+            tStore.write("a2", "second");
+            tStore.write("a1", "replaced");
+        }
+
+        // A record cut by a crash
+        QFile fIndex(sPath + "/" + TILE_STORE_INDEX_FILE);
+        fIndex.open(QIODevice::Append);
+        fIndex.write("\x00\x00\x00", 3);
+        fIndex.close();
+
+        CTileStore tStore;
+        tStore.open(sPath);
+
+        qDebug() << "Tiles =" << tStore.count() << ", expected 3";
+        qDebug() << "a0 =" << tStore.read("a0") << ", a1 =" << tStore.read("a1") << ", a2 =" << tStore.read("a2") << ", expected loose, replaced, second";
+        qDebug() << "Loose file left =" << QFile::exists(sPath + "/a0.jpg") << ", expected false";
+
+        tStore.close();
+        QDir(sPath).removeRecursively();
+    }
+
+    qDebug() << "--------------------------------------------------";
+    qDebug() << "Testing CHTTPMapClient";
+
+    {
+        QByteArray baTile;
+        QBuffer bTile(&baTile);
+        QImage imgTile(256, 256, QImage::Format_RGB888);
+        imgTile.fill(Qt::green);
+        bTile.open(QIODevice::WriteOnly);
+        imgTile.save(&bTile, "JPG");
+
+        // A stand-in tile server, answering each request after a delay
+        QTcpServer tServer;
+        tServer.listen(QHostAddress::LocalHost);
+
+        QStringList lRequested;
+        int iInProgress = 0;
+        int iMaxInProgress = 0;
+
+        QObject::connect(&tServer, &QTcpServer::newConnection, [&]()
+        {
+            while (tServer.hasPendingConnections())
+            {
+                QTcpSocket* pSocket = tServer.nextPendingConnection();
+
+                QObject::connect(pSocket, &QTcpSocket::disconnected, pSocket, &QObject::deleteLater);
+                QObject::connect(pSocket, &QTcpSocket::readyRead, [&, pSocket]()
+                {
+                    if (pSocket->property("Answered").toBool() || pSocket->canReadLine() == false)
+                    {
+                        return;
+                    }
+
+                    pSocket->setProperty("Answered", true);
+
+                    // GET /name.jpg HTTP/1.1
+                    QString sRequest = QString(pSocket->readLine());
+                    lRequested.append(QFileInfo(sRequest.split(' ')[1]).completeBaseName());
+
+                    iInProgress++;
+                    iMaxInProgress = qMax(iMaxInProgress, iInProgress);
+
+                    QTimer::singleShot(50, pSocket, [&, pSocket]()
+                    {
+                        iInProgress--;
+
+                        pSocket->write(QString("HTTP/1.1 200 OK\r\nContent-Type: image/jpeg\r\nContent-Length: %1\r\nConnection: close\r\n\r\n").arg(baTile.count()).toLatin1());
+                        pSocket->write(baTile);
+                        pSocket->disconnectFromHost();
+                    });
+                });
+            }
+        });
+
+        QString sPath = QDir::tempPath() + "/Quick3DMapClientTest";
+        QDir(sPath).removeRecursively();
+
+        CHTTPMapClient* pClient = new CHTTPMapClient();
+        pClient->setTilePath(sPath);
+        pClient->setServerURL(QString("http://127.0.0.1:%1/").arg(tServer.serverPort()) + "%1.jpg");
+        pClient->setMaxConnections(3);
+
+        QEventLoop tLoop;
+        QStringList lReady;
+        int iValidImages = 0;
+
+        QObject::connect(pClient, &CHTTPMapClient::tileReady, [&](QString sTileName)
+        {
+            lReady.append(sTileName);
+
+            if (pClient->getTile(sTileName).size() == QSize(256, 256))
+            {
+                iValidImages++;
+            }
+
+            if (lReady.count() == 11)
+            {
+                tLoop.quit();
+            }
+        });
+
+        // Requested from worst to best priority, the worst one is cancelled
+        QStringList lExpected;  // Best priority first
+
+        for (int iIndex = 0; iIndex < 12; iIndex++)
+        {
+            QString sTileName = QString("t%1").arg(iIndex, 2, 10, QChar('0'));
+
+            pClient->loadTile(sTileName, (double) (12 - iIndex));
+
+            if (iIndex > 0)
+            {
+                lExpected.prepend(sTileName);
+            }
+        }
+
+        pClient->cancelTile("t00");
+
+        QTimer::singleShot(10000, &tLoop, SLOT(quit()));
+        tLoop.exec();
+
+        qDebug() << "Tiles ready =" << lReady.count() << ", valid images =" << iValidImages << ", expected 11";
+        // The first requests run in parallel, so their order on arrival is not fixed
+        qDebug() << "First requests are the best ones =" << (lRequested.mid(0, 3).toSet() == lExpected.mid(0, 3).toSet()) << ", expected true";
+        qDebug() << "Cancelled tile requested =" << lRequested.contains("t00") << ", expected false";
+        qDebug() << "Maximum requests in progress =" << iMaxInProgress << ", expected 3";
+
+        // Tiles come from the store afterwards, without a request
+        lReady.clear();
+        pClient->loadTile("t05");
+
+        QTimer::singleShot(2000, &tLoop, SLOT(quit()));
+        tLoop.exec();
+
+        qDebug() << "Stored tiles =" << pClient->store().count() << ", server requests =" << lRequested.count() << ", expected 11 and 11";
+
+        // Clients of the same path append to one store
+        CHTTPMapClient* pOtherClient = new CHTTPMapClient();
+        pOtherClient->setTilePath(sPath + "/");
+
+        qDebug() << "Store shared =" << (&pOtherClient->store() == &pClient->store()) << ", expected true";
+
+        delete pOtherClient;
+        delete pClient;
+        QDir(sPath).removeRecursively();
+    }
+
+    qDebug() << "--------------------------------------------------";
+    qDebug() << "Testing CFrameStreamer";
+
+    {
+        CFrameStreamer* pStreamer = new CFrameStreamer(6699);
+        QImage imgFrame(640, 480, QImage::Format_RGB32);
+        imgFrame.fill(Qt::darkGray);
+
+        // Submitted faster than encoded, the waiting frames are replaced
+        for (int iIndex = 0; iIndex < 20; iIndex++)
+        {
+            pStreamer->submit(imgFrame);
+        }
+
+        for (int iWait = 0; iWait < 200 && pStreamer->sentCount() + pStreamer->droppedCount() < 20; iWait++)
+        {
+            QThread::msleep(10);
+        }
+
+        qDebug() << "Sent + dropped frames =" << pStreamer->sentCount() + pStreamer->droppedCount() << ", expected 20";
+        qDebug() << "Dropped frames =" << pStreamer->droppedCount() << ", expected at most" << 20 - FRAME_STREAMER_QUEUE_SIZE;
+        qDebug() << "Frames sent =" << (pStreamer->sentCount() >= FRAME_STREAMER_QUEUE_SIZE) << ", expected true";
+
+        delete pStreamer;
+    }
 }
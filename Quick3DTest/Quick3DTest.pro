@@ -15,6 +15,7 @@ TEMPLATE = app
 # Dependencies
 INCLUDEPATH += $$PWD/../qt-plus/source/cpp
 INCLUDEPATH += $$PWD/../qt-plus/source/cpp/Web
+INCLUDEPATH += $$PWD/../qt-plus/source/cpp/GeoTools
 INCLUDEPATH += $$PWD/../Quick3D/Source
 INCLUDEPATH += $$PWD/../Quick3D/Source/Animation
 INCLUDEPATH += $$PWD/../Quick3D/Source/Base
@@ -64,11 +65,13 @@ CONFIG(debug, debug|release) {
 SOURCES += \
     Quick3DTest.cpp \
     CUnitTests.cpp \
+    CBenchmarks.cpp \
     main.cpp
 
 HEADERS  += \
     Quick3DTest.h \
-    CUnitTests.h
+    CUnitTests.h \
+    CBenchmarks.h
 
 RESOURCES += \
     Quick3DTest.qrc
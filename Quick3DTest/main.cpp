@@ -13,6 +13,8 @@
 // Application
 #include "Quick3DTest.h"
 #include "CUnitTests.h"
+#include "CBenchmarks.h"
+#include "CQuick3DUtilities.h"
 
 #ifdef USE_VLD
 #include <vld.h>
@@ -21,6 +23,8 @@
 static const char* sArg_Help        = "--help";         // Affiche l'aide
 static const char* sArg_Scene       = "--scene";        // Nom de la scne
 static const char* sArg_UnitTests   = "--unit-tests";   // Unit tests mode
+static const char* sArg_Benchmarks  = "--benchmarks";   // Benchmarks mode
+static const char* sArg_DepthMatrix = "--depth-matrix"; // Offscreen depth matrix mode
 
 static void printUsage()
 {
@@ -35,6 +39,50 @@ static void printUsage()
     sOut << "  " << sArg_Help << ": shows this help\n";
     sOut << "  " << sArg_Scene << ": specify startup scene\n";
     sOut << "  " << sArg_UnitTests << ": runs unit tests\n";
+    sOut << "  " << sArg_Benchmarks << ": runs benchmarks\n";
+    sOut << "  " << sArg_DepthMatrix << " <SRTM path> <latitude> <longitude> <height> <image file>"
+         << ": renders the depth matrix seen from height meters above the ground, without a display, and saves its image\n";
+}
+
+// Renders a full sphere depth matrix with an offscreen scene, arguments follow sArg_DepthMatrix in lArgList
+static int renderDepthMatrix(const QStringList& lArgList)
+{
+    int iIndexArg = lArgList.indexOf(sArg_DepthMatrix) + 1;
+
+    if (iIndexArg + 5 > lArgList.count())
+    {
+        printUsage();
+        return 1;
+    }
+
+    QVector<CGeoZone> vZones;
+    QVector<double> vDepth;
+    QVector<char> vDetection;
+    QVector<char> vEdges;
+    QImage imgDepthImage;
+    QImage imgDetectionImage;
+    QImage imgContourImage;
+
+    CPanoramicMatrixParams tParams(vZones, vDepth, vDetection, vEdges, imgDepthImage, imgDetectionImage, imgContourImage);
+
+    tParams.m_sPathToSTRMData = lArgList[iIndexArg];
+    tParams.m_gCameraPosition = CGeoloc(lArgList[iIndexArg + 1].toDouble(), lArgList[iIndexArg + 2].toDouble(), lArgList[iIndexArg + 3].toDouble());
+    tParams.m_vStartPanTiltDegrees = Math::CVector2(-90.0, -180.0);
+    tParams.m_vEndPanTiltDegrees = Math::CVector2(90.0, 180.0);
+
+    CQuick3DUtilities::getInstance()->computeSphericalDetectionMatrices_CubeMapped(tParams, nullptr);
+    CQuick3DUtilities::getInstance()->computeMatrixImages(tParams);
+
+    // The offscreen scene must go before the application
+    CQuick3DUtilities::killInstance();
+
+    if (imgDepthImage.save(lArgList[iIndexArg + 4]) == false)
+    {
+        QTextStream(stderr) << "Could not save " << lArgList[iIndexArg + 4] << "\n";
+        return 1;
+    }
+
+    return 0;
 }
 
 int main(int argc, char *argv[])
@@ -57,9 +105,37 @@ int main(int argc, char *argv[])
     }
     else if (lArgList.contains(sArg_UnitTests))
     {
+        // Network tests need an event loop
+        QCoreApplication a(argc, argv);
+
         CUnitTests tests;
         tests.run();
     }
+    else if (lArgList.contains(sArg_Benchmarks))
+    {
+        // Offscreen rendering needs a platform plugin, by default one that does not open the display
+        if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        {
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        }
+
+        QApplication a(argc, argv);
+
+        CBenchmarks benchmarks;
+        benchmarks.run();
+    }
+    else if (lArgList.contains(sArg_DepthMatrix))
+    {
+        // Same platform as the benchmarks, matrices are computed on machines without a display
+        if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        {
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        }
+
+        QApplication a(argc, argv);
+
+        return renderDepthMatrix(lArgList);
+    }
     else
     {
         if (lArgList.contains(sArg_Scene))